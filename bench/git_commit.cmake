@@ -0,0 +1,21 @@
+# Writes OUTPUT defining QSPLOT_GIT_COMMIT as the short commit of SOURCE_DIR.
+# Run by the qsplot_git_commit target on every build, so the bench reports the
+# commit it was built from rather than the one CMake was configured at. The
+# header is only rewritten when the commit changes, so nothing else rebuilds.
+set(QSPLOT_GIT_COMMIT "")
+if(GIT_EXECUTABLE)
+    execute_process(
+        COMMAND ${GIT_EXECUTABLE} rev-parse --short HEAD
+        WORKING_DIRECTORY ${SOURCE_DIR}
+        OUTPUT_VARIABLE QSPLOT_GIT_COMMIT
+        OUTPUT_STRIP_TRAILING_WHITESPACE
+        ERROR_QUIET
+    )
+endif()
+if(NOT QSPLOT_GIT_COMMIT)
+    set(QSPLOT_GIT_COMMIT "unknown")
+endif()
+
+file(WRITE "${OUTPUT}.tmp" "#pragma once\n#define QSPLOT_GIT_COMMIT \"${QSPLOT_GIT_COMMIT}\"\n")
+configure_file("${OUTPUT}.tmp" "${OUTPUT}" COPYONLY)
+file(REMOVE "${OUTPUT}.tmp")
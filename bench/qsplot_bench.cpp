@@ -0,0 +1,741 @@
+// qsplot_bench: timings of the engine hot paths, written as JSON.
+//
+//   qsplot_bench [--quick] [--filter <substring>] [--no-render] [--out <file.json>]
+//                [--replay <session.qsr>]
+//
+// Each benchmark runs until it has at least kMinIterations samples and
+// kMinSeconds of measurement (after one warm-up run) and reports the median,
+// minimum and mean wall time. Throughput is items (points or rows) per second
+// at the median. The output goes to stdout unless --out is given; progress
+// goes to stderr. --replay also plays a recorded session (Renderer::startRecording)
+// into a headless renderer as fast as it is accepted, as a realistic load.
+
+#include "core/Clustering.h"
+#include "core/DataProcessor.h"
+#include "core/FeatureStore.h"
+#include "core/SessionLog.h"
+#include "core/SpatialIndex.h"
+#include "graphics/Renderer.h"
+#include "graphics/RendererConfig.h"
+#include "graphics/SelectionEngine.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstddef>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <functional>
+#include <iostream>
+#include <random>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#if __has_include("qsplot_git_commit.h")
+#include "qsplot_git_commit.h"  // Generated on every build (bench/git_commit.cmake)
+#endif
+#ifndef QSPLOT_GIT_COMMIT
+#define QSPLOT_GIT_COMMIT "unknown"
+#endif
+
+namespace {
+    constexpr int kMinIterations = 5;
+    constexpr double kMinSeconds = 0.5;
+    constexpr int kRenderFrames = 60;
+    constexpr int kViewportWidth = 1920, kViewportHeight = 1080;
+    constexpr int kSessionFrames = 8;  // Point sets per synthetic session
+
+#ifdef _WIN32
+    constexpr const char* kNullSink = "findstr \"^\" > NUL";
+#else
+    constexpr const char* kNullSink = "cat > /dev/null";
+#endif
+
+    using Clock = std::chrono::steady_clock;
+
+    struct Options {
+        bool quick = false;
+        bool render = true;
+        std::string filter;
+        std::string out;
+        std::string replay;
+    };
+
+    struct Result {
+        std::string name;
+        int iterations = 0;
+        double medianMs = 0.0, minMs = 0.0, meanMs = 0.0;
+        double items = 0.0;  // Per iteration
+        std::vector<std::pair<std::string, double>> extra;
+    };
+
+    std::vector<Result> g_results;
+    Options g_options;
+
+    bool selected(const std::string& name) {
+        return g_options.filter.empty() || name.find(g_options.filter) != std::string::npos;
+    }
+
+    Result summarize(const std::string& name, std::vector<double> samples, double items) {
+        Result r;
+        r.name = name;
+        r.items = items;
+        r.iterations = (int)samples.size();
+        if (samples.empty()) return r;
+        std::sort(samples.begin(), samples.end());
+        r.medianMs = samples[samples.size() / 2];
+        r.minMs = samples.front();
+        double sum = 0.0;
+        for (double s : samples) sum += s;
+        r.meanMs = sum / samples.size();
+        return r;
+    }
+
+    // fn runs once per sample; items is what one run processes. False if filtered out.
+    bool bench(const std::string& name, double items, const std::function<void()>& fn) {
+        if (!selected(name)) return false;
+        std::cerr << "[Bench] " << name << std::flush;
+
+        fn();  // Warm-up: first-touch allocations, thread pool start
+        std::vector<double> samples;
+        auto start = Clock::now();
+        while ((int)samples.size() < kMinIterations ||
+               std::chrono::duration<double>(Clock::now() - start).count() < kMinSeconds) {
+            auto t0 = Clock::now();
+            fn();
+            samples.push_back(std::chrono::duration<double, std::milli>(Clock::now() - t0).count());
+        }
+
+        g_results.push_back(summarize(name, std::move(samples), items));
+        std::cerr << ": " << g_results.back().medianMs << " ms" << std::endl;
+        return true;
+    }
+
+    std::vector<float> gaussian(size_t count, float scale, uint32_t seed) {
+        std::mt19937 rng(seed);
+        std::normal_distribution<float> dist(0.0f, scale);
+        std::vector<float> v(count);
+        for (auto& x : v) x = dist(rng);
+        return v;
+    }
+
+    std::vector<float> uniform(size_t count, uint32_t seed) {
+        std::mt19937 rng(seed);
+        std::uniform_real_distribution<float> dist(0.0f, 1.0f);
+        std::vector<float> v(count);
+        for (auto& x : v) x = dist(rng);
+        return v;
+    }
+
+    // Orthographic-like projection of [-10, 10]^3 onto the viewport, column-major
+    void fitViewProjection(float* m) {
+        std::fill(m, m + 16, 0.0f);
+        m[0] = m[5] = 0.1f;
+        m[10] = -0.1f;
+        m[15] = 1.0f;
+    }
+
+    // ---------------------------------------------------------------------
+    // DataProcessor
+    // ---------------------------------------------------------------------
+
+    void benchPca() {
+        std::vector<size_t> rows = g_options.quick ? std::vector<size_t>{ 10000, 100000 }
+                                                   : std::vector<size_t>{ 10000, 100000, 1000000 };
+        std::vector<int> dims = { 16, 64, 512 };
+
+        for (size_t n : rows) {
+            for (int d : dims) {
+                if ((double)n * d > 64e6) continue;  // Keep inputs under 256 MB
+                std::vector<float> data = gaussian(n * (size_t)d, 1.0f, 7);
+
+                DataProcessor::DataView view;
+                view.data = data.data();
+                view.type = DataProcessor::DataView::Type::Float32;
+                view.rows = (Eigen::Index)n;
+                view.cols = d;
+                view.rowStride = d;
+                view.colStride = 1;
+
+                DataProcessor processor;
+                processor.loadView(view);
+
+                const std::pair<const char*, DataProcessor::PcaSolver> solvers[] = {
+                    { "full", DataProcessor::PcaSolver::Full },
+                    { "randomized", DataProcessor::PcaSolver::Randomized },
+                };
+                for (const auto& [solverName, solver] : solvers) {
+                    std::string name = std::string("pca/") + solverName + "/n=" + std::to_string(n) +
+                                       "/d=" + std::to_string(d);
+                    bench(name, (double)n, [&] {
+                        Eigen::MatrixXd reduced = processor.computePCA(3, solver);
+                        if (reduced.rows() != (Eigen::Index)n) std::abort();
+                    });
+                }
+            }
+        }
+    }
+
+    void benchFeatureStats() {
+        std::vector<size_t> rows = g_options.quick ? std::vector<size_t>{ 1000000 }
+                                                   : std::vector<size_t>{ 1000000, 10000000 };
+        const int d = 16;
+        for (size_t n : rows) {
+            std::string name = "feature_stats/n=" + std::to_string(n) + "/d=" + std::to_string(d);
+            if (!selected(name)) continue;
+
+            std::vector<float> data = gaussian(n * (size_t)d, 1.0f, 9);
+            FeatureStore::View view;
+            view.data = data.data();
+            view.type = FeatureStore::View::Type::Float32;
+            view.rows = (Eigen::Index)n;
+            view.cols = d;
+            view.rowStride = d;
+            view.colStride = 1;
+            FeatureStore store(view);
+            bench(name, (double)n, [&] {
+                if (store.computeStats().size() != (size_t)d) std::abort();
+            });
+        }
+    }
+
+    // ---------------------------------------------------------------------
+    // Renderer staging (producer side, no render thread)
+    // ---------------------------------------------------------------------
+
+    std::vector<size_t> pointCounts() {
+        return g_options.quick ? std::vector<size_t>{ 1000000 } : std::vector<size_t>{ 1000000, 5000000, 20000000 };
+    }
+
+    void benchStaging() {
+        for (size_t n : pointCounts()) {
+            std::string name = "set_points/n=" + std::to_string(n);
+            if (!selected(name)) continue;
+
+            std::vector<float> positions = gaussian(n * 3, 3.0f, 11);
+            std::vector<float> values = uniform(n, 12);
+            Renderer renderer;  // Not started: commands apply in place
+            bench(name, (double)n, [&] {
+                renderer.setPoints(positions.data(), values.data(), n);
+            });
+            g_results.back().extra.push_back({ "bytes_per_iteration", (double)n * 16.0 });
+        }
+    }
+
+    // ---------------------------------------------------------------------
+    // Brush selection (CPU paths)
+    // ---------------------------------------------------------------------
+
+    void benchSelection() {
+        for (size_t n : pointCounts()) {
+            std::vector<float> positions = gaussian(n * 3, 3.0f, 21);
+
+            SelectionEngine::Query query;
+            fitViewProjection(query.viewProj);
+            query.viewportWidth = kViewportWidth;
+            query.viewportHeight = kViewportHeight;
+            query.current = { 0, 0, positions.data(), n };
+            query.next = query.current;
+
+            // Rectangles covering a quarter and all of the viewport
+            const std::pair<const char*, float> rects[] = { { "quarter", 0.5f }, { "full", 1.0f } };
+            for (const auto& [rectName, extent] : rects) {
+                float x0 = kViewportWidth * (0.5f - extent / 2), x1 = kViewportWidth * (0.5f + extent / 2);
+                float y0 = kViewportHeight * (0.5f - extent / 2), y1 = kViewportHeight * (0.5f + extent / 2);
+                query.brush = { x0, y0, x1, y0, x1, y1, x0, y1 };
+
+                size_t selectedCount = 0;
+                if (bench(std::string("select_rect/") + rectName + "/n=" + std::to_string(n), (double)n, [&] {
+                        selectedCount = SelectionEngine::selectCPU(query).size();
+                    })) {
+                    g_results.back().extra.push_back({ "selected", (double)selectedCount });
+                }
+            }
+
+            // Visible-only selection: a full-screen ID readback
+            std::vector<int> pixels((size_t)kViewportWidth * kViewportHeight);
+            std::mt19937 rng(22);
+            std::uniform_int_distribution<int> id(-1, (int)n - 1);
+            for (auto& p : pixels) p = id(rng);
+            query.brush = { 0.0f, 0.0f, (float)kViewportWidth, 0.0f,
+                            (float)kViewportWidth, (float)kViewportHeight, 0.0f, (float)kViewportHeight };
+            bench("select_visible/full/n=" + std::to_string(n), (double)pixels.size(), [&] {
+                SelectionEngine::collectVisibleCPU(query, pixels.data(), 0, 0, kViewportWidth, kViewportHeight);
+            });
+        }
+    }
+
+    // ---------------------------------------------------------------------
+    // Spatial index: build over a morph, then queries against it
+    // ---------------------------------------------------------------------
+
+    void benchSpatial() {
+        for (size_t n : pointCounts()) {
+            std::vector<float> positions = gaussian(n * 3, 3.0f, 41);
+            std::vector<float> target = gaussian(n * 3, 3.0f, 42);
+            SpatialIndex index;
+            bench("spatial_build/n=" + std::to_string(n), (double)n, [&] {
+                index.build(positions.data(), n, target.data(), n, 0.5f);
+            });
+            if (index.size() != n) continue;  // Filtered out
+
+            // Many small queries per sample, so the timing is not all clock overhead
+            constexpr int kQueries = 1000;
+            std::mt19937 rng(43);
+            std::uniform_int_distribution<int> id(0, (int)n - 1);
+            std::vector<int> ids(kQueries);
+            for (auto& i : ids) i = id(rng);
+            bench("spatial_knn/k=50/n=" + std::to_string(n), (double)kQueries, [&] {
+                for (int i : ids) {
+                    if (index.knn(index.position(i), 50, i).size() != 50) std::abort();
+                }
+            });
+            const float origin[3] = { 0.0f, 0.0f, -40.0f }, direction[3] = { 0.0f, 0.0f, 1.0f };
+            bench("spatial_ray/n=" + std::to_string(n), 1.0, [&] {
+                index.raycast(origin, direction, 0.025f, 0.0002f, [](int) { return true; });
+            });
+        }
+    }
+
+    // ---------------------------------------------------------------------
+    // Clustering: k-means fits (cold and warm-started) and kNN outlier scores
+    // ---------------------------------------------------------------------
+
+    void benchClustering() {
+        std::vector<size_t> rows = g_options.quick ? std::vector<size_t>{ 1000000 }
+                                                   : std::vector<size_t>{ 1000000, 5000000 };
+        const int d = 16;
+        for (size_t n : rows) {
+            std::string suffix = "/n=" + std::to_string(n) + "/d=" + std::to_string(d);
+            std::vector<float> data = gaussian(n * (size_t)d, 1.0f, 51);
+            FeatureStore::View view;
+            view.data = data.data();
+            view.type = FeatureStore::View::Type::Float32;
+            view.rows = (Eigen::Index)n;
+            view.cols = d;
+            view.rowStride = d;
+            view.colStride = 1;
+            FeatureStore store(view);
+
+            MiniBatchKMeans kmeans;
+            bench("kmeans_fit/cold" + suffix, (double)n, [&] {
+                kmeans.reset();
+                if (kmeans.fitPredict(store).size() != n) std::abort();
+            });
+            // The next frame of a series: starts from the fitted centroids
+            bench("kmeans_fit/warm" + suffix, (double)n, [&] {
+                if (kmeans.fitPredict(store).size() != n) std::abort();
+            });
+
+            std::vector<float> positions = gaussian(n * 3, 3.0f, 52);
+            bench("outlier_scores/k=10/n=" + std::to_string(n), (double)n, [&] {
+                if (knnOutlierScores(positions.data(), n, 10).size() != n) std::abort();
+            });
+        }
+    }
+
+    // ---------------------------------------------------------------------
+    // Session logs: a drifting point set, recorded and replayed
+    // ---------------------------------------------------------------------
+
+    void benchSession() {
+        std::vector<size_t> counts = g_options.quick ? std::vector<size_t>{ 1000000 }
+                                                     : std::vector<size_t>{ 1000000, 5000000 };
+        std::string path = (std::filesystem::temp_directory_path() / "qsplot_bench_session.qsr").string();
+        for (size_t n : counts) {
+            std::string suffix = "/n=" + std::to_string(n);
+            std::vector<float> positions = gaussian(n * 3, 3.0f, 61);
+            std::vector<float> velocity = gaussian(n * 3, 0.01f, 62);
+            std::vector<float> values = uniform(n, 63);
+
+            // Producer payloads, XOR deltas, byte planes, LZ, disk: kSessionFrames frames
+            SessionWriter::Stats stats;
+            bool written = bench("session_write" + suffix, (double)n * kSessionFrames, [&] {
+                std::unique_ptr<SessionWriter> writer = SessionWriter::open(path);
+                if (!writer) std::abort();
+                std::vector<float> frame(positions);
+                for (int f = 0; f < kSessionFrames; f++) {
+                    for (size_t i = 0; i < frame.size(); i++) frame[i] += velocity[i];
+                    SessionPayload payload;
+                    payload.put<uint64_t>(n);
+                    payload.put<uint8_t>(1);
+                    payload.put<uint8_t>(1);
+                    payload.putArray(frame.data(), frame.size());
+                    payload.putArray(values.data(), n);
+                    writer->write(SessionKind::Points, payload.take());
+                }
+                writer->close();
+                stats = writer->stats();
+                if (stats.failed) std::abort();
+            });
+            if (written && stats.storedBytes > 0) {
+                g_results.back().extra.push_back({ "compression_ratio", (double)stats.bytes / stats.storedBytes });
+            }
+
+            // Decoding and the setters, into a renderer that applies them in place
+            if (!written) continue;
+            bench("session_replay" + suffix, (double)n * kSessionFrames, [&] {
+                Renderer renderer;
+                if (renderer.replay(path, 0.0) != kSessionFrames) std::abort();
+            });
+        }
+        std::filesystem::remove(path);
+    }
+
+    // ---------------------------------------------------------------------
+    // Session log codec: round trips that must come back bit-exact (self-check)
+    // ---------------------------------------------------------------------
+
+    [[noreturn]] void roundtripFailed(const std::string& what) {
+        std::cerr << std::endl << "[Bench] ERROR: session_roundtrip: " << what << std::endl;
+        std::abort();
+    }
+
+    std::vector<uint8_t> randomBytes(size_t size, uint32_t seed) {
+        std::mt19937 rng(seed);
+        std::vector<uint8_t> v(size);
+        for (auto& b : v) b = (uint8_t)rng();
+        return v;
+    }
+
+    std::vector<uint8_t> bytesOf(const std::vector<float>& v, size_t tail) {
+        std::vector<uint8_t> out(v.size() * sizeof(float) + tail, 0xA5);
+        std::memcpy(out.data(), v.data(), v.size() * sizeof(float));
+        return out;
+    }
+
+    // The LZ stream alone: exact size in, nothing else accepted
+    void checkCompress(const std::string& what, const std::vector<uint8_t>& data) {
+        std::vector<uint8_t> stored, back(data.size() + 1);
+        SessionLog::compress(data.data(), data.size(), stored);
+        if (!SessionLog::decompress(stored.data(), stored.size(), back.data(), data.size()) ||
+            !std::equal(data.begin(), data.end(), back.begin())) {
+            roundtripFailed(what + ": LZ stream does not decode");
+        }
+        if (stored.size() > 1 && SessionLog::decompress(stored.data(), stored.size() - 1, back.data(), data.size())) {
+            roundtripFailed(what + ": truncated LZ stream accepted");
+        }
+        if (SessionLog::decompress(stored.data(), stored.size(), back.data(), data.size() + 1)) {
+            roundtripFailed(what + ": LZ stream decoded to the wrong size");
+        }
+    }
+
+    // A sequence of payloads of one kind, so the XOR delta chains across them
+    void checkCodec(const std::string& what, const std::vector<std::vector<uint8_t>>& payloads) {
+        SessionLog::History encoded, decoded;
+        std::vector<uint8_t> stored, back;
+        for (size_t i = 0; i < payloads.size(); i++) {
+            uint8_t codec = SessionLog::encode(SessionKind::Points, payloads[i], encoded, stored);
+            if (stored.size() > payloads[i].size()) roundtripFailed(what + ": stored more than the payload");
+            if (!SessionLog::decode(SessionKind::Points, codec, stored, payloads[i].size(), decoded, back) ||
+                back != payloads[i]) {
+                roundtripFailed(what + ": record " + std::to_string(i) + " does not decode");
+            }
+        }
+    }
+
+    std::vector<uint64_t> recordOffsets(const std::string& path) {
+        std::vector<uint64_t> offsets;
+        std::ifstream in(path, std::ios::binary);
+        uint64_t offset = sizeof(SessionLog::Header);
+        SessionLog::RecordHeader header;
+        while (in.seekg((std::streamoff)offset) && in.read(reinterpret_cast<char*>(&header), sizeof(header))) {
+            offsets.push_back(offset);
+            offset += sizeof(header) + header.storedSize;
+        }
+        return offsets;
+    }
+
+    void writeAll(const std::string& path, const std::vector<std::vector<uint8_t>>& payloads,
+                  const std::vector<SessionKind>& kinds) {
+        std::unique_ptr<SessionWriter> writer = SessionWriter::open(path);
+        if (!writer) roundtripFailed("session log cannot be created");
+        for (size_t i = 0; i < payloads.size(); i++) writer->write(kinds[i], payloads[i]);
+        writer->close();
+        if (writer->stats().failed || writer->stats().records != payloads.size()) {
+            roundtripFailed("session log was not written");
+        }
+    }
+
+    size_t readAll(const std::string& path, const std::vector<std::vector<uint8_t>>& expected,
+                   const std::vector<SessionKind>& kinds) {
+        std::unique_ptr<SessionReader> reader = SessionReader::open(path);
+        if (!reader) roundtripFailed("session log does not open");
+        SessionReader::Record record;
+        size_t count = 0;
+        while (reader->next(record)) {
+            if (count >= expected.size() || record.kind != kinds[count] || record.payload != expected[count]) {
+                roundtripFailed("record " + std::to_string(count) + " of the log differs");
+            }
+            count++;
+        }
+        return count;
+    }
+
+    // The file level: every record back, a truncated tail and a corrupt record end the log
+    void checkSessionFile(const std::string& path) {
+        std::vector<std::vector<uint8_t>> payloads;
+        std::vector<SessionKind> kinds;
+        std::vector<float> frame = gaussian(30001, 3.0f, 71);
+        std::vector<float> velocity = gaussian(frame.size(), 0.01f, 72);
+        for (int f = 0; f < 6; f++) {
+            for (size_t i = 0; i < frame.size(); i++) frame[i] += velocity[i];
+            payloads.push_back(bytesOf(frame, 0));
+            kinds.push_back(SessionKind::Points);
+            SessionPayload orbit;
+            orbit.put<float>(0.01f * f);
+            orbit.put<float>(-0.02f);
+            payloads.push_back(orbit.take());
+            kinds.push_back(SessionKind::CameraOrbit);
+        }
+        writeAll(path, payloads, kinds);
+        if (readAll(path, payloads, kinds) != payloads.size()) roundtripFailed("session log lost records");
+
+        // Corrupt codec bits of record 5: the four before it are read, then the log ends
+        std::vector<uint64_t> offsets = recordOffsets(path);
+        if (offsets.size() != payloads.size()) roundtripFailed("record headers do not chain");
+        {
+            std::fstream file(path, std::ios::in | std::ios::out | std::ios::binary);
+            file.seekp((std::streamoff)(offsets[5] + offsetof(SessionLog::RecordHeader, codec)));
+            char corrupt = (char)0x80;
+            file.write(&corrupt, 1);
+        }
+        if (readAll(path, payloads, kinds) != 5) roundtripFailed("corrupt record was not the end of the log");
+
+        // A crash in the middle of the last record: everything before it is read
+        writeAll(path, payloads, kinds);
+        std::filesystem::resize_file(path, std::filesystem::file_size(path) - 5);
+        if (readAll(path, payloads, kinds) != payloads.size() - 1) {
+            roundtripFailed("truncated tail was not the end of the log");
+        }
+    }
+
+    void benchSessionRoundtrip() {
+        std::vector<std::pair<std::string, std::vector<uint8_t>>> buffers;
+        for (size_t size : { 0, 1, 3, 255, 256, 257, 4099 }) {
+            buffers.push_back({ "random/" + std::to_string(size), randomBytes(size, 80 + (uint32_t)size) });
+        }
+        buffers.push_back({ "constant", std::vector<uint8_t>(100003, 0x5A) });
+        std::vector<uint8_t> periodic(70001);  // Matches longer than their 1-3 byte offsets
+        for (size_t i = 0; i < periodic.size(); i++) periodic[i] = "abc"[i % 3];
+        buffers.push_back({ "overlapping", periodic });
+        std::vector<uint8_t> far = randomBytes(200000, 81);  // Repeats past the 64 KB offset limit
+        std::copy(far.begin(), far.begin() + 1000, far.end() - 1000);
+        buffers.push_back({ "far repeat", far });
+
+        std::vector<float> drift = gaussian(50000, 3.0f, 82);
+        std::vector<float> velocity = gaussian(drift.size(), 0.01f, 83);
+        std::vector<std::vector<uint8_t>> frames, tails, sizes;
+        for (int f = 0; f < 4; f++) {
+            for (size_t i = 0; i < drift.size(); i++) drift[i] += velocity[i];
+            frames.push_back(bytesOf(drift, 0));
+            tails.push_back(bytesOf(drift, 3));              // size % 4 == 3: the tail stays in place
+            sizes.push_back(bytesOf(drift, (size_t)f % 4));  // Changing size: no delta between them
+        }
+        std::string path = (std::filesystem::temp_directory_path() / "qsplot_bench_roundtrip.qsr").string();
+
+        bench("session_roundtrip", (double)(frames.size() * frames[0].size()), [&] {
+            for (const auto& [what, data] : buffers) {
+                checkCompress(what, data);
+                checkCodec(what, { data, data });  // The second one as an all-zero delta
+            }
+            checkCodec("drifting frames", frames);
+            checkCodec("drifting frames with a tail", tails);
+            checkCodec("changing sizes", sizes);
+            checkSessionFile(path);
+        });
+        std::filesystem::remove(path);
+    }
+
+    // A recorded session into a running headless renderer, as fast as its queue takes it
+    void benchReplayFile(const std::string& path) {
+        std::string name = "session_replay/file";
+        if (!selected(name)) return;
+        std::cerr << "[Bench] " << name << std::flush;
+
+        RendererConfig config;
+        config.headless = true;
+        config.exitProcessOnClose = false;
+        config.vsync = false;
+        config.windowWidth = kViewportWidth;
+        config.windowHeight = kViewportHeight;
+
+        Renderer renderer(config);
+        renderer.start();
+        auto t0 = Clock::now();
+        long long records = renderer.replay(path, 0.0);
+        bool drawn = records >= 0 && renderer.fence()->wait(120.0) && renderer.isRunning();
+        double totalMs = std::chrono::duration<double, std::milli>(Clock::now() - t0).count();
+        Renderer::QueueStats queue = renderer.getQueueStats();
+        renderer.stop();
+        if (records < 0) {
+            std::cerr << ": failed (not a session log)" << std::endl;
+            return;
+        }
+        if (!drawn) {
+            std::cerr << ": skipped (no GL context)" << std::endl;
+            return;
+        }
+
+        Result r;
+        r.name = name;
+        r.iterations = 1;
+        r.medianMs = r.minMs = r.meanMs = totalMs;
+        r.items = (double)records;
+        r.extra.push_back({ "queue_max_depth", (double)queue.maxDepth });
+        r.extra.push_back({ "queue_stall_ms", queue.stallMs });
+        g_results.push_back(r);
+        std::cerr << ": " << records << " records in " << totalMs << " ms" << std::endl;
+    }
+
+    // ---------------------------------------------------------------------
+    // Headless frames: scene, readback and export into a null sink
+    // ---------------------------------------------------------------------
+
+    void benchRenderFrames(const std::string& name, size_t n, bool culling, bool pulling) {
+        if (!selected(name)) return;
+        std::cerr << "[Bench] " << name << std::flush;
+
+        RendererConfig config;
+        config.headless = true;
+        config.exitProcessOnClose = false;
+        config.vsync = false;
+        config.windowWidth = kViewportWidth;
+        config.windowHeight = kViewportHeight;
+        config.frustumCulling = culling;
+        config.vertexPulling = pulling;
+
+        std::vector<float> positions = gaussian(n * 3, 3.0f, 31);
+        std::vector<float> values = uniform(n, 32);
+        std::vector<float> target = gaussian(n * 3, 3.0f, 33);
+
+        Renderer renderer(config);
+        renderer.start();
+        renderer.setPoints(positions.data(), values.data(), n);
+        renderer.setTargetPoints(target.data(), values.data(), n);
+
+        // Each frame morphs a little, so nothing is cached between frames
+        auto batch = [&](int frames) {
+            std::vector<Renderer::FrameRequest> requests(frames);
+            for (int i = 0; i < frames; i++) requests[i].morphTime = (float)i / frames;
+            return renderer.renderFrames(std::move(requests), kNullSink) && renderer.waitForFrames(120.0);
+        };
+
+        if (!batch(5)) {
+            std::cerr << ": skipped (no GL context)" << std::endl;
+            renderer.stop();
+            return;
+        }
+        auto t0 = Clock::now();
+        bool ok = batch(kRenderFrames);
+        double totalMs = std::chrono::duration<double, std::milli>(Clock::now() - t0).count();
+
+        // Let the profiler publish the measured frames
+        std::this_thread::sleep_for(Profiler::kPublishInterval * 2);
+        auto perf = renderer.getPerfStats();
+        renderer.stop();
+        if (!ok) {
+            std::cerr << ": failed" << std::endl;
+            return;
+        }
+
+        Result r;
+        r.name = name;
+        r.iterations = kRenderFrames;
+        r.medianMs = r.minMs = r.meanMs = totalMs / kRenderFrames;  // Pipelined: throughput only
+        r.items = (double)n;
+        if (perf) {
+            for (const auto& s : perf->sections) {
+                std::string section = s.name;
+                if (section != "frame" && section != "scene" && section != "export") continue;
+                r.extra.push_back({ section + "_cpu_p50_ms", s.cpu.p50 });
+                if (s.gpu.samples > 0) r.extra.push_back({ section + "_gpu_p50_ms", s.gpu.p50 });
+            }
+        }
+        g_results.push_back(r);
+        std::cerr << ": " << r.meanMs << " ms/frame" << std::endl;
+    }
+
+    // Default pipeline, then the instanced and vertex-pulled draws of every point
+    void benchRender() {
+        for (size_t n : pointCounts()) {
+            std::string suffix = "n=" + std::to_string(n);
+            benchRenderFrames("render_frame/" + suffix, n, true, false);
+            benchRenderFrames("render_frame/instanced/" + suffix, n, false, false);
+            benchRenderFrames("render_frame/pulled/" + suffix, n, false, true);
+        }
+    }
+
+    // ---------------------------------------------------------------------
+    // Output
+    // ---------------------------------------------------------------------
+
+    std::string toJson() {
+        std::ostringstream o;
+        o.precision(6);
+        o << "{\n  \"context\": {\n";
+        o << "    \"commit\": \"" << QSPLOT_GIT_COMMIT << "\",\n";
+        o << "    \"threads\": " << std::thread::hardware_concurrency() << ",\n";
+        o << "    \"quick\": " << (g_options.quick ? "true" : "false") << "\n";
+        o << "  },\n  \"benchmarks\": [";
+        for (size_t i = 0; i < g_results.size(); i++) {
+            const Result& r = g_results[i];
+            o << (i ? ",\n" : "\n") << "    {\"name\": \"" << r.name << "\", \"iterations\": " << r.iterations
+              << ", \"median_ms\": " << r.medianMs << ", \"min_ms\": " << r.minMs << ", \"mean_ms\": " << r.meanMs;
+            if (r.medianMs > 0.0) o << ", \"items_per_second\": " << r.items / (r.medianMs / 1000.0);
+            for (const auto& [key, value] : r.extra) o << ", \"" << key << "\": " << value;
+            o << "}";
+        }
+        o << "\n  ]\n}\n";
+        return o.str();
+    }
+}
+
+int main(int argc, char** argv) {
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        if (arg == "--quick") {
+            g_options.quick = true;
+        } else if (arg == "--no-render") {
+            g_options.render = false;
+        } else if (arg == "--filter" && i + 1 < argc) {
+            g_options.filter = argv[++i];
+        } else if (arg == "--out" && i + 1 < argc) {
+            g_options.out = argv[++i];
+        } else if (arg == "--replay" && i + 1 < argc) {
+            g_options.replay = argv[++i];
+        } else {
+            std::cerr << "Usage: qsplot_bench [--quick] [--filter <substring>] [--no-render] [--out <file.json>] "
+                         "[--replay <session.qsr>]"
+                      << std::endl;
+            return 2;
+        }
+    }
+
+    benchPca();
+    benchFeatureStats();
+    benchStaging();
+    benchSelection();
+    benchSpatial();
+    benchClustering();
+    benchSession();
+    benchSessionRoundtrip();
+    if (g_options.render) benchRender();
+    if (g_options.render && !g_options.replay.empty()) benchReplayFile(g_options.replay);
+
+    std::string json = toJson();
+    if (g_options.out.empty()) {
+        std::cout << json;
+    } else {
+        std::ofstream file(g_options.out);
+        file << json;
+        if (!file) {
+            std::cerr << "[Bench] ERROR: Could not write to: " << g_options.out << std::endl;
+            return 1;
+        }
+    }
+    return 0;
+}
@@ -8,6 +8,7 @@ import warnings
 from .processor import DataProcessor
 from .core import Visualizer
 from .utils.imputer import FastImputer
+from .qsp import QspWriter, read_qsp, write_qsp
 
 # Expose C++ module components
 try:
@@ -28,6 +29,9 @@ __all__ = [
     "Visualizer",
     "DataProcessor", 
     "FastImputer",
+    "QspWriter",
+    "read_qsp",
+    "write_qsp",
     "Renderer",
     "RendererConfig",
 ]
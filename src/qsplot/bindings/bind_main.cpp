@@ -3,13 +3,64 @@
 #include <nanobind/eigen/dense.h>
 #include <nanobind/stl/vector.h>
 #include <nanobind/stl/string.h>
+#include <nanobind/stl/tuple.h>
+#include <nanobind/stl/shared_ptr.h>
+
+#include <cstdint>
+#include <memory>
+#include <stdexcept>
+#include <tuple>
 
 #include "../graphics/Renderer.h"
 #include "../graphics/RendererConfig.h"
 #include "../core/DataProcessor.h"
+#include "../core/FeatureStore.h"
+#include "../core/Clustering.h"
+#include "../core/QspFile.h"
+#include "../core/FrameAligner.h"
 
 namespace nb = nanobind;
 
+using DataArray = nb::ndarray<nb::ro, nb::ndim<2>, nb::device::cpu>;
+using PositionArray = nb::ndarray<float, nb::ndim<2>, nb::c_contig>;
+using ValueArray = nb::ndarray<float, nb::ndim<1>, nb::c_contig>;
+
+static void checkPointArrays(const PositionArray& positions, const ValueArray& values) {
+    if (positions.shape(1) != 3) {
+        throw std::runtime_error("Positions must be N x 3");
+    }
+    if (positions.shape(0) != values.shape(0)) {
+        throw std::runtime_error("Positions and Values must have same row count");
+    }
+}
+
+// View of a float32/float64 array for DataProcessor, holding a reference to it
+static DataProcessor::DataView makeDataView(const DataArray& data) {
+    DataProcessor::DataView view;
+    if (data.dtype() == nb::dtype<float>()) {
+        view.type = DataProcessor::DataView::Type::Float32;
+    } else if (data.dtype() == nb::dtype<double>()) {
+        view.type = DataProcessor::DataView::Type::Float64;
+    } else {
+        throw nb::type_error("Data must be float32 or float64");
+    }
+    if ((data.shape(0) > 1 && data.stride(0) <= 0) || (data.shape(1) > 1 && data.stride(1) <= 0)) {
+        throw nb::value_error("Data must have positive strides (use np.ascontiguousarray)");
+    }
+
+    view.data = data.data();
+    view.rows = (Eigen::Index)data.shape(0);
+    view.cols = (Eigen::Index)data.shape(1);
+    view.rowStride = (Eigen::Index)data.stride(0);
+    view.colStride = (Eigen::Index)data.stride(1);
+    // The last release may run on any thread
+    view.owner = std::shared_ptr<const void>(new DataArray(data), [](const void* p) {
+        nb::gil_scoped_acquire gil;
+        delete static_cast<const DataArray*>(p);
+    });
+    return view;
+}
+
 NB_MODULE(qsplot_engine, m) {
     m.doc() = "QsPlot: High-performance Visualization for Quantitative Finance";
 
@@ -23,40 +74,73 @@ NB_MODULE(qsplot_engine, m) {
         .def_rw("vsync", &RendererConfig::vsync)
         .def_rw("point_scale", &RendererConfig::pointScale)
         .def_rw("global_alpha", &RendererConfig::globalAlpha)
-        .def_rw("color_mode", &RendererConfig::colorMode);
+        .def_rw("color_mode", &RendererConfig::colorMode)
+        .def_rw("streaming_uploads", &RendererConfig::streamingUploads)
+        .def_rw("streaming_capacity", &RendererConfig::streamingCapacity)
+        .def_rw("select_occluded", &RendererConfig::selectOccluded)
+        .def_rw("spatial_picking", &RendererConfig::spatialPicking)
+        .def_rw("lod_mode", &RendererConfig::lodMode)
+        .def_rw("lod_min_points", &RendererConfig::lodMinPoints)
+        .def_rw("lod_cell_threshold", &RendererConfig::lodCellThreshold)
+        .def_rw("lod_downsample", &RendererConfig::lodDownsample)
+        .def_rw("transparency_mode", &RendererConfig::transparencyMode)
+        .def_rw("frustum_culling", &RendererConfig::frustumCulling)
+        .def_rw("cull_min_points", &RendererConfig::cullMinPoints)
+        .def_rw("vertex_pulling", &RendererConfig::vertexPulling)
+        .def_rw("packed_instances", &RendererConfig::packedInstances)
+        .def_rw("headless", &RendererConfig::headless)
+        .def_rw("export_threads", &RendererConfig::exportThreads)
+        .def_rw("render_on_demand", &RendererConfig::renderOnDemand)
+        .def_rw("idle_frame_rate", &RendererConfig::idleFrameRate)
+        .def_rw("exit_process_on_close", &RendererConfig::exitProcessOnClose);
+
+    // ---------------------------
+    // UploadHandle Binding
+    // ---------------------------
+    nb::class_<Completion>(m, "UploadHandle")
+        .def("done", &Completion::done, "True once the render thread has applied and uploaded the data")
+        .def("wait", [](const Completion& self, double timeout) {
+            nb::gil_scoped_release release;
+            return self.wait(timeout);
+        }, nb::arg("timeout") = -1.0, "Block until done (seconds, < 0 waits forever); False on timeout");
 
     // ---------------------------
     // Renderer Binding
     // ---------------------------
+    // Bulk setters copy without the GIL; the arrays must not be resized or
+    // written by another thread during the call.
     nb::class_<Renderer>(m, "Renderer")
         .def(nb::init<>())
         .def(nb::init<const RendererConfig&>())
         .def("start", &Renderer::start, "Start the rendering thread")
-        .def("stop", &Renderer::stop, "Stop the rendering thread")
-        .def("set_points", [](Renderer& self, 
-                              nb::ndarray<float, nb::ndim<2>, nb::c_contig> positions, 
-                              nb::ndarray<float, nb::ndim<1>, nb::c_contig> values) {
-            
-            // Check dimensions
-            if (positions.shape(1) != 3) {
-                throw std::runtime_error("Positions must be N x 3");
-            }
-            if (positions.shape(0) != values.shape(0)) {
-                throw std::runtime_error("Positions and Values must have same row count");
-            }
-
+        .def("stop", &Renderer::stop, nb::call_guard<nb::gil_scoped_release>(), "Stop the rendering thread")
+        .def("set_points", [](Renderer& self, PositionArray positions, ValueArray values) {
+            checkPointArrays(positions, values);
+            nb::gil_scoped_release release;
             self.setPoints(positions.data(), values.data(), positions.shape(0));
         }, "Upload N x 3 positions and N x 1 values to the renderer")
         
-        .def("set_target_points", [](Renderer& self, 
-                              nb::ndarray<float, nb::ndim<2>, nb::c_contig> positions, 
-                              nb::ndarray<float, nb::ndim<1>, nb::c_contig> values) {
-            // Check dimensions
-            if (positions.shape(1) != 3) throw std::runtime_error("Positions must be N x 3");
-            if (positions.shape(0) != values.shape(0)) throw std::runtime_error("Positions and Values must have same row count");
-            
+        .def("set_target_points", [](Renderer& self, PositionArray positions, ValueArray values) {
+            checkPointArrays(positions, values);
+            nb::gil_scoped_release release;
             self.setTargetPoints(positions.data(), values.data(), positions.shape(0));
         }, "Upload next frame data (Morph Target) (N x 3, N x 1)")
+
+        .def("set_points_async", [](Renderer& self, PositionArray positions, ValueArray values) {
+            checkPointArrays(positions, values);
+            nb::gil_scoped_release release;
+            self.setPoints(positions.data(), values.data(), positions.shape(0));
+            return self.fence();
+        }, nb::arg("positions"), nb::arg("values"),
+           "set_points returning an UploadHandle; the arrays may be reused as soon as it returns")
+        .def("set_target_points_async", [](Renderer& self, PositionArray positions, ValueArray values) {
+            checkPointArrays(positions, values);
+            nb::gil_scoped_release release;
+            self.setTargetPoints(positions.data(), values.data(), positions.shape(0));
+            return self.fence();
+        }, nb::arg("positions"), nb::arg("values"), "set_target_points returning an UploadHandle")
+        .def("fence", &Renderer::fence, nb::call_guard<nb::gil_scoped_release>(),
+             "UploadHandle that completes once everything submitted so far is applied and uploaded")
         
         .def("get_selected_id", &Renderer::getSelectedID, "Get the index of the currently selected point (-1 if none)")
         
@@ -67,17 +151,118 @@ NB_MODULE(qsplot_engine, m) {
             if (positions.shape(1) != 3) throw std::runtime_error("Positions must be N x 3");
             if (positions.shape(0) != values.shape(0)) throw std::runtime_error("Rows mismatch");
             
+            nb::gil_scoped_release release;
             self.setPointsRaw(positions.data(), values.data(), positions.shape(0));
         }, "Directly upload 3D coordinates (bypassing internal logic). Positions must be scaled by user.")
         
-        .def("set_tickers", &Renderer::setTickers, "Set ticker labels for each point")
+        .def("update_points", [](Renderer& self,
+                                 nb::ndarray<int32_t, nb::ndim<1>, nb::c_contig> indices,
+                                 nb::ndarray<float, nb::ndim<2>, nb::c_contig> positions,
+                                 nb::ndarray<float, nb::ndim<1>, nb::c_contig> values) {
+            if (positions.shape(1) != 3) throw std::runtime_error("Positions must be K x 3");
+            if (indices.shape(0) != positions.shape(0) || indices.shape(0) != values.shape(0)) {
+                throw std::runtime_error("Indices, Positions and Values must have same row count");
+            }
+            if (self.getConfig().streamingUploads) {
+                throw std::runtime_error("update_points is not available with streaming_uploads (use set_points)");
+            }
+            bool applied;
+            {
+                nb::gil_scoped_release release;
+                applied = self.updatePoints(indices.data(), positions.data(), values.data(), indices.shape(0));
+            }
+            if (!applied) {
+                throw std::out_of_range("update_points: index out of range of the current point set");
+            }
+        }, nb::arg("indices"), nb::arg("positions"), nb::arg("values"),
+           "Patch K points in place (K indices, K x 3 positions, K values); only changed ranges are re-uploaded")
+
+        .def("update_target_points", [](Renderer& self,
+                                        nb::ndarray<int32_t, nb::ndim<1>, nb::c_contig> indices,
+                                        nb::ndarray<float, nb::ndim<2>, nb::c_contig> positions,
+                                        nb::ndarray<float, nb::ndim<1>, nb::c_contig> values) {
+            if (positions.shape(1) != 3) throw std::runtime_error("Positions must be K x 3");
+            if (indices.shape(0) != positions.shape(0) || indices.shape(0) != values.shape(0)) {
+                throw std::runtime_error("Indices, Positions and Values must have same row count");
+            }
+            if (self.getConfig().streamingUploads) {
+                throw std::runtime_error("update_target_points is not available with streaming_uploads");
+            }
+            bool applied;
+            {
+                nb::gil_scoped_release release;
+                applied = self.updateTargetPoints(indices.data(), positions.data(), values.data(), indices.shape(0));
+            }
+            if (!applied) {
+                throw std::out_of_range("update_target_points: index out of range of the target point set");
+            }
+        }, nb::arg("indices"), nb::arg("positions"), nb::arg("values"),
+           "Patch K points of the morph target in place")
+
+        .def("set_tickers", &Renderer::setTickers, nb::call_guard<nb::gil_scoped_release>(),
+             "Set ticker labels for each point")
         .def("get_selected_ticker", &Renderer::getSelectedTicker, "Get the ticker of the currently selected point")
-        .def("save_screenshot", &Renderer::saveScreenshot, "Save a screenshot to the specified path (PPM format)")
-        .def("set_dimension_labels", &Renderer::setDimensionLabels, 
+        .def("save_screenshot", &Renderer::saveScreenshot, nb::call_guard<nb::gil_scoped_release>(),
+             "Save the scene (no UI) to the specified path: PNG, or PPM for a .ppm extension")
+        .def("set_dimension_labels", &Renderer::setDimensionLabels, nb::call_guard<nb::gil_scoped_release>(), 
              "Set labels for dimensions (color, x, y, z) to display in UI")
         
+        // --- Color Modes ---
+        .def("set_color_mode", &Renderer::setColorMode, nb::call_guard<nb::gil_scoped_release>(), nb::arg("mode"),
+             "0: Heatmap, 1: CoolWarm, 2: Grayscale, 3: Categorical (labels of set_categories)")
+        .def("set_categories", [](Renderer& self, nb::ndarray<uint8_t, nb::ndim<1>, nb::c_contig> labels,
+                                  std::vector<std::string> names) {
+            nb::gil_scoped_release release;
+            self.setCategories(labels.data(), labels.shape(0), names);
+        }, nb::arg("labels"), nb::arg("names") = std::vector<std::string>(),
+           "Set one uint8 label per point (e.g. cluster ids) for the categorical color mode; "
+           "names label the categories in the legend")
+        .def("set_auto_categories", [](Renderer& self, const std::string& mode, int clusters,
+                                       float contamination, size_t neighbors) {
+            Renderer::AutoCategories settings;
+            if (mode == "off") settings.mode = Renderer::AutoCategories::Off;
+            else if (mode == "clusters") settings.mode = Renderer::AutoCategories::Clusters;
+            else if (mode == "outliers") settings.mode = Renderer::AutoCategories::Outliers;
+            else throw nb::value_error("mode must be 'off', 'clusters' or 'outliers'");
+            if (clusters < 1 || clusters > 256) throw nb::value_error("clusters must be in [1, 256]");
+            settings.clusters = clusters;
+            settings.contamination = contamination;
+            settings.neighbors = neighbors;
+            self.setAutoCategories(settings);
+        }, nb::arg("mode"), nb::arg("clusters") = 5, nb::arg("contamination") = 0.05f, nb::arg("neighbors") = 10,
+           "Compute the categories natively from each new feature store ('clusters': warm-started "
+           "mini-batch k-means) or point set ('outliers': kNN distance), replacing set_categories")
+        .def("set_viewport_count", &Renderer::setViewportCount, nb::call_guard<nb::gil_scoped_release>(),
+             nb::arg("count"),
+             "Split the window into a grid of linked viewports sharing the loaded data (0: single view, max 16)")
+        .def("set_viewport_subset", [](Renderer& self, size_t viewport,
+                                       nb::ndarray<uint32_t, nb::ndim<1>, nb::c_contig> indices) {
+            nb::gil_scoped_release release;
+            self.setViewportSubset(viewport, indices.data(), indices.shape(0));
+        }, nb::arg("viewport"), nb::arg("indices"),
+           "Draw only these point indices in a viewport (empty: every point)")
+        .def("set_viewport_filter", &Renderer::setViewportFilter, nb::call_guard<nb::gil_scoped_release>(),
+             nb::arg("viewport"), nb::arg("enabled"),
+             nb::arg("min_value") = 0.0f, nb::arg("max_value") = 1.0f,
+             "Show only points whose normalized value lies in [min_value, max_value] in a viewport")
+        .def("set_viewport_label", &Renderer::setViewportLabel, nb::call_guard<nb::gil_scoped_release>(),
+             nb::arg("viewport"), nb::arg("label"),
+             "Title drawn in the corner of a viewport")
+        .def("set_viewport_camera", &Renderer::setViewportCamera, nb::call_guard<nb::gil_scoped_release>(),
+             nb::arg("viewport"), nb::arg("yaw"),
+             nb::arg("pitch"), nb::arg("distance"), "Place a viewport's orbit camera (radians, world units)")
+        .def("set_viewports_linked", &Renderer::setViewportsLinked, nb::call_guard<nb::gil_scoped_release>(),
+             nb::arg("linked"),
+             "Orbit and zoom every viewport together (True) or only the one under the cursor")
+        .def("orbit_camera", &Renderer::orbitCamera, nb::call_guard<nb::gil_scoped_release>(),
+             nb::arg("delta_x"), nb::arg("delta_y"),
+             "Orbit the camera as a mouse drag does (radians; every viewport while linked)")
+        .def("zoom_camera", &Renderer::zoomCamera, nb::call_guard<nb::gil_scoped_release>(), nb::arg("delta"),
+             "Zoom the camera as the scroll wheel does (every viewport while linked)")
+
         // --- Phase 1: Feature Switching ---
-        .def("set_feature_names", &Renderer::setFeatureNames, "Set feature names for color selector dropdown")
+        .def("set_feature_names", &Renderer::setFeatureNames, nb::call_guard<nb::gil_scoped_release>(),
+             "Set feature names for color selector dropdown")
         .def("get_selected_color_feature_index", &Renderer::getSelectedColorFeatureIndex, 
              "Get the currently selected color feature index from UI")
         .def("has_color_feature_changed", &Renderer::hasColorFeatureChanged,
@@ -109,24 +294,414 @@ NB_MODULE(qsplot_engine, m) {
         // --- Phase 1: Enhanced Tooltips ---
         .def("set_all_feature_values", [](Renderer& self,
                                            nb::ndarray<float, nb::ndim<2>, nb::c_contig> values) {
+            nb::gil_scoped_release release;
             self.setAllFeatureValues(values.data(), values.shape(0), values.shape(1));
         }, "Set all feature values (N x F matrix) for enhanced tooltips")
+        .def("set_all_feature_values_async", [](Renderer& self,
+                                                 nb::ndarray<float, nb::ndim<2>, nb::c_contig> values) {
+            nb::gil_scoped_release release;
+            self.setAllFeatureValues(values.data(), values.shape(0), values.shape(1));
+            return self.fence();
+        }, nb::arg("values"), "set_all_feature_values returning an UploadHandle")
+        .def("set_feature_store", [](Renderer& self, std::shared_ptr<FeatureStore> store) {
+            nb::gil_scoped_release release;
+            self.setFeatureStore(std::move(store));
+        }, nb::arg("store").none(),
+           "Share a FeatureStore with the tooltips and the Statistics tab (no copy); "
+           "its column statistics replace those of set_stats")
         
         // --- Phase 2: Rectangle Brush Selection ---
         .def("get_selected_ids", &Renderer::getSelectedIDs,
              "Get list of selected point IDs (from rectangle or single click selection)")
-        .def("clear_selection", &Renderer::clearSelection,
+        .def("clear_selection", &Renderer::clearSelection, nb::call_guard<nb::gil_scoped_release>(),
              "Clear all selection state")
-             
-        .def("is_running", &Renderer::isRunning, "Check if the rendering thread is currently active");
+
+        // --- Range Filters ---
+        .def("set_range_filters", [](Renderer& self, const std::vector<std::tuple<size_t, float, float>>& ranges) {
+            std::vector<RangeFilter::Range> converted;
+            for (const auto& [column, minValue, maxValue] : ranges) converted.push_back({column, minValue, maxValue});
+            self.setRangeFilters(converted);
+        }, nb::arg("ranges"),
+           "Draw only points whose feature values lie in every (column, min, max) range, evaluated on the GPU "
+           "(at most 8 ranges over FeatureStore columns); [] clears")
+        .def("clear_range_filters", &Renderer::clearRangeFilters, nb::call_guard<nb::gil_scoped_release>(),
+             "Remove every range filter")
+        .def("get_filtered_count", &Renderer::getFilteredCount,
+             "Points passing the range filters (-1 without filters), a frame or two after a change")
+        .def("select_filtered", &Renderer::selectFiltered, nb::call_guard<nb::gil_scoped_release>(),
+             "Replace the selection with the points passing the range filters (see get_selected_ids)")
+
+        // --- Spatial Queries ---
+        .def("query_knn", &Renderer::queryKnn, nb::arg("id"), nb::arg("k"),
+             nb::call_guard<nb::gil_scoped_release>(),
+             "IDs of the k points nearest to point id as drawn, nearest first (without id; [] if it is not drawn)")
+        .def("query_radius", [](Renderer& self, const std::tuple<float, float, float>& point, float radius) {
+            float p[3] = { std::get<0>(point), std::get<1>(point), std::get<2>(point) };
+            nb::gil_scoped_release release;
+            return self.queryRadius(p, radius);
+        }, nb::arg("point"), nb::arg("radius"),
+           "IDs of every point within radius of the (x, y, z) point as drawn, nearest first")
+
+        .def("set_aligned_frames", [](Renderer& self, const FrameAligner& aligner) {
+            // Straight from the aligner's buffers into the staging copies. The
+            // GIL stays held: it keeps other Python threads from running
+            // align()/push_frame on the aligner while its buffers are read
+            size_t count = aligner.count();
+            self.setPoints(aligner.currentPositions().data(), aligner.currentValues().data(), count);
+            self.setTargetPoints(aligner.nextPositions().data(), aligner.nextValues().data(), count);
+            if (aligner.orderChanged()) self.setTickers(aligner.alignedLabels());
+            return count;
+        }, nb::arg("aligner"), "Upload the aligned current/next frames of a FrameAligner (and tickers if their order changed)")
+        .def("set_timeline", &Renderer::setTimeline, nb::call_guard<nb::gil_scoped_release>(),
+             nb::arg("frame_count"), nb::arg("point_count"), nb::arg("window") = 32,
+             "Reserve a GPU keyframe timeline: frame_count frames of point_count points, window of them resident")
+        .def("clear_timeline", &Renderer::clearTimeline, nb::call_guard<nb::gil_scoped_release>(),
+             "Drop the keyframe timeline and return to the point sets")
+        .def("load_dataset", [](Renderer& self, std::shared_ptr<QspFile> dataset, size_t window) {
+            nb::gil_scoped_release release;
+            self.loadDataset(std::move(dataset), window);
+        }, nb::arg("dataset"), nb::arg("window") = 32,
+           "Play a mapped .qsp file as a timeline; keyframes are paged from the file by the render thread")
+        .def("set_keyframe", [](Renderer& self, size_t frame,
+                                nb::ndarray<float, nb::ndim<2>, nb::c_contig> positions,
+                                nb::ndarray<float, nb::ndim<1>, nb::c_contig> values) {
+            if (positions.shape(1) != 3) throw std::runtime_error("Positions must be N x 3");
+            if (positions.shape(0) != values.shape(0)) throw std::runtime_error("Rows mismatch");
+            bool stored;
+            {
+                nb::gil_scoped_release release;
+                stored = self.setKeyframe(frame, positions.data(), values.data(), positions.shape(0));
+            }
+            if (!stored) {
+                throw nb::index_error("Keyframe outside the timeline or wrong point count");
+            }
+        }, nb::arg("frame"), nb::arg("positions"), nb::arg("values"),
+           "Upload keyframe `frame` (N x 3 positions, NaN for absent points; N values) into its window slot")
+        .def("invalidate_keyframes", &Renderer::invalidateKeyframes, nb::call_guard<nb::gil_scoped_release>(),
+             "Mark every resident keyframe outdated: still drawn, but playback waits for set_keyframe to replace it")
+        .def("set_timeline_playback", &Renderer::setTimelinePlayback, nb::call_guard<nb::gil_scoped_release>(),
+             nb::arg("playing"), nb::arg("fps") = 1.0f, nb::arg("loop") = true,
+             "Start or pause timeline playback at fps keyframes per second")
+        .def("seek_timeline", &Renderer::seekTimeline, nb::call_guard<nb::gil_scoped_release>(),
+             nb::arg("position"), "Move the playhead to a fractional frame")
+        .def("get_timeline_position", &Renderer::getTimelinePosition, "Current fractional playhead frame")
+        .def("render_frames", [](Renderer& self, const std::vector<std::string>& paths,
+                                 const std::vector<float>& morphTimes,
+                                 const std::vector<float>& timelinePositions,
+                                 const std::vector<std::tuple<float, float, float>>& cameras,
+                                 const std::string& pipe, bool wait) {
+            size_t n = paths.size();
+            if ((!morphTimes.empty() && morphTimes.size() != n) ||
+                (!timelinePositions.empty() && timelinePositions.size() != n) ||
+                (!cameras.empty() && cameras.size() != n)) {
+                throw std::runtime_error("morph_times, timeline_positions and cameras must be empty or match paths");
+            }
+            std::vector<Renderer::FrameRequest> frames(n);
+            for (size_t i = 0; i < n; i++) {
+                frames[i].path = paths[i];
+                if (!morphTimes.empty()) frames[i].morphTime = morphTimes[i];
+                if (!timelinePositions.empty()) frames[i].timelinePosition = timelinePositions[i];
+                if (!cameras.empty()) {
+                    frames[i].setCamera = true;
+                    std::tie(frames[i].yaw, frames[i].pitch, frames[i].distance) = cameras[i];
+                }
+            }
+            if (!self.renderFrames(std::move(frames), pipe)) {
+                throw std::runtime_error("render_frames: could not start: " + pipe);
+            }
+            if (wait) {
+                nb::gil_scoped_release release;
+                self.waitForFrames();
+            }
+        }, nb::arg("paths"), nb::arg("morph_times") = std::vector<float>(),
+           nb::arg("timeline_positions") = std::vector<float>(),
+           nb::arg("cameras") = std::vector<std::tuple<float, float, float>>(),
+           nb::arg("pipe") = "", nb::arg("wait") = true,
+           "Render one offscreen frame per path (scene only). Optional per-frame morph times, timeline "
+           "positions and (yaw, pitch, distance) cameras. pipe: shell command fed raw RGB24 frames instead of files")
+        .def("wait_for_frames", [](const Renderer& self, double timeout) {
+            nb::gil_scoped_release release;
+            return self.waitForFrames(timeout);
+        }, nb::arg("timeout") = -1.0,
+           "Block until every requested frame is written; False on timeout or if the renderer stopped")
+        .def("get_export_stats", [](const Renderer& self) {
+            Renderer::ExportStats e = self.getExportStats();
+            nb::dict d;
+            d["requested"] = e.requested;
+            d["finished"] = e.finished;
+            d["failed"] = e.failed;
+            return d;
+        }, "Get frame export counters (requested, finished, failed)")
+        .def("is_running", &Renderer::isRunning, "Check if the rendering thread is currently active")
+        .def("get_queue_stats", [](const Renderer& self) {
+            Renderer::QueueStats q = self.getQueueStats();
+            nb::dict d;
+            d["depth"] = q.depth;
+            d["max_depth"] = q.maxDepth;
+            d["submitted"] = q.submitted;
+            d["stalls"] = q.stalls;
+            d["stall_ms"] = q.stallMs;
+            d["last_drain_ms"] = q.lastDrainMs;
+            return d;
+        }, "Get command queue counters (depth, max_depth, submitted, stalls, stall_ms, last_drain_ms)")
+        .def("get_perf_stats", [](const Renderer& self) {
+            nb::dict d;
+            auto snapshot = self.getPerfStats();
+            if (!snapshot) return d;
+            auto summary = [](const Profiler::Summary& s) {
+                nb::dict t;
+                t["p50_ms"] = s.p50;
+                t["p99_ms"] = s.p99;
+                t["mean_ms"] = s.mean;
+                t["max_ms"] = s.max;
+                t["last_ms"] = s.last;
+                t["samples"] = s.samples;
+                return t;
+            };
+            nb::dict sections;
+            for (const auto& section : snapshot->sections) {
+                nb::dict entry;
+                entry["cpu"] = summary(section.cpu);
+                if (section.gpu.samples > 0) entry["gpu"] = summary(section.gpu);
+                sections[section.name] = entry;
+            }
+            d["frames"] = snapshot->frames;
+            d["gpu_timers"] = snapshot->gpuTimers;
+            d["sections"] = sections;
+            return d;
+        }, "Get per-pass frame timings: {frames, gpu_timers, sections: {name: {cpu, gpu}}} with "
+           "p50_ms/p99_ms/mean_ms/max_ms/last_ms/samples over the last frames (empty until published)")
+
+        // --- Session Recording ---
+        .def("start_recording", [](Renderer& self, const std::string& path, bool features) {
+            if (!self.startRecording(path, features)) throw nb::value_error("start_recording: could not create the file (see stderr)");
+        }, nb::arg("path"), nb::arg("features") = false,
+           "Log every later point set, metadata setter and camera move to a compressed .qsr file "
+           "(feature matrices too if features=True); replaces a recording in progress")
+        .def("stop_recording", [](Renderer& self) {
+            nb::gil_scoped_release release;
+            self.stopRecording();
+        }, "Write everything queued and close the recording")
+        .def("get_recording_stats", [](const Renderer& self) {
+            Renderer::RecordingStats r = self.getRecordingStats();
+            nb::dict d;
+            d["active"] = r.active;
+            d["path"] = r.path;
+            d["records"] = r.records;
+            d["bytes"] = r.bytes;
+            d["stored_bytes"] = r.storedBytes;
+            d["queued_bytes"] = r.queuedBytes;
+            d["failed"] = r.failed;
+            return d;
+        }, "Get counters of the current or last recording (active, path, records, bytes, stored_bytes, "
+           "queued_bytes, failed)")
+        .def("replay", [](Renderer& self, const std::string& path, double speed) {
+            long long applied;
+            {
+                nb::gil_scoped_release release;
+                applied = self.replay(path, speed);
+            }
+            if (applied < 0) throw nb::value_error("replay: not a valid session log (see stderr)");
+            return applied;
+        }, nb::arg("path"), nb::arg("speed") = 1.0,
+           "Feed a recording back through the renderer at speed x the original pace (<= 0: as fast as "
+           "possible); blocks until done and returns the records applied")
+        .def("stop_replay", &Renderer::stopReplay, "Make a replay running on another thread return");
+
+    // ---------------------------
+    // FeatureStore Binding
+    // ---------------------------
+    nb::class_<FeatureStore>(m, "FeatureStore")
+        .def("__init__", [](FeatureStore* self, DataArray values) {
+            new (self) FeatureStore(makeDataView(values));
+        }, nb::arg("values"), "View an N x F float32/float64 array (any layout) without copying it")
+        .def_static("map_file", [](const std::string& path, size_t rows, size_t cols,
+                                   const std::string& dtype, size_t offset, const std::string& order) {
+            FeatureStore::View::Type type;
+            if (dtype == "float32") type = FeatureStore::View::Type::Float32;
+            else if (dtype == "float64") type = FeatureStore::View::Type::Float64;
+            else throw nb::value_error("dtype must be 'float32' or 'float64'");
+            if (order != "C" && order != "F") throw nb::value_error("order must be 'C' or 'F'");
+            auto store = FeatureStore::mapFile(path, rows, cols, type, offset, order == "C");
+            if (!store) throw nb::value_error("map_file: could not map the matrix (see stderr)");
+            return store;
+        }, nb::arg("path"), nb::arg("rows"), nb::arg("cols"), nb::arg("dtype") = "float32",
+           nb::arg("offset") = 0, nb::arg("order") = "C",
+           "Memory-map a headerless rows x cols matrix starting at byte offset")
+        .def_prop_ro("rows", &FeatureStore::rows)
+        .def_prop_ro("cols", &FeatureStore::cols)
+        .def("row", [](const FeatureStore& self, size_t row) {
+            if (row >= self.rows()) throw nb::index_error("row out of range");
+            std::vector<float> out(self.cols());
+            self.row(row, out.data());
+            return out;
+        }, nb::arg("row"), "Feature values of one point")
+        .def("compute_stats", [](const FeatureStore& self) {
+            std::vector<FeatureStore::ColumnStats> stats;
+            {
+                nb::gil_scoped_release release;
+                stats = self.computeStats();
+            }
+            nb::list out;
+            for (const auto& c : stats) {
+                nb::dict d;
+                d["min"] = c.min;
+                d["max"] = c.max;
+                d["mean"] = c.mean;
+                d["std"] = c.std;
+                d["median"] = c.median;
+                d["count"] = c.count;
+                out.append(d);
+            }
+            return out;
+        }, "Per-column min/max/mean/std/median/count over finite values (list of dicts)");
+
+    // ---------------------------
+    // Clustering Bindings
+    // ---------------------------
+    using Labels = Eigen::Matrix<int32_t, Eigen::Dynamic, 1>;
+    nb::class_<MiniBatchKMeans>(m, "KMeans")
+        .def("__init__", [](MiniBatchKMeans* self, int clusters, size_t batchSize, int maxIterations,
+                            float tolerance, uint32_t seed) {
+            if (clusters < 1) throw nb::value_error("clusters must be positive");
+            MiniBatchKMeans::Options options;
+            options.clusters = clusters;
+            options.batchSize = batchSize;
+            options.maxIterations = maxIterations;
+            options.tolerance = tolerance;
+            options.seed = seed;
+            new (self) MiniBatchKMeans(options);
+        }, nb::arg("n_clusters") = 5, nb::arg("batch_size") = 4096, nb::arg("max_iter") = 100,
+           nb::arg("tol") = 1e-4f, nb::arg("seed") = 42,
+           "Mini-batch k-means; each fit starts from the previous fit's centroids")
+        .def("fit_predict", [](MiniBatchKMeans& self, const FeatureStore& store) {
+            nb::gil_scoped_release release;
+            std::vector<int32_t> labels = self.fitPredict(store);
+            return Labels(Eigen::Map<const Labels>(labels.data(), (Eigen::Index)labels.size()));
+        }, nb::arg("store"), "Fit on every row of a FeatureStore and return its int32 cluster labels")
+        .def("predict", [](const MiniBatchKMeans& self, const FeatureStore& store) {
+            nb::gil_scoped_release release;
+            std::vector<int32_t> labels = self.predict(store);
+            return Labels(Eigen::Map<const Labels>(labels.data(), (Eigen::Index)labels.size()));
+        }, nb::arg("store"), "Label rows with the current centroids (all 0 before the first fit)")
+        .def("reset", &MiniBatchKMeans::reset, "Forget the centroids: the next fit seeds with k-means++")
+        .def_prop_ro("fitted", &MiniBatchKMeans::fitted)
+        .def_prop_ro("centroids", &MiniBatchKMeans::centroids, nb::rv_policy::copy, "n_clusters x n_features")
+        .def_prop_ro("inertia", &MiniBatchKMeans::inertia, "Sum of squared distances of the last labelling")
+        .def_prop_ro("iterations", &MiniBatchKMeans::iterations, "Batches of the last fit");
+
+    m.def("outlier_scores", [](nb::ndarray<float, nb::ndim<2>, nb::c_contig> positions, size_t neighbors) {
+        if (positions.shape(1) != 3) throw std::runtime_error("Positions must be N x 3");
+        nb::gil_scoped_release release;
+        std::vector<float> scores = knnOutlierScores(positions.data(), positions.shape(0), neighbors);
+        return Eigen::VectorXf(Eigen::Map<const Eigen::VectorXf>(scores.data(), (Eigen::Index)scores.size()));
+    }, nb::arg("positions"), nb::arg("neighbors") = 10,
+       "Mean distance of each (x, y, z) point to its nearest neighbors, scaled to [0, 1] (1: most isolated)");
+
+    // ---------------------------
+    // QspFile Binding
+    // ---------------------------
+    nb::class_<QspFile>(m, "QspFile")
+        .def_static("open", [](const std::string& path) {
+            std::shared_ptr<const QspFile> file;
+            {
+                nb::gil_scoped_release release;
+                file = QspFile::open(path);
+            }
+            if (!file) throw nb::value_error("QspFile.open: not a valid .qsp file (see stderr)");
+            return std::const_pointer_cast<QspFile>(file);
+        }, nb::arg("path"), "Memory-map a .qsp session file")
+        .def_prop_ro("frame_count", &QspFile::frameCount)
+        .def_prop_ro("point_count", &QspFile::pointCount)
+        .def_prop_ro("feature_count", &QspFile::featureCount)
+        .def_prop_ro("labels", &QspFile::labels)
+        .def_prop_ro("feature_names", &QspFile::featureNames)
+        .def_prop_ro("frame_names", &QspFile::frameNames)
+        .def_prop_ro("path", &QspFile::path)
+        .def("features", [](const QspFile& self, size_t frame) {
+            if (frame >= self.frameCount()) throw nb::index_error("frame out of range");
+            return std::const_pointer_cast<FeatureStore>(self.features(frame));
+        }, nb::arg("frame"), "FeatureStore over one frame's features in the mapping (None without features)");
+
+    // ---------------------------
+    // FrameAligner Binding
+    // ---------------------------
+    nb::class_<FrameAligner>(m, "FrameAligner")
+        .def(nb::init<>())
+        .def("intern", &FrameAligner::intern, nb::arg("labels"), "Intern labels (e.g. tickers) to stable integer IDs")
+        .def("push_frame", [](FrameAligner& self,
+                              nb::ndarray<int, nb::ndim<1>, nb::c_contig> ids,
+                              nb::ndarray<float, nb::ndim<2>, nb::c_contig> positions,
+                              nb::ndarray<float, nb::ndim<1>, nb::c_contig> values) {
+            if (positions.shape(1) != 3) throw std::runtime_error("Positions must be N x 3");
+            if (positions.shape(0) != ids.shape(0) || values.shape(0) != ids.shape(0)) {
+                throw std::runtime_error("IDs, Positions and Values must have same row count");
+            }
+            for (size_t i = 0; i < ids.shape(0); i++) {
+                if (ids.data()[i] < 0 || (size_t)ids.data()[i] >= self.labelCount()) {
+                    throw nb::index_error("push_frame: ID was not interned");
+                }
+            }
+            self.pushFrame(ids.data(), positions.data(), values.data(), ids.shape(0));
+        }, nb::arg("ids"), nb::arg("positions"), nb::arg("values"),
+           "Push the next frame; the previously pushed frame becomes the current one")
+        .def("reset_frames", &FrameAligner::resetFrames, "Drop pushed frames, keeping interned labels and slots")
+        .def("align", &FrameAligner::align, "Join the last two frames on their IDs, returns the common count")
+        .def("aligned_ids", &FrameAligner::alignedIds, "Interned IDs of the aligned points, in point order")
+        .def("aligned_tickers", &FrameAligner::alignedLabels, "Labels of the aligned points, in point order");
 
     // ---------------------------
     // DataProcessor Binding
     // ---------------------------
     nb::class_<DataProcessor>(m, "DataProcessor")
         .def(nb::init<>())
-        .def("load_data", &DataProcessor::loadData, "Load raw data matrix")
-        .def("compute_pca", &DataProcessor::computePCA, nb::arg("target_dims") = 3, "Reduce to 3D using PCA")
-        .def("get_explained_variance_ratio", &DataProcessor::getExplainedVarianceRatio, "Get variance ratio per component")
-        .def("extract_feature", &DataProcessor::extractFeature, "Get column vector");
+        .def("load_data", [](DataProcessor& self, DataArray data) {
+            self.loadView(makeDataView(data));
+        }, nb::arg("data"), "Load raw data matrix (float32/float64, any layout), viewed without copying")
+        .def("compute_pca", [](DataProcessor& self, int targetDims, const std::string& solver, int powerIterations) {
+            DataProcessor::PcaSolver mode;
+            if (solver == "auto") mode = DataProcessor::PcaSolver::Auto;
+            else if (solver == "full") mode = DataProcessor::PcaSolver::Full;
+            else if (solver == "randomized") mode = DataProcessor::PcaSolver::Randomized;
+            else throw nb::value_error("solver must be 'auto', 'full' or 'randomized'");
+            nb::gil_scoped_release release;
+            return self.computePCA(targetDims, mode, powerIterations);
+        }, nb::arg("target_dims") = 3, nb::arg("solver") = "auto", nb::arg("power_iterations") = 4,
+           "Reduce to 3D using PCA")
+        .def("get_error_bound", &DataProcessor::getErrorBound, "Eigenvalue error bound of the last PCA")
+        .def("get_explained_variance_ratio", &DataProcessor::getExplainedVarianceRatio,
+             nb::call_guard<nb::gil_scoped_release>(),
+             "Get variance ratio per component (of the last compute_pca, or of the incremental fit after partial_fit)")
+        .def("extract_feature", &DataProcessor::extractFeature, "Get column vector")
+        .def("reset_incremental", &DataProcessor::resetIncremental, nb::arg("n_components") = 3,
+             "Start a new incremental PCA")
+        .def("partial_fit", [](DataProcessor& self, DataArray data) {
+            DataProcessor::DataView view = makeDataView(data);
+            bool folded;
+            {
+                nb::gil_scoped_release release;
+                folded = self.partialFit(view);
+            }
+            if (!folded) {
+                throw nb::value_error("partial_fit: column count differs from earlier rows");
+            }
+        }, nb::arg("data"),
+           "Fold rows into the incremental PCA: O(rows x D^2); the O(D^3) axis solve waits for the next read")
+        .def("transform", [](const DataProcessor& self, DataArray data) {
+            DataProcessor::DataView view = makeDataView(data);
+            Eigen::MatrixXd projected;
+            {
+                nb::gil_scoped_release release;
+                projected = self.transformIncremental(view);
+            }
+            if (projected.size() == 0 && view.rows > 0) {
+                throw nb::value_error("transform: nothing fitted or wrong column count (see stderr)");
+            }
+            return projected;
+        }, nb::arg("data"), "Project rows onto the incremental PCA axes (standardized, as compute_pca)")
+        .def("get_incremental_components", &DataProcessor::getIncrementalBasis,
+             nb::call_guard<nb::gil_scoped_release>(),
+             "Incremental PCA axes (n_components x n_features)")
+        .def("get_incremental_sample_count", &DataProcessor::getIncrementalSampleCount,
+             "Rows folded into the incremental PCA");
 }
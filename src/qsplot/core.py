@@ -23,9 +23,14 @@ class Visualizer:
     - Animation control
     """
     
-    def __init__(self):
+    def __init__(self, config=None):
+        """
+        Args:
+            config: Optional qsplot_engine.RendererConfig (e.g. headless=True
+                for offscreen export).
+        """
         if qsplot_engine:
-            self.engine = qsplot_engine.Renderer()
+            self.engine = qsplot_engine.Renderer(config) if config is not None else qsplot_engine.Renderer()
             self.engine.start()
         else:
             self.engine = None
@@ -43,6 +48,11 @@ class Visualizer:
         self._global_pca_cache: Dict[str, Any] = {}  # keyed by color_feature
         self._global_color_bounds: Dict[str, tuple] = {}  # {col_name: (min, max)}
         self._global_norm_bounds: Dict[str, tuple] = {}  # {cache_key: (center, scale)}
+
+        # Per-row labels for the categorical color mode (clusters, outlier flags)
+        self._categories: Optional[pd.Series] = None
+        self._category_names: List[str] = []
+        self._auto_categories = False  # The engine computes the categories itself
         
     def load_data(self, 
                   df: pd.DataFrame, 
@@ -145,18 +155,28 @@ class Visualizer:
             return
             
         print(f"Fitting global PCA on all {len(self._feature_cols)} features...")
-        X_all = self.df[self._feature_cols].values
-        pca_info = self.processor.fit_global_pca(X_all, n_components=3, 
-                                                  feature_names=self._feature_cols)
+        # Grouped once, iterated for the fit and again for the bounds
+        grouped = self.df.groupby(self._date_col, sort=True)[self._feature_cols]
+
+        def snapshots():
+            for _, frame in grouped:
+                yield frame.values
+
+        # Both paths fit correlation PCA (standardized features), so the axes
+        # do not depend on whether the engine is installed
+        if self.processor.has_incremental_pca():
+            # Folded in natively one timestamp at a time, no concatenated copy
+            pca_info = self.processor.fit_global_pca_incremental(snapshots(), len(self._feature_cols),
+                                                                 n_components=3,
+                                                                 feature_names=self._feature_cols)
+        else:
+            X_all = self.df[self._feature_cols].values
+            pca_info = self.processor.fit_global_pca(X_all, n_components=3,
+                                                      feature_names=self._feature_cols,
+                                                      standardize=True)
         
         # Pre-compute global normalization bounds by projecting all timestamps
-        dates = self.get_dates()
-        all_positions = []
-        for date in dates:
-            mask = self.df[self._date_col] == date
-            snapshot_X = self.df.loc[mask, self._feature_cols].values
-            positions = pca_info['pca'].transform(snapshot_X)
-            all_positions.append(positions)
+        all_positions = [pca_info['pca'].transform(snapshot_X) for snapshot_X in snapshots()]
         
         global_center, global_scale = self.processor.compute_global_normalization_bounds(all_positions)
         
@@ -277,21 +297,8 @@ class Visualizer:
         )
         
         tickers = snapshot[self._ticker_col].values
+        categories = self._categories.loc[mask].values if self._categories is not None else None
         
-        # 8. Compute per-feature statistics (Phase 1: Stats Panel)
-        stats = []
-        for i, col in enumerate(self._feature_cols):
-            col_vals = X[:, i]
-            stats.append({
-                "name": col,
-                "min": float(np.nanmin(col_vals)),
-                "max": float(np.nanmax(col_vals)),
-                "mean": float(np.nanmean(col_vals)),
-                "std": float(np.nanstd(col_vals)),
-                "median": float(np.nanmedian(col_vals)),
-                "count": int(len(col_vals))
-            })
-
         return {
             "positions": positions_norm.astype(np.float32),
             "values": color_values.astype(np.float32),
@@ -300,9 +307,9 @@ class Visualizer:
             "x_label": axis_labels[0],
             "y_label": axis_labels[1],
             "z_label": axis_labels[2],
-            "stats": stats,
             "explained_variance": reduction_result.get('explained_variance_ratios'),
-            "all_feature_values": X.astype(np.float32)  # N x F matrix for tooltips
+            "all_feature_values": X,  # N x F matrix for tooltips and stats, not copied
+            "categories": categories  # uint8 labels in point order, or None
         }
     
     def _generate_axis_labels(self, method: str, explained_var: Optional[List[float]], 
@@ -367,64 +374,67 @@ class Visualizer:
         
         print(f"Starting animation across {len(valid_dates)} timestamps (normalization={normalization})...")
         
+        # Native alignment: tickers are interned once, frames are joined in C++
+        aligner = None
+        if hasattr(qsplot_engine, 'FrameAligner') and hasattr(self.engine, 'set_aligned_frames'):
+            aligner = qsplot_engine.FrameAligner()
+            ticker_index = pd.Index(pd.unique(self.df[self._ticker_col]))
+            ticker_ids = np.asarray(aligner.intern([str(t) for t in ticker_index]), dtype=np.int32)
+            id_index = pd.Index(ticker_ids)  # Aligned IDs back to tickers
+        
+        color_feature = None
+        data_curr = None
+        
         for i in range(len(valid_dates) - 1):
             t_curr = valid_dates[i]
             t_next = valid_dates[i+1]
             
             print(f"Morphing: {t_curr} -> {t_next}")
             
-            # Prepare Dataframes with specified normalization mode
-            data_curr = self.prepare_frame(t_curr, method=method, normalization=normalization)
-            data_next = self.prepare_frame(t_next, method=method, normalization=normalization)
+            # Each prepared frame is reused as the next pair's current one
+            if data_curr is None:
+                data_curr = self.prepare_frame(t_curr, method=method, normalization=normalization,
+                                               color_feature=color_feature)
+                if aligner is not None:
+                    aligner.reset_frames()
+                    if data_curr:
+                        self._push_aligned_frame(aligner, ticker_index, ticker_ids, data_curr)
+            data_next = self.prepare_frame(t_next, method=method, normalization=normalization,
+                                           color_feature=color_feature)
             
             if not data_curr or not data_next:
+                data_curr = data_next
+                if aligner is not None:
+                    aligner.reset_frames()
+                    if data_next:
+                        self._push_aligned_frame(aligner, ticker_index, ticker_ids, data_next)
                 continue
-                
-            # --- ALIGNMENT LOGIC ---
-            ticks_curr = data_curr['tickers']
-            ticks_next = data_next['tickers']
             
-            # Intersection
-            common_tickers = np.intersect1d(ticks_curr, ticks_next)
+            if aligner is not None:
+                self._push_aligned_frame(aligner, ticker_index, ticker_ids, data_next)
+                n_common = aligner.align()
+            else:
+                aligned = self._align_frames(data_curr, data_next)
+                n_common = 0 if aligned is None else len(aligned[0])
             
-            if len(common_tickers) == 0:
+            if n_common == 0:
                 print("No common tickers, skipping frame.")
+                data_curr = data_next
                 continue
             
-            # Filter & Align Current
-            mask_curr = np.isin(ticks_curr, common_tickers)
-            pos_curr_filtered = data_curr['positions'][mask_curr]
-            val_curr_filtered = data_curr['values'][mask_curr]
-            ticks_curr_filtered = ticks_curr[mask_curr]
-            
-            sort_idx_curr = np.argsort(ticks_curr_filtered)
-            pos_curr_aligned = pos_curr_filtered[sort_idx_curr]
-            val_curr_aligned = val_curr_filtered[sort_idx_curr]
-            
-            # Filter & Align Next
-            mask_next = np.isin(ticks_next, common_tickers)
-            pos_next_filtered = data_next['positions'][mask_next]
-            val_next_filtered = data_next['values'][mask_next]
-            ticks_next_filtered = ticks_next[mask_next]
-            
-            sort_idx_next = np.argsort(ticks_next_filtered)
-            pos_next_aligned = pos_next_filtered[sort_idx_next]
-            val_next_aligned = val_next_filtered[sort_idx_next]
-            
-            # 1. Contiguous Array oluştur
-            p_c = np.ascontiguousarray(pos_curr_aligned, dtype=np.float32)
-            v_c = np.ascontiguousarray(val_curr_aligned, dtype=np.float32)
-            p_n = np.ascontiguousarray(pos_next_aligned, dtype=np.float32)
-            v_n = np.ascontiguousarray(val_next_aligned, dtype=np.float32)
-            
-            # 2. Send to C++
-            self.engine.set_points_raw(p_c, v_c)
-            self.engine.set_target_points(p_n, v_n)
+            # Send to C++
+            if aligner is not None:
+                self.engine.set_aligned_frames(aligner)
+                order = ticker_index[id_index.get_indexer(np.asarray(aligner.aligned_ids(), dtype=np.int32))]
+            else:
+                order, p_c, v_c, p_n, v_n = aligned
+                self.engine.set_points_raw(p_c, v_c)
+                self.engine.set_target_points(p_n, v_n)
             
-            # 3. Send metadata to UI (labels, stats, feature values)
-            self._send_metadata_to_engine(data_curr)
+            # 3. Send metadata to UI (labels, stats, feature values), one row per uploaded point
+            self._send_metadata_to_engine(self._metadata_on_order(order, data_curr))
             
-            print(f"   -> {len(common_tickers)} points sent to GPU.")
+            print(f"   -> {n_common} points sent to GPU.")
             
             # Wait for user to view animation, polling for feature changes
             wait_time = 1.0
@@ -442,6 +452,216 @@ class Visualizer:
             # If changed, update the parameter for the next frames
             if current_color_feature != color_feature:
                 color_feature = current_color_feature
+                data_next = None  # Prepared with the old color feature
+            
+            data_curr = data_next
+
+    @staticmethod
+    def _push_aligned_frame(aligner, ticker_index: pd.Index, ticker_ids: np.ndarray, data: Dict[str, Any]):
+        """Push a prepared frame into a native FrameAligner."""
+        ids = ticker_ids[ticker_index.get_indexer(data['tickers'])]
+        aligner.push_frame(np.ascontiguousarray(ids, dtype=np.int32),
+                           np.ascontiguousarray(data['positions'], dtype=np.float32),
+                           np.ascontiguousarray(data['values'], dtype=np.float32))
+
+    @staticmethod
+    def _align_frames(data_curr: Dict[str, Any], data_next: Dict[str, Any]):
+        """
+        Join two prepared frames on their tickers (fallback when the engine has
+        no FrameAligner). Returns the shared tickers (sorted, the point order)
+        and contiguous (pos_curr, val_curr, pos_next, val_next), or None if no
+        tickers are shared.
+        """
+        common, idx_curr, idx_next = np.intersect1d(data_curr['tickers'], data_next['tickers'],
+                                                    return_indices=True)
+        if len(common) == 0:
+            return None
+        
+        return (pd.Index(common),
+                np.ascontiguousarray(data_curr['positions'][idx_curr], dtype=np.float32),
+                np.ascontiguousarray(data_curr['values'][idx_curr], dtype=np.float32),
+                np.ascontiguousarray(data_next['positions'][idx_next], dtype=np.float32),
+                np.ascontiguousarray(data_next['values'][idx_next], dtype=np.float32))
+
+    def play(self, start_date: str, end_date: str, method: str = 'pca', window: int = 32,
+             fps: float = 2.0, loop: bool = True, normalization: str = 'global'):
+        """
+        Plays a time range from a keyframe timeline on the GPU.
+
+        Every ticker seen in the range gets a fixed point index, and up to
+        `window` prepared frames stay resident on the GPU. Playback, scrubbing
+        and looping within the window need no uploads; this call keeps the
+        frames ahead of the playhead prefetched until the window is closed.
+        Falls back to animate() when the engine has no timeline.
+
+        Args:
+            start_date: Start date for the range.
+            end_date: End date for the range.
+            method: Dimensionality reduction method ('pca', 'tsne', 'umap').
+            window: Number of keyframes kept resident on the GPU.
+            fps: Playback speed in keyframes per second.
+            loop: Restart from the first frame after the last one.
+            normalization: See animate().
+        """
+        if not self.engine:
+            print("Engine not initialized.")
+            return
+        if not hasattr(self.engine, 'set_timeline'):
+            self.animate(start_date, end_date, method=method, normalization=normalization)
+            return
+
+        s = pd.to_datetime(start_date)
+        e = pd.to_datetime(end_date)
+        valid_dates = [d for d in self.get_dates() if s <= d <= e]
+        if not valid_dates:
+            print("No timestamps in range.")
+            return
+
+        in_range = self.df[self._date_col].between(s, e)
+        universe = pd.Index(pd.unique(self.df.loc[in_range, self._ticker_col]))
+        n_frames = len(valid_dates)
+        window = max(1, min(window, n_frames))
+
+        print(f"Playing {n_frames} timestamps, {len(universe)} tickers, {window} resident frames...")
+        self.engine.set_tickers([str(t) for t in universe])
+        self.engine.set_timeline(n_frames, len(universe), window)
+        self.engine.set_timeline_playback(True, fps, loop)
+
+        color_feature = None
+        slot_frames: Dict[int, int] = {}  # Window slot -> resident frame
+        metadata_sent = False
+
+        try:
+            while hasattr(self.engine, 'is_running') and self.engine.is_running():
+                if hasattr(self.engine, 'has_color_feature_changed') and self.engine.has_color_feature_changed():
+                    color_feature = self.engine.get_selected_color_feature_index()
+                    print(f"UI changed color feature to index {color_feature}")
+                    slot_frames.clear()  # Every resident frame is stale
+                    if hasattr(self.engine, 'invalidate_keyframes'):
+                        self.engine.invalidate_keyframes()
+                    metadata_sent = False
+
+                # The frames from the playhead to the end of the window, nearest first
+                base = int(self.engine.get_timeline_position())
+                wanted = [base + k for k in range(window)]
+                wanted = [f % n_frames for f in wanted] if loop else [f for f in wanted if f < n_frames]
+                missing = next((f for f in wanted if slot_frames.get(f % window) != f), None)
+
+                if missing is None:
+                    time.sleep(0.02)
+                    continue
+
+                data = self.prepare_frame(valid_dates[missing], method=method,
+                                          normalization=normalization, color_feature=color_feature)
+                self._push_keyframe(missing, universe, data)
+                slot_frames[missing % window] = missing
+                if not metadata_sent:
+                    # Tooltips and statistics of the first frame, in point (universe) order
+                    first = data if missing == 0 else self.prepare_frame(
+                        valid_dates[0], method=method, normalization=normalization, color_feature=color_feature)
+                    if first:
+                        self._send_metadata_to_engine(self._metadata_on_order(universe, first))
+                    metadata_sent = True
+        except KeyboardInterrupt:
+            print("Interrupted by user.")
+            self.stop()
+
+    def _push_keyframe(self, frame: int, universe: pd.Index, data: Dict[str, Any]):
+        """Upload a prepared frame into the timeline, NaN for tickers absent from it."""
+        positions, values, _ = self._frame_on_universe(universe, data)
+        self.engine.set_keyframe(frame, positions, values)
+
+    def _frame_on_universe(self, universe: pd.Index, data: Dict[str, Any], with_features: bool = False):
+        """Positions, values (and features) of a prepared frame in universe order, NaN where absent."""
+        positions = np.full((len(universe), 3), np.nan, dtype=np.float32)
+        values = np.zeros(len(universe), dtype=np.float32)
+        features = np.full((len(universe), len(self._feature_cols)), np.nan, dtype=np.float32) if with_features else None
+        if data:
+            rows = universe.get_indexer(data['tickers'])
+            keep = rows >= 0
+            positions[rows[keep]] = data['positions'][keep]
+            values[rows[keep]] = data['values'][keep]
+            if with_features:
+                features[rows[keep]] = data['all_feature_values'][keep]
+        return positions, values, features
+
+    def _metadata_on_order(self, order: pd.Index, data: Dict[str, Any]) -> Dict[str, Any]:
+        """
+        A prepared frame with its per-point metadata (features, categories) in
+        the order its points were uploaded in: row i describes point i, NaN
+        features and category 0 for tickers the frame does not have.
+        """
+        _, _, features = self._frame_on_universe(order, data, with_features=True)
+        meta = dict(data, tickers=np.asarray(order), all_feature_values=features)
+        if data.get('categories') is not None:
+            categories = np.zeros(len(order), dtype=np.uint8)
+            rows = order.get_indexer(data['tickers'])
+            keep = rows >= 0
+            categories[rows[keep]] = np.asarray(data['categories'])[keep]
+            meta['categories'] = categories
+        return meta
+
+    def save_qsp(self, path: str, start_date: Optional[str] = None, end_date: Optional[str] = None,
+                 method: str = 'pca', normalization: str = 'global') -> int:
+        """
+        Precomputes a time range into a .qsp session file (see qsplot.qsp).
+
+        Every ticker of the range gets a fixed point index, like play(). The
+        file stores the reduced positions, color values and raw features of
+        every frame, so open_qsp() can show it later without pandas or PCA.
+
+        Args:
+            path: Output .qsp file.
+            start_date: First date (default: first available).
+            end_date: Last date (default: last available).
+            method: Dimensionality reduction method ('pca', 'tsne', 'umap').
+            normalization: See animate().
+
+        Returns:
+            Number of frames written.
+        """
+        from .qsp import QspWriter
+
+        dates = self.get_dates()
+        if start_date is not None:
+            dates = [d for d in dates if d >= pd.to_datetime(start_date)]
+        if end_date is not None:
+            dates = [d for d in dates if d <= pd.to_datetime(end_date)]
+        if not dates:
+            print("No timestamps in range.")
+            return 0
+
+        in_range = self.df[self._date_col].between(dates[0], dates[-1])
+        universe = pd.Index(pd.unique(self.df.loc[in_range, self._ticker_col]))
+        frame_names = [pd.Timestamp(d).strftime('%Y-%m-%d') for d in dates]
+
+        print(f"Writing {len(dates)} frames of {len(universe)} tickers to {path}...")
+        with QspWriter(path, [str(t) for t in universe], len(dates),
+                       feature_names=self._feature_cols, frame_names=frame_names) as writer:
+            for frame, date in enumerate(dates):
+                data = self.prepare_frame(date, method=method, normalization=normalization)
+                writer.write_frame(frame, *self._frame_on_universe(universe, data, with_features=True))
+        return len(dates)
+
+    def open_qsp(self, path: str, window: int = 32, fps: float = 2.0, loop: bool = True):
+        """
+        Plays a .qsp session file written by save_qsp().
+
+        The engine maps the file and pages frames to the GPU itself, so
+        nothing is recomputed and this call returns immediately.
+
+        Args:
+            path: .qsp file.
+            window: Number of keyframes kept resident on the GPU.
+            fps: Playback speed in keyframes per second.
+            loop: Restart from the first frame after the last one.
+        """
+        if not self.engine or not hasattr(qsplot_engine, 'QspFile'):
+            print("Engine not initialized or without .qsp support.")
+            return
+        dataset = qsplot_engine.QspFile.open(path)
+        self.engine.load_dataset(dataset, window)
+        self.engine.set_timeline_playback(True, fps, loop)
 
     def static(self, date: Optional[str] = None, method: str = 'pca', block: bool = True):
         """
@@ -523,7 +743,118 @@ class Visualizer:
             except KeyboardInterrupt:
                 print("Interrupted by user.")
                 self.stop()
-    
+
+    def compare(self, by: str, date: Optional[str] = None, method: str = 'pca',
+                link_cameras: bool = True, block: bool = True):
+        """
+        Small multiples: one viewport per value of a column, side by side.
+
+        The snapshot is uploaded once; every viewport draws the points of its
+        group from the same GPU buffers with its own camera, so adding panels
+        costs no extra memory. At most 16 groups are shown.
+
+        Args:
+            by: Column whose values split the points (e.g. 'Sector').
+            date: Snapshot to show. If None, uses the first available date.
+            method: Dimensionality reduction method ('pca', 'tsne', 'umap')
+            link_cameras: Orbit and zoom all viewports together.
+            block: If True, blocks until the visualizer window is closed.
+        """
+        if not self.engine:
+            print("Engine not initialized.")
+            return
+        if self.df is None or by not in self.df.columns:
+            print(f"Column {by!r} not found.")
+            return
+
+        dates = self.get_dates()
+        if len(dates) == 0:
+            print("No data loaded. Use load_data() first.")
+            return
+        selected_date = dates[0] if date is None else pd.to_datetime(date)
+        if selected_date not in dates:
+            print(f"Warning: Date {date} not found. Using first available: {dates[0]}")
+            selected_date = dates[0]
+
+        if not hasattr(self.engine, 'set_viewport_count'):
+            print("Engine without viewport support, showing a single view.")
+            self.static(selected_date, method=method, block=block)
+            return
+
+        # Same row order as prepare_frame(), so positions in the group are point indices
+        groups = self.df.loc[self.df[self._date_col] == selected_date, by].values
+        names = pd.unique(groups[pd.notna(groups)])
+        if len(names) > 16:
+            print(f"Warning: {len(names)} groups in {by!r}, showing the first 16.")
+            names = names[:16]
+
+        self.engine.set_viewport_count(len(names))
+        for viewport, name in enumerate(names):
+            indices = np.flatnonzero(groups == name).astype(np.uint32)
+            self.engine.set_viewport_subset(viewport, indices)
+            self.engine.set_viewport_label(viewport, str(name))
+        self.engine.set_viewports_linked(link_cameras)
+
+        self.static(selected_date, method=method, block=block)
+
+    def export_frames(self, path_pattern: str, start_date: Optional[str] = None,
+                      end_date: Optional[str] = None, method: str = 'pca',
+                      camera: Optional[tuple] = None, normalization: str = 'global',
+                      timeout: float = -1.0) -> int:
+        """
+        Renders one offscreen image per timestamp, without UI.
+
+        Frames are queued as they are prepared; reading them back and encoding
+        them runs on the engine's threads, so preparing the next frame overlaps
+        the export of the previous ones. Works with a headless renderer
+        (Visualizer(config) with config.headless = True).
+
+        Args:
+            path_pattern: Output path, formatted with `frame` (index) and `date`,
+                e.g. 'out/{frame:05d}.png'. A .ppm extension writes PPM.
+            start_date: First timestamp (default: the first one).
+            end_date: Last timestamp (default: the last one).
+            method: Dimensionality reduction method ('pca', 'tsne', 'umap').
+            camera: Optional (yaw, pitch, distance) used for every frame.
+            normalization: See animate().
+            timeout: Seconds to wait for the files (< 0 waits until done).
+
+        Returns:
+            Number of frames queued.
+        """
+        if not self.engine or not hasattr(self.engine, 'render_frames'):
+            print("Engine not initialized.")
+            return 0
+
+        dates = self.get_dates()
+        if start_date is not None:
+            dates = [d for d in dates if d >= pd.to_datetime(start_date)]
+        if end_date is not None:
+            dates = [d for d in dates if d <= pd.to_datetime(end_date)]
+
+        cameras = [camera] if camera is not None else []
+        queued = 0
+        metadata_sent = False
+        for date in dates:
+            data = self.prepare_frame(date, method=method, normalization=normalization)
+            if not data:
+                continue
+            positions = np.ascontiguousarray(data['positions'], dtype=np.float32)
+            values = np.ascontiguousarray(data['values'], dtype=np.float32)
+            self.engine.set_points_raw(positions, values)
+            self.engine.set_target_points(positions, values)
+            if not metadata_sent:
+                self._send_metadata_to_engine(data)
+                metadata_sent = True
+
+            path = path_pattern.format(frame=queued, date=pd.Timestamp(date).strftime('%Y-%m-%d'))
+            self.engine.render_frames([path], cameras=cameras, wait=False)
+            queued += 1
+
+        if queued and not self.engine.wait_for_frames(timeout):
+            print("Warning: not every frame was written before the timeout.")
+        return queued
+
     def _send_metadata_to_engine(self, data: Dict[str, Any]):
         """
         Send dimension labels, feature names, stats, explained variance,
@@ -545,19 +876,50 @@ class Visualizer:
         if hasattr(self.engine, 'set_feature_names') and self._feature_cols:
             self.engine.set_feature_names(self._feature_cols)
         
-        # Stats panel data
-        if hasattr(self.engine, 'set_stats') and 'stats' in data:
-            self.engine.set_stats(data['stats'])
-        
         # PCA explained variance
         if hasattr(self.engine, 'set_explained_variance') and data.get('explained_variance'):
             ev = np.array(data['explained_variance'], dtype=np.float32)
             self.engine.set_explained_variance(np.ascontiguousarray(ev))
         
-        # All feature values for enhanced tooltips
-        if hasattr(self.engine, 'set_all_feature_values') and 'all_feature_values' in data:
-            fv = np.ascontiguousarray(data['all_feature_values'], dtype=np.float32)
-            self.engine.set_all_feature_values(fv)
+        # Labels for the categorical color mode: a uint8 per point, the engine
+        # switches palettes without re-uploading the points
+        categories = data.get('categories')
+        if categories is not None and not self._auto_categories and hasattr(self.engine, 'set_categories'):
+            self.engine.set_categories(np.ascontiguousarray(categories, dtype=np.uint8), self._category_names)
+
+        fv = data.get('all_feature_values')
+        if fv is None:
+            return
+        if fv.dtype not in (np.float32, np.float64):
+            fv = fv.astype(np.float64)
+
+        # Feature store: the engine views the matrix in place, reads tooltip
+        # rows on hover and computes the Statistics tab natively
+        if hasattr(qsplot_engine, 'FeatureStore') and hasattr(self.engine, 'set_feature_store'):
+            self.engine.set_feature_store(qsplot_engine.FeatureStore(fv))
+            return
+
+        # Older engines: stats from numpy and a float32 copy for the tooltips
+        if hasattr(self.engine, 'set_stats'):
+            self.engine.set_stats(self._compute_feature_stats(fv))
+        if hasattr(self.engine, 'set_all_feature_values'):
+            self.engine.set_all_feature_values(np.ascontiguousarray(fv, dtype=np.float32))
+
+    def _compute_feature_stats(self, X: np.ndarray) -> List[Dict[str, Any]]:
+        """Per-feature statistics for engines without a FeatureStore."""
+        stats = []
+        for i, col in enumerate(self._feature_cols):
+            col_vals = X[:, i]
+            stats.append({
+                "name": col,
+                "min": float(np.nanmin(col_vals)),
+                "max": float(np.nanmax(col_vals)),
+                "mean": float(np.nanmean(col_vals)),
+                "std": float(np.nanstd(col_vals)),
+                "median": float(np.nanmedian(col_vals)),
+                "count": int(np.count_nonzero(np.isfinite(col_vals)))
+            })
+        return stats
     
     # --- Phase 2: Selection Export ---
     
@@ -627,7 +989,79 @@ class Visualizer:
         df.to_csv(path, index=False)
         print(f"Exported {len(df)} points to {path}")
         return True
-                
+
+    def filter(self, ranges: Optional[Dict[str, tuple]] = None, select: bool = False):
+        """
+        Shows only points whose features lie in every given range.
+
+        The ranges are evaluated on the GPU against the feature columns the
+        engine already holds, so nothing is recomputed or uploaded again, and
+        they keep applying as frames change. Filtered-out points cannot be
+        hovered, clicked or brushed.
+
+        Args:
+            ranges: {feature: (min, max)}, inclusive; None for an open bound.
+                    Empty or None clears every filter. At most 8 features.
+            select: Also replace the selection with the passing points
+                    (see get_selected_points), once they are known.
+
+        Example:
+            vis.filter({"Beta": (0.8, 1.2), "MarketCap": (10e9, None)})
+        """
+        if not self.engine or not hasattr(self.engine, 'set_range_filters'):
+            print("Engine not initialized or without range filters.")
+            return
+
+        converted = []
+        for name, (low, high) in (ranges or {}).items():
+            if name not in self._feature_cols:
+                print(f"Warning: {name!r} is not a feature column, ignored.")
+                continue
+            low = -np.inf if low is None else float(low)
+            high = np.inf if high is None else float(high)
+            converted.append((self._feature_cols.index(name), low, high))
+
+        self.engine.set_range_filters(converted)
+        if select and converted:
+            self.engine.select_filtered()
+
+    def filtered_count(self) -> int:
+        """Number of points passing filter() (-1 without filters), a frame or two after a change."""
+        if not self.engine or not hasattr(self.engine, 'get_filtered_count'):
+            return -1
+        return self.engine.get_filtered_count()
+
+    def nearest(self, point_id: int, k: int = 50) -> List[int]:
+        """
+        IDs of the k points nearest to a point, as currently drawn.
+
+        Answered by the engine's spatial index over the drawn positions (morph
+        and playback included), which it rebuilds in parallel only when the
+        points changed since the last query.
+
+        Args:
+            point_id: Point to search around (an ID as in get_selected_points).
+            k: Number of neighbours.
+
+        Returns:
+            Nearest first, without point_id; [] if it is not drawn.
+        """
+        if not self.engine or not hasattr(self.engine, 'query_knn'):
+            print("Engine not initialized or without spatial queries.")
+            return []
+        return self.engine.query_knn(int(point_id), int(k))
+
+    def within(self, center, radius: float) -> List[int]:
+        """
+        IDs of every point within radius (world units) of an (x, y, z) position
+        as currently drawn, nearest first. See nearest().
+        """
+        if not self.engine or not hasattr(self.engine, 'query_radius'):
+            print("Engine not initialized or without spatial queries.")
+            return []
+        x, y, z = (float(c) for c in center)
+        return self.engine.query_radius((x, y, z), float(radius))
+
     # --- Phase 3: ML Integration ---
     
     def compute_clusters(self, n_clusters: int = 5, method: str = 'kmeans'):
@@ -636,7 +1070,8 @@ class Visualizer:
         
         Args:
             n_clusters: Number of clusters to find.
-            method: Clustering algorithm ('kmeans').
+            method: Clustering algorithm ('kmeans', or 'minibatch' for the native
+                warm-started mini-batch k-means).
         """
         if self.df is None or not self._feature_cols:
             print("No data loaded to compute clusters.")
@@ -648,6 +1083,8 @@ class Visualizer:
         
         feature_name = 'Cluster'
         self.df[feature_name] = labels
+        n_labels = int(labels.max()) + 1 if len(labels) else 0
+        self._set_categories(labels, [f"Cluster {k}" for k in range(n_labels)])
         
         if feature_name not in self._feature_cols:
             self._feature_cols.append(feature_name)
@@ -657,7 +1094,8 @@ class Visualizer:
         self._global_pca_cache.clear()
         self._fit_global_pca(feature_name)
         
-        print(f"✓ Added '{feature_name}' as a new feature. Select it from the UI Color Feature dropdown.")
+        print(f"✓ Added '{feature_name}' as a new feature. Select it from the UI Color Feature dropdown, "
+              "or the Categorical color mode.")
         
     def compute_outliers(self, contamination: float = 0.05, method: str = 'isolation_forest'):
         """
@@ -665,7 +1103,8 @@ class Visualizer:
         
         Args:
             contamination: Expected proportion of outliers.
-            method: Outlier detection algorithm ('isolation_forest').
+            method: Outlier detection algorithm ('isolation_forest', or 'knn' for the
+                native nearest-neighbor distance score).
         """
         if self.df is None or not self._feature_cols:
             print("No data loaded to compute outliers.")
@@ -677,6 +1116,9 @@ class Visualizer:
         
         feature_name = 'Outlier_Score'
         self.df[feature_name] = scores
+        # The top `contamination` share of scores are the outliers, by the engine's rule
+        flags = self.processor.flag_outliers(scores, contamination)
+        self._set_categories(flags, ["Inlier", "Outlier"])
         
         if feature_name not in self._feature_cols:
             self._feature_cols.append(feature_name)
@@ -686,7 +1128,82 @@ class Visualizer:
         self._global_pca_cache.clear()
         self._fit_global_pca(feature_name)
         
-        print(f"✓ Added '{feature_name}' as a new feature. Select it from the UI Color Feature dropdown.")
+        print(f"✓ Added '{feature_name}' as a new feature. Select it from the UI Color Feature dropdown, "
+              "or the Categorical color mode.")
+
+    def auto_categories(self, mode: str = 'clusters', n_clusters: int = 5,
+                        contamination: float = 0.05, neighbors: int = 10):
+        """
+        Let the engine compute the categorical colors of every new frame natively.
+
+        'clusters' fits mini-batch k-means on each frame's features, starting
+        from the previous frame's centroids so cluster numbers stay stable
+        through an animation; 'outliers' flags the `contamination` share of
+        points furthest from their `neighbors` nearest neighbors in the drawn
+        (PCA) positions. Nothing passes through Python per frame. Takes effect
+        with the next frame sent; 'off' returns to compute_clusters() and
+        compute_outliers() labels.
+
+        Args:
+            mode: 'clusters', 'outliers' or 'off'.
+        """
+        if not self.engine or not hasattr(self.engine, 'set_auto_categories'):
+            print("Engine not initialized or without native categories.")
+            return
+        self.engine.set_auto_categories(mode, n_clusters, contamination, neighbors)
+        self._auto_categories = mode != 'off'
+
+    # --- Session Recording ---
+
+    def record(self, path: str, features: bool = False) -> bool:
+        """
+        Record everything sent to the engine from now on to a .qsr file.
+
+        Every frame, patch, label and camera move (mouse or API) is logged with
+        its time, compressed on a background thread. Feature matrices are
+        large and only logged with features=True (tooltips and statistics of
+        the replay). A later record() replaces the recording.
+
+        Args:
+            path: File to create.
+            features: Also log the per-point feature values.
+        """
+        if not self.engine or not hasattr(self.engine, 'start_recording'):
+            print("Engine not initialized or without session recording.")
+            return False
+        self.engine.start_recording(path, features)
+        return True
+
+    def stop_recording(self) -> Dict[str, Any]:
+        """Finish the recording; returns its counters (records, bytes, stored_bytes, ...)."""
+        if not self.engine or not hasattr(self.engine, 'stop_recording'):
+            return {}
+        self.engine.stop_recording()
+        return self.engine.get_recording_stats()
+
+    def replay(self, path: str, speed: float = 1.0) -> int:
+        """
+        Play a recording back into the window, blocking until it ends or the
+        window is closed.
+
+        Args:
+            path: A file written by record().
+            speed: Multiple of the recorded pace; 0 replays as fast as the
+                engine accepts the frames (a load test).
+
+        Returns:
+            Number of records replayed.
+        """
+        if not self.engine or not hasattr(self.engine, 'replay'):
+            print("Engine not initialized or without session replay.")
+            return 0
+        return self.engine.replay(path, float(speed))
+
+    def _set_categories(self, labels: np.ndarray, names: List[str]):
+        """Keep per-row labels for the categorical color mode; sent with the next frame."""
+        labels = np.clip(np.asarray(labels, dtype=np.int64), 0, 255).astype(np.uint8)
+        self._categories = pd.Series(labels, index=self.df.index)
+        self._category_names = names[:256]
 
     def stop(self):
         if self.engine:
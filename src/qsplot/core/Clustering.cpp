@@ -0,0 +1,251 @@
+#include "Clustering.h"
+#include "FeatureStore.h"
+#include "Parallel.h"
+#include "SpatialIndex.h"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <random>
+
+namespace {
+
+constexpr size_t kBlockRows = 1024;        // Rows per distance GEMM
+constexpr size_t kMinChunk = 1 << 14;      // Rows per parallel chunk when labelling
+constexpr size_t kSampleRows = 1 << 14;    // Evenly spaced rows for seeding and the variance
+constexpr size_t kOutlierChunk = 1 << 12;  // Points per parallel chunk of kNN queries
+
+using Matrix = MiniBatchKMeans::Matrix;
+
+inline float finiteOr0(float v) { return std::isfinite(v) ? v : 0.0f; }
+
+// Rows begin .. begin + n of the store (rows == nullptr) or rows[0 .. n)
+void gather(const FeatureStore& store, const size_t* rows, size_t begin, size_t n, Matrix& block) {
+    block.resize((Eigen::Index)n, (Eigen::Index)store.cols());
+    for (size_t i = 0; i < n; i++) {
+        float* out = block.row((Eigen::Index)i).data();
+        store.row(rows ? rows[i] : begin + i, out);
+        for (size_t c = 0; c < store.cols(); c++) out[c] = finiteOr0(out[c]);
+    }
+}
+
+// Nearest centroid of every block row and the squared distance to it
+void assign(const Matrix& block, const Matrix& centroids, const Eigen::RowVectorXf& centroidNorms,
+            int32_t* labels, float* distances) {
+    Matrix d = (-2.0f * block * centroids.transpose()).rowwise() + centroidNorms;
+    Eigen::VectorXf rowNorms = block.rowwise().squaredNorm();
+    for (Eigen::Index i = 0; i < d.rows(); i++) {
+        Eigen::Index best;
+        float nearest = d.row(i).minCoeff(&best);
+        labels[i] = (int32_t)best;
+        if (distances) distances[i] = std::max(0.0f, nearest + rowNorms[i]);
+    }
+}
+
+}  // namespace
+
+MiniBatchKMeans::MiniBatchKMeans() : MiniBatchKMeans(Options()) {}
+
+MiniBatchKMeans::MiniBatchKMeans(const Options& options) : m_options(options) {
+    m_options.clusters = std::max(1, m_options.clusters);
+    m_options.batchSize = std::max<size_t>(1, m_options.batchSize);
+    m_options.maxIterations = std::max(1, m_options.maxIterations);
+}
+
+void MiniBatchKMeans::reset() {
+    m_centroids.resize(0, 0);
+    m_inertia = 0.0;
+    m_iterations = 0;
+}
+
+void MiniBatchKMeans::seed(const Matrix& sample, size_t clusters) {
+    // k-means++: each further centroid is drawn with probability proportional to
+    // its squared distance from the nearest one chosen so far
+    std::mt19937_64 rng(m_options.seed);
+    Eigen::Index n = sample.rows();
+    m_centroids.resize((Eigen::Index)clusters, sample.cols());
+    m_centroids.row(0) = sample.row(std::uniform_int_distribution<Eigen::Index>(0, n - 1)(rng));
+    Eigen::VectorXf nearest = (sample.rowwise() - m_centroids.row(0)).rowwise().squaredNorm();
+
+    for (Eigen::Index c = 1; c < (Eigen::Index)clusters; c++) {
+        double total = nearest.cast<double>().sum();
+        Eigen::Index next = 0;
+        if (total > 0.0) {
+            double target = std::uniform_real_distribution<double>(0.0, total)(rng);
+            double running = 0.0;
+            for (next = 0; next + 1 < n; next++) {
+                running += nearest[next];
+                if (running > target) break;
+            }
+        } else {
+            next = std::uniform_int_distribution<Eigen::Index>(0, n - 1)(rng);  // All rows coincide
+        }
+        m_centroids.row(c) = sample.row(next);
+        nearest = nearest.cwiseMin((sample.rowwise() - m_centroids.row(c)).rowwise().squaredNorm());
+    }
+}
+
+std::vector<int32_t> MiniBatchKMeans::fitPredict(const FeatureStore& store) {
+    size_t rows = store.rows(), cols = store.cols();
+    m_iterations = 0;
+    if (rows == 0 || cols == 0) {
+        m_inertia = 0.0;
+        return std::vector<int32_t>(rows, 0);
+    }
+
+    // Evenly spaced rows: the k-means++ candidates and the convergence scale
+    size_t samples = std::min(rows, kSampleRows);
+    std::vector<size_t> sampleRows(samples);
+    for (size_t i = 0; i < samples; i++) sampleRows[i] = i * rows / samples;
+    Matrix sample;
+    gather(store, sampleRows.data(), 0, samples, sample);
+    Eigen::RowVectorXf mean = sample.colwise().mean();
+    double variance = (sample.rowwise() - mean).squaredNorm() / ((double)samples * (double)cols);
+    double tolerance = (double)m_options.tolerance * variance;
+
+    size_t clusters = std::min<size_t>((size_t)m_options.clusters, rows);
+    if (m_centroids.rows() != (Eigen::Index)clusters || m_centroids.cols() != (Eigen::Index)cols) {
+        seed(sample, clusters);
+    }
+
+    std::mt19937_64 rng(m_options.seed + ++m_fits);
+    std::uniform_int_distribution<size_t> pick(0, rows - 1);
+    size_t batch = std::min(m_options.batchSize, rows);
+    std::vector<size_t> indices(batch);
+    std::vector<double> hits(clusters, 0.0);  // Rows each centroid has absorbed this fit
+
+    size_t chunks = parallelChunkCount(batch, kBlockRows);
+    std::vector<Eigen::MatrixXd> sums(chunks);
+    std::vector<std::vector<double>> counts(chunks);
+
+    for (int iteration = 0; iteration < m_options.maxIterations; iteration++) {
+        for (size_t& i : indices) i = pick(rng);
+        std::sort(indices.begin(), indices.end());  // Walk the store forward
+
+        // Per-centroid sums and counts of the batch rows nearest to it
+        Eigen::RowVectorXf norms = m_centroids.rowwise().squaredNorm().transpose();
+        parallelFor(batch, kBlockRows, [&](size_t chunk, size_t begin, size_t end) {
+            sums[chunk] = Eigen::MatrixXd::Zero((Eigen::Index)clusters, (Eigen::Index)cols);
+            counts[chunk].assign(clusters, 0.0);
+            Matrix block;
+            std::vector<int32_t> labels(kBlockRows);
+            for (size_t b = begin; b < end; b += kBlockRows) {
+                size_t n = std::min(kBlockRows, end - b);
+                gather(store, indices.data() + b, 0, n, block);
+                assign(block, m_centroids, norms, labels.data(), nullptr);
+                for (size_t i = 0; i < n; i++) {
+                    sums[chunk].row(labels[i]) += block.row((Eigen::Index)i).cast<double>();
+                    counts[chunk][labels[i]] += 1.0;
+                }
+            }
+        });
+
+        // Each centroid moves to its batch mean by (batch hits / total hits)
+        double shift = 0.0;
+        for (size_t c = 0; c < clusters; c++) {
+            double n = 0.0;
+            Eigen::RowVectorXd sum = Eigen::RowVectorXd::Zero((Eigen::Index)cols);
+            for (size_t k = 0; k < chunks; k++) {
+                n += counts[k][c];
+                sum += sums[k].row((Eigen::Index)c);
+            }
+            if (n == 0.0) continue;  // Empty in this batch: stays put
+            hits[c] += n;
+            double rate = n / hits[c];
+            Eigen::RowVectorXd centroid = m_centroids.row((Eigen::Index)c).cast<double>();
+            Eigen::RowVectorXd step = rate * (sum / n - centroid);
+            m_centroids.row((Eigen::Index)c) = (centroid + step).cast<float>();
+            shift += step.squaredNorm();
+        }
+        m_iterations++;
+        if (shift / (double)clusters <= tolerance) break;
+    }
+
+    return label(store, &m_inertia);
+}
+
+std::vector<int32_t> MiniBatchKMeans::predict(const FeatureStore& store) const {
+    if (!fitted() || m_centroids.cols() != (Eigen::Index)store.cols()) {
+        return std::vector<int32_t>(store.rows(), 0);
+    }
+    return label(store, nullptr);
+}
+
+std::vector<int32_t> MiniBatchKMeans::label(const FeatureStore& store, double* inertia) const {
+    size_t rows = store.rows();
+    std::vector<int32_t> labels(rows);
+    std::vector<double> partial(parallelChunkCount(rows, kMinChunk), 0.0);
+    Eigen::RowVectorXf norms = m_centroids.rowwise().squaredNorm().transpose();
+
+    parallelFor(rows, kMinChunk, [&](size_t chunk, size_t begin, size_t end) {
+        Matrix block;
+        std::vector<float> distances(kBlockRows);
+        for (size_t b = begin; b < end; b += kBlockRows) {
+            size_t n = std::min(kBlockRows, end - b);
+            gather(store, nullptr, b, n, block);
+            assign(block, m_centroids, norms, labels.data() + b, distances.data());
+            for (size_t i = 0; i < n; i++) partial[chunk] += distances[i];
+        }
+    });
+
+    if (inertia) {
+        *inertia = 0.0;
+        for (double p : partial) *inertia += p;
+    }
+    return labels;
+}
+
+std::vector<float> knnOutlierScores(const float* positions, size_t count, size_t neighbors) {
+    std::vector<float> scores(count, 0.0f);
+    if (!positions || count == 0) return scores;
+    neighbors = std::max<size_t>(1, neighbors);
+
+    SpatialIndex index;
+    index.build(positions, count);
+    parallelFor(count, kOutlierChunk, [&](size_t, size_t begin, size_t end) {
+        for (size_t i = begin; i < end; i++) {
+            if (!index.contains((int)i)) continue;
+            const float* p = index.position((int)i);
+            std::vector<int> nearest = index.knn(p, neighbors, (int)i);
+            if (nearest.empty()) continue;
+            double sum = 0.0;
+            for (int id : nearest) {
+                const float* q = index.position(id);
+                float dx = q[0] - p[0], dy = q[1] - p[1], dz = q[2] - p[2];
+                sum += std::sqrt(dx * dx + dy * dy + dz * dz);
+            }
+            scores[i] = (float)(sum / nearest.size());
+        }
+    });
+
+    // Min-max over the indexed points, 1 = most isolated
+    float lo = std::numeric_limits<float>::max(), hi = 0.0f;
+    for (size_t i = 0; i < count; i++) {
+        if (!index.contains((int)i)) continue;
+        lo = std::min(lo, scores[i]);
+        hi = std::max(hi, scores[i]);
+    }
+    float range = hi - lo;
+    for (size_t i = 0; i < count; i++) {
+        scores[i] = range > 0.0f && index.contains((int)i) ? (scores[i] - lo) / range : 0.0f;
+    }
+    return scores;
+}
+
+std::vector<uint8_t> flagOutliers(const std::vector<float>& scores, float contamination) {
+    std::vector<uint8_t> flags(scores.size(), 0);
+    if (scores.empty() || !(contamination > 0.0f)) return flags;
+
+    // The (1 - contamination) quantile, as np.quantile's lower neighbour
+    std::vector<float> sorted(scores);
+    size_t k = (size_t)std::floor((1.0 - std::min(contamination, 1.0f)) * (double)(sorted.size() - 1));
+    std::nth_element(sorted.begin(), sorted.begin() + k, sorted.end());
+    float threshold = sorted[k];
+
+    // At the minimum (e.g. every score tied), >= would flag every point
+    bool strict = threshold <= *std::min_element(sorted.begin(), sorted.end());
+    for (size_t i = 0; i < scores.size(); i++) {
+        flags[i] = strict ? scores[i] > threshold : scores[i] >= threshold;
+    }
+    return flags;
+}
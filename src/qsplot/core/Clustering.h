@@ -0,0 +1,81 @@
+#pragma once
+
+#include <Eigen/Dense>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+class FeatureStore;
+
+/**
+ * @brief Mini-batch k-means (Sculley 2010) over a FeatureStore.
+ *
+ * Each iteration draws batchSize random rows, assigns them to the nearest
+ * centroid and moves every centroid towards the mean of its batch rows with a
+ * per-centroid learning rate of (batch hits / total hits). A fit stops after
+ * maxIterations batches or once the centroids move less than `tolerance`
+ * times the mean feature variance.
+ *
+ * The centroids are kept between fits: fitting the next frame of a series
+ * starts from the last frame's centroids (k-means++ seeding only on the first
+ * fit, after reset() or when the feature count changes), so it converges in a
+ * few batches and cluster k stays the same group from frame to frame.
+ *
+ * Distances are computed for blocks of rows as one float GEMM,
+ * |x|^2 - 2 x.c + |c|^2, and the blocks run on all cores. Non-finite feature
+ * values count as 0.
+ */
+class MiniBatchKMeans {
+public:
+    using Matrix = Eigen::Matrix<float, Eigen::Dynamic, Eigen::Dynamic, Eigen::RowMajor>;
+
+    struct Options {
+        int clusters = 5;
+        size_t batchSize = 4096;
+        int maxIterations = 100;   // Batches per fit
+        float tolerance = 1e-4f;
+        uint32_t seed = 42;
+    };
+
+    MiniBatchKMeans();
+    explicit MiniBatchKMeans(const Options& options);
+
+    // Fit on every row of `store` and label them (0 .. clusters - 1)
+    std::vector<int32_t> fitPredict(const FeatureStore& store);
+    // Label rows with the current centroids (all 0 before the first fit)
+    std::vector<int32_t> predict(const FeatureStore& store) const;
+
+    // Forget the centroids: the next fit seeds from scratch
+    void reset();
+
+    const Options& options() const { return m_options; }
+    bool fitted() const { return m_centroids.rows() > 0; }
+    const Matrix& centroids() const { return m_centroids; }  // clusters x features
+    double inertia() const { return m_inertia; }             // Sum of squared distances of the last labelling
+    int iterations() const { return m_iterations; }          // Batches of the last fit
+
+private:
+    void seed(const Matrix& sample, size_t clusters);  // k-means++
+    std::vector<int32_t> label(const FeatureStore& store, double* inertia) const;
+
+    Options m_options;
+    Matrix m_centroids;
+    double m_inertia = 0.0;
+    int m_iterations = 0;
+    uint64_t m_fits = 0;  // Varies the batch draws between fits
+};
+
+/**
+ * @brief Distance-based outlier score of every point (e.g. the PCA positions)
+ *
+ * The mean distance to the `neighbors` nearest points, found with a
+ * SpatialIndex built over the positions and queried on all cores, scaled to
+ * [0, 1] so that 1 is the most isolated point. Points with a non-finite
+ * position score 0.
+ *
+ * @param positions count x 3 floats
+ */
+std::vector<float> knnOutlierScores(const float* positions, size_t count, size_t neighbors = 10);
+
+// Flags (1) the `contamination` share of points with the highest score; none when all scores tie
+std::vector<uint8_t> flagOutliers(const std::vector<float>& scores, float contamination);
@@ -1,81 +1,421 @@
 #include "DataProcessor.h"
+#include "Parallel.h"
+#include <algorithm>
 #include <iostream>
+#include <random>
 
-DataProcessor::DataProcessor() : m_hasData(false) {
+namespace {
+    // Rows per block: bounds the temporaries of the Gram and projection passes
+    constexpr size_t kPcaBlockRows = 4096;
+
+    // Memory for the per-thread D x D Gram partials: wide inputs use fewer threads
+    // rather than T * D^2 doubles (one 4096-wide partial is already 128 MB)
+    constexpr size_t kGramBudgetBytes = size_t(512) << 20;
+
+    // Randomized solver: extra basis vectors, and the width it starts paying off at
+    constexpr Eigen::Index kOversample = 10;
+    constexpr Eigen::Index kRandomizedMinDims = 512;
+    constexpr unsigned int kRandomSeed = 0x5eed;
+
+    // out = A * B, rows of A split across threads
+    Eigen::MatrixXd parallelProduct(const Eigen::MatrixXd& A, const Eigen::MatrixXd& B) {
+        Eigen::MatrixXd out(A.rows(), B.cols());
+        parallelFor((size_t)A.rows(), 256, [&](size_t, size_t begin, size_t end) {
+            Eigen::Index n = (Eigen::Index)(end - begin);
+            out.middleRows((Eigen::Index)begin, n).noalias() = A.middleRows((Eigen::Index)begin, n) * B;
+        });
+        return out;
+    }
+
+    Eigen::MatrixXd orthonormalBasis(const Eigen::MatrixXd& Y) {
+        Eigen::HouseholderQR<Eigen::MatrixXd> qr(Y);
+        return qr.householderQ() * Eigen::MatrixXd::Identity(Y.rows(), Y.cols());
+    }
+
+    // Top-k eigenpairs of a symmetric PSD matrix by randomized subspace iteration:
+    // O(D^2 k) per iteration instead of the O(D^3) full solve. Largest first.
+    void randomizedEigen(const Eigen::MatrixXd& A, int k, int powerIterations,
+                         Eigen::MatrixXd& vectors, Eigen::VectorXd& values) {
+        Eigen::Index width = std::min<Eigen::Index>(A.rows(), k + kOversample);
+
+        // Fixed seed: the same data always gives the same axes
+        std::mt19937 rng(kRandomSeed);
+        std::normal_distribution<double> normal;
+        Eigen::MatrixXd omega(A.rows(), width);
+        for (Eigen::Index i = 0; i < omega.size(); i++) omega.data()[i] = normal(rng);
+
+        Eigen::MatrixXd Q = orthonormalBasis(parallelProduct(A, omega));
+        for (int i = 0; i < powerIterations; i++) {
+            Q = orthonormalBasis(parallelProduct(A, Q));
+        }
+
+        // Rayleigh-Ritz on the captured subspace
+        Eigen::MatrixXd B = Q.transpose() * parallelProduct(A, Q);
+        Eigen::SelfAdjointEigenSolver<Eigen::MatrixXd> eigen(0.5 * (B + B.transpose()));
+        vectors = Q * eigen.eigenvectors().rightCols(k).rowwise().reverse();
+        values = eigen.eigenvalues().tail(k).reverse();
+    }
+
+    // Column sums and lower-triangle Gram of (X - shift), one partial per thread,
+    // with no more partials than fit in kGramBudgetBytes
+    template <typename MatrixT>
+    void accumulateGram(const MatrixT& X, const Eigen::RowVectorXd& shift,
+                        std::vector<Eigen::RowVectorXd>& sums, std::vector<Eigen::MatrixXd>& grams) {
+        const Eigen::Index dims = X.cols();
+        size_t rows = (size_t)X.rows();
+        size_t gramBytes = std::max<size_t>(1, sizeof(double) * (size_t)dims * (size_t)dims);
+        size_t maxPartials = std::max<size_t>(1, kGramBudgetBytes / gramBytes);
+        size_t grain = std::max(kPcaBlockRows, (rows + maxPartials - 1) / maxPartials);
+
+        size_t chunks = parallelChunkCount(rows, grain);
+        sums.assign(chunks, Eigen::RowVectorXd::Zero(dims));
+        grams.assign(chunks, Eigen::MatrixXd::Zero(dims, dims));
+
+        parallelFor(rows, grain, [&](size_t chunk, size_t begin, size_t end) {
+            Eigen::MatrixXd block;
+            for (size_t b = begin; b < end; b += kPcaBlockRows) {
+                Eigen::Index n = (Eigen::Index)std::min(kPcaBlockRows, end - b);
+                block = X.middleRows((Eigen::Index)b, n).template cast<double>().rowwise() - shift;
+                sums[chunk] += block.colwise().sum();
+                grams[chunk].template selfadjointView<Eigen::Lower>().rankUpdate(block.transpose());
+            }
+        });
+    }
+
+    // Correlation matrix of a covariance matrix; invStd gets 1 / std (1 for constant features)
+    Eigen::MatrixXd correlationOf(const Eigen::MatrixXd& cov, Eigen::VectorXd& invStd) {
+        Eigen::VectorXd stdDevs = cov.diagonal().cwiseMax(0.0).cwiseSqrt();
+
+        // Avoid division by zero
+        for (Eigen::Index i = 0; i < stdDevs.size(); ++i) {
+            if (stdDevs[i] < 1e-9) stdDevs[i] = 1.0;
+        }
+
+        invStd = stdDevs.cwiseInverse();
+        return invStd.asDiagonal() * cov * invStd.asDiagonal();
+    }
+
+    // out = X * weights - bias, block by block
+    template <typename MatrixT>
+    void projectRows(const MatrixT& X, const Eigen::MatrixXd& weights, const Eigen::RowVectorXd& bias,
+                     Eigen::MatrixXd& out) {
+        parallelFor((size_t)X.rows(), kPcaBlockRows, [&](size_t, size_t begin, size_t end) {
+            Eigen::MatrixXd block;
+            for (size_t b = begin; b < end; b += kPcaBlockRows) {
+                Eigen::Index n = (Eigen::Index)std::min(kPcaBlockRows, end - b);
+                block = X.middleRows((Eigen::Index)b, n).template cast<double>();
+                out.middleRows((Eigen::Index)b, n).noalias() = block * weights;
+                out.middleRows((Eigen::Index)b, n).rowwise() -= bias;
+            }
+        });
+    }
+}
+
+DataProcessor::DataProcessor() : m_hasData(false), m_errorBound(0.0) {
 }
 
 DataProcessor::~DataProcessor() {
 }
 
+template <typename Fn>
+decltype(auto) DataProcessor::visit(const DataView& v, Fn&& fn) {
+    using Eigen::Dynamic;
+
+    auto withType = [&](auto tag) -> decltype(auto) {
+        using T = decltype(tag);
+        const T* data = static_cast<const T*>(v.data);
+        using RowMajor = Eigen::Matrix<T, Dynamic, Dynamic, Eigen::RowMajor>;
+        using ColMajor = Eigen::Matrix<T, Dynamic, Dynamic, Eigen::ColMajor>;
+
+        // Contiguous layouts get unit-stride maps so the GEMMs stay vectorized
+        if (v.colStride == 1 && v.rowStride == v.cols) {
+            return fn(Eigen::Map<const RowMajor>(data, v.rows, v.cols));
+        }
+        if (v.rowStride == 1 && v.colStride == v.rows) {
+            return fn(Eigen::Map<const ColMajor>(data, v.rows, v.cols));
+        }
+        using Strided = Eigen::Map<const RowMajor, 0, Eigen::Stride<Dynamic, Dynamic>>;
+        return fn(Strided(data, v.rows, v.cols, Eigen::Stride<Dynamic, Dynamic>(v.rowStride, v.colStride)));
+    };
+
+    if (v.type == DataView::Type::Float32) return withType(float{});
+    return withType(double{});
+}
+
 void DataProcessor::loadData(const Eigen::Ref<const Eigen::MatrixXd>& data) {
-    m_rawData = data;
-    m_hasData = true;
-    std::cout << "[DataProcessor] Loaded data: " << m_rawData.rows() << " x " << m_rawData.cols() << std::endl;
+    m_ownedData = data;
+
+    DataView view;
+    view.data = m_ownedData.data();
+    view.type = DataView::Type::Float64;
+    view.rows = m_ownedData.rows();
+    view.cols = m_ownedData.cols();
+    view.rowStride = 1;
+    view.colStride = m_ownedData.rows();
+    setView(std::move(view));
+}
+
+void DataProcessor::loadView(DataView view) {
+    // The caller's buffer replaces any owned copy
+    m_ownedData.resize(0, 0);
+    setView(std::move(view));
 }
 
-Eigen::MatrixXd DataProcessor::computePCA(int targetDims) {
-    if (!m_hasData || m_rawData.rows() == 0) {
+void DataProcessor::setView(DataView view) {
+    m_view = std::move(view);
+    m_hasData = m_view.data != nullptr;
+    std::cout << "[DataProcessor] Loaded data: " << m_view.rows << " x " << m_view.cols
+              << (m_view.type == DataView::Type::Float32 ? " (float32" : " (float64")
+              << (m_view.owner ? ", view)" : ")") << std::endl;
+}
+
+Eigen::MatrixXd DataProcessor::computePCA(int targetDims, PcaSolver solver, int powerIterations) {
+    if (!m_hasData || m_view.rows == 0) {
         return Eigen::MatrixXd();
     }
 
-    // 1. Center and Standardize the data (Z-Score)
+    const Eigen::Index rows = m_view.rows;
+    const Eigen::Index dims = m_view.cols;
+    const double dof = double(std::max<Eigen::Index>(1, rows - 1));
+    targetDims = (int)std::clamp<Eigen::Index>(targetDims, 1, dims);
+
+    // 1. Means and centered scatter in one multithreaded pass over row blocks
+    Eigen::RowVectorXd means;
+    Eigen::MatrixXd cov;
+    centeredScatter(m_view, means, cov);
+    cov /= dof;
+
+    // 2. Standardize (Z-Score): correlation matrix from the covariance.
     // Important for financial data with different units
-    Eigen::RowVectorXd means = m_rawData.colwise().mean();
-    Eigen::MatrixXd centered = m_rawData.rowwise() - means;
-    
-    // Calculate StdDev for each column
-    Eigen::RowVectorXd stdDevs = (centered.array().square().colwise().sum() / double(m_rawData.rows() - 1)).sqrt();
-    
-    // Avoid division by zero
-    for(int i=0; i<stdDevs.size(); ++i) {
-        if(stdDevs[i] < 1e-9) stdDevs[i] = 1.0;
-    }
-    
-    Eigen::MatrixXd standardized = centered.array().rowwise() / stdDevs.array();
-
-    // 2. Compute Covariance Matrix of Standardized Data (Correlation Matrix)
-    Eigen::MatrixXd cov = (standardized.adjoint() * standardized) / double(m_rawData.rows() - 1);
-
-    // 3. Eigendecomposition (SelfAdjoint for symmetric matrix)
-    Eigen::SelfAdjointEigenSolver<Eigen::MatrixXd> solver(cov);
-    
-    // 4. Sort eigenvectors
-    Eigen::MatrixXd eigenVectors = solver.eigenvectors().rightCols(targetDims);
-    
-    // Sort eigenvalues for variance explanation (ascending order from solver)
-    Eigen::VectorXd eigenValues = solver.eigenvalues();
-    
-    // Provide feedback on Variance Explained (optional logging)
-    double totalVariance = eigenValues.sum();
+    Eigen::VectorXd invStd;
+    Eigen::MatrixXd corr = correlationOf(cov, invStd);
+
+    // 3. Top eigenpairs, largest first
+    Eigen::MatrixXd sortedVectors;
+    Eigen::VectorXd topValues;
+    bool randomized = solver == PcaSolver::Randomized ||
+                      (solver == PcaSolver::Auto && dims >= kRandomizedMinDims &&
+                       targetDims + kOversample <= dims / 4);
+    if (randomized) {
+        randomizedEigen(corr, targetDims, std::max(0, powerIterations), sortedVectors, topValues);
+    } else {
+        Eigen::SelfAdjointEigenSolver<Eigen::MatrixXd> eigen(corr);
+        // Ascending from the solver: reverse columns to have largest first
+        sortedVectors = eigen.eigenvectors().rightCols(targetDims).rowwise().reverse();
+        topValues = eigen.eigenvalues().tail(targetDims).reverse();
+    }
+
+    // Residual ||C v - lambda v|| bounds the error of each eigenvalue (C is symmetric)
+    Eigen::MatrixXd residual = corr * sortedVectors - sortedVectors * topValues.asDiagonal();
+    m_errorBound = residual.colwise().norm().maxCoeff();
+
+    // 4. Variance explained: the trace is the sum of all eigenvalues, no full solve needed
+    double totalVariance = corr.trace();
+    m_explainedIncremental = false;
     if (totalVariance > 1e-9) {
-        // Take top N eigenvalues (which are at the end)
-        m_explainedVariance = eigenValues.tail(targetDims).reverse() / totalVariance;
+        m_explainedVariance = topValues / totalVariance;
         
-        double explained = eigenValues.tail(targetDims).sum();
-        std::cout << "[DataProcessor] PCA Variance Explained: " << (explained / totalVariance) * 100.0 << "%" << std::endl;
+        double explained = topValues.sum();
+        std::cout << "[DataProcessor] PCA Variance Explained: " << (explained / totalVariance) * 100.0 << "%"
+                  << " (" << (randomized ? "randomized" : "full") << " solver, error bound " << m_errorBound << ")"
+                  << std::endl;
     } else {
         m_explainedVariance = Eigen::VectorXd::Zero(targetDims);
     }
 
-    // Reverse columns to have largest first
-    Eigen::MatrixXd sortedVectors = eigenVectors.rowwise().reverse();
+    // 5. Project: ((x - mean) / std) * V == x * W - mean * W, with W = diag(1/std) * V.
+    // Row blocks are written straight into the result, no standardized copy.
+    Eigen::MatrixXd weights = invStd.asDiagonal() * sortedVectors;
+    Eigen::RowVectorXd bias = means * weights;
+    Eigen::MatrixXd projected(rows, sortedVectors.cols());
+    visit(m_view, [&](const auto& X) { projectRows(X, weights, bias, projected); });
+    return projected;
+}
+
+void DataProcessor::centeredScatter(const DataView& view, Eigen::RowVectorXd& mean, Eigen::MatrixXd& scatter) {
+    const Eigen::Index rows = view.rows;
+
+    // Rows are shifted by the first sample so the Gram matrix does not cancel
+    // catastrophically for features with a large offset.
+    Eigen::RowVectorXd shift;
+    std::vector<Eigen::RowVectorXd> partialSums;
+    std::vector<Eigen::MatrixXd> partialGrams;
+    visit(view, [&](const auto& X) {
+        shift = X.row(0).template cast<double>();
+        accumulateGram(X, shift, partialSums, partialGrams);
+    });
+
+    // Reduce into the first partial, releasing each other one as it is folded in
+    for (size_t c = 1; c < partialSums.size(); c++) {
+        partialSums[0] += partialSums[c];
+        partialGrams[0] += partialGrams[c];
+        partialGrams[c].resize(0, 0);
+    }
+
+    Eigen::RowVectorXd shiftedMean = partialSums[0] / double(rows);
+    mean = shiftedMean + shift;
 
-    // 5. Project standardized data
-    return standardized * sortedVectors;
+    // Scatter = G - n * m^T m, lower triangle only until here
+    scatter = partialGrams[0].selfadjointView<Eigen::Lower>();
+    partialGrams.clear();
+    scatter.noalias() -= double(rows) * shiftedMean.transpose() * shiftedMean;
 }
 
 Eigen::VectorXd DataProcessor::getExplainedVarianceRatio() const {
+    if (m_explainedIncremental) {
+        resolveIncremental();
+        return m_incremental.explained;
+    }
     return m_explainedVariance;
 }
 
+double DataProcessor::getErrorBound() const {
+    return m_errorBound;
+}
+
 Eigen::VectorXd DataProcessor::extractFeature(int colIndex) {
-    if (!m_hasData || colIndex < 0 || colIndex >= m_rawData.cols()) {
+    if (!m_hasData || colIndex < 0 || colIndex >= m_view.cols) {
         return Eigen::VectorXd();
     }
-    return m_rawData.col(colIndex);
+    return visit(m_view, [&](const auto& X) -> Eigen::VectorXd { return X.col(colIndex).template cast<double>(); });
 }
 
 size_t DataProcessor::getSampleCount() const {
     if (!m_hasData) return 0;
-    return m_rawData.rows();
+    return (size_t)m_view.rows;
+}
+
+// ---------------------------------------------------------------------------
+// Incremental PCA
+// ---------------------------------------------------------------------------
+
+void DataProcessor::resetIncremental(int components) {
+    m_incremental = IncrementalState{};
+    m_incremental.components = std::max(1, components);
+}
+
+bool DataProcessor::partialFit(const DataView& rows) {
+    IncrementalState& st = m_incremental;
+    if (!rows.data || rows.rows == 0) return true;
+    if (st.count > 0 && rows.cols != st.mean.size()) {
+        std::cerr << "[DataProcessor] partialFit: expected " << st.mean.size() << " columns, got " << rows.cols << std::endl;
+        return false;
+    }
+
+    // The rows' own mean and scatter, merged into the running ones (Chan et al.),
+    // so the covariance is exactly that of every row folded in so far
+    Eigen::RowVectorXd blockMean;
+    Eigen::MatrixXd blockScatter;
+    centeredScatter(rows, blockMean, blockScatter);
+    const double n = double(rows.rows);
+    if (st.count == 0) {
+        st.mean = std::move(blockMean);
+        st.scatter = std::move(blockScatter);
+    } else {
+        double total = double(st.count) + n;
+        Eigen::RowVectorXd delta = blockMean - st.mean;
+        st.scatter += blockScatter;
+        st.scatter.noalias() += (double(st.count) * n / total) * delta.transpose() * delta;
+        st.mean += (n / total) * delta;
+    }
+    st.count += rows.rows;
+    st.stale = true;  // Axes are solved by the next reader (resolveIncremental)
+    m_explainedIncremental = true;
+    return true;
+}
+
+void DataProcessor::resolveIncremental() const {
+    IncrementalState& st = m_incremental;
+    if (!st.stale) return;
+
+    // Correlation PCA of the running covariance, as computePCA does on the whole data
+    Eigen::MatrixXd cov = st.scatter / double(std::max<Eigen::Index>(1, st.count - 1));
+    Eigen::VectorXd invStd;
+    Eigen::MatrixXd corr = correlationOf(cov, invStd);
+    Eigen::Index keep = std::min<Eigen::Index>(st.components, corr.rows());
+    Eigen::SelfAdjointEigenSolver<Eigen::MatrixXd> eigen(corr);
+    Eigen::MatrixXd basis = eigen.eigenvectors().rightCols(keep).rowwise().reverse().transpose();
+    Eigen::VectorXd values = eigen.eigenvalues().tail(keep).reverse();
+    stabilizeAxes(basis, values);
+    st.basis = std::move(basis);
+    st.invStd = std::move(invStd);
+
+    double total = corr.trace();
+    st.explained = total > 1e-12 ? Eigen::VectorXd(values / total) : Eigen::VectorXd::Zero(keep);
+    st.stale = false;
+}
+
+void DataProcessor::stabilizeAxes(Eigen::MatrixXd& basis, Eigen::VectorXd& values) const {
+    const Eigen::MatrixXd& previous = m_incremental.basis;
+    const Eigen::Index k = basis.rows();
+
+    if (previous.rows() == 0 || previous.cols() != basis.cols()) {
+        // First fit: largest loading of each axis positive
+        for (Eigen::Index i = 0; i < k; i++) {
+            Eigen::Index arg;
+            basis.row(i).cwiseAbs().maxCoeff(&arg);
+            if (basis(i, arg) < 0.0) basis.row(i) *= -1.0;
+        }
+        return;
+    }
+
+    // Keep each previous axis on the new axis it overlaps most, so nearly equal
+    // eigenvalues swapping places do not swap the screen axes
+    Eigen::MatrixXd overlap = basis * previous.transpose();  // new x previous
+    std::vector<Eigen::Index> order;
+    std::vector<bool> used(k, false);
+    for (Eigen::Index j = 0; j < std::min(k, previous.rows()); j++) {
+        Eigen::Index best = -1;
+        for (Eigen::Index i = 0; i < k; i++) {
+            if (!used[i] && (best < 0 || std::abs(overlap(i, j)) > std::abs(overlap(best, j)))) best = i;
+        }
+        used[best] = true;
+        order.push_back(best);
+    }
+    for (Eigen::Index i = 0; i < k; i++) {
+        if (!used[i]) order.push_back(i);
+    }
+
+    Eigen::MatrixXd sortedBasis(k, basis.cols());
+    Eigen::VectorXd sortedValues(k);
+    for (Eigen::Index r = 0; r < k; r++) {
+        Eigen::Index i = order[r];
+        // Matched axes keep their direction
+        double sign = (r < previous.rows() && overlap(i, r) < 0.0) ? -1.0 : 1.0;
+        sortedBasis.row(r) = sign * basis.row(i);
+        sortedValues[r] = values[i];
+    }
+    basis = std::move(sortedBasis);
+    values = std::move(sortedValues);
+}
+
+Eigen::MatrixXd DataProcessor::transformIncremental(const DataView& rows) const {
+    const IncrementalState& st = m_incremental;
+    if (st.count == 0) {
+        std::cerr << "[DataProcessor] ERROR: transformIncremental: nothing was fitted yet" << std::endl;
+        return Eigen::MatrixXd();
+    }
+    if (rows.cols != st.mean.size()) {
+        std::cerr << "[DataProcessor] ERROR: transformIncremental: expected " << st.mean.size() << " columns, got "
+                  << rows.cols << std::endl;
+        return Eigen::MatrixXd();
+    }
+    resolveIncremental();
+    if (!rows.data || rows.rows == 0) return Eigen::MatrixXd(0, st.basis.rows());
+
+    // Standardized like the fitted rows: ((x - mean) / std) * V, as in computePCA
+    Eigen::MatrixXd weights = st.invStd.asDiagonal() * st.basis.transpose();
+    Eigen::RowVectorXd bias = st.mean * weights;
+    Eigen::MatrixXd projected(rows.rows, weights.cols());
+    visit(rows, [&](const auto& X) { projectRows(X, weights, bias, projected); });
+    return projected;
+}
+
+Eigen::MatrixXd DataProcessor::getIncrementalBasis() const {
+    resolveIncremental();
+    return m_incremental.basis;
+}
+
+size_t DataProcessor::getIncrementalSampleCount() const {
+    return (size_t)m_incremental.count;
 }
@@ -1,33 +1,81 @@
 #pragma once
 
 #include <Eigen/Dense>
+#include <memory>
 #include <vector>
 
 class DataProcessor {
 public:
+    /**
+     * @brief Borrowed 2D array (Rows = Samples, Cols = Dimensions)
+     *
+     * float32 or float64 with arbitrary positive strides (row-major numpy arrays
+     * included). `owner` keeps the memory alive while the processor holds the view.
+     */
+    struct DataView {
+        enum class Type { Float32, Float64 };
+
+        const void* data = nullptr;
+        Type type = Type::Float64;
+        Eigen::Index rows = 0, cols = 0;
+        Eigen::Index rowStride = 0, colStride = 0;  // In elements
+        std::shared_ptr<const void> owner;
+    };
+
     DataProcessor();
     ~DataProcessor();
 
     /**
      * @brief Load raw data matrix (Rows = Samples, Cols = Dimensions)
      * 
-     * @param data Eigen Matrix reference
+     * @param data Eigen Matrix reference (copied)
      */
     void loadData(const Eigen::Ref<const Eigen::MatrixXd>& data);
 
+    /**
+     * @brief Use the caller's buffer in place, without copying or converting it
+     *
+     * All kernels are instantiated for the view's scalar type and layout.
+     */
+    void loadView(DataView view);
+
+    /**
+     * @brief Eigen solver used by computePCA
+     *
+     * Full: dense solve of the D x D correlation matrix, O(D^3).
+     * Randomized: subspace iteration for the top components only, O(D^2 k).
+     * Auto: Randomized for wide data (D >= 512) when few components are kept.
+     */
+    enum class PcaSolver { Auto, Full, Randomized };
+
     /**
      * @brief Perform PCA reduction to N dimensions
+     *
+     * Means and the Gram matrix are accumulated in one multithreaded pass over
+     * row blocks, and the projection is written block by block, so peak memory
+     * is O(D^2 + block) on top of the data instead of two extra N x D copies.
      * 
      * @param targetDims Number of dimensions to maximize variance for (usually 3 for XYZ)
+     * @param solver Eigen solver, see PcaSolver
+     * @param powerIterations Subspace iterations of the randomized solver
      * @return Eigen::MatrixXd Reduced matrix (Rows x targetDims)
      */
-    Eigen::MatrixXd computePCA(int targetDims = 3);
+    Eigen::MatrixXd computePCA(int targetDims = 3, PcaSolver solver = PcaSolver::Auto, int powerIterations = 4);
     
     /**
      * @brief Get the explained variance ratio of the last PCA computation
      */
     Eigen::VectorXd getExplainedVarianceRatio() const;
 
+    /**
+     * @brief Max residual ||C v - lambda v|| of the last PCA components
+     *
+     * Every returned eigenvalue is within this distance of a true eigenvalue of
+     * the correlation matrix; divide by the feature count for the error of a
+     * variance ratio.
+     */
+    double getErrorBound() const;
+
     /**
      * @brief Extract a specific column as a vector (e.g., for Color mapping)
      * 
@@ -41,8 +89,74 @@ public:
      */
     size_t getSampleCount() const;
 
+    /**
+     * @brief Start a new incremental PCA keeping `components` axes
+     *
+     * partialFit() merges the rows' mean and centered scatter into running
+     * ones in O(rows x D^2), so each new frame costs only its own rows and the
+     * result is exactly the correlation PCA computePCA() would compute on all
+     * rows folded in so far. The axes themselves (a D x D eigensolve, O(D^3))
+     * are only solved when they are next read: by transformIncremental(),
+     * getIncrementalBasis() or getExplainedVarianceRatio(), so folding in T
+     * frames before the first read costs one eigensolve, not T. Each solve is
+     * matched to the previously solved axes, reordered and sign-flipped, so
+     * they don't swap or flip between reads.
+     */
+    void resetIncremental(int components = 3);
+
+    /**
+     * @brief Fold rows into the incremental PCA
+     *
+     * getExplainedVarianceRatio() reports the incremental fit from here on,
+     * until the next computePCA(). Returns false if the column count differs
+     * from earlier rows.
+     */
+    bool partialFit(const DataView& rows);
+
+    /**
+     * @brief Project rows onto the incremental axes (Rows x components)
+     *
+     * Rows are standardized with the fitted means and deviations first, as in
+     * computePCA(). Returns an empty matrix (with the reason on stderr) if
+     * nothing was fitted or the column count differs.
+     */
+    Eigen::MatrixXd transformIncremental(const DataView& rows) const;
+
+    /**
+     * @brief Current incremental axes (components x Dimensions, rows are axes, in standardized units)
+     */
+    Eigen::MatrixXd getIncrementalBasis() const;
+
+    size_t getIncrementalSampleCount() const;
+
 private:
-    Eigen::MatrixXd m_rawData;
+    void setView(DataView view);
+
+    // Calls fn with an Eigen::Map of the view for its type and layout
+    template <typename Fn>
+    static decltype(auto) visit(const DataView& view, Fn&& fn);
+
+    // Column means and the D x D scatter sum((x - mean)^T (x - mean)) of a view
+    static void centeredScatter(const DataView& view, Eigen::RowVectorXd& mean, Eigen::MatrixXd& scatter);
+    void stabilizeAxes(Eigen::MatrixXd& basis, Eigen::VectorXd& values) const;
+    void resolveIncremental() const;  // Solves the axes of a stale incremental state
+
+    struct IncrementalState {
+        int components = 3;
+        Eigen::Index count = 0;
+        Eigen::RowVectorXd mean;
+        Eigen::MatrixXd scatter;         // D x D, centered on mean
+        Eigen::VectorXd invStd;          // 1 / std of the features the axes were taken from
+        Eigen::MatrixXd basis;           // components x D
+        Eigen::VectorXd explained;       // Variance ratio of each axis
+        bool stale = false;              // Rows folded in since the axes were solved
+    };
+
+    DataView m_view;
+    Eigen::MatrixXd m_ownedData;  // Backing store for loadData
     bool m_hasData;
     Eigen::VectorXd m_explainedVariance;
+    double m_errorBound;
+    mutable IncrementalState m_incremental;  // Axes solved lazily by the const readers
+    bool m_explainedIncremental = false;     // Last fit was partialFit rather than computePCA
 };
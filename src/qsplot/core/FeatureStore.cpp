@@ -0,0 +1,229 @@
+#include "FeatureStore.h"
+#include "MappedFile.h"
+#include "Parallel.h"
+
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+#include <limits>
+
+namespace {
+
+constexpr size_t kStatsMinChunk = 1 << 14;  // Rows per parallel chunk
+constexpr size_t kMedianBudget = size_t(16) << 20;  // Bytes of gathered median samples held at once
+
+// Per-column running sums of one chunk
+struct Moments {
+    explicit Moments(size_t cols)
+        : count(cols, 0), sum(cols, 0.0), sq(cols, 0.0),
+          min(cols, std::numeric_limits<double>::infinity()),
+          max(cols, -std::numeric_limits<double>::infinity()) {}
+
+    std::vector<size_t> count;
+    std::vector<double> sum, sq, min, max;
+};
+
+// v - v is 0 for finite values and NaN otherwise; compiles to a branchless select
+template <typename T>
+inline bool finite(T v) { return v - v == T(0); }
+
+// First pass: counts, sums and extrema of rows [begin, end)
+template <typename T>
+void accumulate(const T* data, size_t rowStride, size_t colStride, size_t cols,
+                size_t begin, size_t end, Moments& m) {
+    if (rowStride == 1) {
+        // Column-major: columns are contiguous
+        for (size_t c = 0; c < cols; c++) {
+            const T* col = data + c * colStride;
+            size_t count = 0;
+            double sum = 0.0, lo = m.min[c], hi = m.max[c];
+            for (size_t r = begin; r < end; r++) {
+                T v = col[r];
+                bool ok = finite(v);
+                count += ok;
+                sum += ok ? (double)v : 0.0;
+                lo = ok && v < lo ? (double)v : lo;
+                hi = ok && v > hi ? (double)v : hi;
+            }
+            m.count[c] += count;
+            m.sum[c] += sum;
+            m.min[c] = lo;
+            m.max[c] = hi;
+        }
+        return;
+    }
+    // Row-major (or strided): sweep each row across all columns. Sums go straight
+    // into the double accumulators; extrema are exact in T and widened once.
+    std::vector<T> lo(cols, std::numeric_limits<T>::infinity()), hi(cols, -std::numeric_limits<T>::infinity());
+    for (size_t r = begin; r < end; r++) {
+        const T* row = data + r * rowStride;
+        for (size_t c = 0; c < cols; c++) {
+            T v = row[c * colStride];
+            bool ok = finite(v);
+            m.count[c] += ok;
+            m.sum[c] += ok ? (double)v : 0.0;
+            lo[c] = ok && v < lo[c] ? v : lo[c];
+            hi[c] = ok && v > hi[c] ? v : hi[c];
+        }
+    }
+    for (size_t c = 0; c < cols; c++) {
+        m.min[c] = std::min(m.min[c], (double)lo[c]);
+        m.max[c] = std::max(m.max[c], (double)hi[c]);
+    }
+}
+
+// Second pass: squared deviations from the column means
+template <typename T>
+void accumulateDeviations(const T* data, size_t rowStride, size_t colStride, size_t cols,
+                          size_t begin, size_t end, const std::vector<double>& mean, Moments& m) {
+    if (rowStride == 1) {
+        for (size_t c = 0; c < cols; c++) {
+            const T* col = data + c * colStride;
+            double sq = 0.0, mu = mean[c];
+            for (size_t r = begin; r < end; r++) {
+                T v = col[r];
+                double d = finite(v) ? (double)v - mu : 0.0;
+                sq += d * d;
+            }
+            m.sq[c] += sq;
+        }
+        return;
+    }
+    for (size_t r = begin; r < end; r++) {
+        const T* row = data + r * rowStride;
+        for (size_t c = 0; c < cols; c++) {
+            T v = row[c * colStride];
+            double d = finite(v) ? (double)v - mean[c] : 0.0;
+            m.sq[c] += d * d;
+        }
+    }
+}
+
+// Median of the finite values among count samples, reordered in place
+template <typename T>
+float sampleMedian(T* values, size_t count) {
+    T* end = std::partition(values, values + count, [](T v) { return finite(v); });
+    size_t n = (size_t)(end - values);
+    if (n == 0) return 0.0f;
+
+    T* mid = values + n / 2;
+    std::nth_element(values, mid, end);
+    double median = (double)*mid;
+    if (n % 2 == 0) {
+        // Average with the largest value of the lower half, as numpy does
+        median = 0.5 * (median + (double)*std::max_element(values, mid));
+    }
+    return (float)median;
+}
+
+template <typename T>
+std::vector<FeatureStore::ColumnStats> computeStatsTyped(const FeatureStore::View& view) {
+    const T* data = static_cast<const T*>(view.data);
+    const size_t rows = (size_t)view.rows, cols = (size_t)view.cols;
+    const size_t rowStride = (size_t)view.rowStride, colStride = (size_t)view.colStride;
+
+    std::vector<Moments> chunks(parallelChunkCount(rows, kStatsMinChunk), Moments(cols));
+    parallelFor(rows, kStatsMinChunk, [&](size_t chunk, size_t begin, size_t end) {
+        accumulate(data, rowStride, colStride, cols, begin, end, chunks[chunk]);
+    });
+
+    Moments total(cols);
+    for (const Moments& m : chunks) {
+        for (size_t c = 0; c < cols; c++) {
+            total.count[c] += m.count[c];
+            total.sum[c] += m.sum[c];
+            total.min[c] = std::min(total.min[c], m.min[c]);
+            total.max[c] = std::max(total.max[c], m.max[c]);
+        }
+    }
+    std::vector<double> mean(cols, 0.0);
+    for (size_t c = 0; c < cols; c++) {
+        if (total.count[c] > 0) mean[c] = total.sum[c] / (double)total.count[c];
+    }
+
+    parallelFor(rows, kStatsMinChunk, [&](size_t chunk, size_t begin, size_t end) {
+        accumulateDeviations(data, rowStride, colStride, cols, begin, end, mean, chunks[chunk]);
+    });
+    for (const Moments& m : chunks) {
+        for (size_t c = 0; c < cols; c++) total.sq[c] += m.sq[c];
+    }
+
+    std::vector<FeatureStore::ColumnStats> stats(cols);
+    for (size_t c = 0; c < cols; c++) {
+        FeatureStore::ColumnStats& s = stats[c];
+        s.count = total.count[c];
+        if (s.count == 0) continue;
+        s.min = (float)total.min[c];
+        s.max = (float)total.max[c];
+        s.mean = (float)mean[c];
+        s.std = (float)std::sqrt(total.sq[c] / (double)s.count);  // Population std (ddof = 0)
+    }
+
+    // Medians: every step-th row is gathered for a group of columns in one sweep
+    // over the rows, then each column of the group is selected on its own core
+    const size_t step = (rows + FeatureStore::kMedianSamples - 1) / FeatureStore::kMedianSamples;
+    const size_t samples = (rows + step - 1) / step;
+    const size_t group = std::clamp<size_t>(kMedianBudget / (samples * sizeof(T)), 1, cols);
+    std::vector<T> scratch(group * samples);
+    for (size_t first = 0; first < cols; first += group) {
+        const size_t count = std::min(group, cols - first);
+        parallelFor(samples, kStatsMinChunk, [&](size_t, size_t begin, size_t end) {
+            for (size_t i = begin; i < end; i++) {
+                const T* row = data + i * step * rowStride + first * colStride;
+                for (size_t c = 0; c < count; c++) scratch[c * samples + i] = row[c * colStride];
+            }
+        });
+        parallelFor(count, 1, [&](size_t, size_t begin, size_t end) {
+            for (size_t c = begin; c < end; c++) {
+                if (stats[first + c].count > 0) stats[first + c].median = sampleMedian(&scratch[c * samples], samples);
+            }
+        });
+    }
+    return stats;
+}
+
+}  // namespace
+
+FeatureStore::FeatureStore(View view) : m_view(std::move(view)) {
+    if (!m_view.data) m_view.rows = m_view.cols = 0;
+}
+
+std::shared_ptr<FeatureStore> FeatureStore::mapFile(const std::string& path, size_t rows, size_t cols,
+                                                    View::Type type, size_t byteOffset, bool rowMajor) {
+    std::shared_ptr<const MappedFile> file = MappedFile::open(path);
+    if (!file) return nullptr;
+
+    const size_t elementSize = type == View::Type::Float32 ? sizeof(float) : sizeof(double);
+    if (byteOffset % elementSize != 0 || byteOffset > file->size() ||
+        (cols > 0 && rows > (file->size() - byteOffset) / elementSize / cols)) {
+        std::cerr << "[FeatureStore] ERROR: " << path << " holds no aligned " << rows << " x " << cols
+                  << " matrix at offset " << byteOffset << std::endl;
+        return nullptr;
+    }
+
+    View view;
+    view.data = file->data() + byteOffset;
+    view.type = type;
+    view.rows = (Eigen::Index)rows;
+    view.cols = (Eigen::Index)cols;
+    view.rowStride = rowMajor ? (Eigen::Index)cols : 1;
+    view.colStride = rowMajor ? 1 : (Eigen::Index)rows;
+    view.owner = file;
+    return std::make_shared<FeatureStore>(std::move(view));
+}
+
+float FeatureStore::value(size_t row, size_t col) const {
+    size_t index = row * (size_t)m_view.rowStride + col * (size_t)m_view.colStride;
+    if (m_view.type == View::Type::Float32) return static_cast<const float*>(m_view.data)[index];
+    return (float)static_cast<const double*>(m_view.data)[index];
+}
+
+void FeatureStore::row(size_t row, float* out) const {
+    for (size_t c = 0; c < cols(); c++) out[c] = value(row, c);
+}
+
+std::vector<FeatureStore::ColumnStats> FeatureStore::computeStats() const {
+    if (rows() == 0 || cols() == 0) return std::vector<ColumnStats>(cols());
+    if (m_view.type == View::Type::Float32) return computeStatsTyped<float>(m_view);
+    return computeStatsTyped<double>(m_view);
+}
@@ -0,0 +1,61 @@
+#pragma once
+
+#include "DataProcessor.h"
+
+#include <cstddef>
+#include <memory>
+#include <string>
+#include <vector>
+
+/**
+ * @brief Read-only N x F feature matrix shared by the tooltip and the stats table.
+ *
+ * Holds a DataProcessor::DataView of memory owned elsewhere: a numpy array
+ * (kept alive by the view's owner) or a memory-mapped file, so the features
+ * are never copied. Rows are fetched one at a time when a point is hovered.
+ *
+ * computeStats() reduces every column on all cores: min/max/sum and then the
+ * squared deviations in two passes along the contiguous axis, accumulated in
+ * double, and the median by selection (nth_element) over at most
+ * kMedianSamples evenly spaced rows, so it is exact for smaller inputs and a
+ * close estimate above. The median samples are gathered a few columns at a
+ * time into a scratch buffer of at most 16 MB.
+ * Non-finite values are skipped.
+ */
+class FeatureStore {
+public:
+    using View = DataProcessor::DataView;
+
+    static constexpr size_t kMedianSamples = size_t(1) << 18;  // Exact median up to this many rows
+
+    struct ColumnStats {
+        float min = 0.0f, max = 0.0f, mean = 0.0f, std = 0.0f, median = 0.0f;
+        size_t count = 0;  // Finite values
+    };
+
+    explicit FeatureStore(View view);
+
+    /**
+     * @brief Map a headerless matrix of rows x cols values from a file
+     *
+     * @param byteOffset Start of the matrix in the file
+     * @param rowMajor Row-major (C order) or column-major (Fortran order) layout
+     * @return Null if the file cannot be mapped or is too small
+     */
+    static std::shared_ptr<FeatureStore> mapFile(const std::string& path, size_t rows, size_t cols,
+                                                 View::Type type = View::Type::Float32,
+                                                 size_t byteOffset = 0, bool rowMajor = true);
+
+    size_t rows() const { return (size_t)m_view.rows; }
+    size_t cols() const { return (size_t)m_view.cols; }
+    const View& view() const { return m_view; }
+
+    float value(size_t row, size_t col) const;
+    // Copies cols() values of one row into out
+    void row(size_t row, float* out) const;
+
+    std::vector<ColumnStats> computeStats() const;
+
+private:
+    View m_view;
+};
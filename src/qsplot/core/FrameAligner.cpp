@@ -0,0 +1,95 @@
+#include "FrameAligner.h"
+
+#include <algorithm>
+
+std::vector<int> FrameAligner::intern(const std::vector<std::string>& labels) {
+    std::vector<int> ids(labels.size());
+    for (size_t i = 0; i < labels.size(); i++) {
+        auto it = m_idOf.find(labels[i]);
+        if (it == m_idOf.end()) {
+            int id = (int)m_labels.size();
+            it = m_idOf.emplace(labels[i], id).first;
+            m_labels.push_back(labels[i]);
+            m_slotOf.push_back(-1);
+        }
+        ids[i] = it->second;
+    }
+    return ids;
+}
+
+void FrameAligner::pushFrame(const int* ids, const float* positions, const float* values, size_t count) {
+    m_latest ^= 1;
+    Frame& frame = m_frames[m_latest];
+
+    // Slots first, so rowOfSlot covers every ID of this frame
+    for (size_t i = 0; i < count; i++) {
+        int id = ids[i];
+        if (id < 0 || id >= (int)m_labels.size() || m_slotOf[id] >= 0) continue;
+        m_slotOf[id] = (int)m_idOfSlot.size();
+        m_idOfSlot.push_back(id);
+    }
+
+    frame.rowOfSlot.assign(m_idOfSlot.size(), -1);
+    frame.positions.assign(positions, positions + count * 3);
+    frame.values.assign(values, values + count);
+    for (size_t i = 0; i < count; i++) {
+        int id = ids[i];
+        if (id < 0 || id >= (int)m_labels.size()) continue;
+        frame.rowOfSlot[m_slotOf[id]] = (int)i;
+    }
+    frame.valid = true;
+}
+
+void FrameAligner::resetFrames() {
+    for (auto& frame : m_frames) frame = Frame{};
+    m_currentPositions.clear();
+    m_currentValues.clear();
+    m_nextPositions.clear();
+    m_nextValues.clear();
+    m_orderChanged = !m_alignedIds.empty();
+    m_alignedIds.clear();
+}
+
+size_t FrameAligner::align() {
+    const Frame& current = m_frames[m_latest ^ 1];
+    const Frame& next = m_frames[m_latest];
+
+    std::vector<int> ids;
+    m_currentPositions.clear();
+    m_currentValues.clear();
+    m_nextPositions.clear();
+    m_nextValues.clear();
+
+    if (current.valid && next.valid) {
+        // Slots are append-only: the older frame may know fewer of them
+        size_t slots = std::min(current.rowOfSlot.size(), next.rowOfSlot.size());
+        ids.reserve(slots);
+        m_currentPositions.reserve(slots * 3);
+        m_nextPositions.reserve(slots * 3);
+        m_currentValues.reserve(slots);
+        m_nextValues.reserve(slots);
+
+        for (size_t s = 0; s < slots; s++) {
+            int a = current.rowOfSlot[s];
+            int b = next.rowOfSlot[s];
+            if (a < 0 || b < 0) continue;
+
+            ids.push_back(m_idOfSlot[s]);
+            m_currentPositions.insert(m_currentPositions.end(), &current.positions[a * 3], &current.positions[a * 3] + 3);
+            m_nextPositions.insert(m_nextPositions.end(), &next.positions[b * 3], &next.positions[b * 3] + 3);
+            m_currentValues.push_back(current.values[a]);
+            m_nextValues.push_back(next.values[b]);
+        }
+    }
+
+    m_orderChanged = ids != m_alignedIds;
+    m_alignedIds.swap(ids);
+    return m_alignedIds.size();
+}
+
+std::vector<std::string> FrameAligner::alignedLabels() const {
+    std::vector<std::string> labels;
+    labels.reserve(m_alignedIds.size());
+    for (int id : m_alignedIds) labels.push_back(m_labels[id]);
+    return labels;
+}
@@ -0,0 +1,68 @@
+#pragma once
+
+#include <cstddef>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+/**
+ * @brief Joins consecutive frames on their labels (e.g. tickers) for morphing.
+ *
+ * Labels are interned to integer IDs once, and every ID gets a persistent slot
+ * the first time it appears in a frame. align() emits the current and next
+ * frame for the IDs present in both, ordered by slot, so a label keeps its
+ * position in the point buffers for as long as it stays in the universe.
+ *
+ * Frames are pushed one at a time: each push makes the previous frame the
+ * current one, so every frame is prepared and passed in once.
+ */
+class FrameAligner {
+public:
+    FrameAligner() = default;
+
+    // IDs for the labels, new labels get the next free ID
+    std::vector<int> intern(const std::vector<std::string>& labels);
+    size_t labelCount() const { return m_labels.size(); }
+
+    // ids: interned IDs per row; positions: count x 3; values: count.
+    // Rows with unknown IDs are skipped, a repeated ID keeps its last row.
+    void pushFrame(const int* ids, const float* positions, const float* values, size_t count);
+
+    // Drop the pushed frames, keeping labels and slots
+    void resetFrames();
+
+    // Aligns the last two pushed frames, returns the common point count
+    size_t align();
+
+    size_t count() const { return m_alignedIds.size(); }
+    // True if the last align() changed which ID sits in which point index
+    bool orderChanged() const { return m_orderChanged; }
+
+    const std::vector<float>& currentPositions() const { return m_currentPositions; }
+    const std::vector<float>& currentValues() const { return m_currentValues; }
+    const std::vector<float>& nextPositions() const { return m_nextPositions; }
+    const std::vector<float>& nextValues() const { return m_nextValues; }
+    const std::vector<int>& alignedIds() const { return m_alignedIds; }
+    std::vector<std::string> alignedLabels() const;
+
+private:
+    struct Frame {
+        std::vector<int> rowOfSlot;  // -1 if the slot's ID is absent
+        std::vector<float> positions;
+        std::vector<float> values;
+        bool valid = false;
+    };
+
+    std::unordered_map<std::string, int> m_idOf;
+    std::vector<std::string> m_labels;
+    std::vector<int> m_slotOf;    // ID -> slot, -1 until first seen in a frame
+    std::vector<int> m_idOfSlot;
+
+    Frame m_frames[2];
+    int m_latest = 1;  // Index of the most recently pushed frame
+
+    std::vector<float> m_currentPositions, m_currentValues;
+    std::vector<float> m_nextPositions, m_nextValues;
+    std::vector<int> m_alignedIds;
+    bool m_orderChanged = false;
+};
@@ -0,0 +1,76 @@
+#include "MappedFile.h"
+
+#include <iostream>
+
+#ifdef _WIN32
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+std::shared_ptr<const MappedFile> MappedFile::open(const std::string& path) {
+    std::shared_ptr<MappedFile> file(new MappedFile());
+    file->m_path = path;
+
+#ifdef _WIN32
+    HANDLE handle = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING,
+                                FILE_ATTRIBUTE_NORMAL, nullptr);
+    if (handle == INVALID_HANDLE_VALUE) {
+        std::cerr << "[MappedFile] ERROR: Could not open: " << path << std::endl;
+        return nullptr;
+    }
+    file->m_file = handle;
+    LARGE_INTEGER size;
+    if (!GetFileSizeEx(handle, &size) || size.QuadPart == 0) {
+        std::cerr << "[MappedFile] ERROR: Empty or unreadable file: " << path << std::endl;
+        return nullptr;
+    }
+    file->m_mapping = CreateFileMappingA(handle, nullptr, PAGE_READONLY, 0, 0, nullptr);
+    if (!file->m_mapping) {
+        std::cerr << "[MappedFile] ERROR: Could not map: " << path << std::endl;
+        return nullptr;
+    }
+    file->m_data = static_cast<const unsigned char*>(MapViewOfFile(file->m_mapping, FILE_MAP_READ, 0, 0, 0));
+    file->m_size = (size_t)size.QuadPart;
+#else
+    int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0) {
+        std::cerr << "[MappedFile] ERROR: Could not open: " << path << std::endl;
+        return nullptr;
+    }
+    struct stat st;
+    if (fstat(fd, &st) != 0 || st.st_size == 0) {
+        ::close(fd);
+        std::cerr << "[MappedFile] ERROR: Empty or unreadable file: " << path << std::endl;
+        return nullptr;
+    }
+    void* mapped = mmap(nullptr, (size_t)st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+    ::close(fd);  // The mapping keeps the file referenced
+    if (mapped != MAP_FAILED) {
+        file->m_data = static_cast<const unsigned char*>(mapped);
+        file->m_size = (size_t)st.st_size;
+    }
+#endif
+
+    if (!file->m_data) {
+        std::cerr << "[MappedFile] ERROR: Could not map: " << path << std::endl;
+        return nullptr;
+    }
+    return file;
+}
+
+MappedFile::~MappedFile() {
+#ifdef _WIN32
+    if (m_data) UnmapViewOfFile(m_data);
+    if (m_mapping) CloseHandle(m_mapping);
+    if (m_file) CloseHandle(m_file);
+#else
+    if (m_data) munmap(const_cast<unsigned char*>(m_data), m_size);
+#endif
+}
@@ -0,0 +1,36 @@
+#pragma once
+
+#include <cstddef>
+#include <memory>
+#include <string>
+
+/**
+ * @brief Read-only memory mapping of a whole file.
+ *
+ * Pages are faulted in by the OS on first access, so opening a file costs the
+ * same regardless of its size. The mapping lives as long as the last
+ * shared_ptr to it; views into the file hold one as their owner.
+ */
+class MappedFile {
+public:
+    // Null if the file cannot be opened or mapped (empty files included)
+    static std::shared_ptr<const MappedFile> open(const std::string& path);
+
+    ~MappedFile();
+
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    const unsigned char* data() const { return m_data; }
+    size_t size() const { return m_size; }
+    const std::string& path() const { return m_path; }
+
+private:
+    MappedFile() = default;
+
+    const unsigned char* m_data = nullptr;
+    size_t m_size = 0;
+    std::string m_path;
+    void* m_file = nullptr;     // Windows file handle
+    void* m_mapping = nullptr;  // Windows mapping handle
+};
@@ -0,0 +1,49 @@
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <thread>
+#include <vector>
+
+/**
+ * @brief Number of chunks parallelFor splits `count` items into.
+ *
+ * One chunk per hardware thread, but never smaller than `minChunk` items so
+ * small inputs stay on the calling thread.
+ */
+inline size_t parallelChunkCount(size_t count, size_t minChunk) {
+    if (count == 0) return 0;
+    size_t workers = std::max<size_t>(1, std::thread::hardware_concurrency());
+    size_t byGrain = (count + std::max<size_t>(1, minChunk) - 1) / std::max<size_t>(1, minChunk);
+    return std::max<size_t>(1, std::min(workers, byGrain));
+}
+
+/**
+ * @brief Run fn(chunk, begin, end) over [0, count) on all cores and wait.
+ *
+ * Chunks are contiguous and ordered, so per-chunk results indexed by `chunk`
+ * can be concatenated to keep the original order. The calling thread
+ * processes the last chunk itself.
+ */
+template <typename Fn>
+void parallelFor(size_t count, size_t minChunk, Fn&& fn) {
+    size_t chunks = parallelChunkCount(count, minChunk);
+    if (chunks == 0) return;
+    if (chunks == 1) {
+        fn(size_t(0), size_t(0), count);
+        return;
+    }
+
+    size_t step = (count + chunks - 1) / chunks;
+    std::vector<std::thread> workers;
+    workers.reserve(chunks - 1);
+    for (size_t c = 0; c + 1 < chunks; c++) {
+        size_t begin = c * step;
+        size_t end = std::min(count, begin + step);
+        workers.emplace_back([&fn, c, begin, end]() { fn(c, begin, end); });
+    }
+    size_t last = chunks - 1;
+    fn(last, std::min(count, last * step), count);
+
+    for (auto& t : workers) t.join();
+}
@@ -0,0 +1,127 @@
+#include "QspFile.h"
+
+#include <cstring>
+#include <iostream>
+#include <limits>
+
+namespace {
+
+uint64_t readU64(const unsigned char* p) {
+    uint64_t v;
+    std::memcpy(&v, p, sizeof(v));
+    return v;
+}
+
+// offset + count * size <= limit, without overflowing
+bool fits(uint64_t offset, uint64_t count, uint64_t size, uint64_t limit) {
+    if (offset > limit) return false;
+    return size == 0 || count <= (limit - offset) / size;
+}
+
+// frameCount blocks of `bytes` each, `stride` apart, all inside the file
+bool validBlocks(uint64_t offset, uint64_t stride, uint64_t frames, uint64_t bytes, uint64_t fileSize) {
+    if (offset % QspFile::kAlignment != 0 || stride % QspFile::kAlignment != 0 || stride < bytes) return false;
+    return fits(offset, frames - 1, stride, fileSize) && fits(offset + (frames - 1) * stride, 1, bytes, fileSize);
+}
+
+}  // namespace
+
+std::shared_ptr<const QspFile> QspFile::open(const std::string& path) {
+    std::shared_ptr<const MappedFile> file = MappedFile::open(path);
+    if (!file) return nullptr;
+
+    auto fail = [&](const char* reason) -> std::shared_ptr<const QspFile> {
+        std::cerr << "[QspFile] ERROR: " << path << ": " << reason << std::endl;
+        return nullptr;
+    };
+    if (file->size() < sizeof(Header)) return fail("too small for a header");
+
+    std::shared_ptr<QspFile> qsp(new QspFile());
+    qsp->m_file = file;
+    Header& h = qsp->m_header;
+    std::memcpy(&h, file->data(), sizeof(Header));
+
+    if (std::memcmp(h.magic, kMagic, sizeof(kMagic)) != 0) return fail("not a .qsp file");
+    if (h.version != kVersion) return fail("unsupported version");
+    if (h.headerSize < sizeof(Header)) return fail("truncated header");
+    if (h.frameCount == 0 || h.pointCount == 0) return fail("no frames or points");
+
+    const uint64_t size = file->size();
+    // Bytes per point are 12 * (featureCount + 1) at most; bound the count before
+    // forming that product so a corrupt header cannot wrap it (or divide by 0)
+    const uint64_t maxBytes = std::numeric_limits<uint64_t>::max();
+    const uint64_t pointBytes = 3 * sizeof(float);
+    if (h.featureCount > maxBytes / pointBytes - 1) return fail("feature count out of range");
+    if (h.pointCount > maxBytes / (pointBytes * (h.featureCount + 1))) return fail("point count out of range");
+    if (!validBlocks(h.positionsOffset, h.positionsStride, h.frameCount, h.pointCount * 3 * sizeof(float), size) ||
+        !validBlocks(h.valuesOffset, h.valuesStride, h.frameCount, h.pointCount * sizeof(float), size)) {
+        return fail("point blocks are misaligned or outside the file");
+    }
+    if (h.featureCount > 0 &&
+        !validBlocks(h.featuresOffset, h.featuresStride, h.frameCount,
+                     h.pointCount * h.featureCount * sizeof(float), size)) {
+        return fail("feature blocks are misaligned or outside the file");
+    }
+
+    if (!qsp->readStrings(h.labelsOffset, (size_t)h.pointCount, qsp->m_labels) ||
+        !qsp->readStrings(h.featureNamesOffset, (size_t)h.featureCount, qsp->m_featureNames) ||
+        !qsp->readStrings(h.frameNamesOffset, std::numeric_limits<size_t>::max(), qsp->m_frameNames) ||
+        (!qsp->m_frameNames.empty() && qsp->m_frameNames.size() != h.frameCount)) {
+        return fail("invalid string table");
+    }
+
+    return qsp;
+}
+
+bool QspFile::readStrings(uint64_t offset, size_t expected, std::vector<std::string>& out) const {
+    const unsigned char* data = m_file->data();
+    const uint64_t size = m_file->size();
+    if (!fits(offset, 1, sizeof(uint64_t), size)) return false;
+
+    uint64_t count = readU64(data + offset);
+    if (expected != std::numeric_limits<size_t>::max() && count != expected) return false;
+    uint64_t table = offset + sizeof(uint64_t);
+    if (count >= std::numeric_limits<uint64_t>::max() / sizeof(uint64_t) ||
+        !fits(table, count + 1, sizeof(uint64_t), size)) {
+        return false;
+    }
+    uint64_t bytes = table + (count + 1) * sizeof(uint64_t);
+
+    out.clear();
+    out.reserve((size_t)count);
+    uint64_t begin = readU64(data + table);
+    for (uint64_t i = 0; i < count; i++) {
+        uint64_t end = readU64(data + table + (i + 1) * sizeof(uint64_t));
+        if (end < begin || !fits(bytes, 1, end, size)) return false;
+        out.emplace_back(reinterpret_cast<const char*>(data + bytes + begin), (size_t)(end - begin));
+        begin = end;
+    }
+    return true;
+}
+
+const float* QspFile::block(uint64_t offset, uint64_t stride, size_t frame) const {
+    if (frame >= frameCount()) return nullptr;
+    return reinterpret_cast<const float*>(m_file->data() + offset + frame * stride);
+}
+
+const float* QspFile::positions(size_t frame) const {
+    return block(m_header.positionsOffset, m_header.positionsStride, frame);
+}
+
+const float* QspFile::values(size_t frame) const {
+    return block(m_header.valuesOffset, m_header.valuesStride, frame);
+}
+
+std::shared_ptr<const FeatureStore> QspFile::features(size_t frame) const {
+    if (featureCount() == 0 || frame >= frameCount()) return nullptr;
+
+    FeatureStore::View view;
+    view.data = block(m_header.featuresOffset, m_header.featuresStride, frame);
+    view.type = FeatureStore::View::Type::Float32;
+    view.rows = (Eigen::Index)pointCount();
+    view.cols = (Eigen::Index)featureCount();
+    view.rowStride = view.cols;
+    view.colStride = 1;
+    view.owner = m_file;
+    return std::make_shared<const FeatureStore>(std::move(view));
+}
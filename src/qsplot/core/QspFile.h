@@ -0,0 +1,84 @@
+#pragma once
+
+#include "FeatureStore.h"
+#include "MappedFile.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+/**
+ * @brief Precomputed session (.qsp): per-frame positions, values and features.
+ *
+ * Every frame has the same pointCount points, one per label (ticker), so a
+ * label keeps its point index for the whole file; points absent from a frame
+ * have NaN positions. Blocks are float32, little-endian and start on
+ * kAlignment boundaries, so a frame is uploaded with one glBufferSubData
+ * straight from the mapping and read in place by the CPU passes.
+ *
+ *   Header (128 bytes, below)
+ *   positions: frameCount blocks of pointCount x 3, block f at positionsOffset + f * positionsStride
+ *   values:    frameCount blocks of pointCount
+ *   features:  frameCount blocks of pointCount x featureCount (row-major), absent if featureCount == 0
+ *   labels, featureNames, frameNames: string tables
+ *
+ * A string table is a uint64 count, count + 1 uint64 offsets from the end of
+ * the offset array, then the UTF-8 bytes (no terminators). frameNames may be
+ * empty; labels has pointCount entries and featureNames featureCount.
+ * src/qsplot/qsp.py writes and reads the same layout.
+ */
+class QspFile {
+public:
+    static constexpr char kMagic[8] = { 'Q', 'S', 'P', 'L', 'O', 'T', '\0', '\0' };
+    static constexpr uint32_t kVersion = 1;
+    static constexpr size_t kAlignment = 4096;
+
+    struct Header {
+        char magic[8];
+        uint32_t version;
+        uint32_t headerSize;
+        uint64_t frameCount;
+        uint64_t pointCount;
+        uint64_t featureCount;
+        uint64_t positionsOffset, positionsStride;  // Bytes
+        uint64_t valuesOffset, valuesStride;
+        uint64_t featuresOffset, featuresStride;
+        uint64_t labelsOffset;
+        uint64_t featureNamesOffset;
+        uint64_t frameNamesOffset;
+        uint64_t reserved[2];
+    };
+    static_assert(sizeof(Header) == 128, "Header layout is part of the file format");
+
+    // Maps and validates a file. Null (with the reason on stderr) if it is not a valid .qsp.
+    static std::shared_ptr<const QspFile> open(const std::string& path);
+
+    size_t frameCount() const { return (size_t)m_header.frameCount; }
+    size_t pointCount() const { return (size_t)m_header.pointCount; }
+    size_t featureCount() const { return (size_t)m_header.featureCount; }
+
+    // Point data of one frame, in the mapping
+    const float* positions(size_t frame) const;  // pointCount x 3
+    const float* values(size_t frame) const;     // pointCount
+    // Features of one frame as a store sharing the mapping; null without features
+    std::shared_ptr<const FeatureStore> features(size_t frame) const;
+
+    const std::vector<std::string>& labels() const { return m_labels; }
+    const std::vector<std::string>& featureNames() const { return m_featureNames; }
+    const std::vector<std::string>& frameNames() const { return m_frameNames; }
+    const std::string& path() const { return m_file->path(); }
+
+private:
+    QspFile() = default;
+
+    const float* block(uint64_t offset, uint64_t stride, size_t frame) const;
+    bool readStrings(uint64_t offset, size_t expected, std::vector<std::string>& out) const;
+
+    std::shared_ptr<const MappedFile> m_file;
+    Header m_header{};
+    std::vector<std::string> m_labels;
+    std::vector<std::string> m_featureNames;
+    std::vector<std::string> m_frameNames;
+};
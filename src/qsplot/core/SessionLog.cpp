@@ -0,0 +1,382 @@
+#include "SessionLog.h"
+
+#include <algorithm>
+#include <chrono>
+#include <iostream>
+#include <limits>
+
+namespace {
+
+constexpr int kHashBits = 16;
+constexpr size_t kMinMatch = 4;
+constexpr size_t kMaxOffset = 65535;
+
+inline uint32_t load32(const uint8_t* p) {
+    uint32_t v;
+    std::memcpy(&v, p, sizeof(v));
+    return v;
+}
+
+void putLength(std::vector<uint8_t>& out, size_t n) {
+    for (; n >= 255; n -= 255) out.push_back(255);
+    out.push_back((uint8_t)n);
+}
+
+// One sequence: token (literal length << 4 | match length - 4), literals, offset (u16), match
+void emitSequence(std::vector<uint8_t>& out, const uint8_t* literals, size_t literalLength, size_t offset,
+                  size_t matchLength) {
+    size_t extra = matchLength ? matchLength - kMinMatch : 0;
+    out.push_back((uint8_t)((std::min<size_t>(literalLength, 15) << 4) | std::min<size_t>(extra, 15)));
+    if (literalLength >= 15) putLength(out, literalLength - 15);
+    out.insert(out.end(), literals, literals + literalLength);
+    if (matchLength == 0) return;
+    out.push_back((uint8_t)(offset & 0xff));
+    out.push_back((uint8_t)(offset >> 8));
+    if (extra >= 15) putLength(out, extra - 15);
+}
+
+bool readLength(const uint8_t* data, size_t size, size_t& ip, size_t& n) {
+    uint8_t b;
+    do {
+        if (ip >= size) return false;
+        b = data[ip++];
+        n += b;
+    } while (b == 255);
+    return true;
+}
+
+// Byte p of every 32-bit word goes to plane p; the size % 4 tail stays at the end
+void splitPlanes(const uint8_t* in, size_t size, uint8_t* out) {
+    size_t words = size / 4;
+    for (size_t w = 0; w < words; w++) {
+        for (size_t p = 0; p < 4; p++) out[p * words + w] = in[w * 4 + p];
+    }
+    std::memcpy(out + words * 4, in + words * 4, size - words * 4);
+}
+
+void joinPlanes(const uint8_t* in, size_t size, uint8_t* out) {
+    size_t words = size / 4;
+    for (size_t w = 0; w < words; w++) {
+        for (size_t p = 0; p < 4; p++) out[w * 4 + p] = in[p * words + w];
+    }
+    std::memcpy(out + words * 4, in + words * 4, size - words * 4);
+}
+
+uint64_t unixMicros() {
+    auto now = std::chrono::system_clock::now().time_since_epoch();
+    return (uint64_t)std::chrono::duration_cast<std::chrono::microseconds>(now).count();
+}
+
+int64_t steadyNanos() {
+    auto now = std::chrono::steady_clock::now().time_since_epoch();
+    return (int64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(now).count();
+}
+
+}  // namespace
+
+bool SessionCursor::getString(std::string& s) {
+    uint32_t length = 0;
+    if (!get(length) || length > remaining()) return false;
+    s.assign(reinterpret_cast<const char*>(m_data + m_offset), length);
+    m_offset += length;
+    return true;
+}
+
+bool SessionCursor::getStrings(std::vector<std::string>& list) {
+    uint32_t count = 0;
+    if (!get(count) || count > remaining() / sizeof(uint32_t)) return false;  // Each string has a length
+    list.resize(count);
+    for (std::string& s : list) {
+        if (!getString(s)) return false;
+    }
+    return true;
+}
+
+uint8_t SessionLog::encode(SessionKind kind, const std::vector<uint8_t>& payload, History& history,
+                           std::vector<uint8_t>& stored) {
+    std::vector<uint8_t>& previous = history[(size_t)kind];
+    if (payload.size() < kMinEncodedBytes) {
+        stored = payload;
+        previous = payload;
+        return 0;
+    }
+
+    uint8_t codec = kCodecPlanes;
+    std::vector<uint8_t> delta(payload);
+    if (previous.size() == payload.size()) {
+        for (size_t i = 0; i < delta.size(); i++) delta[i] ^= previous[i];
+        codec |= kCodecDelta;
+    }
+    std::vector<uint8_t> planes(payload.size());
+    splitPlanes(delta.data(), delta.size(), planes.data());
+
+    compress(planes.data(), planes.size(), stored);
+    if (stored.size() < planes.size()) {
+        codec |= kCodecLz;
+    } else {
+        stored.swap(planes);  // Incompressible: the planes as they are
+    }
+    previous = payload;
+    return codec;
+}
+
+bool SessionLog::decode(SessionKind kind, uint8_t codec, const std::vector<uint8_t>& stored, size_t size,
+                        History& history, std::vector<uint8_t>& payload) {
+    std::vector<uint8_t>& previous = history[(size_t)kind];
+    if (codec & ~(kCodecLz | kCodecPlanes | kCodecDelta)) return false;
+
+    std::vector<uint8_t> planes;
+    if (codec & kCodecLz) {
+        planes.resize(size);
+        if (!decompress(stored.data(), stored.size(), planes.data(), size)) return false;
+    } else {
+        if (stored.size() != size) return false;
+        planes = stored;
+    }
+
+    if (codec & kCodecPlanes) {
+        payload.resize(size);
+        joinPlanes(planes.data(), size, payload.data());
+    } else {
+        payload.swap(planes);
+    }
+
+    if (codec & kCodecDelta) {
+        if (previous.size() != size) return false;
+        for (size_t i = 0; i < size; i++) payload[i] ^= previous[i];
+    }
+    previous = payload;
+    return true;
+}
+
+void SessionLog::compress(const uint8_t* data, size_t size, std::vector<uint8_t>& out) {
+    out.clear();
+    out.reserve(size / 2 + 16);
+    std::vector<uint32_t> table(size_t(1) << kHashBits, 0);  // Last position + 1 of each 4-byte hash
+
+    size_t anchor = 0, i = 0;
+    while (i + kMinMatch <= size) {
+        uint32_t word = load32(data + i);
+        uint32_t& slot = table[(word * 2654435761u) >> (32 - kHashBits)];
+        size_t candidate = slot;
+        slot = (uint32_t)(i + 1);
+        if (candidate == 0 || i + 1 - candidate > kMaxOffset || load32(data + candidate - 1) != word) {
+            i++;
+            continue;
+        }
+
+        size_t from = candidate - 1, length = kMinMatch;
+        while (i + length < size && data[from + length] == data[i + length]) length++;
+        emitSequence(out, data + anchor, i - anchor, i - from, length);
+        i += length;
+        anchor = i;
+    }
+    emitSequence(out, data + anchor, size - anchor, 0, 0);  // Trailing literals end the stream
+}
+
+bool SessionLog::decompress(const uint8_t* data, size_t size, uint8_t* out, size_t outSize) {
+    size_t ip = 0, op = 0;
+    while (true) {
+        if (ip >= size) return false;
+        uint8_t token = data[ip++];
+
+        size_t literals = token >> 4;
+        if (literals == 15 && !readLength(data, size, ip, literals)) return false;
+        if (literals > size - ip || literals > outSize - op) return false;
+        std::memcpy(out + op, data + ip, literals);
+        ip += literals;
+        op += literals;
+        if (ip == size) return op == outSize;
+
+        if (size - ip < 2) return false;
+        size_t offset = (size_t)data[ip] | ((size_t)data[ip + 1] << 8);
+        ip += 2;
+        if (offset == 0 || offset > op) return false;
+        size_t length = token & 15;
+        if (length == 15 && !readLength(data, size, ip, length)) return false;
+        length += kMinMatch;
+        if (length > outSize - op) return false;
+
+        // Overlapping matches repeat the last `offset` bytes: copy forward
+        const uint8_t* from = out + op - offset;
+        if (offset >= length) {
+            std::memcpy(out + op, from, length);
+        } else {
+            for (size_t k = 0; k < length; k++) out[op + k] = from[k];
+        }
+        op += length;
+    }
+}
+
+std::unique_ptr<SessionWriter> SessionWriter::open(const std::string& path) {
+    std::FILE* file = std::fopen(path.c_str(), "wb");
+    if (!file) {
+        std::cerr << "[SessionLog] ERROR: cannot create " << path << std::endl;
+        return nullptr;
+    }
+
+    SessionLog::Header header{};
+    std::memcpy(header.magic, SessionLog::kMagic, sizeof(header.magic));
+    header.version = SessionLog::kVersion;
+    header.headerSize = sizeof(SessionLog::Header);
+    header.startTimeUs = unixMicros();
+    if (std::fwrite(&header, sizeof(header), 1, file) != 1) {
+        std::cerr << "[SessionLog] ERROR: cannot write " << path << std::endl;
+        std::fclose(file);
+        return nullptr;
+    }
+
+    std::unique_ptr<SessionWriter> writer(new SessionWriter());
+    writer->m_path = path;
+    writer->m_file = file;
+    writer->m_startNs = steadyNanos();
+    writer->m_thread = std::thread(&SessionWriter::writerLoop, writer.get());
+    return writer;
+}
+
+SessionWriter::~SessionWriter() { close(); }
+
+void SessionWriter::write(SessionKind kind, std::vector<uint8_t> payload) {
+    if (payload.size() > std::numeric_limits<uint32_t>::max()) {
+        std::cerr << "[SessionLog] ERROR: record of " << payload.size() << " bytes is too large, skipped"
+                  << std::endl;
+        return;
+    }
+
+    std::unique_lock<std::mutex> lock(m_mutex);
+    if (payload.size() >= kMinBlockingBytes) {
+        m_drained.wait(lock, [this]() {
+            return m_stats.queuedBytes <= kMaxQueuedBytes || m_stats.failed || m_stopping;
+        });
+    }
+    if (m_stopping || m_stats.failed) return;
+
+    uint64_t timeUs = (uint64_t)std::max<int64_t>(0, (steadyNanos() - m_startNs) / 1000);
+    m_stats.queuedBytes += payload.size();
+    m_jobs.push_back({ kind, timeUs, std::move(payload) });
+    m_wake.notify_one();
+}
+
+void SessionWriter::close() {
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        if (!m_thread.joinable()) return;
+        m_stopping = true;
+    }
+    m_wake.notify_one();
+    m_drained.notify_all();
+    m_thread.join();
+    std::fclose(m_file);
+    m_file = nullptr;
+}
+
+SessionWriter::Stats SessionWriter::stats() const {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_stats;
+}
+
+void SessionWriter::writerLoop() {
+    SessionLog::History history;
+    std::vector<uint8_t> stored;
+    std::unique_lock<std::mutex> lock(m_mutex);
+    while (true) {
+        m_wake.wait(lock, [this]() { return m_stopping || !m_jobs.empty(); });
+        if (m_jobs.empty()) break;  // Stopping with everything written
+        Job job = std::move(m_jobs.front());
+        m_jobs.pop_front();
+        bool idle = m_jobs.empty();
+        lock.unlock();
+
+        SessionLog::RecordHeader record{};
+        record.kind = (uint8_t)job.kind;
+        record.codec = SessionLog::encode(job.kind, job.payload, history, stored);
+        record.size = (uint32_t)job.payload.size();
+        record.storedSize = (uint32_t)stored.size();
+        record.timeUs = job.timeUs;
+        bool ok = std::fwrite(&record, sizeof(record), 1, m_file) == 1 &&
+                  (stored.empty() || std::fwrite(stored.data(), 1, stored.size(), m_file) == stored.size());
+        if (ok && idle) ok = std::fflush(m_file) == 0;  // Nothing else to batch with: make it durable
+
+        lock.lock();
+        m_stats.queuedBytes -= job.payload.size();
+        if (ok) {
+            m_stats.records++;
+            m_stats.bytes += job.payload.size();
+            m_stats.storedBytes += sizeof(record) + stored.size();
+        } else if (!m_stats.failed) {
+            std::cerr << "[SessionLog] ERROR: write to " << m_path << " failed, recording stopped" << std::endl;
+            m_stats.failed = true;
+            m_jobs.clear();
+            m_stats.queuedBytes = 0;
+        }
+        m_drained.notify_all();
+    }
+}
+
+std::unique_ptr<SessionReader> SessionReader::open(const std::string& path) {
+    std::FILE* file = std::fopen(path.c_str(), "rb");
+    if (!file) {
+        std::cerr << "[SessionLog] ERROR: cannot open " << path << std::endl;
+        return nullptr;
+    }
+
+    SessionLog::Header header{};
+    const char* reason = nullptr;
+    if (std::fread(&header, sizeof(header), 1, file) != 1 ||
+        std::memcmp(header.magic, SessionLog::kMagic, sizeof(header.magic)) != 0) {
+        reason = "not a session log";
+    } else if (header.version != SessionLog::kVersion) {
+        reason = "unsupported session log version";
+    } else if (header.headerSize < sizeof(header) ||
+               std::fseek(file, (long)header.headerSize, SEEK_SET) != 0) {
+        reason = "corrupt session log header";
+    }
+    if (reason) {
+        std::cerr << "[SessionLog] ERROR: " << path << ": " << reason << std::endl;
+        std::fclose(file);
+        return nullptr;
+    }
+
+    std::unique_ptr<SessionReader> reader(new SessionReader());
+    reader->m_path = path;
+    reader->m_file = file;
+    reader->m_startTimeUs = header.startTimeUs;
+    return reader;
+}
+
+SessionReader::~SessionReader() {
+    if (m_file) std::fclose(m_file);
+}
+
+bool SessionReader::next(Record& record) {
+    if (!m_file) return false;
+
+    SessionLog::RecordHeader header{};
+    size_t got = std::fread(&header, 1, sizeof(header), m_file);
+    const char* reason = nullptr;
+    if (got == 0 && std::feof(m_file)) {
+        // Clean end of the log
+    } else if (got != sizeof(header)) {
+        reason = "truncated record header";
+    } else if (header.kind == 0 || header.kind >= (uint8_t)SessionKind::Count ||
+               header.storedSize > header.size) {
+        reason = "corrupt record header";  // encode() never stores more than the payload
+    } else {
+        m_stored.resize(header.storedSize);
+        if (std::fread(m_stored.data(), 1, m_stored.size(), m_file) != m_stored.size()) {
+            reason = "truncated record";
+        } else if (!SessionLog::decode((SessionKind)header.kind, header.codec, m_stored, header.size, m_history,
+                                       record.payload)) {
+            reason = "corrupt record";
+        } else {
+            record.kind = (SessionKind)header.kind;
+            record.timeUs = header.timeUs;
+            return true;
+        }
+    }
+
+    if (reason) std::cerr << "[SessionLog] ERROR: " << m_path << ": " << reason << ", replay stops here" << std::endl;
+    std::fclose(m_file);
+    m_file = nullptr;
+    return false;
+}
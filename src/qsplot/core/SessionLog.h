@@ -0,0 +1,277 @@
+#pragma once
+
+#include <array>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+// Commands a session log (.qsr) records, with their payload layouts. Counts
+// are uint64, strings a uint32 byte count and the UTF-8 bytes, string lists a
+// uint32 count and the strings, arrays raw float32/int32/uint32/uint8. New
+// kinds are appended, so older logs keep their numbering.
+enum class SessionKind : uint8_t {
+    Points = 1,          // count, hasPositions u8, hasValues u8, positions count x 3, values count
+    TargetPoints,        // as Points
+    UpdatePoints,        // count, hasPositions u8, hasValues u8, indices i32, positions count x 3, values count
+    UpdateTargetPoints,  // as UpdatePoints
+    Tickers,             // string list
+    DimensionLabels,     // color, x, y, z strings
+    FeatureNames,        // string list
+    Categories,          // count, labels u8, names string list
+    ColorMode,           // int32
+    ExplainedVariance,   // count, floats
+    FeatureValues,       // rows, cols, row-major floats (setAllFeatureValues)
+    FeatureStore,        // as FeatureValues (setFeatureStore)
+    CameraOrbit,         // deltaX, deltaY floats
+    CameraZoom,          // delta float
+    ViewportCamera,      // viewport u64, yaw, pitch, distance floats
+    Stats,               // count, then per column: name string, min, max, mean, std, median floats, count i32
+    RangeFilters,        // count, then per range: column u64, min, max floats
+    ViewportCount,       // count u64
+    ViewportSubset,      // viewport u64, count, indices u32
+    ViewportFilter,      // viewport u64, enabled u8, min, max floats
+    ViewportLabel,       // viewport u64, label string
+    ViewportsLinked,     // linked u8
+    Count
+};
+
+/**
+ * @brief Payload builder for a session record
+ */
+class SessionPayload {
+public:
+    template <typename T>
+    void put(T value) {
+        append(&value, sizeof(T));
+    }
+    template <typename T>
+    void putArray(const T* data, size_t count) {
+        if (data && count > 0) append(data, count * sizeof(T));
+    }
+    void putString(const std::string& s) {
+        put<uint32_t>((uint32_t)s.size());
+        append(s.data(), s.size());
+    }
+    void putStrings(const std::vector<std::string>& list) {
+        put<uint32_t>((uint32_t)list.size());
+        for (const std::string& s : list) putString(s);
+    }
+
+    std::vector<uint8_t> take() { return std::move(m_bytes); }
+
+private:
+    void append(const void* data, size_t size) {
+        const uint8_t* p = static_cast<const uint8_t*>(data);
+        m_bytes.insert(m_bytes.end(), p, p + size);
+    }
+
+    std::vector<uint8_t> m_bytes;
+};
+
+/**
+ * @brief Bounds-checked reader over a session record payload
+ *
+ * Every call fails (returns false) once the payload is exhausted, so a
+ * truncated or foreign payload is rejected instead of read past its end.
+ */
+class SessionCursor {
+public:
+    explicit SessionCursor(const std::vector<uint8_t>& bytes) : m_data(bytes.data()), m_size(bytes.size()) {}
+
+    template <typename T>
+    bool get(T& value) {
+        return take(&value, sizeof(T));
+    }
+    template <typename T>
+    bool getArray(std::vector<T>& out, size_t count) {
+        if (count > remaining() / sizeof(T)) return false;
+        out.resize(count);
+        return take(out.data(), count * sizeof(T));
+    }
+    bool getString(std::string& s);
+    bool getStrings(std::vector<std::string>& list);
+
+    size_t remaining() const { return m_size - m_offset; }
+
+private:
+    bool take(void* out, size_t size) {
+        if (size > remaining()) return false;
+        if (size > 0) std::memcpy(out, m_data + m_offset, size);
+        m_offset += size;
+        return true;
+    }
+
+    const uint8_t* m_data;
+    size_t m_size;
+    size_t m_offset = 0;
+};
+
+/**
+ * @brief Append-only, compressed log of renderer commands (.qsr).
+ *
+ *   Header (32 bytes, below)
+ *   records: RecordHeader (24 bytes) + stored payload, in the order written
+ *
+ * All fields are little-endian. A record's time is microseconds since the
+ * log was opened; the header holds that moment as Unix microseconds, so an
+ * event at a given wall-clock time can be found in the log.
+ *
+ * Records are appended whole and in order, so a crash loses at most the
+ * record being written and a reader stops cleanly at a truncated tail. They
+ * are not independent, though: payloads of kMinEncodedBytes or more are
+ * XORed with the previous payload of the same kind when it had the same size
+ * (consecutive frames share signs, exponents and most mantissa bits), split
+ * into the four byte planes of their 32-bit words, and LZ77-compressed in a
+ * byte-oriented format (LZ4 style: literal runs and 16-bit offset matches, no
+ * entropy coding), which turns the mostly-zero planes into long matches and
+ * stays fast enough for the writer thread to keep up with a frame per second
+ * of millions of points. Since a record can only be decoded after the ones
+ * before it, a corrupt record cannot be skipped: the reader ends the log
+ * there.
+ */
+class SessionLog {
+public:
+    static constexpr char kMagic[8] = { 'Q', 'S', 'P', 'L', 'O', 'G', '\0', '\0' };
+    static constexpr uint32_t kVersion = 1;
+    static constexpr size_t kMinEncodedBytes = 256;
+
+    // Codec bits of RecordHeader::codec; 0 is the raw payload
+    static constexpr uint8_t kCodecLz = 1;       // LZ77 stream
+    static constexpr uint8_t kCodecPlanes = 2;   // Byte planes of the 32-bit words (the tail stays in place)
+    static constexpr uint8_t kCodecDelta = 4;    // XOR with the previous payload of the kind
+
+    struct Header {
+        char magic[8];
+        uint32_t version;
+        uint32_t headerSize;
+        uint64_t startTimeUs;  // Unix time the log was opened
+        uint64_t reserved;
+    };
+    static_assert(sizeof(Header) == 32, "Header layout is part of the file format");
+
+    struct RecordHeader {
+        uint8_t kind;          // SessionKind
+        uint8_t codec;
+        uint16_t reserved;
+        uint32_t size;         // Payload bytes
+        uint32_t storedSize;   // Bytes that follow
+        uint32_t reserved2;
+        uint64_t timeUs;
+    };
+    static_assert(sizeof(RecordHeader) == 24, "RecordHeader layout is part of the file format");
+
+    // Encoding state: the previous payload of every kind, for the XOR delta
+    using History = std::array<std::vector<uint8_t>, (size_t)SessionKind::Count>;
+
+    // Encodes payload to stored bytes and returns its codec; updates history
+    static uint8_t encode(SessionKind kind, const std::vector<uint8_t>& payload, History& history,
+                          std::vector<uint8_t>& stored);
+    // Inverse of encode; false if the stored bytes do not decode to `size` bytes
+    static bool decode(SessionKind kind, uint8_t codec, const std::vector<uint8_t>& stored, size_t size,
+                       History& history, std::vector<uint8_t>& payload);
+
+    // The LZ77 stream alone
+    static void compress(const uint8_t* data, size_t size, std::vector<uint8_t>& out);
+    static bool decompress(const uint8_t* data, size_t size, uint8_t* out, size_t outSize);
+};
+
+/**
+ * @brief Writes a session log from any thread without touching the disk.
+ *
+ * write() stamps the record and queues it; a writer thread encodes and
+ * appends records in order and flushes whenever the queue runs dry. Writers
+ * of payloads of kMinBlockingBytes or more wait while more than
+ * kMaxQueuedBytes are queued, so a disk that cannot keep up slows producers
+ * instead of dropping frames; smaller records (camera input from the render
+ * thread) never wait.
+ */
+class SessionWriter {
+public:
+    static constexpr size_t kMaxQueuedBytes = size_t(256) << 20;
+    static constexpr size_t kMinBlockingBytes = size_t(64) << 10;
+
+    struct Stats {
+        uint64_t records = 0;      // Written
+        uint64_t bytes = 0;        // Payload bytes written
+        uint64_t storedBytes = 0;  // After encoding, with record headers
+        uint64_t queuedBytes = 0;  // Waiting for the writer thread
+        bool failed = false;       // An I/O error stopped the log
+    };
+
+    // Creates (truncates) the file. Null, with the reason on stderr, on failure.
+    static std::unique_ptr<SessionWriter> open(const std::string& path);
+    ~SessionWriter();  // close()
+
+    SessionWriter(const SessionWriter&) = delete;
+    SessionWriter& operator=(const SessionWriter&) = delete;
+
+    void write(SessionKind kind, std::vector<uint8_t> payload);
+    // Writes everything queued, then closes the file
+    void close();
+
+    Stats stats() const;
+    const std::string& path() const { return m_path; }
+
+private:
+    struct Job {
+        SessionKind kind;
+        uint64_t timeUs;
+        std::vector<uint8_t> payload;
+    };
+
+    SessionWriter() = default;
+    void writerLoop();
+
+    std::string m_path;
+    std::FILE* m_file = nullptr;
+    int64_t m_startNs = 0;  // steady_clock
+
+    std::thread m_thread;
+    std::deque<Job> m_jobs;
+    mutable std::mutex m_mutex;
+    std::condition_variable m_wake;     // Writer: jobs or stop
+    std::condition_variable m_drained;  // Producers: queue below the budget
+    bool m_stopping = false;
+    Stats m_stats;
+};
+
+/**
+ * @brief Reads the records of a session log in order
+ */
+class SessionReader {
+public:
+    struct Record {
+        SessionKind kind = SessionKind::Points;
+        uint64_t timeUs = 0;
+        std::vector<uint8_t> payload;
+    };
+
+    // Null, with the reason on stderr, if the file is not a session log
+    static std::unique_ptr<SessionReader> open(const std::string& path);
+    ~SessionReader();
+
+    SessionReader(const SessionReader&) = delete;
+    SessionReader& operator=(const SessionReader&) = delete;
+
+    // False at the end of the log; a truncated or corrupt record ends it too (reported on stderr)
+    bool next(Record& record);
+
+    uint64_t startTimeUs() const { return m_startTimeUs; }
+
+private:
+    SessionReader() = default;
+
+    std::string m_path;
+    std::FILE* m_file = nullptr;
+    uint64_t m_startTimeUs = 0;
+    SessionLog::History m_history;
+    std::vector<uint8_t> m_stored;
+};
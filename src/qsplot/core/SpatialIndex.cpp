@@ -0,0 +1,346 @@
+#include "SpatialIndex.h"
+#include "Parallel.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <limits>
+#include <queue>
+#include <utility>
+
+namespace {
+
+constexpr size_t kMinChunk = 1 << 15;      // Points per parallel chunk
+constexpr size_t kMinCellChunk = 1 << 14;  // Cells per parallel chunk when sorting
+constexpr uint32_t kNoCell = std::numeric_limits<uint32_t>::max();
+
+struct Bounds {
+    float min[3] = { std::numeric_limits<float>::max(), std::numeric_limits<float>::max(),
+                     std::numeric_limits<float>::max() };
+    float max[3] = { -std::numeric_limits<float>::max(), -std::numeric_limits<float>::max(),
+                     -std::numeric_limits<float>::max() };
+    size_t count = 0;
+};
+
+inline bool finite3(const float* p) { return std::isfinite(p[0]) && std::isfinite(p[1]) && std::isfinite(p[2]); }
+
+}  // namespace
+
+void SpatialIndex::build(const float* current, size_t count, const float* next, size_t nextCount, float t) {
+    m_count = current ? count : 0;
+    m_positions.resize(m_count * 3);
+    m_cellStart.clear();
+    m_cellPoints.clear();
+    m_dims[0] = m_dims[1] = m_dims[2] = 0;
+    if (m_count == 0) return;
+
+    // Positions as drawn, and the bounds of the finite ones
+    size_t morphed = next ? std::min(nextCount, m_count) : 0;
+    std::vector<Bounds> partial(parallelChunkCount(m_count, kMinChunk));
+    parallelFor(m_count, kMinChunk, [&](size_t chunk, size_t begin, size_t end) {
+        Bounds& b = partial[chunk];
+        for (size_t i = begin; i < end; i++) {
+            float* p = m_positions.data() + i * 3;
+            for (int a = 0; a < 3; a++) {
+                float v = current[i * 3 + a];
+                if (i < morphed) v += t * (next[i * 3 + a] - v);
+                p[a] = v;
+            }
+            if (!finite3(p)) continue;
+            for (int a = 0; a < 3; a++) {
+                b.min[a] = std::min(b.min[a], p[a]);
+                b.max[a] = std::max(b.max[a], p[a]);
+            }
+            b.count++;
+        }
+    });
+    Bounds bounds;
+    for (const Bounds& b : partial) {
+        for (int a = 0; a < 3; a++) {
+            bounds.min[a] = std::min(bounds.min[a], b.min[a]);
+            bounds.max[a] = std::max(bounds.max[a], b.max[a]);
+        }
+        bounds.count += b.count;
+    }
+    if (bounds.count == 0) {
+        m_dims[0] = m_dims[1] = m_dims[2] = 1;
+        m_cellStart.assign(2, 0);
+        return;
+    }
+
+    // Cubic cells for ~kPointsPerCell points each; flat axes count as one cell thick
+    float extent[3], largest = 0.0f;
+    for (int a = 0; a < 3; a++) {
+        extent[a] = bounds.max[a] - bounds.min[a];
+        largest = std::max(largest, extent[a]);
+        m_origin[a] = bounds.min[a];
+    }
+    if (largest > 0.0f) {
+        double thinnest = (double)largest / kMaxCellsPerAxis;
+        double volume = 1.0;
+        for (int a = 0; a < 3; a++) volume *= std::max((double)extent[a], thinnest);
+        double cells = (double)std::max<size_t>(1, bounds.count / kPointsPerCell);
+        m_cellSize = (float)std::max(std::cbrt(volume / cells), (double)largest / (kMaxCellsPerAxis - 1));
+    } else {
+        m_cellSize = 1.0f;  // Every point in one place
+    }
+    for (int a = 0; a < 3; a++) {
+        m_dims[a] = std::clamp((int)std::floor(extent[a] / m_cellSize) + 1, 1, kMaxCellsPerAxis);
+    }
+    size_t cells = (size_t)m_dims[0] * m_dims[1] * m_dims[2];
+
+    // Counting sort: cell of every point, counts, offsets, scatter
+    std::vector<uint32_t> pointCell(m_count);
+    std::vector<std::atomic<uint32_t>> counts(cells);
+    parallelFor(m_count, kMinChunk, [&](size_t, size_t begin, size_t end) {
+        for (size_t i = begin; i < end; i++) {
+            const float* p = m_positions.data() + i * 3;
+            if (!finite3(p)) {
+                pointCell[i] = kNoCell;
+                continue;
+            }
+            size_t cell = cellIndex(cellCoord(p[0], 0), cellCoord(p[1], 1), cellCoord(p[2], 2));
+            pointCell[i] = (uint32_t)cell;
+            counts[cell].fetch_add(1, std::memory_order_relaxed);
+        }
+    });
+
+    m_cellStart.resize(cells + 1);
+    uint32_t offset = 0;
+    for (size_t c = 0; c < cells; c++) {
+        m_cellStart[c] = offset;
+        offset += counts[c].load(std::memory_order_relaxed);
+        counts[c].store(m_cellStart[c], std::memory_order_relaxed);  // Now the write cursor
+    }
+    m_cellStart[cells] = offset;
+
+    m_cellPoints.resize(offset);
+    parallelFor(m_count, kMinChunk, [&](size_t, size_t begin, size_t end) {
+        for (size_t i = begin; i < end; i++) {
+            if (pointCell[i] == kNoCell) continue;
+            uint32_t slot = counts[pointCell[i]].fetch_add(1, std::memory_order_relaxed);
+            m_cellPoints[slot] = (uint32_t)i;
+        }
+    });
+
+    // The scatter order depends on the threads
+    parallelFor(cells, kMinCellChunk, [&](size_t, size_t begin, size_t end) {
+        for (size_t c = begin; c < end; c++) {
+            std::sort(m_cellPoints.begin() + m_cellStart[c], m_cellPoints.begin() + m_cellStart[c + 1]);
+        }
+    });
+}
+
+bool SpatialIndex::contains(int id) const {
+    return id >= 0 && (size_t)id < m_count && finite3(position(id));
+}
+
+int SpatialIndex::cellCoord(float p, int axis) const {
+    float c = std::floor((p - m_origin[axis]) / m_cellSize);
+    if (!(c > 0.0f)) return 0;  // Also NaN
+    if (c >= (float)(m_dims[axis] - 1)) return m_dims[axis] - 1;
+    return (int)c;
+}
+
+float SpatialIndex::distance2(int id, const float* point) const {
+    const float* p = position(id);
+    float dx = p[0] - point[0], dy = p[1] - point[1], dz = p[2] - point[2];
+    return dx * dx + dy * dy + dz * dz;
+}
+
+std::vector<int> SpatialIndex::knn(const float* point, size_t k, int exclude) const {
+    std::vector<int> result;
+    if (k == 0 || m_cellPoints.empty() || !finite3(point)) return result;
+
+    using Entry = std::pair<float, int>;  // Squared distance, ID
+    std::priority_queue<Entry> best;      // Farthest kept neighbour on top
+    auto visit = [&](int x, int y, int z) {
+        size_t cell = cellIndex(x, y, z);
+        for (uint32_t j = m_cellStart[cell]; j < m_cellStart[cell + 1]; j++) {
+            int id = (int)m_cellPoints[j];
+            if (id == exclude) continue;
+            Entry e(distance2(id, point), id);
+            if (best.size() < k) {
+                best.push(e);
+            } else if (e < best.top()) {
+                best.pop();
+                best.push(e);
+            }
+        }
+    };
+
+    // Shells of cells at Chebyshev distance r around the point's cell, until nothing
+    // outside the searched block can be nearer than the k-th neighbour
+    int c[3];
+    for (int a = 0; a < 3; a++) c[a] = cellCoord(point[a], a);
+    for (int r = 0;; r++) {
+        int lo[3], hi[3];
+        bool covered = true;
+        for (int a = 0; a < 3; a++) {
+            lo[a] = std::max(0, c[a] - r);
+            hi[a] = std::min(m_dims[a] - 1, c[a] + r);
+            covered = covered && lo[a] == 0 && hi[a] == m_dims[a] - 1;
+        }
+        for (int z = lo[2]; z <= hi[2]; z++) {
+            for (int y = lo[1]; y <= hi[1]; y++) {
+                if (std::abs(z - c[2]) == r || std::abs(y - c[1]) == r) {
+                    for (int x = lo[0]; x <= hi[0]; x++) visit(x, y, z);
+                } else {
+                    if (c[0] - r >= 0) visit(c[0] - r, y, z);
+                    if (r > 0 && c[0] + r < m_dims[0]) visit(c[0] + r, y, z);
+                }
+            }
+        }
+        if (covered) break;
+
+        if (best.size() == k) {
+            float gap = std::numeric_limits<float>::max();
+            for (int a = 0; a < 3; a++) {
+                if (c[a] - r > 0) gap = std::min(gap, point[a] - (m_origin[a] + (c[a] - r) * m_cellSize));
+                if (c[a] + r < m_dims[a] - 1) gap = std::min(gap, m_origin[a] + (c[a] + r + 1) * m_cellSize - point[a]);
+            }
+            if (gap > 0.0f && best.top().first <= gap * gap) break;
+        }
+    }
+
+    result.resize(best.size());
+    for (size_t i = result.size(); i-- > 0;) {
+        result[i] = best.top().second;
+        best.pop();
+    }
+    return result;
+}
+
+std::vector<int> SpatialIndex::radius(const float* point, float radius) const {
+    std::vector<int> result;
+    if (!(radius >= 0.0f) || m_cellPoints.empty() || !finite3(point)) return result;
+
+    int lo[3], hi[3];
+    for (int a = 0; a < 3; a++) {
+        lo[a] = cellCoord(point[a] - radius, a);
+        hi[a] = cellCoord(point[a] + radius, a);
+    }
+    float r2 = radius * radius;
+    std::vector<std::pair<float, int>> found;
+    for (int z = lo[2]; z <= hi[2]; z++) {
+        for (int y = lo[1]; y <= hi[1]; y++) {
+            for (int x = lo[0]; x <= hi[0]; x++) {
+                size_t cell = cellIndex(x, y, z);
+                for (uint32_t j = m_cellStart[cell]; j < m_cellStart[cell + 1]; j++) {
+                    int id = (int)m_cellPoints[j];
+                    float d2 = distance2(id, point);
+                    if (d2 <= r2) found.emplace_back(d2, id);
+                }
+            }
+        }
+    }
+
+    std::sort(found.begin(), found.end());
+    result.reserve(found.size());
+    for (const auto& f : found) result.push_back(f.second);
+    return result;
+}
+
+int SpatialIndex::raycast(const float* origin, const float* direction, float radius, float spread,
+                          const std::function<bool(int)>& accept) const {
+    if (m_cellPoints.empty() || !finite3(origin) || !finite3(direction)) return -1;
+    float length = std::sqrt(direction[0] * direction[0] + direction[1] * direction[1] + direction[2] * direction[2]);
+    if (!(length > 0.0f)) return -1;
+    float d[3] = { direction[0] / length, direction[1] / length, direction[2] / length };
+    radius = std::max(radius, 0.0f);
+    spread = std::max(spread, 0.0f);
+
+    // Widest the cone gets over the grid: a hit lies within m cells of a cell on the ray
+    float far2 = 0.0f;
+    for (int a = 0; a < 3; a++) {
+        float lo = m_origin[a] - origin[a], hi = lo + m_dims[a] * m_cellSize;
+        far2 += std::max(lo * lo, hi * hi);
+    }
+    float reach = radius + spread * std::sqrt(far2);
+    int m = std::min((int)std::ceil(reach / m_cellSize), kMaxCellsPerAxis);
+
+    // Walk the grid padded by m cells (Amanatides-Woo), scanning the m-block around each cell
+    float t0 = 0.0f, t1 = std::numeric_limits<float>::max();
+    for (int a = 0; a < 3; a++) {
+        float lo = m_origin[a] - m * m_cellSize, hi = m_origin[a] + (m_dims[a] + m) * m_cellSize;
+        if (std::abs(d[a]) < 1e-12f) {
+            if (origin[a] < lo || origin[a] > hi) return -1;
+            continue;
+        }
+        float ta = (lo - origin[a]) / d[a], tb = (hi - origin[a]) / d[a];
+        if (ta > tb) std::swap(ta, tb);
+        t0 = std::max(t0, ta);
+        t1 = std::min(t1, tb);
+    }
+    if (t0 > t1) return -1;
+
+    int cell[3], step[3];
+    float tNext[3], tDelta[3];
+    for (int a = 0; a < 3; a++) {
+        float s = origin[a] + d[a] * t0;
+        int c = (int)std::floor((s - m_origin[a]) / m_cellSize);
+        cell[a] = std::clamp(c, -m, m_dims[a] + m - 1);
+        step[a] = d[a] > 0.0f ? 1 : (d[a] < 0.0f ? -1 : 0);
+        if (step[a] == 0) {
+            tNext[a] = tDelta[a] = std::numeric_limits<float>::max();
+            continue;
+        }
+        float boundary = m_origin[a] + (cell[a] + (step[a] > 0 ? 1 : 0)) * m_cellSize;
+        tNext[a] = (boundary - origin[a]) / d[a];
+        tDelta[a] = m_cellSize / std::abs(d[a]);
+    }
+
+    // Points scanned from a later cell lie at most this far before its entry
+    float slack = (2 * m + 1) * m_cellSize * std::sqrt(3.0f);
+    int hitID = -1, nearID = -1;
+    float hitT = 0.0f, nearScore = 0.0f, nearT = 0.0f;
+    float tEnter = t0;
+    float r2 = radius * radius;
+    while (!(hitID >= 0 && hitT < tEnter - slack)) {
+        int lo[3], hi[3];
+        for (int a = 0; a < 3; a++) {
+            lo[a] = std::max(0, cell[a] - m);
+            hi[a] = std::min(m_dims[a] - 1, cell[a] + m);
+        }
+        for (int z = lo[2]; z <= hi[2]; z++) {
+            for (int y = lo[1]; y <= hi[1]; y++) {
+                for (int x = lo[0]; x <= hi[0]; x++) {
+                    size_t c = cellIndex(x, y, z);
+                    for (uint32_t j = m_cellStart[c]; j < m_cellStart[c + 1]; j++) {
+                        int id = (int)m_cellPoints[j];
+                        const float* p = position(id);
+                        float v[3] = { p[0] - origin[0], p[1] - origin[1], p[2] - origin[2] };
+                        float t = v[0] * d[0] + v[1] * d[1] + v[2] * d[2];
+                        if (t <= 0.0f) continue;
+                        float perp2 = std::max(0.0f, v[0] * v[0] + v[1] * v[1] + v[2] * v[2] - t * t);
+                        if (perp2 <= r2) {
+                            bool better = hitID < 0 || t < hitT || (t == hitT && id < hitID);
+                            if (better && accept(id)) {
+                                hitID = id;
+                                hitT = t;
+                            }
+                        } else if (hitID < 0) {
+                            float cone = radius + spread * t;
+                            if (perp2 > cone * cone) continue;
+                            float score = perp2 / (cone * cone);
+                            bool better = nearID < 0 || score < nearScore || (score == nearScore && t < nearT);
+                            if (better && accept(id)) {
+                                nearID = id;
+                                nearScore = score;
+                                nearT = t;
+                            }
+                        }
+                    }
+                }
+            }
+        }
+
+        int a = tNext[0] < tNext[1] ? (tNext[0] < tNext[2] ? 0 : 2) : (tNext[1] < tNext[2] ? 1 : 2);
+        if (tNext[a] > t1) break;
+        tEnter = tNext[a];
+        cell[a] += step[a];
+        tNext[a] += tDelta[a];
+        if (cell[a] < -m || cell[a] > m_dims[a] + m - 1) break;
+    }
+    return hitID >= 0 ? hitID : nearID;
+}
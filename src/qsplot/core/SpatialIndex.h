@@ -0,0 +1,72 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <vector>
+
+/**
+ * @brief Uniform grid over a point set for neighbour, radius and ray queries.
+ *
+ * build() keeps its own copy of the positions (morphed between two sets if
+ * asked), so a built index is immutable and may be queried from any thread
+ * while the renderer moves on. The grid is sized for about kPointsPerCell
+ * points per cell over the bounds of the finite positions, and the points are
+ * bucketed by a counting sort: cell counts and the scatter run on all cores
+ * with atomic counters, then every cell is sorted so the layout (and each
+ * query's tie-breaking) does not depend on the thread timing.
+ *
+ * Points with a non-finite position (absent from a keyframe) are not indexed.
+ * Distances are Euclidean in world units; results are nearest first, ties by ID.
+ */
+class SpatialIndex {
+public:
+    static constexpr size_t kPointsPerCell = 4;
+    static constexpr int kMaxCellsPerAxis = 1024;
+
+    SpatialIndex() = default;
+
+    /**
+     * @brief Index `count` positions (x, y, z)
+     *
+     * `next` (nextCount positions) is interpolated in by `t` like the point
+     * shaders do; points past nextCount keep their current position.
+     */
+    void build(const float* current, size_t count, const float* next = nullptr, size_t nextCount = 0,
+               float t = 0.0f);
+
+    size_t size() const { return m_count; }   // IDs 0 .. size() - 1
+    size_t indexed() const { return m_cellPoints.size(); }  // Finite positions
+    bool contains(int id) const;
+    const float* position(int id) const { return m_positions.data() + (size_t)id * 3; }
+
+    // The k points nearest to `point`, without `exclude`
+    std::vector<int> knn(const float* point, size_t k, int exclude = -1) const;
+    // Every point within `radius` of `point`
+    std::vector<int> radius(const float* point, float radius) const;
+
+    /**
+     * @brief First point hit by a ray
+     *
+     * A point is hit when it lies in front of `origin` within `radius` of the
+     * ray; the front-most hit wins. Failing that, points within
+     * radius + spread * t (a cone, e.g. a few pixels of tolerance) count, and
+     * the one closest to the ray in that measure wins. `accept` rejects points
+     * that are not pickable. Returns -1 without a hit.
+     */
+    int raycast(const float* origin, const float* direction, float radius, float spread,
+                const std::function<bool(int)>& accept) const;
+
+private:
+    int cellCoord(float p, int axis) const;
+    size_t cellIndex(int x, int y, int z) const { return ((size_t)z * m_dims[1] + y) * m_dims[0] + x; }
+    float distance2(int id, const float* point) const;
+
+    size_t m_count = 0;
+    std::vector<float> m_positions;     // m_count x 3, as indexed
+    float m_origin[3] = { 0.0f, 0.0f, 0.0f };
+    float m_cellSize = 1.0f;
+    int m_dims[3] = { 0, 0, 0 };
+    std::vector<uint32_t> m_cellStart;  // Cells + 1 offsets into m_cellPoints
+    std::vector<uint32_t> m_cellPoints; // Finite IDs grouped by cell, ascending in each
+};
@@ -0,0 +1,103 @@
+#include "AsyncReadback.h"
+
+#include <glad/glad.h>
+#include <algorithm>
+#include <cstring>
+
+void AsyncReadback::init() {
+    if (m_initialized) return;
+    for (auto& slot : m_slots) {
+        glGenBuffers(1, &slot.pbo);
+    }
+    m_initialized = true;
+}
+
+void AsyncReadback::destroy() {
+    if (!m_initialized) return;
+    for (auto& slot : m_slots) {
+        if (slot.fence) {
+            glDeleteSync((GLsync)slot.fence);
+            slot.fence = nullptr;
+        }
+        glDeleteBuffers(1, &slot.pbo);
+        slot.pbo = 0;
+        slot.capacity = 0;
+    }
+    m_initialized = false;
+}
+
+bool AsyncReadback::busy() const {
+    for (const auto& slot : m_slots) {
+        if (slot.fence) return true;
+    }
+    return false;
+}
+
+bool AsyncReadback::request(int x, int y, int width, int height, int tag) {
+    if (!m_initialized || width <= 0 || height <= 0) return false;
+
+    Slot* free = nullptr;
+    for (auto& slot : m_slots) {
+        if (!slot.fence) { free = &slot; break; }
+    }
+    if (!free) return false;
+
+    size_t bytes = (size_t)width * (size_t)height * sizeof(int);
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, free->pbo);
+    if (bytes > free->capacity) {
+        glBufferData(GL_PIXEL_PACK_BUFFER, (GLsizeiptr)bytes, nullptr, GL_STREAM_READ);
+        free->capacity = bytes;
+    }
+
+    // With a pack buffer bound the last argument is an offset: the copy is queued, not waited on
+    glPixelStorei(GL_PACK_ALIGNMENT, 1);
+    glReadBuffer(GL_COLOR_ATTACHMENT0);
+    glReadPixels(x, y, width, height, GL_RED_INTEGER, GL_INT, nullptr);
+    glPixelStorei(GL_PACK_ALIGNMENT, 4);
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+
+    free->fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+    free->sequence = ++m_sequence;
+    free->tag = tag;
+    free->x = x;
+    free->y = y;
+    free->width = width;
+    free->height = height;
+    return true;
+}
+
+bool AsyncReadback::poll(Result& out) {
+    if (!m_initialized) return false;
+
+    // Oldest in-flight read first; later reads cannot complete before it
+    Slot* oldest = nullptr;
+    for (auto& slot : m_slots) {
+        if (slot.fence && (!oldest || slot.sequence < oldest->sequence)) oldest = &slot;
+    }
+    if (!oldest) return false;
+
+    GLenum status = glClientWaitSync((GLsync)oldest->fence, 0, 0);
+    if (status != GL_ALREADY_SIGNALED && status != GL_CONDITION_SATISFIED) return false;
+
+    glDeleteSync((GLsync)oldest->fence);
+    oldest->fence = nullptr;
+
+    out.tag = oldest->tag;
+    out.x = oldest->x;
+    out.y = oldest->y;
+    out.width = oldest->width;
+    out.height = oldest->height;
+    out.pixels.resize((size_t)oldest->width * (size_t)oldest->height);
+
+    size_t bytes = out.pixels.size() * sizeof(int);
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, oldest->pbo);
+    const void* mapped = glMapBufferRange(GL_PIXEL_PACK_BUFFER, 0, (GLsizeiptr)bytes, GL_MAP_READ_BIT);
+    if (mapped) {
+        std::memcpy(out.pixels.data(), mapped, bytes);
+        glUnmapBuffer(GL_PIXEL_PACK_BUFFER);
+    } else {
+        std::fill(out.pixels.begin(), out.pixels.end(), -1);
+    }
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+    return true;
+}
@@ -0,0 +1,59 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+/**
+ * @brief Ring of pixel-pack buffers for non-blocking integer framebuffer reads.
+ *
+ * request() issues glReadPixels into a free PBO and fences it; poll() hands back
+ * the oldest read whose fence has signaled, typically one or two frames later.
+ * Neither call waits on the GPU: if every slot is still in flight request()
+ * returns false and the caller retries next frame.
+ *
+ * Reads are single-channel GL_RED_INTEGER / GL_INT (the picking ID format).
+ */
+class AsyncReadback {
+public:
+    static constexpr int kSlots = 3;
+
+    struct Result {
+        int tag = 0;            // Caller-defined request kind
+        int x = 0, y = 0;       // Region origin (framebuffer pixels)
+        int width = 0, height = 0;
+        std::vector<int> pixels;  // width * height, row-major from the bottom row
+    };
+
+    AsyncReadback() = default;
+    ~AsyncReadback() = default;
+
+    AsyncReadback(const AsyncReadback&) = delete;
+    AsyncReadback& operator=(const AsyncReadback&) = delete;
+
+    // GL context must be current for all calls
+    void init();
+    void destroy();
+
+    // Read a region of the currently bound GL_READ_FRAMEBUFFER (color attachment 0)
+    bool request(int x, int y, int width, int height, int tag);
+
+    // Fetch the oldest completed read. Returns false if none is ready.
+    bool poll(Result& out);
+
+    bool busy() const;  // Any read still in flight
+
+private:
+    struct Slot {
+        unsigned int pbo = 0;
+        size_t capacity = 0;    // Allocated PBO size (bytes)
+        void* fence = nullptr;  // GLsync, null when the slot is free
+        uint64_t sequence = 0;
+        int tag = 0;
+        int x = 0, y = 0, width = 0, height = 0;
+    };
+
+    Slot m_slots[kSlots];
+    uint64_t m_sequence = 0;
+    bool m_initialized = false;
+};
@@ -76,6 +76,14 @@ void Camera::reset() {
     updateView();
 }
 
+void Camera::setOrbit(float yaw, float pitch, float distance) {
+    float limit = 89.0f * 3.14159f / 180.0f;
+    m_yaw = yaw;
+    m_pitch = std::clamp(pitch, -limit, limit);
+    m_distance = std::max(distance, 0.1f);
+    updateView();
+}
+
 Eigen::Matrix4f Camera::getViewMatrix() const { return m_view; }
 Eigen::Matrix4f Camera::getProjectionMatrix() const { return m_projection; }
 Eigen::Matrix4f Camera::getViewProjectionMatrix() const { return m_projection * m_view; }
@@ -14,6 +14,7 @@ public:
     void zoom(float delta);
     void pan(float deltaX, float deltaY);
     void reset();
+    void setOrbit(float yaw, float pitch, float distance);  // Radians, world units
 
     // Getters
     Eigen::Matrix4f getViewMatrix() const;
@@ -0,0 +1,88 @@
+#include "ColorMap.h"
+
+#include <algorithm>
+#include <cmath>
+
+namespace {
+
+constexpr float kCategoryHueStep = 0.618033988749895f;  // Golden ratio conjugate
+
+// Tableau 10
+constexpr uint8_t kTableau[10][3] = {
+    { 78, 121, 167 }, { 242, 142, 43 }, { 225, 87, 89 }, { 118, 183, 178 }, { 89, 161, 79 },
+    { 237, 201, 72 }, { 176, 122, 161 }, { 255, 157, 167 }, { 156, 117, 95 }, { 186, 176, 172 }
+};
+
+ColorMap::Color quantize(float r, float g, float b) {
+    auto q = [](float c) { return (uint8_t)std::lround(std::clamp(c, 0.0f, 1.0f) * 255.0f); };
+    return { q(r), q(g), q(b), 255 };
+}
+
+ColorMap::Color mix(const float* a, const float* b, float f) {
+    return quantize(a[0] + (b[0] - a[0]) * f, a[1] + (b[1] - a[1]) * f, a[2] + (b[2] - a[2]) * f);
+}
+
+// Two-segment ramp through a middle color
+ColorMap::Table ramp(const float* low, const float* middle, const float* high) {
+    ColorMap::Table table;
+    for (int i = 0; i < ColorMap::kSize; i++) {
+        float t = (float)i / (ColorMap::kSize - 1);
+        table[i] = t < 0.5f ? mix(low, middle, t * 2.0f) : mix(middle, high, (t - 0.5f) * 2.0f);
+    }
+    return table;
+}
+
+ColorMap::Color hsv(float h, float s, float v) {
+    float r = std::fabs(h * 6.0f - 3.0f) - 1.0f;
+    float g = 2.0f - std::fabs(h * 6.0f - 2.0f);
+    float b = 2.0f - std::fabs(h * 6.0f - 4.0f);
+    auto channel = [&](float c) { return v * (1.0f - s + s * std::clamp(c, 0.0f, 1.0f)); };
+    return quantize(channel(r), channel(g), channel(b));
+}
+
+}  // namespace
+
+ColorMap::Table ColorMap::palette(int palette) {
+    if (palette == CoolWarm) {
+        const float cool[3] = { 0.2f, 0.4f, 1.0f }, neutral[3] = { 0.9f, 0.9f, 0.9f }, warm[3] = { 1.0f, 0.2f, 0.2f };
+        return ramp(cool, neutral, warm);
+    }
+    if (palette == Grayscale) {
+        const float black[3] = { 0.0f, 0.0f, 0.0f }, gray[3] = { 0.5f, 0.5f, 0.5f }, white[3] = { 1.0f, 1.0f, 1.0f };
+        return ramp(black, gray, white);
+    }
+    const float blue[3] = { 0.0f, 0.0f, 1.0f }, cyan[3] = { 0.0f, 1.0f, 1.0f }, red[3] = { 1.0f, 0.0f, 0.0f };
+    return ramp(blue, cyan, red);
+}
+
+ColorMap::Table ColorMap::categorical() {
+    Table table;
+    for (int k = 0; k < kSize; k++) {
+        if (k < 10) {
+            table[k] = { kTableau[k][0], kTableau[k][1], kTableau[k][2], 255 };
+        } else {
+            float hue = std::fmod(k * kCategoryHueStep, 1.0f);
+            table[k] = hsv(hue, 0.55f + 0.2f * (k % 2), 0.9f - 0.15f * (k % 3));
+        }
+    }
+    return table;
+}
+
+void ColorMap::sample(const Table& table, float t, float* rgb) {
+    // NaN maps to the first entry
+    float x = std::isnan(t) ? 0.0f : std::clamp(t, 0.0f, 1.0f) * (kSize - 1);
+    int i = std::min((int)x, kSize - 2);
+    float f = x - i;
+    const Color& a = table[i];
+    const Color& b = table[i + 1];
+    rgb[0] = (a.r + (b.r - a.r) * f) / 255.0f;
+    rgb[1] = (a.g + (b.g - a.g) * f) / 255.0f;
+    rgb[2] = (a.b + (b.b - a.b) * f) / 255.0f;
+}
+
+void ColorMap::category(const Table& table, int category, float* rgb) {
+    const Color& c = table[std::clamp(category, 0, kSize - 1)];
+    rgb[0] = c.r / 255.0f;
+    rgb[1] = c.g / 255.0f;
+    rgb[2] = c.b / 255.0f;
+}
@@ -0,0 +1,35 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+
+/**
+ * @brief Color palettes as kSize-entry RGBA8 lookup tables.
+ *
+ * The tables are what the renderer uploads into its LUT texture, and the CPU
+ * reads the same entries for the legend and the selection color, so the three
+ * can never drift apart. Continuous palettes are sampled like GL_LINEAR at
+ * texel centers: entry i holds the color of t = i / (kSize - 1). Categorical
+ * tables hold one color per label and are read without interpolation.
+ */
+class ColorMap {
+public:
+    enum Palette { Heatmap = 0, CoolWarm, Grayscale, kPaletteCount };
+
+    static constexpr int kSize = 256;  // Also the number of categories (uint8 labels)
+
+    struct Color {
+        uint8_t r, g, b, a;
+    };
+    using Table = std::array<Color, kSize>;
+
+    // Continuous palette; unknown ids fall back to Heatmap
+    static Table palette(int palette);
+    // Category k gets a Tableau 10 color for k < 10, then golden-ratio hues
+    static Table categorical();
+
+    // rgb in [0, 1], matching what the LUT texture returns
+    static void sample(const Table& table, float t, float* rgb);
+    static void category(const Table& table, int category, float* rgb);
+};
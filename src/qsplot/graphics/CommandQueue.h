@@ -0,0 +1,94 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <utility>
+
+/**
+ * @brief Bounded single-producer / single-consumer lock-free ring.
+ *
+ * The producer (Python threads, serialized by the Renderer's producer lock) pushes, the render thread
+ * pops. Head and tail live on separate cache lines so the two sides never
+ * contend on the same line.
+ *
+ * @tparam T        Movable element type
+ * @tparam Capacity Number of slots, must be a power of two
+ */
+template <typename T, size_t Capacity>
+class SpscQueue {
+    static_assert(Capacity >= 2 && (Capacity & (Capacity - 1)) == 0, "Capacity must be a power of two");
+
+public:
+    // Producer: returns false if the queue is full
+    bool push(T&& item) {
+        size_t tail = m_tail.load(std::memory_order_relaxed);
+        if (tail - m_head.load(std::memory_order_acquire) >= Capacity) return false;
+        m_items[tail & (Capacity - 1)] = std::move(item);
+        m_tail.store(tail + 1, std::memory_order_release);
+        return true;
+    }
+
+    // Consumer: returns false if the queue is empty
+    bool pop(T& out) {
+        size_t head = m_head.load(std::memory_order_relaxed);
+        if (head == m_tail.load(std::memory_order_acquire)) return false;
+        T& slot = m_items[head & (Capacity - 1)];
+        out = std::move(slot);
+        slot = T();  // Release captured resources before the slot is reused
+        m_head.store(head + 1, std::memory_order_release);
+        return true;
+    }
+
+    // Approximate when called concurrently
+    size_t size() const {
+        return m_tail.load(std::memory_order_acquire) - m_head.load(std::memory_order_acquire);
+    }
+
+    static constexpr size_t capacity() { return Capacity; }
+
+private:
+    alignas(64) std::atomic<size_t> m_head{0};  // Next slot to pop (consumer)
+    alignas(64) std::atomic<size_t> m_tail{0};  // Next slot to push (producer)
+    alignas(64) T m_items[Capacity];
+};
+
+/**
+ * @brief One-shot completion flag shared by a producer and the render thread.
+ *
+ * Handed out by Renderer::fence(). The render thread completes it; any thread
+ * may poll or wait on it.
+ */
+class Completion {
+public:
+    void complete() {
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_done = true;
+        }
+        m_cv.notify_all();
+    }
+
+    bool done() const {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        return m_done;
+    }
+
+    // timeoutSeconds < 0 waits forever. False on timeout.
+    bool wait(double timeoutSeconds = -1.0) const {
+        std::unique_lock<std::mutex> lock(m_mutex);
+        if (timeoutSeconds < 0.0) {
+            m_cv.wait(lock, [this] { return m_done; });
+            return true;
+        }
+        return m_cv.wait_for(lock, std::chrono::duration<double>(timeoutSeconds), [this] { return m_done; });
+    }
+
+private:
+    mutable std::mutex m_mutex;
+    mutable std::condition_variable m_cv;
+    bool m_done = false;
+};
@@ -0,0 +1,226 @@
+#include "FrameExporter.h"
+#include "ImageWriter.h"
+
+#include <glad/glad.h>
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <iostream>
+
+#ifdef _WIN32
+#define popen _popen
+#define pclose _pclose
+static const char* kPipeMode = "wb";
+#else
+static const char* kPipeMode = "w";
+#endif
+
+struct FrameExporter::Pipe {
+    FILE* file = nullptr;
+    std::string command;
+    uint64_t issued = 0;  // Frames handed to the workers (render thread)
+
+    std::mutex mutex;
+    std::condition_variable turn;
+    uint64_t written = 0;  // Next frame allowed to write
+    bool broken = false;
+
+    ~Pipe() {
+        if (file && pclose(file) != 0) {
+            std::cerr << "[Export] Encoder exited with an error: " << command << std::endl;
+        }
+    }
+};
+
+std::shared_ptr<FrameExporter::Pipe> FrameExporter::openPipe(const std::string& command) {
+    FILE* file = popen(command.c_str(), kPipeMode);
+    if (!file) {
+        std::cerr << "[Export] ERROR: Could not start: " << command << std::endl;
+        return nullptr;
+    }
+    auto pipe = std::make_shared<Pipe>();
+    pipe->file = file;
+    pipe->command = command;
+    return pipe;
+}
+
+void FrameExporter::init(int workers) {
+    if (m_initialized) return;
+    for (auto& slot : m_slots) {
+        glGenBuffers(1, &slot.pbo);
+    }
+
+    m_workerCount = workers;
+    m_stopping = false;
+    m_initialized = true;
+}
+
+void FrameExporter::startWorkers() {
+    // Deferred to the first export: most sessions never export a frame
+    int workers = m_workerCount;
+    if (workers <= 0) {
+        workers = std::max(1, (int)std::thread::hardware_concurrency() - 1);
+    }
+    for (int i = 0; i < workers; i++) {
+        m_workers.emplace_back(&FrameExporter::workerLoop, this);
+    }
+}
+
+void FrameExporter::destroy() {
+    if (!m_initialized) return;
+    while (readbackBusy()) poll(true);
+
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_stopping = true;
+    }
+    m_wake.notify_all();
+    for (auto& t : m_workers) t.join();
+    m_workers.clear();
+
+    for (auto& slot : m_slots) {
+        glDeleteBuffers(1, &slot.pbo);
+        slot = Slot{};
+    }
+    m_initialized = false;
+}
+
+bool FrameExporter::readbackBusy() const {
+    for (const auto& slot : m_slots) {
+        if (slot.fence) return true;
+    }
+    return false;
+}
+
+bool FrameExporter::full() const {
+    for (const auto& slot : m_slots) {
+        if (!slot.fence) return false;
+    }
+    return true;
+}
+
+bool FrameExporter::request(int width, int height, Frame frame) {
+    if (!m_initialized || width <= 0 || height <= 0) return false;
+
+    Slot* free = nullptr;
+    for (auto& slot : m_slots) {
+        if (!slot.fence) { free = &slot; break; }
+    }
+    if (!free) return false;
+    if (m_workers.empty()) startWorkers();
+
+    size_t bytes = (size_t)width * (size_t)height * 4;
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, free->pbo);
+    if (bytes > free->capacity) {
+        glBufferData(GL_PIXEL_PACK_BUFFER, (GLsizeiptr)bytes, nullptr, GL_STREAM_READ);
+        free->capacity = bytes;
+    }
+
+    // RGBA8 is the readback format drivers convert fastest; alpha is dropped by the encoder
+    glPixelStorei(GL_PACK_ALIGNMENT, 1);
+    glReadBuffer(GL_COLOR_ATTACHMENT0);
+    glReadPixels(0, 0, width, height, GL_RGBA, GL_UNSIGNED_BYTE, nullptr);
+    glPixelStorei(GL_PACK_ALIGNMENT, 4);
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+
+    free->fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+    free->sequence = ++m_sequence;
+    free->width = width;
+    free->height = height;
+    free->frame = std::move(frame);
+    return true;
+}
+
+void FrameExporter::poll(bool wait) {
+    // Hand reads over in request order so pipes see their frames in sequence
+    while (true) {
+        Slot* oldest = nullptr;
+        for (auto& slot : m_slots) {
+            if (slot.fence && (!oldest || slot.sequence < oldest->sequence)) oldest = &slot;
+        }
+        if (!oldest) return;
+
+        GLenum status = wait ? glClientWaitSync((GLsync)oldest->fence, GL_SYNC_FLUSH_COMMANDS_BIT, 1000000000ull)
+                             : glClientWaitSync((GLsync)oldest->fence, 0, 0);
+        if (status != GL_ALREADY_SIGNALED && status != GL_CONDITION_SATISFIED) return;
+        glDeleteSync((GLsync)oldest->fence);
+        oldest->fence = nullptr;
+        wait = false;  // Only block for the first one
+
+        Job job;
+        job.width = oldest->width;
+        job.height = oldest->height;
+        job.rgba.resize((size_t)job.width * (size_t)job.height * 4);
+        glBindBuffer(GL_PIXEL_PACK_BUFFER, oldest->pbo);
+        void* mapped = glMapBufferRange(GL_PIXEL_PACK_BUFFER, 0, (GLsizeiptr)job.rgba.size(), GL_MAP_READ_BIT);
+        if (mapped) {
+            std::memcpy(job.rgba.data(), mapped, job.rgba.size());
+            glUnmapBuffer(GL_PIXEL_PACK_BUFFER);
+        } else {
+            job.rgba.clear();  // Reported as failed by the worker
+        }
+        glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+
+        job.frame = std::move(oldest->frame);
+        oldest->frame = Frame{};
+        if (job.frame.pipe) job.pipeSequence = job.frame.pipe->issued++;
+
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_jobs.push_back(std::move(job));
+        }
+        m_wake.notify_one();
+    }
+}
+
+void FrameExporter::workerLoop() {
+    while (true) {
+        Job job;
+        {
+            std::unique_lock<std::mutex> lock(m_mutex);
+            m_wake.wait(lock, [this] { return m_stopping || !m_jobs.empty(); });
+            if (m_jobs.empty()) return;  // Stopping and drained
+            job = std::move(m_jobs.front());
+            m_jobs.pop_front();
+        }
+        encode(job);
+        m_finished.fetch_add(1, std::memory_order_release);
+    }
+}
+
+void FrameExporter::encode(Job& job) {
+    // Bottom-up RGBA to top-down RGB
+    const size_t stride = (size_t)job.width * 3;
+    std::vector<unsigned char> rgb(stride * (size_t)job.height);
+    if (!job.rgba.empty()) {
+        for (int y = 0; y < job.height; y++) {
+            const unsigned char* src = job.rgba.data() + (size_t)(job.height - 1 - y) * job.width * 4;
+            unsigned char* dst = rgb.data() + (size_t)y * stride;
+            for (int x = 0; x < job.width; x++) {
+                dst[x * 3 + 0] = src[x * 4 + 0];
+                dst[x * 3 + 1] = src[x * 4 + 1];
+                dst[x * 3 + 2] = src[x * 4 + 2];
+            }
+        }
+    }
+    bool ok = !job.rgba.empty();
+
+    if (Pipe* pipe = job.frame.pipe.get()) {
+        // Wait for this frame's turn: earlier frames are always ahead in the queue
+        std::unique_lock<std::mutex> lock(pipe->mutex);
+        pipe->turn.wait(lock, [&] { return pipe->written == job.pipeSequence; });
+        if (ok && !pipe->broken) {
+            pipe->broken = std::fwrite(rgb.data(), 1, rgb.size(), pipe->file) != rgb.size();
+        }
+        ok = ok && !pipe->broken;
+        pipe->written++;
+        lock.unlock();
+        pipe->turn.notify_all();
+        job.frame.pipe.reset();  // The last frame closes the encoder
+    } else if (ok) {
+        ok = writeImage(job.frame.path, rgb.data(), job.width, job.height);
+        if (!ok) std::cerr << "[Export] ERROR: Could not write to: " << job.frame.path << std::endl;
+    }
+
+    if (!ok) m_failed.fetch_add(1, std::memory_order_release);
+}
@@ -0,0 +1,98 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+/**
+ * @brief Asynchronous frame export: PBO readback + encoder thread pool.
+ *
+ * request() queues a glReadPixels of the bound read framebuffer into a free
+ * pixel-pack buffer and fences it. poll() copies completed reads out of their
+ * PBOs and hands them to the workers, which flip, encode (see ImageWriter.h)
+ * and write them, so the render thread never waits for the GPU or the disk
+ * unless every PBO is in flight.
+ *
+ * Frames of a pipe are written to it as raw RGB24 in request order (e.g. into
+ * `ffmpeg -f rawvideo -pix_fmt rgb24 -s WxH -i - out.mp4`).
+ */
+class FrameExporter {
+public:
+    static constexpr int kSlots = 4;
+
+    struct Pipe;  // An open encoder process, closed with its last frame
+
+    struct Frame {
+        std::string path;            // Image file, unused when piped
+        std::shared_ptr<Pipe> pipe;  // Raw output stream, or null
+    };
+
+    FrameExporter() = default;
+    ~FrameExporter() = default;
+
+    FrameExporter(const FrameExporter&) = delete;
+    FrameExporter& operator=(const FrameExporter&) = delete;
+
+    // GL context must be current for init/destroy/request/poll.
+    // workers: encoder threads (0 = one per core, minus the render thread),
+    // started by the first request()
+    void init(int workers);
+    // Finishes every requested frame, then stops the workers
+    void destroy();
+
+    // Start a shell command reading raw frames on stdin. Null on failure.
+    static std::shared_ptr<Pipe> openPipe(const std::string& command);
+
+    // Read the bound GL_READ_FRAMEBUFFER (color attachment 0). False if all slots are in flight.
+    bool request(int width, int height, Frame frame);
+
+    // Hand completed reads to the encoders; wait: block until the oldest read completes
+    void poll(bool wait);
+
+    bool readbackBusy() const;  // Any read still in flight
+    bool full() const;          // Every slot in flight: request() would fail
+    uint64_t finished() const { return m_finished.load(std::memory_order_acquire); }  // Written or failed
+    uint64_t failed() const { return m_failed.load(std::memory_order_acquire); }
+
+private:
+    struct Slot {
+        unsigned int pbo = 0;
+        size_t capacity = 0;    // Allocated PBO size (bytes)
+        void* fence = nullptr;  // GLsync, null when the slot is free
+        uint64_t sequence = 0;
+        int width = 0, height = 0;
+        Frame frame;
+    };
+
+    struct Job {
+        Frame frame;
+        uint64_t pipeSequence = 0;
+        int width = 0, height = 0;
+        std::vector<unsigned char> rgba;  // Bottom row first, as read
+    };
+
+    void startWorkers();
+    void workerLoop();
+    void encode(Job& job);
+
+    Slot m_slots[kSlots];
+    uint64_t m_sequence = 0;
+    bool m_initialized = false;
+
+    int m_workerCount = 0;
+    std::vector<std::thread> m_workers;
+    std::deque<Job> m_jobs;
+    std::mutex m_mutex;
+    std::condition_variable m_wake;
+    bool m_stopping = false;
+
+    std::atomic<uint64_t> m_finished{0};
+    std::atomic<uint64_t> m_failed{0};
+};
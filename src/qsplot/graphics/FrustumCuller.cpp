@@ -0,0 +1,237 @@
+#include "FrustumCuller.h"
+#include "../core/Parallel.h"
+
+#include <glad/glad.h>
+#include <Eigen/Dense>
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <cstring>
+
+namespace {
+    constexpr GLuint kGroupSize = 256;
+    constexpr GLuint kMaxGroupsX = 65535;
+    constexpr GLuint kStripVertices = 4;  // Billboard quad
+
+    struct DrawArraysIndirectCommand {
+        GLuint count;
+        GLuint instanceCount;
+        GLuint first;
+        GLuint baseInstance;
+    };
+}
+
+void FrustumCuller::init(unsigned int program) {
+    m_program = program;
+    glGenBuffers(1, &m_indexBuffer);
+    glGenBuffers(1, &m_commandBuffer);
+
+    DrawArraysIndirectCommand cmd = { kStripVertices, 0, 0, 0 };
+    glBindBuffer(GL_DRAW_INDIRECT_BUFFER, m_commandBuffer);
+    glBufferData(GL_DRAW_INDIRECT_BUFFER, sizeof(cmd), &cmd, GL_DYNAMIC_DRAW);
+    glBindBuffer(GL_DRAW_INDIRECT_BUFFER, 0);
+
+    if (m_program) {
+        for (auto& slot : m_countSlots) {
+            glGenBuffers(1, &slot.buffer);
+            glBindBuffer(GL_COPY_WRITE_BUFFER, slot.buffer);
+            glBufferData(GL_COPY_WRITE_BUFFER, sizeof(GLuint), nullptr, GL_STREAM_READ);
+        }
+        glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+    }
+}
+
+void FrustumCuller::destroy() {
+    for (auto& slot : m_countSlots) {
+        if (slot.fence) glDeleteSync((GLsync)slot.fence);
+        if (slot.buffer) glDeleteBuffers(1, &slot.buffer);
+        slot = CountSlot{};
+    }
+    if (m_indexBuffer) glDeleteBuffers(1, &m_indexBuffer);
+    if (m_commandBuffer) glDeleteBuffers(1, &m_commandBuffer);
+    m_indexBuffer = m_commandBuffer = 0;
+    m_indexCapacity = 0;
+    m_cpuValid = false;
+    m_cpuIndices.clear();
+    m_program = 0;  // Owned by the renderer
+}
+
+void FrustumCuller::extractPlanes(const float* viewProj, float planes[24]) {
+    // Gribb-Hartmann: rows of the column-major matrix combined with the w row
+    auto row = [viewProj](int r, int c) { return viewProj[c * 4 + r]; };
+    const int rows[6] = { 0, 0, 1, 1, 2, 2 };
+    const float signs[6] = { 1.0f, -1.0f, 1.0f, -1.0f, 1.0f, -1.0f };
+
+    for (int p = 0; p < 6; p++) {
+        float len = 0.0f;
+        for (int c = 0; c < 4; c++) {
+            planes[p * 4 + c] = row(3, c) + signs[p] * row(rows[p], c);
+            if (c < 3) len += planes[p * 4 + c] * planes[p * 4 + c];
+        }
+        len = std::sqrt(len);
+        if (len > 0.0f) {
+            for (int c = 0; c < 4; c++) planes[p * 4 + c] /= len;
+        }
+    }
+}
+
+void FrustumCuller::reserveIndices(size_t count) {
+    size_t bytes = std::max<size_t>(1, count) * sizeof(GLuint);
+    if (bytes <= m_indexCapacity) return;
+    glBindBuffer(GL_ARRAY_BUFFER, m_indexBuffer);
+    glBufferData(GL_ARRAY_BUFFER, (GLsizeiptr)bytes, nullptr, GL_DYNAMIC_DRAW);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+    m_indexCapacity = bytes;
+}
+
+void FrustumCuller::cull(const Query& query) {
+    float planes[24];
+    extractPlanes(query.viewProj, planes);
+
+    if (m_program) {
+        pollCount();
+        cullGPU(query, planes);
+    } else {
+        cullCPU(query, planes);
+    }
+}
+
+// ---------------------------------------------------------------------------
+// GPU path
+// ---------------------------------------------------------------------------
+
+void FrustumCuller::cullGPU(const Query& query, const float* planes) {
+    reserveIndices(query.current.count);
+
+    DrawArraysIndirectCommand cmd = { kStripVertices, 0, 0, 0 };
+    glBindBuffer(GL_DRAW_INDIRECT_BUFFER, m_commandBuffer);
+    glBufferSubData(GL_DRAW_INDIRECT_BUFFER, 0, sizeof(cmd), &cmd);
+    glBindBuffer(GL_DRAW_INDIRECT_BUFFER, 0);
+
+    bool hasNext = query.next.buffer != 0 && query.next.count > 0;
+    glUseProgram(m_program);
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 0, query.current.buffer);
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 1, hasNext ? query.next.buffer : query.current.buffer);
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 2, m_indexBuffer);
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 3, m_commandBuffer);
+
+    glUniform4fv(glGetUniformLocation(m_program, "uPlanes"), 6, planes);
+    glUniform1f(glGetUniformLocation(m_program, "uRadius"), query.radius);
+    glUniform1f(glGetUniformLocation(m_program, "uTime"), query.morphTime);
+    glUniform1ui(glGetUniformLocation(m_program, "uCount"), (GLuint)query.current.count);
+    glUniform1ui(glGetUniformLocation(m_program, "uNextCount"), hasNext ? (GLuint)query.next.count : 0u);
+    glUniform1ui(glGetUniformLocation(m_program, "uCurrentOffset"), (GLuint)(query.current.offset / sizeof(float)));
+    glUniform1ui(glGetUniformLocation(m_program, "uNextOffset"), hasNext ? (GLuint)(query.next.offset / sizeof(float)) : 0u);
+
+    if (query.current.count > 0) {
+        GLuint groups = (GLuint)((query.current.count + kGroupSize - 1) / kGroupSize);
+        GLuint groupsX = std::min(groups, kMaxGroupsX);
+        GLuint groupsY = (groups + groupsX - 1) / groupsX;
+        glDispatchCompute(groupsX, groupsY, 1);
+    }
+
+    // The draw reads the command and the indices (as attribute 5); the copy below reads the count
+    glMemoryBarrier(GL_COMMAND_BARRIER_BIT | GL_VERTEX_ATTRIB_ARRAY_BARRIER_BIT | GL_BUFFER_UPDATE_BARRIER_BIT);
+    glUseProgram(0);
+
+    // Delayed visible count for the UI; skipped while every slot is in flight
+    CountSlot& slot = m_countSlots[m_nextCountSlot];
+    if (!slot.fence) {
+        glBindBuffer(GL_COPY_READ_BUFFER, m_commandBuffer);
+        glBindBuffer(GL_COPY_WRITE_BUFFER, slot.buffer);
+        glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER,
+                            offsetof(DrawArraysIndirectCommand, instanceCount), 0, sizeof(GLuint));
+        glBindBuffer(GL_COPY_READ_BUFFER, 0);
+        glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+        slot.fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+        m_nextCountSlot = (m_nextCountSlot + 1) % kCountSlots;
+    }
+}
+
+void FrustumCuller::pollCount() {
+    // Slots complete in submission order, starting with the oldest
+    for (int k = 0; k < kCountSlots; k++) {
+        CountSlot& slot = m_countSlots[(m_nextCountSlot + k) % kCountSlots];
+        if (!slot.fence) continue;
+
+        GLenum status = glClientWaitSync((GLsync)slot.fence, 0, 0);
+        if (status != GL_ALREADY_SIGNALED && status != GL_CONDITION_SATISFIED) break;
+        glDeleteSync((GLsync)slot.fence);
+        slot.fence = nullptr;
+
+        GLuint count = 0;
+        glBindBuffer(GL_COPY_READ_BUFFER, slot.buffer);
+        glGetBufferSubData(GL_COPY_READ_BUFFER, 0, sizeof(GLuint), &count);
+        glBindBuffer(GL_COPY_READ_BUFFER, 0);
+        m_visible = count;
+    }
+}
+
+// ---------------------------------------------------------------------------
+// CPU fallback
+// ---------------------------------------------------------------------------
+
+void FrustumCuller::cullCPU(const Query& query, const float* planes) {
+    // Nothing moved: last frame's indices are still exact
+    if (m_cpuValid &&
+        std::memcmp(query.viewProj, m_lastQuery.viewProj, sizeof(query.viewProj)) == 0 &&
+        query.morphTime == m_lastQuery.morphTime && query.radius == m_lastQuery.radius &&
+        query.dataVersion == m_lastQuery.dataVersion &&
+        query.current.count == m_lastQuery.current.count && query.next.count == m_lastQuery.next.count) {
+        return;
+    }
+    m_lastQuery = query;
+    m_cpuValid = true;
+
+    const float* current = query.current.cpu;
+    size_t count = current ? query.current.count : 0;
+    const float* next = query.next.cpu;
+    size_t nextCount = next ? query.next.count : 0;
+    float t = query.morphTime;
+
+    Eigen::Map<const Eigen::Matrix<float, 4, 6>> planeMat(planes);
+    Eigen::Matrix<float, 3, 6> normals = planeMat.topRows<3>();
+    Eigen::Matrix<float, 1, 6> limits = planeMat.row(3).array() + query.radius;
+
+    size_t chunks = parallelChunkCount(count, 1 << 16);
+    std::vector<std::vector<unsigned int>> partial(chunks);
+
+    parallelFor(count, 1 << 16, [&](size_t chunk, size_t begin, size_t end) {
+        constexpr size_t kBlock = 1024;
+        Eigen::Matrix3Xf pos(3, kBlock);
+        Eigen::Matrix<float, 6, Eigen::Dynamic> dist(6, kBlock);
+        std::vector<unsigned int>& out = partial[chunk];
+
+        for (size_t b = begin; b < end; b += kBlock) {
+            size_t n = std::min(kBlock, end - b);
+            Eigen::Map<const Eigen::Matrix3Xf> cur(current + b * 3, 3, (Eigen::Index)n);
+            pos.leftCols(n) = cur;
+
+            size_t morphed = (b < nextCount) ? std::min(n, nextCount - b) : 0;
+            if (morphed > 0) {
+                Eigen::Map<const Eigen::Matrix3Xf> nxt(next + b * 3, 3, (Eigen::Index)morphed);
+                pos.leftCols(morphed) += t * (nxt - cur.leftCols(morphed));
+            }
+
+            // Signed distance + radius to all six planes at once
+            dist.leftCols(n) = (normals.transpose() * pos.leftCols(n)).colwise() + limits.transpose();
+            for (size_t j = 0; j < n; j++) {
+                if (dist.col(j).minCoeff() >= 0.0f) out.push_back((unsigned int)(b + j));
+            }
+        }
+    });
+
+    m_cpuIndices.clear();
+    for (auto& p : partial) m_cpuIndices.insert(m_cpuIndices.end(), p.begin(), p.end());
+    m_visible = m_cpuIndices.size();
+
+    reserveIndices(m_cpuIndices.size());
+    glBindBuffer(GL_ARRAY_BUFFER, m_indexBuffer);
+    glBufferSubData(GL_ARRAY_BUFFER, 0, (GLsizeiptr)(m_cpuIndices.size() * sizeof(GLuint)), m_cpuIndices.data());
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+    DrawArraysIndirectCommand cmd = { kStripVertices, (GLuint)m_cpuIndices.size(), 0, 0 };
+    glBindBuffer(GL_DRAW_INDIRECT_BUFFER, m_commandBuffer);
+    glBufferSubData(GL_DRAW_INDIRECT_BUFFER, 0, sizeof(cmd), &cmd);
+    glBindBuffer(GL_DRAW_INDIRECT_BUFFER, 0);
+}
@@ -0,0 +1,78 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "InstanceSource.h"
+
+/**
+ * @brief Frustum culling into a compacted index buffer for indirect draws.
+ *
+ * cull() writes the indices of all instances whose bounding sphere touches the
+ * view frustum into indexBuffer() and the matching DrawArraysIndirectCommand
+ * (4-vertex strip, one instance per visible point) into commandBuffer().
+ *
+ * - GL 4.3+: a compute pass appends indices with an atomic counter on the
+ *   instance count, every frame. The visible count is read back through a
+ *   small fenced ring, so visibleCount() lags a frame or two.
+ * - Fallback: the positions are culled on all cores and uploaded, only when
+ *   the camera, morph or data changed since the last call.
+ */
+class FrustumCuller {
+public:
+    struct Query {
+        float viewProj[16];        // Column-major view-projection matrix
+        float morphTime = 0.0f;
+        float radius = 0.0f;       // Bounding sphere of one billboard (world units)
+        InstanceSource current, next;
+        uint64_t dataVersion = 0;  // Changes whenever instance data is uploaded
+    };
+
+    static constexpr int kCountSlots = 3;
+
+    FrustumCuller() = default;
+    ~FrustumCuller() = default;
+
+    FrustumCuller(const FrustumCuller&) = delete;
+    FrustumCuller& operator=(const FrustumCuller&) = delete;
+
+    // program: linked cullComputeShaderSource, 0 for the CPU path
+    void init(unsigned int program);
+    void destroy();
+
+    bool gpu() const { return m_program != 0; }
+    void cull(const Query& query);
+
+    unsigned int indexBuffer() const { return m_indexBuffer; }
+    unsigned int commandBuffer() const { return m_commandBuffer; }
+    size_t visibleCount() const { return m_visible; }
+
+    // Six normalized planes (a, b, c, d) with the inside positive
+    static void extractPlanes(const float* viewProj, float planes[24]);
+
+private:
+    void cullGPU(const Query& query, const float* planes);
+    void cullCPU(const Query& query, const float* planes);
+    void pollCount();
+    void reserveIndices(size_t count);
+
+    struct CountSlot {
+        unsigned int buffer = 0;
+        void* fence = nullptr;  // GLsync
+    };
+
+    unsigned int m_program = 0;
+    unsigned int m_indexBuffer = 0;
+    unsigned int m_commandBuffer = 0;
+    size_t m_indexCapacity = 0;  // Bytes
+    size_t m_visible = 0;
+
+    CountSlot m_countSlots[kCountSlots];
+    int m_nextCountSlot = 0;
+
+    // CPU path: results are reused until the inputs change
+    bool m_cpuValid = false;
+    Query m_lastQuery;
+    std::vector<unsigned int> m_cpuIndices;
+};
@@ -0,0 +1,237 @@
+#include "ImageWriter.h"
+
+#include <algorithm>
+#include <cctype>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+namespace {
+    // Deflate (RFC 1951) fixed-Huffman tables
+    constexpr int kMinMatch = 3;
+    constexpr int kMaxMatch = 258;
+    constexpr int kWindow = 32768;
+    constexpr int kHashBits = 15;
+    constexpr int kMaxChain = 16;  // Candidates tried per position
+
+    constexpr uint16_t kLengthBase[29] = { 3, 4, 5, 6, 7, 8, 9, 10, 11, 13, 15, 17, 19, 23, 27, 31,
+                                           35, 43, 51, 59, 67, 83, 99, 115, 131, 163, 195, 227, 258 };
+    constexpr uint8_t kLengthExtra[29] = { 0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2, 2,
+                                           3, 3, 3, 3, 4, 4, 4, 4, 5, 5, 5, 5, 0 };
+    constexpr uint16_t kDistBase[30] = { 1, 2, 3, 4, 5, 7, 9, 13, 17, 25, 33, 49, 65, 97, 129, 193, 257, 385,
+                                         513, 769, 1025, 1537, 2049, 3073, 4097, 6145, 8193, 12289, 16385, 24577 };
+    constexpr uint8_t kDistExtra[30] = { 0, 0, 0, 0, 1, 1, 2, 2, 3, 3, 4, 4, 5, 5, 6, 6, 7, 7,
+                                         8, 8, 9, 9, 10, 10, 11, 11, 12, 12, 13, 13 };
+
+    // LSB-first bit stream; Huffman codes are written reversed, as they are read MSB-first
+    struct BitWriter {
+        std::vector<unsigned char>& out;
+        uint32_t bits = 0;
+        int count = 0;
+
+        void put(uint32_t value, int n) {
+            bits |= value << count;
+            count += n;
+            while (count >= 8) {
+                out.push_back((unsigned char)(bits & 0xFF));
+                bits >>= 8;
+                count -= 8;
+            }
+        }
+        void putCode(uint32_t code, int n) {
+            uint32_t reversed = 0;
+            for (int i = 0; i < n; i++) reversed |= ((code >> i) & 1u) << (n - 1 - i);
+            put(reversed, n);
+        }
+        void flush() {
+            if (count > 0) out.push_back((unsigned char)(bits & 0xFF));
+            bits = 0;
+            count = 0;
+        }
+    };
+
+    void putLiteral(BitWriter& w, int symbol) {
+        if (symbol < 144)      w.putCode(0x30 + symbol, 8);
+        else if (symbol < 256) w.putCode(0x190 + (symbol - 144), 9);
+        else if (symbol < 280) w.putCode(symbol - 256, 7);
+        else                   w.putCode(0xC0 + (symbol - 280), 8);
+    }
+
+    void putMatch(BitWriter& w, int length, int distance) {
+        int l = 28;
+        while (kLengthBase[l] > length) l--;
+        putLiteral(w, 257 + l);
+        w.put(length - kLengthBase[l], kLengthExtra[l]);
+
+        int d = 29;
+        while (kDistBase[d] > distance) d--;
+        w.putCode(d, 5);
+        w.put(distance - kDistBase[d], kDistExtra[d]);
+    }
+
+    uint32_t hash3(const unsigned char* p) {
+        uint32_t v = (uint32_t)p[0] << 16 | (uint32_t)p[1] << 8 | p[2];
+        return (v * 2654435761u) >> (32 - kHashBits);
+    }
+
+    // zlib stream: header, one final fixed-Huffman block, Adler-32
+    std::vector<unsigned char> zlibCompress(const std::vector<unsigned char>& data) {
+        std::vector<unsigned char> out;
+        out.reserve(data.size() / 4 + 64);
+        out.push_back(0x78);
+        out.push_back(0x01);
+
+        BitWriter w{ out };
+        w.put(1, 1);  // BFINAL
+        w.put(1, 2);  // BTYPE = fixed Huffman
+
+        const int n = (int)data.size();
+        const unsigned char* src = data.data();
+        std::vector<int> head(1 << kHashBits, -1);
+        std::vector<int> prev(kWindow, -1);
+
+        auto insert = [&](int pos) {
+            uint32_t h = hash3(src + pos);
+            prev[pos & (kWindow - 1)] = head[h];
+            head[h] = pos;
+        };
+
+        int pos = 0;
+        while (pos < n) {
+            int bestLength = 0, bestDistance = 0;
+            if (pos + kMinMatch <= n) {
+                int limit = std::min(kMaxMatch, n - pos);
+                int candidate = head[hash3(src + pos)];
+                for (int chain = 0; candidate >= 0 && chain < kMaxChain; chain++) {
+                    int distance = pos - candidate;
+                    if (distance > kWindow - 1) break;
+                    int length = 0;
+                    while (length < limit && src[candidate + length] == src[pos + length]) length++;
+                    if (length > bestLength) {
+                        bestLength = length;
+                        bestDistance = distance;
+                        if (length == limit) break;
+                    }
+                    candidate = prev[candidate & (kWindow - 1)];
+                }
+            }
+
+            if (bestLength >= kMinMatch) {
+                putMatch(w, bestLength, bestDistance);
+                int end = std::min(pos + bestLength, n - kMinMatch + 1);
+                for (int p = pos; p < end; p++) insert(p);
+                pos += bestLength;
+            } else {
+                putLiteral(w, src[pos]);
+                if (pos + kMinMatch <= n) insert(pos);
+                pos++;
+            }
+        }
+        putLiteral(w, 256);  // End of block
+        w.flush();
+
+        uint32_t a = 1, b = 0;
+        for (unsigned char c : data) {
+            a = (a + c) % 65521;
+            b = (b + a) % 65521;
+        }
+        uint32_t adler = (b << 16) | a;
+        for (int s = 24; s >= 0; s -= 8) out.push_back((unsigned char)(adler >> s));
+        return out;
+    }
+
+    uint32_t crc32(const unsigned char* data, size_t size, uint32_t crc = 0) {
+        static const auto table = [] {
+            std::vector<uint32_t> t(256);
+            for (uint32_t i = 0; i < 256; i++) {
+                uint32_t c = i;
+                for (int k = 0; k < 8; k++) c = (c & 1) ? 0xEDB88320u ^ (c >> 1) : c >> 1;
+                t[i] = c;
+            }
+            return t;
+        }();
+        crc = ~crc;
+        for (size_t i = 0; i < size; i++) crc = table[(crc ^ data[i]) & 0xFF] ^ (crc >> 8);
+        return ~crc;
+    }
+
+    void putU32(std::vector<unsigned char>& out, uint32_t v) {
+        for (int s = 24; s >= 0; s -= 8) out.push_back((unsigned char)(v >> s));
+    }
+
+    void putChunk(std::vector<unsigned char>& out, const char* type, const std::vector<unsigned char>& data) {
+        putU32(out, (uint32_t)data.size());
+        size_t start = out.size();
+        out.insert(out.end(), type, type + 4);
+        out.insert(out.end(), data.begin(), data.end());
+        putU32(out, crc32(out.data() + start, out.size() - start));
+    }
+
+    bool endsWith(const std::string& s, const char* suffix) {
+        size_t n = std::strlen(suffix);
+        if (s.size() < n) return false;
+        for (size_t i = 0; i < n; i++) {
+            if (std::tolower((unsigned char)s[s.size() - n + i]) != suffix[i]) return false;
+        }
+        return true;
+    }
+}
+
+std::vector<unsigned char> encodePng(const unsigned char* rgb, int width, int height) {
+    // Filtered scanlines: each row takes the filter with the smallest absolute sum
+    const size_t stride = (size_t)width * 3;
+    std::vector<unsigned char> filtered((stride + 1) * (size_t)height);
+    std::vector<unsigned char> candidate[3];
+    for (auto& c : candidate) c.resize(stride);
+
+    for (int y = 0; y < height; y++) {
+        const unsigned char* row = rgb + (size_t)y * stride;
+        const unsigned char* up = y > 0 ? row - stride : nullptr;
+
+        uint64_t best = UINT64_MAX;
+        int bestFilter = 0;
+        for (int f = 0; f < 3; f++) {
+            uint64_t sum = 0;
+            for (size_t x = 0; x < stride; x++) {
+                unsigned char predictor = 0;
+                if (f == 1 && x >= 3) predictor = row[x - 3];  // Sub
+                if (f == 2 && up) predictor = up[x];           // Up
+                unsigned char v = (unsigned char)(row[x] - predictor);
+                candidate[f][x] = v;
+                sum += v < 128 ? v : 256 - v;
+            }
+            if (sum < best) { best = sum; bestFilter = f; }
+        }
+
+        unsigned char* dst = filtered.data() + (size_t)y * (stride + 1);
+        dst[0] = (unsigned char)bestFilter;
+        std::memcpy(dst + 1, candidate[bestFilter].data(), stride);
+    }
+
+    std::vector<unsigned char> png = { 0x89, 'P', 'N', 'G', '\r', '\n', 0x1A, '\n' };
+    std::vector<unsigned char> header;
+    putU32(header, (uint32_t)width);
+    putU32(header, (uint32_t)height);
+    header.insert(header.end(), { 8, 2, 0, 0, 0 });  // 8-bit RGB, deflate, adaptive filter, no interlace
+    putChunk(png, "IHDR", header);
+    putChunk(png, "IDAT", zlibCompress(filtered));
+    putChunk(png, "IEND", {});
+    return png;
+}
+
+bool writeImage(const std::string& path, const unsigned char* rgb, int width, int height) {
+    FILE* fp = std::fopen(path.c_str(), "wb");
+    if (!fp) return false;
+
+    bool ok;
+    if (endsWith(path, ".ppm")) {
+        std::fprintf(fp, "P6\n%d %d\n255\n", width, height);
+        size_t bytes = (size_t)width * (size_t)height * 3;
+        ok = std::fwrite(rgb, 1, bytes, fp) == bytes;
+    } else {
+        std::vector<unsigned char> png = encodePng(rgb, width, height);
+        ok = std::fwrite(png.data(), 1, png.size(), fp) == png.size();
+    }
+    return std::fclose(fp) == 0 && ok;
+}
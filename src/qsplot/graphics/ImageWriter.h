@@ -0,0 +1,18 @@
+#pragma once
+
+#include <string>
+#include <vector>
+
+/**
+ * @brief Image encoders for exported frames (no external dependencies).
+ *
+ * Pixels are tightly packed RGB8 rows, top row first. PNG output uses
+ * per-row None/Sub/Up filtering and a single fixed-Huffman deflate block
+ * with greedy LZ77 matching: far from optimal, but uniform backgrounds and
+ * repeated rows (most of a scatter plot) compress well at encoding speeds
+ * that keep up with GPU readback.
+ */
+std::vector<unsigned char> encodePng(const unsigned char* rgb, int width, int height);
+
+// Format by extension: .ppm is binary PPM, anything else PNG. Returns false on I/O errors.
+bool writeImage(const std::string& path, const unsigned char* rgb, int width, int height);
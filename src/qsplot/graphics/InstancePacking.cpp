@@ -0,0 +1,100 @@
+#include "InstancePacking.h"
+#include "../core/Parallel.h"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <vector>
+
+namespace {
+    constexpr size_t kPackGrain = 1 << 16;
+    constexpr float kSnormMax = 32767.0f;
+    constexpr float kUnormMax = 65535.0f;
+    constexpr float kValueCodes = kUnormMax - 1.0f;  // Steps above kPackedAbsent
+
+    struct Bounds {
+        float lo[4] = { std::numeric_limits<float>::max(), std::numeric_limits<float>::max(),
+                        std::numeric_limits<float>::max(), std::numeric_limits<float>::max() };
+        float hi[4] = { std::numeric_limits<float>::lowest(), std::numeric_limits<float>::lowest(),
+                        std::numeric_limits<float>::lowest(), std::numeric_limits<float>::lowest() };
+
+        void add(int axis, float v) {
+            if (std::isnan(v)) return;
+            lo[axis] = std::min(lo[axis], v);
+            hi[axis] = std::max(hi[axis], v);
+        }
+    };
+
+    // Degenerate or empty axes keep a unit scale so decoding stays finite
+    float safeScale(float extent) {
+        return (extent > 0.0f && std::isfinite(extent)) ? extent : 1.0f;
+    }
+}
+
+PackedRange PackedRange::fit(const float* positions, const float* values, size_t count) {
+    std::vector<Bounds> partial(parallelChunkCount(count, kPackGrain));
+    parallelFor(count, kPackGrain, [&](size_t chunk, size_t begin, size_t end) {
+        Bounds& b = partial[chunk];
+        for (size_t i = begin; i < end; i++) {
+            for (int a = 0; a < 3; a++) b.add(a, positions[i * 3 + a]);
+            b.add(3, values[i]);
+        }
+    });
+
+    Bounds total;
+    for (const Bounds& b : partial) {
+        for (int a = 0; a < 4; a++) {
+            total.lo[a] = std::min(total.lo[a], b.lo[a]);
+            total.hi[a] = std::max(total.hi[a], b.hi[a]);
+        }
+    }
+
+    PackedRange range;
+    for (int a = 0; a < 3; a++) {
+        if (total.lo[a] > total.hi[a]) continue;  // No finite coordinate
+        range.posBias[a] = 0.5f * (total.lo[a] + total.hi[a]);
+        range.posScale[a] = safeScale(0.5f * (total.hi[a] - total.lo[a]));
+    }
+    if (total.lo[3] <= total.hi[3]) {
+        range.valueBias = total.lo[3];
+        range.valueScale = safeScale(total.hi[3] - total.lo[3]);
+    }
+    return range;
+}
+
+bool PackedRange::contains(const float* position, float value) const {
+    for (int a = 0; a < 3; a++) {
+        if (std::abs(position[a] - posBias[a]) > posScale[a]) return false;
+    }
+    return value >= valueBias && value <= valueBias + valueScale;
+}
+
+void PackedRange::valueDecode(float& scale, float& bias) const {
+    // code / 65535 * scale + bias == (code - 1) / 65534 * valueScale + valueBias
+    scale = valueScale * (kUnormMax / kValueCodes);
+    bias = valueBias - valueScale / kValueCodes;
+}
+
+void packInstances(const float* positions, const float* values, size_t begin, size_t end,
+                   const PackedRange& range, PackedInstance* out) {
+    float invPos[3];
+    for (int a = 0; a < 3; a++) invPos[a] = 1.0f / range.posScale[a];
+    const float invValue = 1.0f / range.valueScale;
+
+    parallelFor(end - begin, kPackGrain, [&](size_t, size_t lo, size_t hi) {
+        for (size_t k = lo; k < hi; k++) {
+            size_t i = begin + k;
+            PackedInstance& p = out[k];
+            bool absent = false;
+            for (int a = 0; a < 3; a++) {
+                float n = (positions[i * 3 + a] - range.posBias[a]) * invPos[a];
+                absent |= std::isnan(n);
+                n = std::isnan(n) ? 0.0f : std::clamp(n, -1.0f, 1.0f);
+                p.pos[a] = (int16_t)std::lround(n * kSnormMax);
+            }
+            float v = (values[i] - range.valueBias) * invValue;
+            v = std::isnan(v) ? 0.0f : std::clamp(v, 0.0f, 1.0f);
+            p.value = absent ? kPackedAbsent : (uint16_t)(1 + std::lround(v * kValueCodes));
+        }
+    });
+}
@@ -0,0 +1,43 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+/**
+ * @brief Compact instance record: 16-bit snorm position + 16-bit unorm value.
+ *
+ * One interleaved 8-byte record per instance instead of 16 bytes over two
+ * float VBOs. Positions are quantized to the bounding box of their set and
+ * the value to codes 1..65535 of its range; the attribute-fetch shaders
+ * restore them as q * scale + bias with the set's PackedRange. Value code 0
+ * (kPackedAbsent) marks a point with a NaN position, which the shader turns
+ * back into a NaN position so it is clipped like an absent float point.
+ */
+struct PackedInstance {
+    int16_t pos[3];  // snorm16
+    uint16_t value;  // unorm16, kPackedAbsent for NaN positions
+};
+static_assert(sizeof(PackedInstance) == 8, "PackedInstance must stay 8 bytes");
+
+constexpr uint16_t kPackedAbsent = 0;
+
+struct PackedRange {
+    // Decoded value = normalized * scale + bias. The defaults pass floats through.
+    float posScale[3] = { 1.0f, 1.0f, 1.0f };
+    float posBias[3] = { 0.0f, 0.0f, 0.0f };
+    float valueScale = 1.0f;
+    float valueBias = 0.0f;
+
+    // Bounding box of the positions and range of the values (NaNs ignored)
+    static PackedRange fit(const float* positions, const float* values, size_t count);
+
+    // True if the point quantizes without clamping
+    bool contains(const float* position, float value) const;
+
+    // Shader scale and bias of the normalized value attribute (codes 1..65535 span the range)
+    void valueDecode(float& scale, float& bias) const;
+};
+
+// Quantize points [begin, end) into out[0, end - begin), on all cores
+void packInstances(const float* positions, const float* values, size_t begin, size_t end,
+                   const PackedRange& range, PackedInstance* out);
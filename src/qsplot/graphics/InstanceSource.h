@@ -0,0 +1,18 @@
+#pragma once
+
+#include <cstddef>
+
+/**
+ * @brief Where the instance positions of the current draw live.
+ *
+ * Positions are tightly packed vec3s, either in a staged VBO (offset 0) or in
+ * a streaming ring segment. Compute passes bind `buffer` whole and add the
+ * offset themselves, since stream segments need not meet SSBO/TBO offset
+ * alignment. `cpu` mirrors the same data for the fallback paths.
+ */
+struct InstanceSource {
+    unsigned int buffer = 0;     // GL buffer holding the positions
+    size_t offset = 0;           // Byte offset of the first position
+    const float* cpu = nullptr;  // CPU copy of the same data
+    size_t count = 0;
+};
@@ -0,0 +1,306 @@
+#include "InstanceStream.h"
+
+#include <glad/glad.h>
+#include <chrono>
+#include <cstring>
+#include <thread>
+#include <iostream>
+
+namespace {
+    // Bytes per point in a segment: vec3 position + float value
+    constexpr size_t kPointBytes = 4 * sizeof(float);
+
+    // How long a producer waits for the render thread to recycle a segment
+    // before it gives up and takes the staged path instead
+    constexpr auto kClaimTimeout = std::chrono::milliseconds(100);
+
+    constexpr GLbitfield kPersistentFlags =
+        GL_MAP_WRITE_BIT | GL_MAP_READ_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+}
+
+void InstanceStream::init(bool persistent, size_t initialCapacity) {
+    if (m_initialized) return;
+
+    m_persistent = persistent;
+    m_initialized = true;
+    glGenBuffers(1, &m_buffer);
+
+    if (m_persistent && initialCapacity > 0) {
+        m_requestedCapacity = initialCapacity;
+        tryGrow();
+    }
+
+    m_accepting.store(true, std::memory_order_release);
+    std::cout << "[InstanceStream] Streaming uploads enabled ("
+              << (m_persistent ? "persistent mapped ring" : "orphaning fallback") << ")" << std::endl;
+}
+
+void InstanceStream::destroy() {
+    if (!m_initialized) return;
+    m_accepting.store(false, std::memory_order_release);
+
+    // A producer may still be copying into the mapping; let it finish
+    for (auto& seg : m_segments) {
+        while (seg.state.load(std::memory_order_acquire) == Writing) {
+            std::this_thread::yield();
+        }
+    }
+
+    for (auto& seg : m_segments) {
+        if (seg.fence) {
+            glDeleteSync((GLsync)seg.fence);
+            seg.fence = nullptr;
+        }
+        seg.state.store(Free, std::memory_order_release);
+        seg.cpu.clear();
+        seg.cpu.shrink_to_fit();
+    }
+
+    if (m_mapped) {
+        glBindBuffer(GL_ARRAY_BUFFER, m_buffer);
+        glUnmapBuffer(GL_ARRAY_BUFFER);
+        glBindBuffer(GL_ARRAY_BUFFER, 0);
+        m_mapped = nullptr;
+    }
+    if (m_buffer) {
+        glDeleteBuffers(1, &m_buffer);
+        m_buffer = 0;
+    }
+
+    m_capacity = 0;
+    m_gpuBytes = 0;
+    m_current = -1;
+    m_initialized = false;
+}
+
+float* InstanceStream::segmentBase(int index) const {
+    return reinterpret_cast<float*>(m_mapped + (size_t)index * m_capacity * kPointBytes);
+}
+
+size_t InstanceStream::positionOffset() const {
+    if (m_current < 0 || !m_persistent) return 0;
+    return (size_t)m_current * m_capacity * kPointBytes;
+}
+
+size_t InstanceStream::valueOffset() const {
+    if (m_current < 0) return 0;
+    if (!m_persistent) return m_segments[m_current].count * 3 * sizeof(float);
+    return positionOffset() + m_capacity * 3 * sizeof(float);
+}
+
+size_t InstanceStream::count() const {
+    return m_current >= 0 ? m_segments[m_current].count : 0;
+}
+
+const float* InstanceStream::currentPositions() const {
+    if (m_current < 0) return nullptr;
+    if (!m_persistent) return m_segments[m_current].cpu.data();
+    return segmentBase(m_current);
+}
+
+const float* InstanceStream::currentValues() const {
+    if (m_current < 0) return nullptr;
+    if (!m_persistent) return m_segments[m_current].cpu.data() + m_segments[m_current].count * 3;
+    return segmentBase(m_current) + m_capacity * 3;
+}
+
+// ---------------------------------------------------------------------------
+// Producer side
+// ---------------------------------------------------------------------------
+
+int InstanceStream::claimSegment() {
+    auto start = std::chrono::steady_clock::now();
+    bool stalled = false;
+
+    while (m_accepting.load(std::memory_order_acquire)) {
+        // Prefer a free segment, otherwise overwrite a published one that the
+        // render thread has not picked up yet (it is superseded by this frame)
+        for (int wanted : { (int)Free, (int)Ready }) {
+            for (int i = 0; i < kSegments; i++) {
+                int expected = wanted;
+                if (m_segments[i].state.compare_exchange_strong(expected, Writing, std::memory_order_acquire)) {
+                    return i;
+                }
+            }
+        }
+
+        // Every segment is current or still being read by the GPU
+        if (!stalled) {
+            stalled = true;
+            m_stalls.fetch_add(1, std::memory_order_relaxed);
+        }
+        if (std::chrono::steady_clock::now() - start > kClaimTimeout) break;
+        std::this_thread::yield();
+    }
+    return -1;
+}
+
+void InstanceStream::dropReadySegments() {
+    for (auto& seg : m_segments) {
+        int expected = Ready;
+        seg.state.compare_exchange_strong(expected, Free, std::memory_order_acq_rel);
+    }
+}
+
+bool InstanceStream::write(const float* positions, const float* values, size_t count) {
+    if (!positions || !values || count == 0) return false;
+    if (!m_accepting.load(std::memory_order_acquire)) return false;
+
+    int index = claimSegment();
+    if (index < 0) return false;
+    Segment& seg = m_segments[index];
+
+    if (m_persistent) {
+        if (count > m_capacity) {
+            // Ask the render thread for a bigger ring. Older published frames must
+            // not win over the staged upload the caller is about to make.
+            size_t requested = m_requestedCapacity.load(std::memory_order_relaxed);
+            while (requested < count &&
+                   !m_requestedCapacity.compare_exchange_weak(requested, count, std::memory_order_relaxed)) {
+            }
+            seg.state.store(Free, std::memory_order_release);
+            dropReadySegments();
+            return false;
+        }
+        float* base = segmentBase(index);
+        std::memcpy(base, positions, count * 3 * sizeof(float));
+        std::memcpy(base + m_capacity * 3, values, count * sizeof(float));
+    } else {
+        seg.cpu.resize(count * 4);
+        std::memcpy(seg.cpu.data(), positions, count * 3 * sizeof(float));
+        std::memcpy(seg.cpu.data() + count * 3, values, count * sizeof(float));
+    }
+
+    seg.count = count;
+    seg.sequence = m_sequence.fetch_add(1, std::memory_order_relaxed) + 1;
+    seg.state.store(Ready, std::memory_order_release);
+    return true;
+}
+
+// ---------------------------------------------------------------------------
+// Render thread side
+// ---------------------------------------------------------------------------
+
+void InstanceStream::release() {
+    if (m_current < 0) return;
+    Segment& seg = m_segments[m_current];
+    if (m_persistent) {
+        // Fence covers every command issued so far that may read this segment
+        seg.fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+        seg.state.store(InFlight, std::memory_order_release);
+    } else {
+        seg.state.store(Free, std::memory_order_release);
+    }
+    m_current = -1;
+}
+
+void InstanceStream::tryGrow() {
+    // The ring can only be reallocated while nothing references it: no segment
+    // bound for drawing, no producer copying and no unconsumed frame
+    if (m_current >= 0) return;
+
+    int previous[kSegments];
+    int locked = 0;
+    for (; locked < kSegments; locked++) {
+        int s = m_segments[locked].state.load(std::memory_order_acquire);
+        if (s != Free && s != InFlight) break;
+        if (!m_segments[locked].state.compare_exchange_strong(s, Locked, std::memory_order_acquire)) break;
+        previous[locked] = s;
+    }
+    if (locked < kSegments) {
+        for (int i = 0; i < locked; i++) {
+            m_segments[i].state.store(previous[i], std::memory_order_release);
+        }
+        return;
+    }
+
+    size_t requested = m_requestedCapacity.load(std::memory_order_relaxed);
+    size_t capacity = requested + requested / 4;  // Headroom for growing universes
+
+    for (auto& seg : m_segments) {
+        if (seg.fence) {
+            glDeleteSync((GLsync)seg.fence);
+            seg.fence = nullptr;
+        }
+    }
+    if (m_mapped) {
+        glBindBuffer(GL_ARRAY_BUFFER, m_buffer);
+        glUnmapBuffer(GL_ARRAY_BUFFER);
+        m_mapped = nullptr;
+    }
+    // Immutable storage cannot be respecified, so a grow needs a new buffer name
+    glDeleteBuffers(1, &m_buffer);
+    glGenBuffers(1, &m_buffer);
+
+    GLsizeiptr bytes = (GLsizeiptr)(capacity * kPointBytes * kSegments);
+    glBindBuffer(GL_ARRAY_BUFFER, m_buffer);
+    glBufferStorage(GL_ARRAY_BUFFER, bytes, nullptr, kPersistentFlags);
+    m_mapped = static_cast<char*>(glMapBufferRange(GL_ARRAY_BUFFER, 0, bytes, kPersistentFlags));
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+    if (!m_mapped) {
+        std::cerr << "[InstanceStream] Failed to map " << bytes << " bytes, streaming disabled" << std::endl;
+        m_capacity = 0;
+        m_accepting.store(false, std::memory_order_release);
+    } else {
+        m_capacity = capacity;
+        std::cout << "[InstanceStream] Ring capacity: " << capacity << " points x " << kSegments << " segments" << std::endl;
+    }
+
+    for (auto& seg : m_segments) {
+        seg.state.store(Free, std::memory_order_release);
+    }
+}
+
+bool InstanceStream::acquire() {
+    if (!m_initialized) return false;
+
+    if (m_persistent) {
+        // 1. Recycle retired segments whose GPU reads have completed
+        for (auto& seg : m_segments) {
+            if (seg.state.load(std::memory_order_acquire) != InFlight) continue;
+            GLenum status = glClientWaitSync((GLsync)seg.fence, 0, 0);
+            if (status == GL_ALREADY_SIGNALED || status == GL_CONDITION_SATISFIED) {
+                glDeleteSync((GLsync)seg.fence);
+                seg.fence = nullptr;
+                seg.state.store(Free, std::memory_order_release);
+            }
+        }
+
+        // 2. Service grow requests from the producer
+        if (m_requestedCapacity.load(std::memory_order_relaxed) > m_capacity) {
+            tryGrow();
+        }
+    }
+
+    // 3. Claim every published segment, keep the newest and free the rest
+    int newest = -1;
+    for (int i = 0; i < kSegments; i++) {
+        int expected = Ready;
+        if (!m_segments[i].state.compare_exchange_strong(expected, Current, std::memory_order_acquire)) continue;
+        if (newest < 0 || m_segments[i].sequence > m_segments[newest].sequence) {
+            if (newest >= 0) m_segments[newest].state.store(Free, std::memory_order_release);
+            newest = i;
+        } else {
+            m_segments[i].state.store(Free, std::memory_order_release);
+        }
+    }
+    if (newest < 0) return false;
+
+    release();
+    m_current = newest;
+
+    if (!m_persistent) {
+        // Orphan the previous storage so the driver never waits on in-flight draws
+        const Segment& seg = m_segments[m_current];
+        size_t bytes = seg.count * kPointBytes;
+        glBindBuffer(GL_ARRAY_BUFFER, m_buffer);
+        if (bytes > m_gpuBytes) {
+            m_gpuBytes = bytes;
+        }
+        glBufferData(GL_ARRAY_BUFFER, (GLsizeiptr)m_gpuBytes, nullptr, GL_STREAM_DRAW);
+        glBufferSubData(GL_ARRAY_BUFFER, 0, (GLsizeiptr)bytes, seg.cpu.data());
+        glBindBuffer(GL_ARRAY_BUFFER, 0);
+    }
+    return true;
+}
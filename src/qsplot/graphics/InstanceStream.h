@@ -0,0 +1,101 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+/**
+ * @brief Lock-free ring of instance data segments for streaming point uploads.
+ *
+ * The producer (Python thread) copies a frame straight into a free segment and
+ * publishes it; the render thread promotes the newest published segment once per
+ * frame. Neither side takes a mutex.
+ *
+ * - GL 4.4+: all segments live in one persistently mapped buffer (glBufferStorage),
+ *   so the producer's memcpy is the upload. Retired segments are recycled once
+ *   their fence sync object has signaled.
+ * - GL 4.1: segments are CPU-side and the render thread orphans the stream VBO and
+ *   fills it with glBufferSubData when it promotes a segment.
+ *
+ * Segment layout: count x vec3 positions followed by count x float values.
+ */
+class InstanceStream {
+public:
+    static constexpr int kSegments = 3;
+
+    InstanceStream() = default;
+    ~InstanceStream() = default;
+
+    InstanceStream(const InstanceStream&) = delete;
+    InstanceStream& operator=(const InstanceStream&) = delete;
+
+    // --- Render thread (GL context current) ---
+
+    // persistent: use glBufferStorage + MAP_PERSISTENT (requires GL 4.4)
+    // initialCapacity: points to reserve up-front (0 = grow on first write)
+    void init(bool persistent, size_t initialCapacity);
+    void destroy();
+
+    // Recycle signaled segments, service grow requests and promote the newest
+    // published segment. Returns true if a new segment became current.
+    bool acquire();
+
+    // Stop drawing from the stream (e.g. a staged upload replaced its data).
+    // The current segment is retired and recycled once the GPU is done with it.
+    void release();
+
+    bool hasData() const { return m_current >= 0; }
+    unsigned int buffer() const { return m_buffer; }
+    size_t positionOffset() const;  // Byte offset of the current positions
+    size_t valueOffset() const;     // Byte offset of the current values
+    size_t count() const;
+    const float* currentValues() const;     // CPU-visible values of the current segment
+    const float* currentPositions() const;  // CPU-visible positions of the current segment
+
+    // --- Producer thread ---
+
+    // Copy one frame into a free segment and publish it. Returns false if the
+    // stream cannot take the frame right now (no capacity yet, render thread not
+    // running); the caller should use the regular staged upload instead.
+    bool write(const float* positions, const float* values, size_t count);
+
+    uint64_t stallCount() const { return m_stalls.load(std::memory_order_relaxed); }
+
+private:
+    enum State : int {
+        Free = 0,
+        Writing,    // Owned by the producer
+        Ready,      // Published, not yet picked up
+        Current,    // Bound for drawing (render thread)
+        InFlight,   // Retired, GPU may still read it (persistent mode)
+        Locked      // Held by the render thread while reallocating
+    };
+
+    struct Segment {
+        std::atomic<int> state{Free};
+        size_t count = 0;
+        uint64_t sequence = 0;
+        void* fence = nullptr;      // GLsync, render thread only
+        std::vector<float> cpu;     // Non-persistent mode storage
+    };
+
+    int claimSegment();
+    void dropReadySegments();
+    void tryGrow();
+    float* segmentBase(int index) const;
+
+    Segment m_segments[kSegments];
+    bool m_initialized = false;
+    bool m_persistent = false;
+    unsigned int m_buffer = 0;
+    char* m_mapped = nullptr;       // Persistent mapping (guarded by segment states)
+    size_t m_capacity = 0;          // Points per segment (persistent mode)
+    size_t m_gpuBytes = 0;          // Allocated stream VBO size (non-persistent mode)
+    int m_current = -1;
+
+    std::atomic<bool> m_accepting{false};
+    std::atomic<size_t> m_requestedCapacity{0};
+    std::atomic<uint64_t> m_sequence{0};
+    std::atomic<uint64_t> m_stalls{0};
+};
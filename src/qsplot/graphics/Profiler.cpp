@@ -0,0 +1,154 @@
+#include "Profiler.h"
+
+#include <glad/glad.h>
+#include <algorithm>
+
+const char* Profiler::sectionName(int section) {
+    static const char* const kNames[kSectionCount] = {
+        "frame", "commands", "uploads", "culling", "density", "scene",
+        "picking", "gizmo", "ui", "export", "present", "idle"
+    };
+    return section >= 0 && section < kSectionCount ? kNames[section] : "";
+}
+
+void Profiler::History::push(float ms) {
+    m_samples[m_next] = ms;
+    m_next = (m_next + 1) % kHistory;
+    if (m_count < kHistory) m_count++;
+}
+
+void Profiler::init() {
+    if (m_initialized) return;
+    m_frameStart = m_lastPublish = Clock::now();
+    m_initialized = true;
+}
+
+void Profiler::destroy() {
+    if (!m_initialized) return;
+    if (m_gpuOpen >= 0) glEndQuery(GL_TIME_ELAPSED);
+    m_gpuOpen = -1;
+    for (auto& set : m_querySets) {
+        if (!set.queries.empty()) glDeleteQueries((GLsizei)set.queries.size(), set.queries.data());
+        set = QuerySet{};
+    }
+    m_initialized = false;
+}
+
+void Profiler::beginFrame() {
+    if (!m_initialized) return;
+    Clock::time_point now = Clock::now();
+    if (m_frames > 0) {
+        double interval = std::chrono::duration<double, std::milli>(now - m_frameStart).count();
+        m_cpu[Frame].push((float)std::max(0.0, interval - m_idleMs));
+    }
+    m_frameStart = now;
+
+    // The set about to be reused was issued kLatency frames ago
+    collect(m_querySets[m_frames % kLatency]);
+}
+
+void Profiler::collect(QuerySet& set) {
+    if (set.used == 0) return;
+
+    // Queries complete in order: the last one being ready means all are
+    GLint available = 0;
+    glGetQueryObjectiv(set.queries[set.used - 1], GL_QUERY_RESULT_AVAILABLE, &available);
+    if (available) {
+        double sums[kSectionCount] = {};
+        bool timed[kSectionCount] = {};
+        double total = 0.0;
+        for (size_t i = 0; i < set.used; i++) {
+            GLuint64 ns = 0;
+            glGetQueryObjectui64v(set.queries[i], GL_QUERY_RESULT, &ns);
+            double ms = ns / 1e6;
+            sums[set.sections[i]] += ms;
+            timed[set.sections[i]] = true;
+            total += ms;
+        }
+        for (int s = 0; s < kSectionCount; s++) {
+            if (timed[s]) m_gpu[s].push((float)sums[s]);
+        }
+        m_gpu[Frame].push((float)total);
+    }
+    set.used = 0;
+    set.sections.clear();
+}
+
+void Profiler::endFrame() {
+    if (!m_initialized) return;
+    m_idleMs = m_cpuTouched[Idle] ? m_cpuFrameMs[Idle] : 0.0;
+    for (int s = 0; s < kSectionCount; s++) {
+        if (!m_cpuTouched[s]) continue;
+        m_cpu[s].push((float)m_cpuFrameMs[s]);
+        m_cpuFrameMs[s] = 0.0;
+        m_cpuTouched[s] = false;
+    }
+    m_frames++;
+
+    Clock::time_point now = Clock::now();
+    if (now - m_lastPublish >= kPublishInterval) {
+        auto snapshot = std::make_shared<Snapshot>();
+        snapshot->sections = summarize();
+        snapshot->frames = m_frames;
+        snapshot->gpuTimers = m_gpuEnabled;
+        m_published.store(std::move(snapshot), std::memory_order_release);
+        m_lastPublish = now;
+    }
+}
+
+void Profiler::begin(Section section, bool gpu) {
+    if (!m_initialized) return;
+    m_cpuStart[section] = Clock::now();
+
+    m_gpuOwner[section] = false;
+    if (gpu && m_gpuEnabled && m_gpuOpen < 0) {
+        QuerySet& set = m_querySets[m_frames % kLatency];
+        if (set.used == set.queries.size()) {
+            set.queries.push_back(0);
+            glGenQueries(1, &set.queries.back());
+        }
+        glBeginQuery(GL_TIME_ELAPSED, set.queries[set.used++]);
+        set.sections.push_back(section);
+        m_gpuOpen = section;
+        m_gpuOwner[section] = true;
+    }
+}
+
+void Profiler::end(Section section) {
+    if (!m_initialized) return;
+    if (m_gpuOwner[section]) {
+        glEndQuery(GL_TIME_ELAPSED);
+        m_gpuOpen = -1;
+        m_gpuOwner[section] = false;
+    }
+    m_cpuFrameMs[section] += std::chrono::duration<double, std::milli>(Clock::now() - m_cpuStart[section]).count();
+    m_cpuTouched[section] = true;
+}
+
+Profiler::Summary Profiler::summarize(const History& history) {
+    Summary summary;
+    summary.samples = history.count();
+    if (summary.samples == 0) return summary;
+
+    std::vector<float> sorted(history.data(), history.data() + summary.samples);
+    summary.last = sorted[(history.offset() + summary.samples - 1) % summary.samples];
+    std::sort(sorted.begin(), sorted.end());
+
+    double sum = 0.0;
+    for (float v : sorted) sum += v;
+    summary.mean = (float)(sum / summary.samples);
+    summary.p50 = sorted[(summary.samples - 1) / 2];
+    summary.p99 = sorted[std::min(summary.samples - 1, (int)(0.99 * summary.samples))];
+    summary.max = sorted.back();
+    return summary;
+}
+
+std::vector<Profiler::SectionStats> Profiler::summarize() const {
+    std::vector<SectionStats> stats(kSectionCount);
+    for (int s = 0; s < kSectionCount; s++) {
+        stats[s].name = sectionName(s);
+        stats[s].cpu = summarize(m_cpu[s]);
+        stats[s].gpu = summarize(m_gpu[s]);
+    }
+    return stats;
+}
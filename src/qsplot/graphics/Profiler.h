@@ -0,0 +1,152 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+/**
+ * @brief Per-pass frame timing: CPU scopes and GL_TIME_ELAPSED queries.
+ *
+ * Sections are timed between begin() and end(), or by a Scope. Time spent in a
+ * section is summed over the frame, so passes entered several times (picking
+ * regions, export readbacks) report one sample per frame. CPU times of nested
+ * sections are inclusive.
+ *
+ * GPU times come from a ring of kLatency query sets read kLatency - 1 frames
+ * later, so the render thread never waits for a result; a set that is still
+ * not available is dropped. Time-elapsed queries cannot overlap: a GPU scope
+ * opened inside another one is timed on the CPU only.
+ *
+ * Each section keeps its last kHistory samples. A summary with p50/p99 is
+ * published a few times per second for other threads (snapshot()).
+ */
+class Profiler {
+public:
+    enum Section {
+        Frame,     // Interval between frame starts (CPU); sum of all passes (GPU)
+        Commands,  // Draining the command queue
+        Uploads,   // Staged, sparse, streamed and keyframe uploads
+        Culling,
+        Density,   // LOD splat pass
+        Scene,     // Clear, density composite, billboard draw
+        Picking,   // ID passes and their readback
+        Gizmo,
+        Ui,        // ImGui build and draw
+        Export,    // Offscreen frame setup, PBO waits and readback
+        Present,   // Swap buffers (includes vsync waits)
+        Idle,      // Blocked waiting for events (render on demand), not part of Frame
+        kSectionCount
+    };
+
+    static constexpr int kHistory = 240;
+    static constexpr int kLatency = 4;
+    static constexpr auto kPublishInterval = std::chrono::milliseconds(250);
+
+    static const char* sectionName(int section);
+
+    // Rolling window of samples (milliseconds)
+    class History {
+    public:
+        void push(float ms);
+        int count() const { return m_count; }
+        int offset() const { return m_count < kHistory ? 0 : m_next; }  // Oldest sample
+        const float* data() const { return m_samples; }
+
+    private:
+        float m_samples[kHistory] = {};
+        int m_count = 0;
+        int m_next = 0;
+    };
+
+    struct Summary {
+        float p50 = 0.0f, p99 = 0.0f, mean = 0.0f, max = 0.0f, last = 0.0f;
+        int samples = 0;
+    };
+
+    struct SectionStats {
+        const char* name = "";
+        Summary cpu;
+        Summary gpu;  // samples == 0 when the section has no GPU timing
+    };
+
+    struct Snapshot {
+        std::vector<SectionStats> sections;  // One per Section, in order
+        uint64_t frames = 0;
+        bool gpuTimers = false;
+    };
+
+    Profiler() = default;
+    ~Profiler() = default;
+
+    Profiler(const Profiler&) = delete;
+    Profiler& operator=(const Profiler&) = delete;
+
+    // GL context must be current for init/destroy and all timing calls
+    void init();
+    void destroy();
+
+    void beginFrame();  // Collects the oldest query set
+    void endFrame();    // Records this frame's CPU samples, publishes periodically
+
+    void begin(Section section, bool gpu = false);
+    void end(Section section);
+
+    class Scope {
+    public:
+        Scope(Profiler& profiler, Section section, bool gpu) : m_profiler(profiler), m_section(section) {
+            m_profiler.begin(section, gpu);
+        }
+        ~Scope() { m_profiler.end(m_section); }
+
+        Scope(const Scope&) = delete;
+        Scope& operator=(const Scope&) = delete;
+
+    private:
+        Profiler& m_profiler;
+        Section m_section;
+    };
+    Scope scope(Section section, bool gpu = false) { return Scope(*this, section, gpu); }
+
+    void setGpuEnabled(bool enabled) { m_gpuEnabled = enabled; }
+    bool gpuEnabled() const { return m_gpuEnabled; }
+
+    const History& cpuHistory(Section section) const { return m_cpu[section]; }
+    const History& gpuHistory(Section section) const { return m_gpu[section]; }
+    std::vector<SectionStats> summarize() const;
+
+    // Last published summary; safe from any thread. Null before the first one.
+    std::shared_ptr<const Snapshot> snapshot() const { return m_published.load(std::memory_order_acquire); }
+
+private:
+    using Clock = std::chrono::steady_clock;
+
+    struct QuerySet {
+        std::vector<unsigned int> queries;  // Grown on demand, reused every kLatency frames
+        std::vector<int> sections;          // Section of each used query
+        size_t used = 0;
+    };
+
+    static Summary summarize(const History& history);
+    void collect(QuerySet& set);
+
+    History m_cpu[kSectionCount];
+    History m_gpu[kSectionCount];
+    double m_cpuFrameMs[kSectionCount] = {};  // This frame's running sums
+    bool m_cpuTouched[kSectionCount] = {};
+    Clock::time_point m_cpuStart[kSectionCount];
+    bool m_gpuOwner[kSectionCount] = {};      // This begin() opened the running query
+
+    QuerySet m_querySets[kLatency];
+    int m_gpuOpen = -1;  // Section of the running query
+    bool m_gpuEnabled = true;
+    bool m_initialized = false;
+
+    uint64_t m_frames = 0;
+    Clock::time_point m_frameStart;
+    double m_idleMs = 0.0;  // Idle time of the last frame, left out of its interval
+    Clock::time_point m_lastPublish;
+    std::atomic<std::shared_ptr<const Snapshot>> m_published;
+};
@@ -0,0 +1,214 @@
+#include "RangeFilter.h"
+#include "../core/FeatureStore.h"
+#include "../core/Parallel.h"
+
+#include <glad/glad.h>
+#include <algorithm>
+#include <chrono>
+
+namespace {
+    constexpr GLuint kGroupSize = 256;
+    constexpr GLuint kMaxGroupsX = 65535;
+    constexpr size_t kMinChunk = 1 << 16;
+}
+
+void RangeFilter::init(unsigned int program) {
+    m_program = program;
+
+    // Never empty, so the vertex shaders always have a store behind their sampler
+    float none = 0.0f;
+    glGenBuffers(1, &m_columnBuffer);
+    glBindBuffer(GL_TEXTURE_BUFFER, m_columnBuffer);
+    glBufferData(GL_TEXTURE_BUFFER, sizeof(float), &none, GL_DYNAMIC_DRAW);
+    glBindBuffer(GL_TEXTURE_BUFFER, 0);
+
+    glGenTextures(1, &m_texture);
+    glBindTexture(GL_TEXTURE_BUFFER, m_texture);
+    glTexBuffer(GL_TEXTURE_BUFFER, GL_R32F, m_columnBuffer);
+    glBindTexture(GL_TEXTURE_BUFFER, 0);
+
+    if (m_program) glGenBuffers(1, &m_resultBuffer);
+}
+
+void RangeFilter::destroy() {
+    if (m_fence) {
+        glDeleteSync((GLsync)m_fence);
+        m_fence = nullptr;
+    }
+    if (m_texture) glDeleteTextures(1, &m_texture);
+    if (m_columnBuffer) glDeleteBuffers(1, &m_columnBuffer);
+    if (m_resultBuffer) glDeleteBuffers(1, &m_resultBuffer);
+    m_texture = m_columnBuffer = m_resultBuffer = 0;
+    m_resultCapacity = 0;
+    m_active.clear();
+    m_rows = 0;
+    m_staged = false;
+    if (m_cpuMatch.valid()) m_cpuMatch.wait();  // Reads m_columns
+    m_cpuMatch = {};
+    m_cpuStale = false;
+    m_columns.reset();
+    m_program = 0;  // Owned by the renderer
+}
+
+void RangeFilter::stage(const FeatureStore& store, const std::vector<Range>& ranges, std::vector<float>& columns) {
+    size_t rows = store.rows();
+    columns.resize(rows * ranges.size());
+    parallelFor(rows, kMinChunk, [&](size_t, size_t begin, size_t end) {
+        for (size_t k = 0; k < ranges.size(); k++) {
+            float* out = columns.data() + k * rows;
+            for (size_t row = begin; row < end; row++) out[row] = store.value(row, ranges[k].column);
+        }
+    });
+}
+
+std::vector<int> RangeFilter::matchColumns(const std::vector<float>& columns, size_t rows,
+                                           const std::vector<Range>& ranges) {
+    std::vector<std::vector<int>> partial(parallelChunkCount(rows, kMinChunk));
+    parallelFor(rows, kMinChunk, [&](size_t chunk, size_t begin, size_t end) {
+        std::vector<int>& out = partial[chunk];
+        for (size_t row = begin; row < end; row++) {
+            bool pass = true;
+            for (size_t k = 0; k < ranges.size() && pass; k++) {
+                float v = columns[k * rows + row];
+                pass = v >= ranges[k].min && v <= ranges[k].max;  // NaN fails
+            }
+            if (pass) out.push_back((int)row);
+        }
+    });
+
+    // Chunks are ordered, so concatenation stays ascending
+    std::vector<int> result;
+    for (auto& p : partial) result.insert(result.end(), p.begin(), p.end());
+    return result;
+}
+
+std::vector<int> RangeFilter::matchCPU(const FeatureStore& store, const std::vector<Range>& ranges) {
+    std::vector<float> columns;
+    stage(store, ranges, columns);
+    return matchColumns(columns, store.rows(), ranges);
+}
+
+void RangeFilter::update(const FeatureStore* store, const std::vector<Range>& ranges, bool storeChanged) {
+    std::vector<Range> active;
+    if (store) {
+        for (const Range& r : ranges) {
+            if (r.column < store->cols() && (int)active.size() < kMaxRanges) active.push_back(r);
+        }
+    }
+    bool sameColumns = active.size() == m_active.size() &&
+                       std::equal(active.begin(), active.end(), m_active.begin(),
+                                  [](const Range& a, const Range& b) { return a.column == b.column; });
+    if (storeChanged || !sameColumns) m_staged = false;
+    m_active.swap(active);
+    m_rows = m_active.empty() ? 0 : store->rows();
+
+    // A newer match supersedes the one in flight
+    if (m_fence) {
+        glDeleteSync((GLsync)m_fence);
+        m_fence = nullptr;
+    }
+    // The CPU match cannot be stopped: its result is dropped when it arrives
+    if (m_cpuMatch.valid()) m_cpuStale = true;
+    if (m_rows == 0) {
+        m_active.clear();
+        m_staged = false;
+        return;
+    }
+
+    if (!m_staged) {
+        // A fresh buffer: a CPU match in flight keeps reading the old one
+        auto columns = std::make_shared<std::vector<float>>();
+        stage(*store, m_active, *columns);
+        glBindBuffer(GL_TEXTURE_BUFFER, m_columnBuffer);
+        glBufferData(GL_TEXTURE_BUFFER, (GLsizeiptr)(columns->size() * sizeof(float)), columns->data(),
+                     GL_DYNAMIC_DRAW);
+        glBindBuffer(GL_TEXTURE_BUFFER, 0);
+        m_columns = std::move(columns);
+        m_staged = true;
+    }
+
+    if (m_program) {
+        dispatch();
+    } else if (!m_cpuMatch.valid()) {
+        launchCPU();
+    }
+    // Otherwise poll() re-runs the match with these ranges once the stale one is done
+}
+
+void RangeFilter::launchCPU() {
+    m_cpuStale = false;
+    m_cpuMatch = std::async(std::launch::async, [columns = m_columns, rows = m_rows, ranges = m_active]() {
+        return matchColumns(*columns, rows, ranges);
+    });
+}
+
+void RangeFilter::dispatch() {
+    // Layout: uint count, then up to m_rows IDs
+    size_t bytes = (m_rows + 1) * sizeof(GLuint);
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, m_resultBuffer);
+    if (bytes > m_resultCapacity) {
+        glBufferData(GL_SHADER_STORAGE_BUFFER, (GLsizeiptr)bytes, nullptr, GL_DYNAMIC_READ);
+        m_resultCapacity = bytes;
+    }
+    GLuint zero = 0;
+    glBufferSubData(GL_SHADER_STORAGE_BUFFER, 0, sizeof(GLuint), &zero);
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+
+    float mins[kMaxRanges], maxs[kMaxRanges];
+    for (size_t k = 0; k < m_active.size(); k++) {
+        mins[k] = m_active[k].min;
+        maxs[k] = m_active[k].max;
+    }
+
+    glUseProgram(m_program);
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 0, m_columnBuffer);
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 1, m_resultBuffer);
+    glUniform1ui(glGetUniformLocation(m_program, "uRows"), (GLuint)m_rows);
+    glUniform1i(glGetUniformLocation(m_program, "uRangeCount"), (GLint)m_active.size());
+    glUniform1fv(glGetUniformLocation(m_program, "uMin"), (GLsizei)m_active.size(), mins);
+    glUniform1fv(glGetUniformLocation(m_program, "uMax"), (GLsizei)m_active.size(), maxs);
+
+    GLuint groups = (GLuint)((m_rows + kGroupSize - 1) / kGroupSize);
+    GLuint groupsX = std::min(groups, kMaxGroupsX);
+    GLuint groupsY = (groups + groupsX - 1) / groupsX;
+    glDispatchCompute(groupsX, groupsY, 1);
+
+    glMemoryBarrier(GL_BUFFER_UPDATE_BARRIER_BIT);
+    m_fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+    glUseProgram(0);
+}
+
+bool RangeFilter::poll(std::vector<int>& ids) {
+    if (m_cpuMatch.valid()) {
+        if (m_cpuMatch.wait_for(std::chrono::seconds(0)) != std::future_status::ready) return false;
+        std::vector<int> result = m_cpuMatch.get();
+        if (m_cpuStale) {
+            m_cpuStale = false;
+            if (m_rows > 0) launchCPU();
+            return false;
+        }
+        ids.swap(result);
+        return true;
+    }
+    if (!m_fence) return false;
+
+    GLenum status = glClientWaitSync((GLsync)m_fence, 0, 0);
+    if (status != GL_ALREADY_SIGNALED && status != GL_CONDITION_SATISFIED) return false;
+    glDeleteSync((GLsync)m_fence);
+    m_fence = nullptr;
+
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, m_resultBuffer);
+    GLuint count = 0;
+    glGetBufferSubData(GL_SHADER_STORAGE_BUFFER, 0, sizeof(GLuint), &count);
+    size_t n = std::min<size_t>(count, m_rows);
+
+    ids.resize(n);
+    if (n > 0) {
+        glGetBufferSubData(GL_SHADER_STORAGE_BUFFER, sizeof(GLuint), (GLsizeiptr)(n * sizeof(GLuint)), ids.data());
+    }
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+
+    // Atomic appends arrive in arbitrary order
+    std::sort(ids.begin(), ids.end());
+    return true;
+}
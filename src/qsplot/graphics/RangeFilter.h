@@ -0,0 +1,95 @@
+#pragma once
+
+#include <cstddef>
+#include <future>
+#include <memory>
+#include <vector>
+
+class FeatureStore;
+
+/**
+ * @brief Range predicates over feature columns, evaluated on the GPU.
+ *
+ * A point passes when its value lies in [min, max] in every filtered column
+ * (at most kMaxRanges). update() copies just those columns out of the
+ * FeatureStore into one float buffer, column after column, which the point
+ * vertex shaders read through a buffer texture: rejected instances are moved
+ * out of the clip volume before rasterization, so drawing, picking and the
+ * density LOD all skip them.
+ *
+ * The passing rows themselves (for counts and selection) are compacted:
+ * - GL 4.3+: by a compute pass over the same buffer, appending with an atomic
+ *   counter. The result is fenced and fetched with poll() a frame or two later.
+ * - Fallback: by matchColumns() on all cores, on a worker thread so that
+ *   dragging a bound never stalls the render thread. poll() takes the result
+ *   once it is ready; a match still running when the ranges change again is
+ *   discarded and re-run with the newest ranges.
+ */
+class RangeFilter {
+public:
+    static constexpr int kMaxRanges = 8;  // uMin/uMax of rangeComputeShaderSource
+
+    struct Range {
+        size_t column = 0;
+        float min = 0.0f, max = 0.0f;  // Inclusive
+    };
+
+    RangeFilter() = default;
+    ~RangeFilter() = default;
+
+    RangeFilter(const RangeFilter&) = delete;
+    RangeFilter& operator=(const RangeFilter&) = delete;
+
+    // program: linked rangeComputeShaderSource, 0 for the CPU path
+    void init(unsigned int program);
+    void destroy();
+
+    bool gpu() const { return m_program != 0; }
+    bool busy() const { return m_fence != nullptr || m_cpuMatch.valid(); }
+
+    /**
+     * @brief Apply `ranges` to `store` and match them
+     *
+     * The columns are uploaded again only if `storeChanged` or the ranges
+     * name other columns; moving a bound only re-runs the match. Ranges on
+     * columns the store does not have are dropped; without a store or ranges
+     * the filter is inactive. A match still in flight is superseded.
+     */
+    void update(const FeatureStore* store, const std::vector<Range>& ranges, bool storeChanged);
+
+    // Ranges applied by the last update, at most kMaxRanges
+    const std::vector<Range>& active() const { return m_active; }
+    size_t rows() const { return m_rows; }
+    unsigned int texture() const { return m_texture; }  // R32F buffer texture over the columns
+
+    // Fetch the passing rows of the last update, sorted ascending. Non-blocking.
+    bool poll(std::vector<int>& ids);
+
+    // CPU match, sorted ascending
+    static std::vector<int> matchCPU(const FeatureStore& store, const std::vector<Range>& ranges);
+
+private:
+    void dispatch();
+    void launchCPU();
+    // Copy the ranged columns of `store`, column after column
+    static void stage(const FeatureStore& store, const std::vector<Range>& ranges, std::vector<float>& columns);
+    static std::vector<int> matchColumns(const std::vector<float>& columns, size_t rows,
+                                         const std::vector<Range>& ranges);
+
+    unsigned int m_program = 0;
+    unsigned int m_columnBuffer = 0;
+    unsigned int m_texture = 0;
+    unsigned int m_resultBuffer = 0;
+    size_t m_resultCapacity = 0;  // Bytes
+    void* m_fence = nullptr;      // GLsync of the pending match
+
+    std::vector<Range> m_active;
+    size_t m_rows = 0;
+    // Staging for the upload, shared with a CPU match in flight
+    std::shared_ptr<const std::vector<float>> m_columns;
+    bool m_staged = false;  // m_columns holds the columns of m_active
+
+    // CPU path: the match in flight, and whether a later update outdated it
+    std::future<std::vector<int>> m_cpuMatch;
+    bool m_cpuStale = false;
+};
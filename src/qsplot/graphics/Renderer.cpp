@@ -1,6 +1,9 @@
 #include "Renderer.h"
 #include "Shader.h"
 #include "Camera.h"
+#include "../core/FeatureStore.h"
+#include "../core/Clustering.h"
+#include "../core/SessionLog.h"
 
 #include <glad/glad.h>
 #include <GLFW/glfw3.h>
@@ -8,9 +11,13 @@
 #include <vector>
 #include <cmath>
 #include <algorithm>
-#include <mutex>
+#include <chrono>
+#include <cfloat>
+#include <cstddef>
 #include <cstdio>
 #include <cstdlib>
+#include <initializer_list>
+#include <thread>
 
 // ImGui Headers
 #include "imgui.h"
@@ -35,61 +42,304 @@ Renderer::Renderer(const RendererConfig& config)
       m_colorFilterEnabled(false), m_colorFilterValue(0.5f), m_colorFilterTolerance(0.05f),
       m_selectedID(-1), m_hoveredID(-1), m_pickingFBO(0), m_pickingTexture(0), m_pickingDepth(0), m_pickingShaderProgram(0)
 {
+    m_uiSnapshot.store(std::make_shared<const UiSnapshot>());
+    m_selectOccluded = config.selectOccluded;
+    m_lodMode = config.lodMode;
+    m_lodThreshold = config.lodCellThreshold;
+    m_transparencyMode = config.transparencyMode;
+    m_cullEnabled = config.frustumCulling;
 }
 
 Renderer::~Renderer() {
     stop();
+    stopRecording();
 }
 
 void Renderer::start() {
     if (m_running) return;
+    if (m_renderThread.joinable()) m_renderThread.join();  // Loop that exited on window close
+    m_stopRequested = false;
     m_running = true;
     m_renderThread = std::thread(&Renderer::loop, this);
 }
 
 void Renderer::stop() {
-    m_running = false;
+    // Only the render thread clears m_running, once it no longer touches the
+    // staged state: producers keep queueing until then
+    m_stopRequested = true;
+    wake();
     if (m_renderThread.joinable()) {
         m_renderThread.join();
     }
+    releaseRetiredFeatures();
 }
 
-void Renderer::setPoints(const float* positions, const float* values, size_t count) {
-    std::lock_guard<std::mutex> lock(m_dataMutex);
-    
-    if (positions && count > 0) {
-        m_stagedPositions.assign(positions, positions + count * 3);
-    } else {
-        m_stagedPositions.clear();
+// ---------------------------------------------------------------------------
+// Command queue
+// ---------------------------------------------------------------------------
+
+void Renderer::submit(Command cmd) {
+    std::unique_lock<std::mutex> lock(m_producerMutex);
+    // No render thread to race with: apply in place
+    if (!m_running) {
+        cmd();
+        if (m_uiDirty) publishUiSnapshot();
+        completeFences();
+        return;
     }
-    
-    if (values && count > 0) {
-        m_stagedValues.assign(values, values + count);
+
+    if (!m_commands.push(std::move(cmd))) {
+        // Queue full: the render thread is behind by a whole queue of commands
+        m_queueStalls.fetch_add(1, std::memory_order_relaxed);
+        auto start = std::chrono::steady_clock::now();
+        while (!m_commands.push(std::move(cmd))) {
+            // Checked under the lock: once the render thread has cleared
+            // m_running it has drained the queue and left the staged state
+            if (!m_running) {
+                cmd();
+                if (m_uiDirty) publishUiSnapshot();
+                completeFences();
+                break;
+            }
+            // Let the render thread take the lock on its way out
+            lock.unlock();
+            std::this_thread::yield();
+            lock.lock();
+        }
+        auto waited = std::chrono::steady_clock::now() - start;
+        m_queueStallNs.fetch_add((uint64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(waited).count(),
+                                 std::memory_order_relaxed);
+    }
+    lock.unlock();
+    wake();
+
+    m_commandsSubmitted.fetch_add(1, std::memory_order_relaxed);
+    size_t depth = m_commands.size();
+    size_t maxDepth = m_maxQueueDepth.load(std::memory_order_relaxed);
+    while (depth > maxDepth &&
+           !m_maxQueueDepth.compare_exchange_weak(maxDepth, depth, std::memory_order_relaxed)) {
+    }
+}
+
+void Renderer::stopAcceptingCommands() {
+    // From here on producer calls apply in place. Apply what is still queued,
+    // so no fence is left waiting.
+    std::lock_guard<std::mutex> lock(m_producerMutex);
+    m_running = false;
+    drainCommands();
+    completeFences();
+}
+
+void Renderer::drainCommands() {
+    auto start = std::chrono::steady_clock::now();
+
+    // Only apply what was queued when the frame started, so a busy producer
+    // cannot keep the render thread from drawing
+    size_t pending = m_commands.size();
+    Command cmd;
+    for (size_t i = 0; i < pending && m_commands.pop(cmd); i++) {
+        cmd();
+        cmd = nullptr;  // Free captured payloads on this thread, now
+    }
+    if (pending > 0) requestRedraw();
+
+    auto elapsed = std::chrono::steady_clock::now() - start;
+    m_lastDrainNs.store((uint64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed).count(),
+                        std::memory_order_relaxed);
+}
+
+std::shared_ptr<Completion> Renderer::fence() {
+    auto done = std::make_shared<Completion>();
+    submit([this, done]() { m_appliedFences.push_back(done); });
+    return done;
+}
+
+void Renderer::completeFences() {
+    for (auto& done : m_appliedFences) done->complete();
+    m_appliedFences.clear();
+}
+
+void Renderer::wake() {
+    if (!m_config.renderOnDemand) return;
+    std::lock_guard<std::mutex> lock(m_wakeMutex);
+    if (m_eventsReady) glfwPostEmptyEvent();
+}
+
+bool Renderer::frameWanted() {
+    if (m_redrawFrames > 0) {
+        m_redrawFrames--;
+        return true;
+    }
+    // Playback, dataset paging, deferred readbacks and queued exports need the coming frames
+    if (m_timelineActive && (m_timeline.playing || m_timeline.paging)) return true;
+    if (m_clickPending || m_rectPending || m_pickReadback.busy() || m_selection.busy()) return true;
+    if (m_rangeFilter.busy()) return true;
+    if (!m_exportQueue.empty() || m_exporter.readbackBusy()) return true;
+    if (m_commands.size() > 0) return true;
+    // A held slider or drag in the UI
+    return ImGui::IsAnyItemActive();
+}
+
+void Renderer::waitForEvents() {
+    auto timer = m_profiler.scope(Profiler::Idle);
+    if (m_config.idleFrameRate > 0.0f) {
+        glfwWaitEventsTimeout(1.0 / m_config.idleFrameRate);
     } else {
-        m_stagedValues.clear();
+        glfwWaitEvents();
     }
-    
-    m_stagedCount = count;
-    m_forceUpdate = true;
+    requestRedraw();  // Woken by a change: draw it and let the UI settle
+}
+
+Renderer::QueueStats Renderer::getQueueStats() const {
+    QueueStats stats;
+    stats.depth = m_commands.size();
+    stats.maxDepth = m_maxQueueDepth.load(std::memory_order_relaxed);
+    stats.submitted = m_commandsSubmitted.load(std::memory_order_relaxed);
+    stats.stalls = m_queueStalls.load(std::memory_order_relaxed);
+    stats.stallMs = m_queueStallNs.load(std::memory_order_relaxed) / 1e6;
+    stats.lastDrainMs = m_lastDrainNs.load(std::memory_order_relaxed) / 1e6;
+    return stats;
+}
+
+void Renderer::publishUiSnapshot() {
+    auto snapshot = std::make_shared<UiSnapshot>();
+    snapshot->selectedID = m_selectedID;
+    snapshot->selectedIDs = m_selectedIDs;
+    snapshot->selectedTicker = selectedTicker();
+    snapshot->colorFeatureIdx = m_selectedColorFeatureIdx;
+    snapshot->filteredCount = m_rangeFilter.active().empty() ? -1 : (long long)m_rangeIDs.size();
+    m_uiSnapshot.store(std::move(snapshot), std::memory_order_release);
+    m_uiDirty = false;
+}
+
+std::string Renderer::selectedTicker() const {
+    if (m_selectedID >= 0 && m_selectedID < (int)m_tickers.size()) {
+        return m_tickers[m_selectedID];
+    }
+    return "";
+}
+
+// ---------------------------------------------------------------------------
+// Producer API: payloads are copied on the calling thread, the render thread
+// only swaps them in
+// ---------------------------------------------------------------------------
+
+void Renderer::setPoints(const float* positions, const float* values, size_t count) {
+    outlierCategories(positions, count);
+    recordPoints(SessionKind::Points, positions, values, count);
+
+    // Streaming mode: one copy straight into a free ring segment
+    if (m_config.streamingUploads) {
+        std::unique_lock<std::mutex> lock(m_producerMutex);
+        if (m_stream.write(positions, values, count)) {
+            lock.unlock();
+            wake();
+            return;
+        }
+    }
+
+    std::vector<float> stagedPositions, stagedValues;
+    if (positions && count > 0) stagedPositions.assign(positions, positions + count * 3);
+    if (values && count > 0) stagedValues.assign(values, values + count);
+    m_submittedCount = count;
+
+    submit([this, pos = std::move(stagedPositions), val = std::move(stagedValues), count]() mutable {
+        m_stagedPositions.swap(pos);
+        m_stagedValues.swap(val);
+        m_stagedCount = count;
+        m_forceUpdate = true;
+        m_dirtyIndices.clear();  // Superseded by the full upload
+    });
 }
 
 void Renderer::setTargetPoints(const float* positions, const float* values, size_t count) {
-    std::lock_guard<std::mutex> lock(m_dataMutex);
-    
-    if (positions && count > 0) {
-        m_stagedNextPositions.assign(positions, positions + count * 3);
-    } else {
-        m_stagedNextPositions.clear();
+    outlierCategories(positions, count);  // Labels follow the morph target
+    recordPoints(SessionKind::TargetPoints, positions, values, count);
+
+    if (m_config.streamingUploads) {
+        std::unique_lock<std::mutex> lock(m_producerMutex);
+        if (m_nextStream.write(positions, values, count)) {
+            lock.unlock();
+            wake();
+            return;
+        }
     }
-    
-    if (values && count > 0) {
-        m_stagedNextValues.assign(values, values + count);
-    } else {
-        m_stagedNextValues.clear();
+
+    std::vector<float> stagedPositions, stagedValues;
+    if (positions && count > 0) stagedPositions.assign(positions, positions + count * 3);
+    if (values && count > 0) stagedValues.assign(values, values + count);
+    m_submittedNextCount = count;
+
+    submit([this, pos = std::move(stagedPositions), val = std::move(stagedValues), count]() mutable {
+        m_stagedNextPositions.swap(pos);
+        m_stagedNextValues.swap(val);
+        m_stagedNextCount = count;
+        m_forceUpdateNext = true;
+        m_dirtyNextIndices.clear();
+    });
+}
+
+// Apply a sparse patch to one staged state (render thread, indices already validated)
+static void patchStaged(const std::vector<int>& indices, const std::vector<float>& positions,
+                        const std::vector<float>& values, size_t stagedCount,
+                        std::vector<float>& stagedPositions, std::vector<float>& stagedValues,
+                        std::vector<unsigned int>* dirty) {
+    // Full arrays are only re-staged by setPoints; both must cover stagedCount
+    if (stagedPositions.size() < stagedCount * 3 || stagedValues.size() < stagedCount) return;
+
+    for (size_t i = 0; i < indices.size(); i++) {
+        size_t idx = (size_t)indices[i];
+        if (idx >= stagedCount) continue;
+        if (!positions.empty()) {
+            stagedPositions[idx * 3 + 0] = positions[i * 3 + 0];
+            stagedPositions[idx * 3 + 1] = positions[i * 3 + 1];
+            stagedPositions[idx * 3 + 2] = positions[i * 3 + 2];
+        }
+        if (!values.empty()) stagedValues[idx] = values[i];
+        if (dirty) dirty->push_back((unsigned int)idx);
     }
-    
-    m_stagedNextCount = count;
-    m_forceUpdateNext = true;
+}
+
+// Validate against the last submitted count and copy the patch for the queue
+static bool copyPatch(const int* indices, const float* positions, const float* values, size_t count,
+                      size_t submittedCount, std::vector<int>& outIndices,
+                      std::vector<float>& outPositions, std::vector<float>& outValues) {
+    for (size_t i = 0; i < count; i++) {
+        if (indices[i] < 0 || (size_t)indices[i] >= submittedCount) return false;
+    }
+    outIndices.assign(indices, indices + count);
+    if (positions) outPositions.assign(positions, positions + count * 3);
+    if (values) outValues.assign(values, values + count);
+    return true;
+}
+
+bool Renderer::updatePoints(const int* indices, const float* positions, const float* values, size_t count) {
+    if (!indices || count == 0) return true;
+    std::vector<int> idx;
+    std::vector<float> pos, val;
+    if (!copyPatch(indices, positions, values, count, m_submittedCount, idx, pos, val)) return false;
+    recordPatch(SessionKind::UpdatePoints, indices, positions, values, count);
+
+    submit([this, idx = std::move(idx), pos = std::move(pos), val = std::move(val)]() {
+        // A pending full upload already carries the patch
+        patchStaged(idx, pos, val, m_stagedCount, m_stagedPositions, m_stagedValues,
+                    m_forceUpdate ? nullptr : &m_dirtyIndices);
+    });
+    return true;
+}
+
+bool Renderer::updateTargetPoints(const int* indices, const float* positions, const float* values, size_t count) {
+    if (!indices || count == 0) return true;
+    std::vector<int> idx;
+    std::vector<float> pos, val;
+    if (!copyPatch(indices, positions, values, count, m_submittedNextCount, idx, pos, val)) return false;
+    recordPatch(SessionKind::UpdateTargetPoints, indices, positions, values, count);
+
+    submit([this, idx = std::move(idx), pos = std::move(pos), val = std::move(val)]() {
+        patchStaged(idx, pos, val, m_stagedNextCount, m_stagedNextPositions, m_stagedNextValues,
+                    m_forceUpdateNext ? nullptr : &m_dirtyNextIndices);
+    });
+    return true;
 }
 
 void Renderer::setPointsRaw(const float* positions, const float* values, size_t count) {
@@ -97,93 +347,173 @@ void Renderer::setPointsRaw(const float* positions, const float* values, size_t
 }
 
 void Renderer::setTickers(const std::vector<std::string>& tickers) {
-    std::lock_guard<std::mutex> lock(m_dataMutex);
-    m_tickers = tickers;
+    recordStrings(SessionKind::Tickers, tickers);
+    submit([this, tickers = tickers]() mutable {
+        m_tickers.swap(tickers);
+        m_uiDirty = true;  // Selected ticker may have changed
+    });
 }
 
 std::string Renderer::getSelectedTicker() const {
-    if (m_selectedID >= 0 && m_selectedID < (int)m_tickers.size()) {
-        return m_tickers[m_selectedID];
-    }
-    return "";
+    return m_uiSnapshot.load(std::memory_order_acquire)->selectedTicker;
+}
+
+int Renderer::getSelectedID() const {
+    return m_uiSnapshot.load(std::memory_order_acquire)->selectedID;
 }
 
 void Renderer::setDimensionLabels(const std::string& colorLabel, 
                                    const std::string& xLabel,
                                    const std::string& yLabel, 
                                    const std::string& zLabel) {
-    std::lock_guard<std::mutex> lock(m_dataMutex);
-    m_colorLabel = colorLabel;
-    m_xLabel = xLabel;
-    m_yLabel = yLabel;
-    m_zLabel = zLabel;
+    if (recording()) {
+        SessionPayload payload;
+        for (const std::string* label : {&colorLabel, &xLabel, &yLabel, &zLabel}) payload.putString(*label);
+        record(SessionKind::DimensionLabels, payload.take());
+    }
+    submit([this, colorLabel, xLabel, yLabel, zLabel]() {
+        m_colorLabel = colorLabel;
+        m_xLabel = xLabel;
+        m_yLabel = yLabel;
+        m_zLabel = zLabel;
+    });
 }
 
 // --- Phase 1: Feature Switching ---
 void Renderer::setFeatureNames(const std::vector<std::string>& names) {
-    std::lock_guard<std::mutex> lock(m_dataMutex);
-    if (m_featureNames != names) {
-        m_featureNames = names;
-        m_selectedColorFeatureIdx = 0;
-        m_colorFeatureChanged = false;
-    }
+    recordStrings(SessionKind::FeatureNames, names);
+    submit([this, names]() {
+        if (m_featureNames != names) {
+            m_featureNames = names;
+            m_selectedColorFeatureIdx = 0;
+            m_colorFeatureChanged = false;
+            m_uiDirty = true;
+        }
+    });
 }
 
 int Renderer::getSelectedColorFeatureIndex() const {
-    return m_selectedColorFeatureIdx;
+    return m_uiSnapshot.load(std::memory_order_acquire)->colorFeatureIdx;
 }
 
 bool Renderer::hasColorFeatureChanged() {
-    std::lock_guard<std::mutex> lock(m_dataMutex);
-    if (m_colorFeatureChanged) {
-        m_colorFeatureChanged = false;
-        return true;
-    }
-    return false;
+    return m_colorFeatureChanged.exchange(false);
 }
 
 // --- Phase 1: Stats Panel ---
 void Renderer::setStats(const std::vector<StatsData>& stats) {
-    std::lock_guard<std::mutex> lock(m_dataMutex);
-    m_statsData = stats;
+    if (recording()) {
+        SessionPayload payload;
+        payload.put<uint64_t>(stats.size());
+        for (const StatsData& s : stats) {
+            payload.putString(s.name);
+            payload.put(s.min);
+            payload.put(s.max);
+            payload.put(s.mean);
+            payload.put(s.std);
+            payload.put(s.median);
+            payload.put<int32_t>(s.count);
+        }
+        record(SessionKind::Stats, payload.take());
+    }
+    submit([this, stats = stats]() mutable { m_statsData.swap(stats); });
 }
 
 void Renderer::setExplainedVariance(const std::vector<float>& variance) {
-    std::lock_guard<std::mutex> lock(m_dataMutex);
-    m_explainedVariance = variance;
+    if (recording()) {
+        SessionPayload payload;
+        payload.put<uint64_t>(variance.size());
+        payload.putArray(variance.data(), variance.size());
+        record(SessionKind::ExplainedVariance, payload.take());
+    }
+    submit([this, variance = variance]() mutable { m_explainedVariance.swap(variance); });
 }
 
 // --- Phase 1: Enhanced Tooltips ---
 void Renderer::setAllFeatureValues(const float* values, size_t numPoints, size_t numFeatures) {
-    std::lock_guard<std::mutex> lock(m_dataMutex);
+    releaseRetiredFeatures();
+    std::shared_ptr<const FeatureStore> store;
     if (values && numPoints > 0 && numFeatures > 0) {
-        m_allFeatureValues.assign(values, values + numPoints * numFeatures);
-        m_numFeatures = numFeatures;
-    } else {
-        m_allFeatureValues.clear();
-        m_numFeatures = 0;
+        auto all = std::make_shared<const std::vector<float>>(values, values + numPoints * numFeatures);
+        FeatureStore::View view;
+        view.data = all->data();
+        view.type = FeatureStore::View::Type::Float32;
+        view.rows = (Eigen::Index)numPoints;
+        view.cols = (Eigen::Index)numFeatures;
+        view.rowStride = (Eigen::Index)numFeatures;
+        view.colStride = 1;
+        view.owner = std::move(all);
+        store = std::make_shared<const FeatureStore>(std::move(view));
+        recordFeatures(SessionKind::FeatureValues, *store);
+    }
+    submit([this, store = std::move(store)]() mutable {
+        m_features.swap(store);
+        m_featuresVersion++;
+        retireFeatures(std::move(store));
+    });
+}
+
+void Renderer::setFeatureStore(std::shared_ptr<const FeatureStore> store) {
+    releaseRetiredFeatures();
+    std::vector<StatsData> stats;
+    if (store) {
+        for (const FeatureStore::ColumnStats& c : store->computeStats()) {
+            stats.push_back({std::string(), c.min, c.max, c.mean, c.std, c.median, (int)c.count});
+        }
+        clusterCategories(*store);
+        recordFeatures(SessionKind::FeatureStore, *store);
+    }
+    submit([this, store = std::move(store), stats = std::move(stats)]() mutable {
+        m_features.swap(store);
+        m_featuresVersion++;
+        m_statsData.swap(stats);
+        retireFeatures(std::move(store));
+    });
+}
+
+void Renderer::retireFeatures(std::shared_ptr<const FeatureStore> store) {
+    if (!store) return;
+    std::lock_guard<std::mutex> lock(m_retiredMutex);
+    m_retiredFeatures.push_back(std::move(store));
+}
+
+void Renderer::releaseRetiredFeatures() {
+    std::vector<std::shared_ptr<const FeatureStore>> retired;
+    {
+        std::lock_guard<std::mutex> lock(m_retiredMutex);
+        retired.swap(m_retiredFeatures);
     }
 }
 
 void Renderer::loop() {
     // 1. Init GLFW
-    if (!glfwInit()) return;
+    if (!glfwInit()) { stopAcceptingCommands(); return; }
     
     glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 4);
     glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 1);
     glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
 
+    // Headless renderers keep their window hidden and draw offscreen
+    if (m_config.headless) glfwWindowHint(GLFW_VISIBLE, GLFW_FALSE);
+
     // Use config for window size and title
     m_window = glfwCreateWindow(m_config.windowWidth, m_config.windowHeight, m_config.windowTitle, NULL, NULL);
-    if (!m_window) { glfwTerminate(); return; }
+    if (!m_window) { glfwTerminate(); stopAcceptingCommands(); return; }
     
     glfwMakeContextCurrent(m_window);
-    glfwSwapInterval(m_config.vsync ? 1 : 0); // VSync from config
+    glfwSwapInterval(m_config.vsync && !m_config.headless ? 1 : 0); // VSync from config
 
     // 2. Init GLAD
-    if (!gladLoadGLLoader((GLADloadproc)glfwGetProcAddress)) return;
+    if (!gladLoadGLLoader((GLADloadproc)glfwGetProcAddress)) { stopAcceptingCommands(); return; }
 
     initGL();
+    m_exporter.init(m_config.exportThreads);
+    m_profiler.init();
+
+    if (m_config.streamingUploads) {
+        m_stream.init(m_caps.bufferStorage, m_config.streamingCapacity);
+        m_nextStream.init(m_caps.bufferStorage, m_config.streamingCapacity);
+    }
 
     // Setup ImGui
     IMGUI_CHECKVERSION();
@@ -198,93 +528,565 @@ void Renderer::loop() {
     ImGui_ImplGlfw_InitForOpenGL(m_window, false);
     ImGui_ImplOpenGL3_Init("#version 410");
 
-    m_camera = new Camera(1920, 1080);
+    int framebufferWidth = 0, framebufferHeight = 0;
+    glfwGetFramebufferSize(m_window, &framebufferWidth, &framebufferHeight);
+    m_mainCamera = new Camera(std::max(framebufferWidth, 1), std::max(framebufferHeight, 1));
+    m_camera = multiView() ? m_viewports[m_activeViewport].camera.get() : m_mainCamera;
     glfwSetWindowUserPointer(m_window, this);
     glfwSetMouseButtonCallback(m_window, mouse_button_callback);
     glfwSetCursorPosCallback(m_window, cursor_position_callback);
     glfwSetScrollCallback(m_window, scroll_callback);
     glfwSetFramebufferSizeCallback(m_window, framebuffer_size_callback);
+    glfwSetWindowRefreshCallback(m_window, window_refresh_callback);
+    {
+        std::lock_guard<std::mutex> lock(m_wakeMutex);
+        m_eventsReady = true;
+    }
 
     // 3. Render Loop
-    while (m_running && !glfwWindowShouldClose(m_window)) {
+    while (!m_stopRequested && !glfwWindowShouldClose(m_window)) {
+        m_profiler.beginFrame();
         renderFrame();
-        glfwSwapBuffers(m_window);
-        processScreenshotRequest();
-        glfwPollEvents();
+        if (!m_config.headless) {
+            auto timer = m_profiler.scope(Profiler::Present);
+            glfwSwapBuffers(m_window);
+        }
+        {
+            auto timer = m_profiler.scope(Profiler::Export);
+            m_exporter.poll(false);
+        }
+        // Headless renderers are driven by render_frames() and never block here
+        if (m_config.renderOnDemand && !m_config.headless && !frameWanted()) {
+            waitForEvents();
+        } else {
+            glfwPollEvents();
+        }
+
+        // Selection may have changed in the UI or the input callbacks
+        if (m_uiDirty) publishUiSnapshot();
+        m_profiler.endFrame();
     }
     
+    stopAcceptingCommands();
+
     // Cleanup ImGui
     ImGui_ImplOpenGL3_Shutdown();
     ImGui_ImplGlfw_Shutdown();
     ImGui::DestroyContext();
 
-    delete m_camera;
+    m_pickReadback.destroy();
+    m_selection.destroy();
+    m_culler.destroy();
+    m_rangeFilter.destroy();
+    destroyExport();
+    m_profiler.destroy();
+    glDeleteBuffers(1, &m_frameUBO);
+    glDeleteTextures(1, &m_colorLutTexture);
+    glDeleteTextures(1, &m_categoryTexture);
+    glDeleteBuffers(1, &m_categoryBuffer);
+    if (m_timelineVAO) {
+        glDeleteVertexArrays(1, &m_timelineVAO);
+        glDeleteBuffers(1, &m_timelinePosBuffer);
+        glDeleteBuffers(1, &m_timelineValBuffer);
+        glDeleteBuffers(1, &m_timelineIndexBuffer);
+    }
+    m_stream.destroy();
+    m_nextStream.destroy();
+
+    for (Viewport& view : m_viewports) releaseViewportGL(view);
+    delete m_mainCamera;
+    m_mainCamera = m_camera = nullptr;
+    {
+        std::lock_guard<std::mutex> lock(m_wakeMutex);
+        m_eventsReady = false;
+    }
     glfwDestroyWindow(m_window);
     glfwTerminate();
 
     // Force Python process to exit when window is closed
-    std::exit(0);
-}
-
-// Helper functions for CPU-side color calculation (Mirrors Shader Logic)
-static void getHeatMapColor(float t, float* r, float* g, float* b) {
-    t = std::max(0.0f, std::min(1.0f, t));
-    if (t < 0.5f) {
-        float f = t * 2.0f;
-        // mix(blue, cyan, f)
-        *r = 0.0f; 
-        *g = f; 
-        *b = 1.0f;
+    if (m_config.exitProcessOnClose && !m_config.headless) std::exit(0);
+}
+
+// Upload a staged array, reusing the VBO storage until it is outgrown.
+// glBufferData(NULL) orphans the old storage so the driver never waits on in-flight draws.
+template <typename T>
+static void uploadInstanceData(unsigned int vbo, const std::vector<T>& data, size_t& capacityBytes) {
+    size_t bytes = data.size() * sizeof(T);
+    glBindBuffer(GL_ARRAY_BUFFER, vbo);
+    if (bytes > capacityBytes) {
+        capacityBytes = bytes;
+        glBufferData(GL_ARRAY_BUFFER, (GLsizeiptr)bytes, data.data(), GL_DYNAMIC_DRAW);
     } else {
-        float f = (t - 0.5f) * 2.0f;
-        // mix(cyan, red, f)
-        *r = f;
-        *g = 1.0f - f;
-        *b = 1.0f - f;
-    }
-}
-
-static void getCoolWarmColor(float t, float* r, float* g, float* b) {
-    t = std::max(0.0f, std::min(1.0f, t));
-    if (t < 0.5f) {
-        float f = t * 2.0f;
-        // mix(vec3(0.2, 0.4, 1.0), vec3(0.9, 0.9, 0.9), f)
-        *r = 0.2f + (0.9f - 0.2f) * f;
-        *g = 0.4f + (0.9f - 0.4f) * f;
-        *b = 1.0f + (0.9f - 1.0f) * f;
+        glBufferData(GL_ARRAY_BUFFER, (GLsizeiptr)capacityBytes, nullptr, GL_DYNAMIC_DRAW);
+        glBufferSubData(GL_ARRAY_BUFFER, 0, (GLsizeiptr)bytes, data.data());
+    }
+}
+
+void Renderer::bindInstanceAttributes(bool next, unsigned int posBuffer, size_t posOffset,
+                                      unsigned int valBuffer, size_t valOffset) {
+    GLuint posLoc = next ? 3 : 1;
+    GLuint valLoc = next ? 4 : 2;
+
+    glBindVertexArray(m_validVAO);
+    glBindBuffer(GL_ARRAY_BUFFER, posBuffer);
+    glVertexAttribPointer(posLoc, 3, GL_FLOAT, GL_FALSE, 3 * sizeof(float), (void*)posOffset);
+    glBindBuffer(GL_ARRAY_BUFFER, valBuffer);
+    glVertexAttribPointer(valLoc, 1, GL_FLOAT, GL_FALSE, sizeof(float), (void*)valOffset);
+    glBindVertexArray(0);
+}
+
+void Renderer::bindStagedAttributes(bool next) {
+    GLuint posVBO = next ? m_instanceVBO_NextPos : m_instanceVBO_Pos;
+    GLuint valVBO = next ? m_instanceVBO_NextVal : m_instanceVBO_Val;
+    m_packedBound[next] = m_config.packedInstances;
+    if (!m_config.packedInstances) {
+        m_packedRange[next] = PackedRange{};
+        bindInstanceAttributes(next, posVBO, 0, valVBO, 0);
+        return;
+    }
+
+    GLuint posLoc = next ? 3 : 1;
+    GLuint valLoc = next ? 4 : 2;
+    glBindVertexArray(m_validVAO);
+    glBindBuffer(GL_ARRAY_BUFFER, posVBO);
+    glVertexAttribPointer(posLoc, 3, GL_SHORT, GL_TRUE, sizeof(PackedInstance),
+                          (void*)offsetof(PackedInstance, pos));
+    glVertexAttribPointer(valLoc, 1, GL_UNSIGNED_SHORT, GL_TRUE, sizeof(PackedInstance),
+                          (void*)offsetof(PackedInstance, value));
+    glBindVertexArray(0);
+}
+
+void Renderer::uploadPacked(bool next) {
+    const std::vector<float>& positions = next ? m_stagedNextPositions : m_stagedPositions;
+    const std::vector<float>& values = next ? m_stagedNextValues : m_stagedValues;
+    size_t count = std::min(positions.size() / 3, values.size());
+
+    m_packedRange[next] = PackedRange::fit(positions.data(), values.data(), count);
+    m_packScratch.resize(count);
+    packInstances(positions.data(), values.data(), 0, count, m_packedRange[next], m_packScratch.data());
+    uploadInstanceData(next ? m_instanceVBO_NextPos : m_instanceVBO_Pos, m_packScratch,
+                       next ? m_capacityNextPos : m_capacityPos);
+}
+
+void Renderer::updateFrameUniforms(bool lod) {
+    size_t slices = 1 + (multiView() ? m_viewports.size() : 0);
+    m_frameSlices.assign(slices * m_frameSliceStride, 0);
+    fillFrameUniforms(*reinterpret_cast<FrameUniforms*>(m_frameSlices.data()), lod);
+
+    // Every viewport's camera and filter, so drawing them only rebinds
+    if (slices > 1) {
+        Camera* camera = m_camera;
+        int drawViewport = m_drawViewport;
+        for (size_t i = 0; i < m_viewports.size(); i++) {
+            Viewport& view = m_viewports[i];
+            if (view.rect[2] > 0 && view.rect[3] > 0) view.camera->setAspect(view.rect[2], view.rect[3]);
+            m_camera = view.camera.get();
+            m_drawViewport = (int)i;
+            fillFrameUniforms(*reinterpret_cast<FrameUniforms*>(m_frameSlices.data() + (1 + i) * m_frameSliceStride),
+                              false);
+        }
+        m_camera = camera;
+        m_drawViewport = drawViewport;
+    }
+
+    glBindBuffer(GL_UNIFORM_BUFFER, m_frameUBO);
+    glBufferSubData(GL_UNIFORM_BUFFER, 0, (GLsizeiptr)m_frameSlices.size(), m_frameSlices.data());
+    glBindBuffer(GL_UNIFORM_BUFFER, 0);
+    bindFrameUniforms(0);
+}
+
+void Renderer::bindFrameUniforms(size_t slice) {
+    glBindBufferRange(GL_UNIFORM_BUFFER, kFrameStateBinding, m_frameUBO, (GLintptr)(slice * m_frameSliceStride),
+                      sizeof(FrameUniforms));
+}
+
+void Renderer::fillFrameUniforms(FrameUniforms& u, bool lod) const {
+    Eigen::Matrix4f vp = m_camera->getViewProjectionMatrix();
+    Eigen::Vector3f right = m_camera->getRight();
+    Eigen::Vector3f up    = m_camera->getUp();
+    std::copy(vp.data(), vp.data() + 16, u.viewProj);
+    std::copy(right.data(), right.data() + 3, u.cameraRight);
+    std::copy(up.data(), up.data() + 3, u.cameraUp);
+    u.scale = m_pointScale;
+    u.time = m_morphTime;
+    u.alpha = m_globalAlpha;
+    u.categorical = m_colorMode == kCategoricalMode;
+    u.selectedID = m_selectedID;
+    u.hasSelection = m_selectedID != -1;
+
+    // Compute Selected Color on CPU to solve shader issues
+    {
+        size_t numValues = 0, numNext = 0;
+        const float* values = currentValues(numValues);
+        const float* next = nextValues(numNext);
+        if (m_selectedID >= 0 && m_selectedID < (int)numValues) {
+            float v1 = values[m_selectedID];
+            // Check bounds for NextValues
+            float v2 = (m_selectedID < (int)numNext) ? next[m_selectedID] : v1;
+
+            // Calculate current interpolated value
+            float val = v1 + (v2 - v1) * m_morphTime;
+
+            // Same LUT entry the shader draws the point with
+            pointColor(m_selectedID, val, u.selectedColor);
+        }
+    }
+
+    u.colorFilterEnabled = m_colorFilterEnabled;
+    u.colorFilterValue = m_colorFilterValue;
+    u.colorFilterTolerance = m_colorFilterTolerance;
+    if (m_drawViewport >= 0 && m_viewports[m_drawViewport].filterEnabled) {
+        // A viewport's value range is the same band, centered on the range
+        const Viewport& view = m_viewports[m_drawViewport];
+        u.colorFilterEnabled = true;
+        u.colorFilterValue = (view.filterMin + view.filterMax) * 0.5f;
+        u.colorFilterTolerance = (view.filterMax - view.filterMin) * 0.5f;
+    }
+
+    // Billboards in aggregated cells are dropped in the vertex shader;
+    // density-only mode aggregates every occupied cell
+    u.lodThreshold = m_lodMode == 2 ? 0.0f : m_lodThreshold;
+    u.lodExposure = m_lodExposure;
+    u.lodCull = lod && m_lodMode == 1;
+
+    const std::vector<RangeFilter::Range>& ranges = m_rangeFilter.active();
+    u.rangeCount = (int32_t)ranges.size();
+    u.rangeRows = (int32_t)m_rangeFilter.rows();
+    for (size_t k = 0; k < ranges.size(); k++) {
+        u.rangeMin[k / 4][k % 4] = ranges[k].min;
+        u.rangeMax[k / 4][k % 4] = ranges[k].max;
+    }
+
+    for (int k = 0; k < 2; k++) {
+        // Float sets (streamed, keyframes, or packing off) pass through unchanged
+        bool packed = m_packedBound[k] && !m_timelineActive;
+        PackedRange range = packed ? m_packedRange[k] : PackedRange{};
+        std::copy(range.posScale, range.posScale + 3, u.positionScale[k]);
+        std::copy(range.posBias, range.posBias + 3, u.positionBias[k]);
+        u.positionScale[k][3] = packed ? 1.0f : 0.0f;  // Value code 0 marks absent points
+        u.valueRange[k * 2] = range.valueScale;
+        u.valueRange[k * 2 + 1] = range.valueBias;
+        if (packed) range.valueDecode(u.valueRange[k * 2], u.valueRange[k * 2 + 1]);
+    }
+}
+
+const float* Renderer::currentValues(size_t& count) const {
+    if (m_timelineActive) {
+        count = m_timeline.points;
+        return timelineValues(m_timeline.frame);
+    }
+    if (m_streamBound) {
+        count = m_stream.count();
+        return m_stream.currentValues();
+    }
+    count = m_stagedValues.size();
+    return m_stagedValues.data();
+}
+
+const float* Renderer::nextValues(size_t& count) const {
+    if (m_timelineActive) {
+        count = m_timeline.points;
+        return timelineValues(m_timeline.nextFrame);
+    }
+    if (m_nextStreamBound) {
+        count = m_nextStream.count();
+        return m_nextStream.currentValues();
+    }
+    count = m_stagedNextValues.size();
+    return m_stagedNextValues.data();
+}
+
+const float* Renderer::currentPositions(size_t& count) const {
+    if (m_timelineActive) {
+        count = m_timeline.points;
+        return timelinePositions(m_timeline.frame);
+    }
+    if (m_streamBound) {
+        count = m_stream.count();
+        return m_stream.currentPositions();
+    }
+    count = m_stagedPositions.size() / 3;
+    return m_stagedPositions.data();
+}
+
+const float* Renderer::nextPositions(size_t& count) const {
+    if (m_timelineActive) {
+        count = m_timeline.points;
+        return timelinePositions(m_timeline.nextFrame);
+    }
+    if (m_nextStreamBound) {
+        count = m_nextStream.count();
+        return m_nextStream.currentPositions();
+    }
+    count = m_stagedNextPositions.size() / 3;
+    return m_stagedNextPositions.data();
+}
+
+InstanceSource Renderer::currentSource() const {
+    InstanceSource source;
+    size_t count = 0;
+    source.cpu = currentPositions(count);
+    source.count = std::min(count, m_renderCount);
+    if (m_timelineActive) {
+        source.buffer = m_timelinePosBuffer;
+        source.offset = timelineSlot(m_timeline.frame) * m_timeline.points * 3 * sizeof(float);
+        return source;
+    }
+    // Packed sets have no float positions on the GPU: compute passes use the CPU copy
+    source.buffer = m_streamBound ? m_stream.buffer() : (m_packedBound[0] ? 0 : m_instanceVBO_Pos);
+    source.offset = m_streamBound ? m_stream.positionOffset() : 0;
+    return source;
+}
+
+InstanceSource Renderer::nextSource() const {
+    InstanceSource source;
+    source.cpu = nextPositions(source.count);
+    if (m_timelineActive) {
+        source.buffer = m_timelinePosBuffer;
+        source.offset = timelineSlot(m_timeline.nextFrame) * m_timeline.points * 3 * sizeof(float);
+        return source;
+    }
+    source.buffer = m_nextStreamBound ? m_nextStream.buffer() : (m_packedBound[1] ? 0 : m_instanceVBO_NextPos);
+    source.offset = m_nextStreamBound ? m_nextStream.positionOffset() : 0;
+    return source;
+}
+
+// Above this many ranges the per-call overhead of glBufferSubData dominates
+static const size_t kMaxSubDataRanges = 256;
+
+// Sort and dedupe dirty indices, then merge them into [begin, end) ranges
+static std::vector<std::pair<unsigned int, unsigned int>> coalesceDirty(std::vector<unsigned int>& dirty) {
+    // Points closer than this are merged into one range: re-sending a few clean
+    // points is cheaper than another glBufferSubData call
+    const unsigned int kMergeGap = 64;
+
+    std::sort(dirty.begin(), dirty.end());
+    dirty.erase(std::unique(dirty.begin(), dirty.end()), dirty.end());
+
+    std::vector<std::pair<unsigned int, unsigned int>> ranges;
+    for (unsigned int idx : dirty) {
+        if (!ranges.empty() && idx <= ranges.back().second + kMergeGap) {
+            ranges.back().second = idx + 1;
+        } else {
+            ranges.push_back({ idx, idx + 1 });
+        }
+    }
+    return ranges;
+}
+
+// Merge ranges across their narrowest clean gaps until at most `limit` remain:
+// the fewest clean points re-sent for that many glBufferSubData calls
+static void limitRanges(std::vector<std::pair<unsigned int, unsigned int>>& ranges, size_t limit) {
+    if (ranges.size() <= limit) return;
+    if (limit <= 1) {
+        ranges = { { ranges.front().first, ranges.back().second } };
+        return;
+    }
+
+    std::vector<unsigned int> gaps(ranges.size() - 1);
+    for (size_t i = 0; i + 1 < ranges.size(); i++) gaps[i] = ranges[i + 1].first - ranges[i].second;
+
+    // The widest (limit - 1) gaps stay open; ties at the cut open in order
+    size_t open = limit - 1;
+    std::vector<unsigned int> sorted(gaps);
+    std::nth_element(sorted.begin(), sorted.end() - open, sorted.end());
+    unsigned int cut = *(sorted.end() - open);
+    size_t tiedOpen = open - (size_t)std::count_if(gaps.begin(), gaps.end(), [cut](unsigned int g) { return g > cut; });
+
+    size_t out = 0;
+    for (size_t i = 0; i < gaps.size(); i++) {
+        bool keepGap = gaps[i] > cut || (gaps[i] == cut && tiedOpen > 0 && tiedOpen--);
+        if (keepGap) {
+            ranges[++out] = ranges[i + 1];
+        } else {
+            ranges[out].second = ranges[i + 1].second;
+        }
+    }
+    ranges.resize(out + 1);
+}
+
+void Renderer::uploadDirtyPoints(std::vector<unsigned int>& dirty, unsigned int posVBO, unsigned int valVBO,
+                                  const std::vector<float>& positions, const std::vector<float>& values) {
+    std::vector<std::pair<unsigned int, unsigned int>> ranges = coalesceDirty(dirty);
+
+    if (ranges.size() > kMaxSubDataRanges && m_scatterProgram) {
+        // Large scattered dirty set: ship only the patches and scatter on the GPU
+        struct Patch { unsigned int index; float value; float pos[3]; };
+        std::vector<Patch> patches(dirty.size());
+        for (size_t i = 0; i < dirty.size(); i++) {
+            unsigned int idx = dirty[i];
+            patches[i] = { idx, values[idx], { positions[idx * 3], positions[idx * 3 + 1], positions[idx * 3 + 2] } };
+        }
+
+        size_t bytes = patches.size() * sizeof(Patch);
+        glBindBuffer(GL_SHADER_STORAGE_BUFFER, m_scatterBuffer);
+        if (bytes > m_scatterCapacity) m_scatterCapacity = bytes;
+        glBufferData(GL_SHADER_STORAGE_BUFFER, (GLsizeiptr)m_scatterCapacity, nullptr, GL_STREAM_DRAW);
+        glBufferSubData(GL_SHADER_STORAGE_BUFFER, 0, (GLsizeiptr)bytes, patches.data());
+
+        glUseProgram(m_scatterProgram);
+        glUniform1ui(m_scatterPatchCountLoc, (GLuint)patches.size());
+        glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 0, m_scatterBuffer);
+        glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 1, posVBO);
+        glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 2, valVBO);
+        glDispatchCompute((GLuint)((patches.size() + 255) / 256), 1, 1);
+        glMemoryBarrier(GL_VERTEX_ATTRIB_ARRAY_BARRIER_BIT | GL_SHADER_STORAGE_BARRIER_BIT);
+        glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
     } else {
-        float f = (t - 0.5f) * 2.0f;
-        // mix(vec3(0.9, 0.9, 0.9), vec3(1.0, 0.2, 0.2), f)
-        *r = 0.9f + (1.0f - 0.9f) * f;
-        *g = 0.9f + (0.2f - 0.9f) * f;
-        *b = 0.9f + (0.2f - 0.9f) * f;
+        // No compute shaders (GL 4.1): bounded batches rather than the whole dirty span
+        limitRanges(ranges, kMaxSubDataRanges);
+        glBindBuffer(GL_ARRAY_BUFFER, posVBO);
+        for (const auto& r : ranges) {
+            glBufferSubData(GL_ARRAY_BUFFER, r.first * 3 * sizeof(float),
+                            (r.second - r.first) * 3 * sizeof(float), &positions[r.first * 3]);
+        }
+        glBindBuffer(GL_ARRAY_BUFFER, valVBO);
+        for (const auto& r : ranges) {
+            glBufferSubData(GL_ARRAY_BUFFER, r.first * sizeof(float),
+                            (r.second - r.first) * sizeof(float), &values[r.first]);
+        }
+    }
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+    dirty.clear();
+}
+
+void Renderer::uploadDirtyPacked(bool next, std::vector<unsigned int>& dirty) {
+    const std::vector<float>& positions = next ? m_stagedNextPositions : m_stagedPositions;
+    const std::vector<float>& values = next ? m_stagedNextValues : m_stagedValues;
+    const PackedRange& range = m_packedRange[next];
+
+    // A patch outside the quantization bounds needs a refit of the whole set
+    for (unsigned int idx : dirty) {
+        if (!range.contains(&positions[idx * 3], values[idx])) {
+            uploadPacked(next);
+            dirty.clear();
+            return;
+        }
+    }
+
+    std::vector<std::pair<unsigned int, unsigned int>> ranges = coalesceDirty(dirty);
+    limitRanges(ranges, kMaxSubDataRanges);
+
+    glBindBuffer(GL_ARRAY_BUFFER, next ? m_instanceVBO_NextPos : m_instanceVBO_Pos);
+    for (const auto& r : ranges) {
+        m_packScratch.resize(r.second - r.first);
+        packInstances(positions.data(), values.data(), r.first, r.second, range, m_packScratch.data());
+        glBufferSubData(GL_ARRAY_BUFFER, r.first * sizeof(PackedInstance),
+                        m_packScratch.size() * sizeof(PackedInstance), m_packScratch.data());
     }
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+    dirty.clear();
 }
 
 void Renderer::renderFrame() {
+    // Apply everything the Python side queued since the last frame
+    {
+        auto timer = m_profiler.scope(Profiler::Commands);
+        drainCommands();
+    }
+
+    // Export requests redirect the scene passes into the offscreen target
+    {
+        auto timer = m_profiler.scope(Profiler::Export);
+        m_exportFrame = beginExportFrame();
+    }
+    if (m_config.headless && !m_exportFrame) {
+        // Nothing to draw: keep the queue and the encoders moving without spinning
+        serveSpatialRequests(true);
+        completeFences();  // Staged now, uploaded with the next exported frame
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        return;
+    }
+
     // Check for new data
+    m_profiler.begin(Profiler::Uploads, true);
     {
-        std::lock_guard<std::mutex> lock(m_dataMutex);
         if (m_forceUpdate && !m_stagedPositions.empty()) {
-            glBindBuffer(GL_ARRAY_BUFFER, m_instanceVBO_Pos);
-            glBufferData(GL_ARRAY_BUFFER, m_stagedPositions.size() * sizeof(float), m_stagedPositions.data(), GL_DYNAMIC_DRAW);
+            if (m_config.packedInstances) {
+                uploadPacked(false);
+            } else {
+                uploadInstanceData(m_instanceVBO_Pos, m_stagedPositions, m_capacityPos);
+                uploadInstanceData(m_instanceVBO_Val, m_stagedValues, m_capacityVal);
+            }
 
-            glBindBuffer(GL_ARRAY_BUFFER, m_instanceVBO_Val);
-            glBufferData(GL_ARRAY_BUFFER, m_stagedValues.size() * sizeof(float), m_stagedValues.data(), GL_DYNAMIC_DRAW);
+            // A staged upload supersedes whatever the stream was showing
+            if (m_streamBound) {
+                m_stream.release();
+                m_streamBound = false;
+            }
+            bindStagedAttributes(false);
             
             m_renderCount = m_stagedCount;
             m_forceUpdate = false;
+            m_dirtyIndices.clear();
+            m_instanceVersion++;
         }
         if (m_forceUpdateNext && !m_stagedNextPositions.empty()) {
-            glBindBuffer(GL_ARRAY_BUFFER, m_instanceVBO_NextPos);
-            glBufferData(GL_ARRAY_BUFFER, m_stagedNextPositions.size() * sizeof(float), m_stagedNextPositions.data(), GL_DYNAMIC_DRAW);
-            glBindBuffer(GL_ARRAY_BUFFER, m_instanceVBO_NextVal);
-            glBufferData(GL_ARRAY_BUFFER, m_stagedNextValues.size() * sizeof(float), m_stagedNextValues.data(), GL_DYNAMIC_DRAW);
+            if (m_config.packedInstances) {
+                uploadPacked(true);
+            } else {
+                uploadInstanceData(m_instanceVBO_NextPos, m_stagedNextPositions, m_capacityNextPos);
+                uploadInstanceData(m_instanceVBO_NextVal, m_stagedNextValues, m_capacityNextVal);
+            }
+
+            if (m_nextStreamBound) {
+                m_nextStream.release();
+                m_nextStreamBound = false;
+            }
+            bindStagedAttributes(true);
             m_forceUpdateNext = false;
+            m_dirtyNextIndices.clear();
+            m_instanceVersion++;
+        }
+
+        // Sparse patches from updatePoints / updateTargetPoints
+        if (!m_dirtyIndices.empty()) {
+            if (m_packedBound[0]) {
+                uploadDirtyPacked(false, m_dirtyIndices);
+            } else {
+                uploadDirtyPoints(m_dirtyIndices, m_instanceVBO_Pos, m_instanceVBO_Val, m_stagedPositions, m_stagedValues);
+            }
+            m_instanceVersion++;
+        }
+        if (!m_dirtyNextIndices.empty()) {
+            if (m_packedBound[1]) {
+                uploadDirtyPacked(true, m_dirtyNextIndices);
+            } else {
+                uploadDirtyPoints(m_dirtyNextIndices, m_instanceVBO_NextPos, m_instanceVBO_NextVal,
+                                  m_stagedNextPositions, m_stagedNextValues);
+            }
+            m_instanceVersion++;
         }
     }
 
+    // Streaming uploads: the producer already wrote the data, just rebind
+    if (m_stream.acquire()) {
+        bindInstanceAttributes(false, m_stream.buffer(), m_stream.positionOffset(),
+                               m_stream.buffer(), m_stream.valueOffset());
+        m_streamBound = true;
+        m_packedBound[0] = false;
+        m_renderCount = m_stream.count();
+        m_instanceVersion++;
+    }
+    if (m_nextStream.acquire()) {
+        bindInstanceAttributes(true, m_nextStream.buffer(), m_nextStream.positionOffset(),
+                               m_nextStream.buffer(), m_nextStream.valueOffset());
+        m_nextStreamBound = true;
+        m_packedBound[1] = false;
+        m_instanceVersion++;
+    }
+
+    // Keyframe playback replaces both point sets while a timeline is set
+    updateTimeline();
+    serveSpatialRequests(false);  // Spatial queries see the points uploaded above
+    completeFences();
+    m_profiler.end(Profiler::Uploads);
+    layoutViewports();  // Window may have been resized or split
+
     // Start ImGui Frame
+    m_profiler.begin(Profiler::Ui);
     ImGui_ImplOpenGL3_NewFrame();
     ImGui_ImplGlfw_NewFrame();
     ImGui::NewFrame();
@@ -301,13 +1103,30 @@ void Renderer::renderFrame() {
                 ImGui::Text("Appearance");
                 ImGui::SliderFloat("Point Size", &m_pointScale, 0.01f, 0.1f);
                 ImGui::SliderFloat("Alpha", &m_globalAlpha, 0.0f, 1.0f);
+                const char* transparencyModes[] = { "Instance order", "Order independent" };
+                ImGui::Combo("Transparency", &m_transparencyMode, transparencyModes, IM_ARRAYSIZE(transparencyModes));
                 
-                const char* colorConfig[] = { "Heatmap (Blue-Red)", "CoolWarm (Div)", "Viridis (Grayscale)" };
-                ImGui::Combo("Color Mode", &m_colorMode, colorConfig, IM_ARRAYSIZE(colorConfig));
+                const char* colorConfig[] = { "Heatmap (Blue-Red)", "CoolWarm (Div)", "Viridis (Grayscale)",
+                                              "Categorical (Labels)" };
+                if (ImGui::Combo("Color Mode", &m_colorMode, colorConfig, IM_ARRAYSIZE(colorConfig))) {
+                    recordColorMode(m_colorMode);  // As if set with setColorMode
+                }
+
+                const char* lodModes[] = { "Off", "Auto (dense regions)", "Density only" };
+                ImGui::Combo("Level of Detail", &m_lodMode, lodModes, IM_ARRAYSIZE(lodModes));
+                if (m_lodMode != 0) {
+                    ImGui::SliderFloat("Cell Threshold", &m_lodThreshold, 1.0f, 64.0f, "%.0f pts");
+                    ImGui::SliderFloat("Density Exposure", &m_lodExposure, 0.01f, 1.0f);
+                    if (m_lodMode == 1 && !lodActive()) {
+                        ImGui::TextDisabled("Inactive below %zu points", m_config.lodMinPoints);
+                    }
+                }
+                ImGui::Checkbox("Frustum Culling", &m_cullEnabled);
+                if (multiView()) ImGui::Checkbox("Link Viewport Cameras", &m_viewportsLinked);
                 
                 ImGui::Separator();
                 ImGui::Text("Time Series");
-                ImGui::SliderFloat("Time Morph", &m_morphTime, 0.0f, 1.0f);
+                renderTimelineControls();
 
                 // Dimension Labels
                 ImGui::Separator();
@@ -315,7 +1134,6 @@ void Renderer::renderFrame() {
                 
                 // Color Feature Selector (Phase 1)
                 {
-                    std::lock_guard<std::mutex> lock(m_dataMutex);
                     if (!m_featureNames.empty()) {
                         // Build combo items string
                         int prevIdx = m_selectedColorFeatureIdx;
@@ -331,6 +1149,7 @@ void Renderer::renderFrame() {
                         }
                         if (m_selectedColorFeatureIdx != prevIdx) {
                             m_colorFeatureChanged = true;
+                            m_uiDirty = true;
                         }
                     } else {
                         ImGui::BulletText("Color: %s", m_colorLabel.c_str());
@@ -354,71 +1173,34 @@ void Renderer::renderFrame() {
                     if (ImGui::Button("Clear Selection")) {
                         m_selectedIDs.clear();
                         m_selectedID = -1;
+                        m_uiDirty = true;
                     }
                 } else if (m_selectedID != -1) {
                     ImGui::Text("Selected ID: %d", m_selectedID);
                     // Show ticker label if available
-                    std::string ticker = getSelectedTicker();
+                    std::string ticker = selectedTicker();
                     if (!ticker.empty()) {
                         ImGui::Text("Ticker: %s", ticker.c_str());
                     }
                     // Show current value
                     {
-                        std::lock_guard<std::mutex> lock(m_dataMutex);
-                        if (m_selectedID < (int)m_stagedValues.size()) {
-                            float val = m_stagedValues[m_selectedID];
+                        size_t numValues = 0;
+                        const float* values = currentValues(numValues);
+                        if (m_selectedID < (int)numValues) {
+                            float val = values[m_selectedID];
                             ImGui::Text("Value: %.4f", val);
                         }
                     }
                 } else {
                     ImGui::Text("None (Shift+Drag to select area)");
                 }
+                ImGui::Checkbox("Include hidden points", &m_selectOccluded);
 
                 // Color Legend
                 ImGui::Separator();
                 ImGui::Text("Color Legend");
                 {
-                    ImVec2 legendSize(200, 20);
-                    ImVec2 pos = ImGui::GetCursorScreenPos();
-                    ImDrawList* drawList = ImGui::GetWindowDrawList();
-                    
-                    // Draw gradient bar
-                    int numSteps = 40;
-                    float stepWidth = legendSize.x / numSteps;
-                    for (int i = 0; i < numSteps; i++) {
-                        float t = (float)i / (numSteps - 1);
-                        float r, g, b;
-                        
-                        if (m_colorMode == 0) { // Heatmap
-                            getHeatMapColor(t, &r, &g, &b);
-                        } else if (m_colorMode == 1) { // CoolWarm
-                            getCoolWarmColor(t, &r, &g, &b);
-                        } else { // Grayscale
-                            r = g = b = t;
-                        }
-                        
-                        ImU32 col = IM_COL32((int)(r*255), (int)(g*255), (int)(b*255), 255);
-                        drawList->AddRectFilled(
-                            ImVec2(pos.x + i * stepWidth, pos.y),
-                            ImVec2(pos.x + (i + 1) * stepWidth, pos.y + legendSize.y),
-                            col
-                        );
-                    }
-                    
-                    // Draw color filter slider indicator (thin white bar)
-                    if (m_colorFilterEnabled) {
-                        float sliderX = pos.x + m_colorFilterValue * legendSize.x;
-                        drawList->AddLine(
-                            ImVec2(sliderX, pos.y - 5),
-                            ImVec2(sliderX, pos.y + legendSize.y + 5),
-                            IM_COL32(255, 255, 255, 255),
-                            3.0f
-                        );
-                    }
-                    
-                    // Move cursor past the legend
-                    ImGui::Dummy(legendSize);
-                    ImGui::Text("0.0                     1.0");
+                    renderColorLegend();
                     
                     // Color filter slider
                     ImGui::Checkbox("Color Filter", &m_colorFilterEnabled);
@@ -427,15 +1209,38 @@ void Renderer::renderFrame() {
                         ImGui::SliderFloat("Tolerance", &m_colorFilterTolerance, 0.01f, 0.2f, "±%.2f");
                     }
                 }
+
+                ImGui::Separator();
+                ImGui::Text("Range Filters");
+                renderRangeFilterControls();
                 
                 ImGui::EndTabItem();
             }
             
             if (ImGui::BeginTabItem("Statistics")) {
-                std::lock_guard<std::mutex> lock(m_dataMutex);
-                
                 // Point count
                 ImGui::Text("Points: %zu", m_renderCount);
+                if (m_cullActive) {
+                    ImGui::Text("Visible: %zu / %zu (%s cull)", m_culler.visibleCount(), m_renderCount,
+                                m_culler.gpu() ? "GPU" : "CPU");
+                }
+                if (instancesPacked()) {
+                    ImGui::Text("Instances: packed (%zu bytes per point and set)", sizeof(PackedInstance));
+                }
+                if (m_config.streamingUploads) {
+                    ImGui::Text("Uploads: %s (%llu producer stalls)",
+                                m_caps.bufferStorage ? "streaming, persistent ring" : "streaming, orphaning",
+                                (unsigned long long)(m_stream.stallCount() + m_nextStream.stallCount()));
+                }
+                {
+                    QueueStats q = getQueueStats();
+                    ImGui::Text("Commands: %llu (peak depth %zu/%zu, last drain %.2f ms)",
+                                (unsigned long long)q.submitted, q.maxDepth, kCommandQueueSize, q.lastDrainMs);
+                    if (q.stalls > 0) {
+                        ImGui::Text("Queue full: %llu times (%.1f ms waited)",
+                                    (unsigned long long)q.stalls, q.stallMs);
+                    }
+                }
                 
                 // PCA Explained Variance
                 if (!m_explainedVariance.empty()) {
@@ -466,9 +1271,12 @@ void Renderer::renderFrame() {
                         ImGui::TableSetupColumn("Median", ImGuiTableColumnFlags_WidthFixed, 60);
                         ImGui::TableHeadersRow();
                         
-                        for (const auto& s : m_statsData) {
+                        for (size_t i = 0; i < m_statsData.size(); i++) {
+                            const StatsData& s = m_statsData[i];
+                            std::string name = !s.name.empty() ? s.name
+                                : i < m_featureNames.size() ? m_featureNames[i] : "Feature " + std::to_string(i);
                             ImGui::TableNextRow();
-                            ImGui::TableNextColumn(); ImGui::Text("%s", s.name.c_str());
+                            ImGui::TableNextColumn(); ImGui::Text("%s", name.c_str());
                             ImGui::TableNextColumn(); ImGui::Text("%.2f", s.min);
                             ImGui::TableNextColumn(); ImGui::Text("%.2f", s.max);
                             ImGui::TableNextColumn(); ImGui::Text("%.2f", s.mean);
@@ -483,6 +1291,11 @@ void Renderer::renderFrame() {
                 ImGui::EndTabItem();
             }
             
+            if (ImGui::BeginTabItem("Performance")) {
+                renderPerformancePanel();
+                ImGui::EndTabItem();
+            }
+            
             if (ImGui::BeginTabItem("About")) {
                 ImGui::Text("QsPlot");
                 ImGui::Separator();
@@ -511,32 +1324,15 @@ void Renderer::renderFrame() {
     // ========================================
     // Hover Detection & Tooltip
     // ========================================
-    // Only detect hover if mouse is NOT over any UI window
-    if (!ImGui::IsWindowHovered(ImGuiHoveredFlags_AnyWindow)) {
-        ImGuiIO& io = ImGui::GetIO();
-        double mouseX = io.MousePos.x;
-        double mouseY = io.MousePos.y;
-        
-        // Get framebuffer size
-        int fbWidth, fbHeight;
-        glfwGetFramebufferSize(m_window, &fbWidth, &fbHeight);
-        
-        // Convert to framebuffer coordinates
-        int pixelX = (int)mouseX;
-        int pixelY = fbHeight - (int)mouseY;  // Flip Y (ImGui is top-left, OpenGL is bottom-left)
-        
-        // Read from picking FBO
-        if (pixelX >= 0 && pixelX < fbWidth && pixelY >= 0 && pixelY < fbHeight) {
-            glBindFramebuffer(GL_READ_FRAMEBUFFER, m_pickingFBO);
-            GLint pointID = -1;
-            glReadPixels(pixelX, pixelY, 1, 1, GL_RED_INTEGER, GL_INT, &pointID);
-            glBindFramebuffer(GL_READ_FRAMEBUFFER, 0);
-            
-            m_hoveredID = pointID;
-        } else {
-            m_hoveredID = -1;
-        }
-        
+    // Only detect hover if mouse is NOT over any UI window. The ID under the
+    // cursor comes from the async picking pipeline (issued after the scene pass).
+    m_hoverPickActive = !ImGui::IsWindowHovered(ImGuiHoveredFlags_AnyWindow);
+    {
+        auto timer = m_profiler.scope(Profiler::Picking);
+        processPickResults();
+    }
+
+    if (m_hoverPickActive) {
         // Show tooltip if hovering over a point
         if (m_hoveredID != -1) {
             ImGui::BeginTooltip();
@@ -544,7 +1340,6 @@ void Renderer::renderFrame() {
             
             // Show ticker if available
             {
-                std::lock_guard<std::mutex> lock(m_dataMutex);
                 if (m_hoveredID >= 0 && m_hoveredID < (int)m_tickers.size()) {
                     std::string ticker = m_tickers[m_hoveredID];
                     if (!ticker.empty()) {
@@ -555,22 +1350,25 @@ void Renderer::renderFrame() {
             
             // Show all feature values (Phase 1: Enhanced Tooltips)
             {
-                std::lock_guard<std::mutex> lock(m_dataMutex);
-                if (m_hoveredID >= 0 && m_numFeatures > 0 && 
-                    (size_t)m_hoveredID * m_numFeatures + m_numFeatures <= m_allFeatureValues.size()) {
+                if (m_hoveredID >= 0 && m_features && m_features->cols() > 0 &&
+                    (size_t)m_hoveredID < m_features->rows()) {
                     ImGui::Separator();
-                    size_t offset = (size_t)m_hoveredID * m_numFeatures;
-                    for (size_t f = 0; f < m_numFeatures; f++) {
+                    for (size_t f = 0; f < m_features->cols(); f++) {
                         const char* fname = (f < m_featureNames.size()) ? 
                             m_featureNames[f].c_str() : "Feature";
-                        ImGui::Text("%s: %.4f", fname, m_allFeatureValues[offset + f]);
+                        ImGui::Text("%s: %.4f", fname, m_features->value((size_t)m_hoveredID, f));
                     }
-                } else if (m_hoveredID >= 0 && m_hoveredID < (int)m_stagedValues.size()) {
+                } else {
                     // Fallback: show single value if no all-feature data
-                    float v1 = m_stagedValues[m_hoveredID];
-                    float v2 = (m_hoveredID < (int)m_stagedNextValues.size()) ? m_stagedNextValues[m_hoveredID] : v1;
-                    float val = v1 + (v2 - v1) * m_morphTime;
-                    ImGui::Text("Value: %.4f", val);
+                    size_t numValues = 0, numNext = 0;
+                    const float* values = currentValues(numValues);
+                    const float* next = nextValues(numNext);
+                    if (m_hoveredID >= 0 && m_hoveredID < (int)numValues) {
+                        float v1 = values[m_hoveredID];
+                        float v2 = (m_hoveredID < (int)numNext) ? next[m_hoveredID] : v1;
+                        float val = v1 + (v2 - v1) * m_morphTime;
+                        ImGui::Text("Value: %.4f", val);
+                    }
                 }
             }
             
@@ -580,6 +1378,8 @@ void Renderer::renderFrame() {
         m_hoveredID = -1;  // Clear hover when over UI
     }
 
+    renderViewportOverlay();
+
     // Draw rectangle selection overlay (Phase 2)
     if (m_rectSelecting) {
         ImDrawList* fgDraw = ImGui::GetForegroundDrawList();
@@ -590,6 +1390,7 @@ void Renderer::renderFrame() {
     }
 
     ImGui::Render();
+    m_profiler.end(Profiler::Ui);
 
     // Reset OpenGL State before rendering scene (ImGui modifies state)
     glEnable(GL_DEPTH_TEST);
@@ -598,93 +1399,165 @@ void Renderer::renderFrame() {
     glEnable(GL_BLEND);
     glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
 
+    // Visible set for the billboard and picking draws
+    {
+        auto timer = m_profiler.scope(Profiler::Culling, true);
+        updateCulling();
+    }
+
+    // Density LOD: accumulate before the scene, composite underneath the billboards
+    bool lod = m_camera && lodActive() && m_densityProgram;
+    updateColorMap();     // Palette or labels changed since the last frame
+    updateRangeFilter();  // Ranges or feature store changed
+    if (m_camera) updateFrameUniforms(lod);
+    if (lod) {
+        auto timer = m_profiler.scope(Profiler::Density, true);
+        renderDensityPass();
+    }
+
+    m_profiler.begin(Profiler::Scene, true);
+    glBindFramebuffer(GL_FRAMEBUFFER, m_sceneFBO);
     glClearColor(m_config.backgroundColor[0], m_config.backgroundColor[1], m_config.backgroundColor[2], 1.0f);
     glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
 
-    glUseProgram(m_shaderProgram);
+    if (lod) renderDensityComposite();
 
-    // Update Camera
+    // Billboards in aggregated cells are dropped in the vertex shader
     if (m_camera) {
-        Eigen::Matrix4f view = m_camera->getViewMatrix();
-        // Row 0 is Right, Row 1 is Up
-        Eigen::Vector3f right = m_camera->getRight();
-        Eigen::Vector3f up    = m_camera->getUp();
-
-        glUniform3fv(glGetUniformLocation(m_shaderProgram, "uCameraRight"), 1, right.data());
-        glUniform3fv(glGetUniformLocation(m_shaderProgram, "uCameraUp"), 1, up.data());
-
-        Eigen::Matrix4f vp = m_camera->getViewProjectionMatrix();
-        glUniformMatrix4fv(glGetUniformLocation(m_shaderProgram, "uVP"), 1, GL_FALSE, vp.data());
-        glUniform1f(glGetUniformLocation(m_shaderProgram, "uScale"), m_pointScale); 
-        glUniform1f(glGetUniformLocation(m_shaderProgram, "uAlpha"), m_globalAlpha);
-        glUniform1i(glGetUniformLocation(m_shaderProgram, "uColorMode"), m_colorMode);
-        glUniform1f(glGetUniformLocation(m_shaderProgram, "uTime"), m_morphTime);
-        glUniform1i(glGetUniformLocation(m_shaderProgram, "uSelectedID"), m_selectedID);
-        glUniform1i(glGetUniformLocation(m_shaderProgram, "uHasSelection"), (m_selectedID != -1));
-        
-        // Color filter uniforms
-        glUniform1i(glGetUniformLocation(m_shaderProgram, "uColorFilterEnabled"), m_colorFilterEnabled);
-        glUniform1f(glGetUniformLocation(m_shaderProgram, "uColorFilterValue"), m_colorFilterValue);
-        glUniform1f(glGetUniformLocation(m_shaderProgram, "uColorFilterTolerance"), m_colorFilterTolerance);
-        
-        // Compute Selected Color on CPU to solve shader issues
-        float selR = 0.0f, selG = 0.0f, selB = 0.0f;
+        glActiveTexture(GL_TEXTURE0);
+        glBindTexture(GL_TEXTURE_2D, lod ? m_densityTexture : 0);
+    }
 
-        {
-            std::lock_guard<std::mutex> lock(m_dataMutex);
-            if (m_selectedID >= 0 && m_selectedID < (int)m_stagedValues.size()) {
-                float v1 = m_stagedValues[m_selectedID];
-                // Check bounds for NextValues
-                float v2 = (m_selectedID < (int)m_stagedNextValues.size()) ? m_stagedNextValues[m_selectedID] : v1;
-                
-                // Calculate current interpolated value
-                float val = v1 + (v2 - v1) * m_morphTime; 
-                
-                // Map value to color
-                if (m_colorMode == 0) { // Heatmap
-                    getHeatMapColor(val, &selR, &selG, &selB);
-                } else if (m_colorMode == 1) { // CoolWarm
-                    getCoolWarmColor(val, &selR, &selG, &selB);
-                } else { // Direct Value (Viridis/Grayscale fallback -> White)
-                    float c = std::max(0.0f, std::min(1.0f, val));
-                    selR = c; selG = c; selB = c;
-                }
-            }
+    // Small multiples draw each viewport with its own camera; density-only mode draws no billboards at all
+    if (multiView()) {
+        renderViewports();
+    } else if (!(lod && m_lodMode == 2)) {
+        if (oitActive()) {
+            renderTransparentPoints();
+        } else {
+            GLuint program = pointProgram();
+            glUseProgram(program);
+            drawPoints(program);
         }
-        
-        glUniform3f(glGetUniformLocation(m_shaderProgram, "uSelectedColor"), selR, selG, selB);
     }
+    m_profiler.end(Profiler::Scene);
 
-    glBindVertexArray(m_validVAO);
-    glDrawArraysInstanced(GL_TRIANGLE_STRIP, 0, 4, (GLsizei)m_renderCount);
+    // Scissored ID passes for hover/click/brush, read back in a later frame
+    {
+        auto timer = m_profiler.scope(Profiler::Picking, true);
+        issuePickRequests();
+    }
+
+    // Render Gizmo on top of scene but behind UI (per viewport when split)
+    if (!multiView()) {
+        auto timer = m_profiler.scope(Profiler::Gizmo, true);
+        renderGizmo();
+    }
 
-    // Render Gizmo on top of scene but behind UI
-    renderGizmo();
+    // Exported frames are the scene alone; the window gets a copy before the UI
+    if (m_exportFrame) {
+        auto timer = m_profiler.scope(Profiler::Export, true);
+        finishExportFrame();
+    }
 
     // Render UI on top
-    ImGui_ImplOpenGL3_RenderDrawData(ImGui::GetDrawData());
+    if (!m_config.headless) {
+        auto timer = m_profiler.scope(Profiler::Ui, true);
+        ImGui_ImplOpenGL3_RenderDrawData(ImGui::GetDrawData());
+    }
+}
+
+// Sources are concatenated in order; the first one carries the #version line
+// (frameStateSource for render programs)
+static unsigned int compileShader(unsigned int type, std::initializer_list<const char*> sources) {
+    unsigned int shader = glCreateShader(type);
+    glShaderSource(shader, (GLsizei)sources.size(), sources.begin(), NULL);
+    glCompileShader(shader);
+
+    GLint ok = GL_FALSE;
+    glGetShaderiv(shader, GL_COMPILE_STATUS, &ok);
+    if (!ok) {
+        char log[1024];
+        glGetShaderInfoLog(shader, sizeof(log), NULL, log);
+        std::cerr << "[Shader] Compile error: " << log << std::endl;
+    }
+    return shader;
+}
+
+static unsigned int linkProgram(unsigned int program) {
+    glLinkProgram(program);
+
+    GLint ok = GL_FALSE;
+    glGetProgramiv(program, GL_LINK_STATUS, &ok);
+    if (!ok) {
+        char log[1024];
+        glGetProgramInfoLog(program, sizeof(log), NULL, log);
+        std::cerr << "[Shader] Link error: " << log << std::endl;
+        glDeleteProgram(program);
+        return 0;
+    }
+    return program;
+}
+
+unsigned int Renderer::buildProgram(const char* vertexSource, const char* fragmentSource) {
+    return buildPointProgram(vertexSource, nullptr, fragmentSource);
+}
+
+unsigned int Renderer::buildPointProgram(const char* fetchSource, const char* vertexBody, const char* fragmentSource,
+                                         const char* outputSource) {
+    unsigned int vs = vertexBody ? compileShader(GL_VERTEX_SHADER, { frameStateSource, rangeFilterSource, fetchSource,
+                                                                      vertexBody })
+                                 : compileShader(GL_VERTEX_SHADER, { frameStateSource, rangeFilterSource, fetchSource });
+    unsigned int fs = outputSource ? compileShader(GL_FRAGMENT_SHADER, { frameStateSource, outputSource, fragmentSource })
+                                   : compileShader(GL_FRAGMENT_SHADER, { frameStateSource, fragmentSource });
+
+    unsigned int program = glCreateProgram();
+    glAttachShader(program, vs);
+    glAttachShader(program, fs);
+    program = linkProgram(program);
+
+    glDeleteShader(vs);
+    glDeleteShader(fs);
+    if (program) {
+        // Unused members may be optimized out, the block itself never is
+        glUniformBlockBinding(program, glGetUniformBlockIndex(program, "FrameState"), kFrameStateBinding);
+    }
+    return program;
+}
+
+unsigned int Renderer::buildComputeProgram(const char* computeSource) {
+    unsigned int cs = compileShader(GL_COMPUTE_SHADER, { computeSource });
+
+    unsigned int program = glCreateProgram();
+    glAttachShader(program, cs);
+    program = linkProgram(program);
+
+    glDeleteShader(cs);
+    return program;
 }
 
 void Renderer::initGL() {
+    m_caps.bufferStorage = GLAD_GL_VERSION_4_4 != 0;
+    m_caps.computeShaders = GLAD_GL_VERSION_4_3 != 0;
+
     glEnable(GL_DEPTH_TEST);
     glEnable(GL_BLEND);
     glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA); 
 
-    unsigned int vertexShader = glCreateShader(GL_VERTEX_SHADER);
-    glShaderSource(vertexShader, 1, &vertexShaderSource, NULL);
-    glCompileShader(vertexShader);
-    
-    unsigned int fragmentShader = glCreateShader(GL_FRAGMENT_SHADER);
-    glShaderSource(fragmentShader, 1, &fragmentShaderSource, NULL);
-    glCompileShader(fragmentShader);
-
-    m_shaderProgram = glCreateProgram();
-    glAttachShader(m_shaderProgram, vertexShader);
-    glAttachShader(m_shaderProgram, fragmentShader);
-    glLinkProgram(m_shaderProgram);
-    
-    glDeleteShader(vertexShader);
-    glDeleteShader(fragmentShader);
+    // Per-frame state of every render program, rewritten once per frame: the
+    // frame's slice and one per viewport, each at a bindable offset
+    GLint uboAlignment = 256;
+    glGetIntegerv(GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT, &uboAlignment);
+    size_t alignment = std::max<size_t>(1, (size_t)uboAlignment);
+    m_frameSliceStride = (sizeof(FrameUniforms) + alignment - 1) / alignment * alignment;
+    glGenBuffers(1, &m_frameUBO);
+    glBindBuffer(GL_UNIFORM_BUFFER, m_frameUBO);
+    glBufferData(GL_UNIFORM_BUFFER, (GLsizeiptr)((1 + kMaxViewports) * m_frameSliceStride), nullptr,
+                 GL_DYNAMIC_DRAW);
+    glBindBuffer(GL_UNIFORM_BUFFER, 0);
+
+    m_shaderProgram = buildPointProgram(instanceAttributeFetchSource, vertexShaderSource, fragmentShaderSource,
+                                        blendedOutputSource);
 
     float quadVertices[] = { -0.5f, 0.5f, 0.0f, -0.5f, -0.5f, 0.0f, 0.5f, 0.5f, 0.0f, 0.5f, -0.5f, 0.0f };
 
@@ -730,40 +1603,85 @@ void Renderer::initGL() {
 
     // Init Picking FBO
     initPickingFBO(1280, 720);
+    m_pickReadback.init();
 
     // Compile Picking Shaders
-    unsigned int pickVS = glCreateShader(GL_VERTEX_SHADER);
-    glShaderSource(pickVS, 1, &pickingVertexShaderSource, NULL);
-    glCompileShader(pickVS);
-    
-    unsigned int pickFS = glCreateShader(GL_FRAGMENT_SHADER);
-    glShaderSource(pickFS, 1, &pickingFragmentShaderSource, NULL);
-    glCompileShader(pickFS);
-
-    m_pickingShaderProgram = glCreateProgram();
-    glAttachShader(m_pickingShaderProgram, pickVS);
-    glAttachShader(m_pickingShaderProgram, pickFS);
-    glLinkProgram(m_pickingShaderProgram);
-
-    glDeleteShader(pickVS);
-    glDeleteShader(pickFS);
+    m_pickingShaderProgram = buildPointProgram(instanceAttributeFetchSource, pickingVertexShaderSource,
+                                               pickingFragmentShaderSource);
+
+    // Delta update scatter pass (compute shaders are GL 4.3+)
+    if (m_caps.computeShaders) {
+        m_scatterProgram = buildComputeProgram(scatterComputeShaderSource);
+        m_scatterPatchCountLoc = glGetUniformLocation(m_scatterProgram, "uPatchCount");
+        glGenBuffers(1, &m_scatterBuffer);
+        m_selectionProgram = buildComputeProgram(selectionComputeShaderSource);
+        m_cullProgram = buildComputeProgram(cullComputeShaderSource);
+        m_rangeProgram = buildComputeProgram(rangeComputeShaderSource);
+    }
+    m_selection.init(m_selectionProgram);  // CPU fallback when 0
+
+    // Culled draws fetch instances by index from buffer textures
+    const std::string culledFetch = std::string(instanceIndexAttributeSource) + instanceBufferFetchSource;
+    m_culledShaderProgram = buildPointProgram(culledFetch.c_str(), vertexShaderSource, fragmentShaderSource,
+                                              blendedOutputSource);
+    m_culledPickingProgram = buildPointProgram(culledFetch.c_str(), pickingVertexShaderSource,
+                                               pickingFragmentShaderSource);
+
+    // Order-independent transparency (targets are sized on first use)
+    m_oitProgram = buildPointProgram(instanceAttributeFetchSource, vertexShaderSource, fragmentShaderSource,
+                                     oitOutputSource);
+    m_culledOitProgram = buildPointProgram(culledFetch.c_str(), vertexShaderSource, fragmentShaderSource,
+                                           oitOutputSource);
+
+    // Vertex pulling: the same buffer fetch, indexed by the vertex ID
+    if (m_config.vertexPulling) {
+        const std::string pulledFetch = std::string(instanceIndexPulledSource) + instanceBufferFetchSource;
+        m_pulledShaderProgram = buildPointProgram(pulledFetch.c_str(), vertexShaderSource, fragmentShaderSource,
+                                                  blendedOutputSource);
+        m_pulledPickingProgram = buildPointProgram(pulledFetch.c_str(), pickingVertexShaderSource,
+                                                   pickingFragmentShaderSource);
+        m_pulledOitProgram = buildPointProgram(pulledFetch.c_str(), vertexShaderSource, fragmentShaderSource,
+                                               oitOutputSource);
+        glGenVertexArrays(1, &m_pulledVAO);  // No attributes, but core profiles draw with a VAO bound
+    }
+    m_oitCompositeProgram = buildProgram(densityCompositeVertexShaderSource, oitCompositeFragmentShaderSource);
+    initCulling();
+
+    // Density LOD (target is sized on first use)
+    m_densityProgram = buildPointProgram(instanceAttributeFetchSource, densityVertexShaderSource,
+                                         densityFragmentShaderSource);
+    m_densityCompositeProgram = buildProgram(densityCompositeVertexShaderSource, densityCompositeFragmentShaderSource);
+    glGenVertexArrays(1, &m_fullscreenVAO);
+
+    // The density texture is always read from unit 0
+    for (unsigned int program : { m_shaderProgram, m_culledShaderProgram, m_oitProgram, m_culledOitProgram,
+                                  m_pulledShaderProgram, m_pulledOitProgram, m_densityCompositeProgram }) {
+        if (!program) continue;
+        glUseProgram(program);
+        glUniform1i(glGetUniformLocation(program, "uDensity"), 0);
+    }
+    if (m_oitCompositeProgram) {
+        glUseProgram(m_oitCompositeProgram);
+        glUniform1i(glGetUniformLocation(m_oitCompositeProgram, "uAccum"), 0);
+        glUniform1i(glGetUniformLocation(m_oitCompositeProgram, "uRevealage"), 1);
+    }
+    glUseProgram(0);
+    initColorMap();
+    initRangeFilter();
 
     // ---------------------------
     // Gizmo Initialization
     // ---------------------------
     const char* gizmoVert = R"(
-        #version 410 core
         layout(location = 0) in vec3 aPos;
         layout(location = 1) in vec3 aColor;
         out vec3 vColor;
-        uniform mat4 uVP;
         void main() {
             vColor = aColor;
             gl_Position = uVP * vec4(aPos, 1.0);
         }
     )";
     const char* gizmoFrag = R"(
-        #version 410 core
         in vec3 vColor;
         out vec4 FragColor;
         void main() {
@@ -771,21 +1689,7 @@ void Renderer::initGL() {
         }
     )";
 
-    unsigned int gVS = glCreateShader(GL_VERTEX_SHADER);
-    glShaderSource(gVS, 1, &gizmoVert, NULL);
-    glCompileShader(gVS);
-
-    unsigned int gFS = glCreateShader(GL_FRAGMENT_SHADER);
-    glShaderSource(gFS, 1, &gizmoFrag, NULL);
-    glCompileShader(gFS);
-
-    m_gizmoShaderProgram = glCreateProgram();
-    glAttachShader(m_gizmoShaderProgram, gVS);
-    glAttachShader(m_gizmoShaderProgram, gFS);
-    glLinkProgram(m_gizmoShaderProgram);
-    
-    glDeleteShader(gVS); 
-    glDeleteShader(gFS);
+    m_gizmoShaderProgram = buildProgram(gizmoVert, gizmoFrag);
 
     // Axes Data (X=Red, Y=Green, Z=Blue) Length 10
     float axes[] = {
@@ -826,6 +1730,7 @@ void Renderer::mouse_button_callback(GLFWwindow* window, int button, int action,
 
     Renderer* self = static_cast<Renderer*>(glfwGetWindowUserPointer(window));
     if (!self) return;
+    self->requestRedraw();
 
     // Skip if mouse is on ImGui (e.g. menu, slider)
     if (ImGui::GetIO().WantCaptureMouse) return; 
@@ -835,6 +1740,7 @@ void Renderer::mouse_button_callback(GLFWwindow* window, int button, int action,
         
         double x, y;
         glfwGetCursorPos(window, &x, &y);
+        self->activateViewportAt(x, y);
         
         // Store click start position for click-vs-drag detection
         self->m_clickStartX = x;
@@ -867,10 +1773,13 @@ void Renderer::mouse_button_callback(GLFWwindow* window, int button, int action,
             double rdx = std::abs(x - self->m_rectStartX);
             double rdy = std::abs(y - self->m_rectStartY);
             if (rdx > 5 && rdy > 5) {
-                auto ids = self->getPickedIDsInRect(
-                    self->m_rectStartX, self->m_rectStartY, x, y);
-                self->m_selectedIDs = ids;
-                self->m_selectedID = ids.empty() ? -1 : ids[0];
+                // Brush polygon in framebuffer pixels; the selection lands a frame or two later
+                int ax, ay, bx, by;
+                self->windowToFramebuffer(std::min(self->m_rectStartX, x), std::max(self->m_rectStartY, y), ax, ay);
+                self->windowToFramebuffer(std::max(self->m_rectStartX, x), std::min(self->m_rectStartY, y), bx, by);
+                float x0 = (float)ax, y0 = (float)ay, x1 = (float)bx + 1.0f, y1 = (float)by + 1.0f;
+                self->m_pendingBrush = { x0, y0, x1, y0, x1, y1, x0, y1 };
+                self->m_rectPending = true;
             }
         } else {
             // Calculate distance from click start
@@ -881,12 +1790,9 @@ void Renderer::mouse_button_callback(GLFWwindow* window, int button, int action,
             // Only select if mouse didn't move much (click, not drag)
             const double CLICK_THRESHOLD = 5.0; // pixels
             if (distance < CLICK_THRESHOLD) {
-                // This is a click, do picking
-                int picked = self->getPickedID(x, y);
-                
-                if (picked != -1) {
-                    self->m_selectedID = picked;
-                    self->m_selectedIDs.clear();  // Single select clears multi-select
+                // This is a click, queue a pick (resolved a frame or two later)
+                if (self->windowToFramebuffer(x, y, self->m_clickPixelX, self->m_clickPixelY)) {
+                    self->m_clickPending = true;
                 }
             }
         }
@@ -903,6 +1809,7 @@ void Renderer::cursor_position_callback(GLFWwindow* window, double xpos, double
 
     Renderer* self = static_cast<Renderer*>(glfwGetWindowUserPointer(window));
     if (!self || !self->m_camera) return;
+    self->requestRedraw();  // Camera, hover and UI may all follow the cursor
 
     double deltaX = xpos - self->m_lastX;
     double deltaY = ypos - self->m_lastY;
@@ -920,7 +1827,7 @@ void Renderer::cursor_position_callback(GLFWwindow* window, double xpos, double
             self->m_rectEndY = ypos;
         } else {
             float sens = 0.005f;
-            self->m_camera->orbit((float)deltaX * sens, (float)deltaY * sens);
+            self->orbitCameras((float)deltaX * sens, (float)deltaY * sens);
         }
     }
     
@@ -928,7 +1835,9 @@ void Renderer::cursor_position_callback(GLFWwindow* window, double xpos, double
         float sens = 0.05f;
         // self->m_camera->zoom((float)deltaY * sens); 
         // Right click PAN or ZOOM based on user pref. Let's stick to zoom for now to match prev behavior
-        self->m_camera->zoom((float)deltaY * sens);
+        self->zoomCameras((float)deltaY * sens);
+    } else if (!self->m_mouseLeftDown) {
+        self->activateViewportAt(xpos, ypos);  // Input follows the cursor between drags
     }
 }
 
@@ -938,11 +1847,12 @@ void Renderer::scroll_callback(GLFWwindow* window, double xoffset, double yoffse
 
     Renderer* self = static_cast<Renderer*>(glfwGetWindowUserPointer(window));
     if (!self || !self->m_camera) return;
+    self->requestRedraw();
 
     if (ImGui::GetIO().WantCaptureMouse) return;
 
     float sens = 0.5f;
-    self->m_camera->zoom((float)yoffset * sens);
+    self->zoomCameras((float)yoffset * sens);
 }
 
 void Renderer::framebuffer_size_callback(GLFWwindow* window, int width, int height) {
@@ -951,15 +1861,20 @@ void Renderer::framebuffer_size_callback(GLFWwindow* window, int width, int heig
         self->m_camera->setAspect(width, height);
         self->initPickingFBO(width, height); 
     }
+    if (self) self->requestRedraw();
     glViewport(0, 0, width, height);
 }
 
+void Renderer::window_refresh_callback(GLFWwindow* window) {
+    // Exposed or damaged by the window system
+    Renderer* self = static_cast<Renderer*>(glfwGetWindowUserPointer(window));
+    if (self) self->requestRedraw();
+}
+
 void Renderer::renderGizmo() {
     if (m_camera) {
         glUseProgram(m_gizmoShaderProgram);
-        Eigen::Matrix4f vp = m_camera->getViewProjectionMatrix();
-        glUniformMatrix4fv(glGetUniformLocation(m_gizmoShaderProgram, "uVP"), 1, GL_FALSE, vp.data());
-        
+
         // Draw thicker lines for better visibility
         glLineWidth(2.0f);
         glBindVertexArray(m_gizmoVAO);
@@ -968,49 +1883,40 @@ void Renderer::renderGizmo() {
     }
 }
 
-void Renderer::saveScreenshot(const std::string& path) {
-    std::lock_guard<std::mutex> lock(m_dataMutex);
-    m_screenshotPath = path;
-    m_screenshotRequested = true;
-}
-
-void Renderer::processScreenshotRequest() {
-    if (!m_screenshotRequested) return;
-    
-    int width, height;
-    glfwGetFramebufferSize(m_window, &width, &height);
-    
-    // Allocate buffer for pixel data (RGB)
-    std::vector<unsigned char> pixels(width * height * 3);
-    
-    // Read pixels from framebuffer
-    glReadPixels(0, 0, width, height, GL_RGB, GL_UNSIGNED_BYTE, pixels.data());
-    
-    // Flip vertically (OpenGL origin is bottom-left)
-    std::vector<unsigned char> flipped(width * height * 3);
-    for (int y = 0; y < height; y++) {
-        memcpy(
-            flipped.data() + y * width * 3,
-            pixels.data() + (height - 1 - y) * width * 3,
-            width * 3
-        );
-    }
-    
-    // Write to file as simple PPM format (portable, no external deps)
-    std::string path;
-    {
-        std::lock_guard<std::mutex> lock(m_dataMutex);
-        path = m_screenshotPath;
-        m_screenshotRequested = false;
+void Renderer::renderPerformancePanel() {
+    const Profiler::History& frames = m_profiler.cpuHistory(Profiler::Frame);
+    if (frames.count() > 0) {
+        ImGui::PlotLines("##FrameTimes", frames.data(), frames.count(), frames.offset(),
+                         "Frame time (ms)", FLT_MAX, FLT_MAX, ImVec2(-1, 60));
     }
-    
-    FILE* fp = fopen(path.c_str(), "wb");
-    if (fp) {
-        fprintf(fp, "P6\n%d %d\n255\n", width, height);
-        fwrite(flipped.data(), 1, flipped.size(), fp);
-        fclose(fp);
-        printf("[Screenshot] Saved to: %s\n", path.c_str());
-    } else {
-        printf("[Screenshot] ERROR: Could not write to: %s\n", path.c_str());
+
+    bool gpu = m_profiler.gpuEnabled();
+    if (ImGui::Checkbox("GPU timers", &gpu)) m_profiler.setGpuEnabled(gpu);
+
+    if (ImGui::BeginTable("PerfTable", 5, ImGuiTableFlags_Borders | ImGuiTableFlags_RowBg)) {
+        ImGui::TableSetupColumn("Section", ImGuiTableColumnFlags_WidthFixed, 80);
+        ImGui::TableSetupColumn("CPU p50", ImGuiTableColumnFlags_WidthFixed, 60);
+        ImGui::TableSetupColumn("CPU p99", ImGuiTableColumnFlags_WidthFixed, 60);
+        ImGui::TableSetupColumn("GPU p50", ImGuiTableColumnFlags_WidthFixed, 60);
+        ImGui::TableSetupColumn("GPU p99", ImGuiTableColumnFlags_WidthFixed, 60);
+        ImGui::TableHeadersRow();
+
+        for (const auto& s : m_profiler.summarize()) {
+            if (s.cpu.samples == 0 && s.gpu.samples == 0) continue;  // Pass not used
+            ImGui::TableNextRow();
+            ImGui::TableNextColumn(); ImGui::Text("%s", s.name);
+            ImGui::TableNextColumn(); ImGui::Text("%.2f", s.cpu.p50);
+            ImGui::TableNextColumn(); ImGui::Text("%.2f", s.cpu.p99);
+            if (s.gpu.samples > 0) {
+                ImGui::TableNextColumn(); ImGui::Text("%.2f", s.gpu.p50);
+                ImGui::TableNextColumn(); ImGui::Text("%.2f", s.gpu.p99);
+            } else {
+                ImGui::TableNextColumn(); ImGui::TextDisabled("-");
+                ImGui::TableNextColumn(); ImGui::TextDisabled("-");
+            }
+        }
+        ImGui::EndTable();
     }
+    ImGui::TextDisabled("Milliseconds over the last %d frames. CPU times include nested sections.",
+                        Profiler::kHistory);
 }
@@ -2,14 +2,36 @@
 
 #include <vector>
 #include <string>
-#include <mutex>
 #include <thread>
 #include <atomic>
+#include <memory>
+#include <functional>
+#include <cstdint>
+#include <deque>
+#include <mutex>
 
 #include "RendererConfig.h"
+#include "InstanceStream.h"
+#include "CommandQueue.h"
+#include "AsyncReadback.h"
+#include "SelectionEngine.h"
+#include "FrustumCuller.h"
+#include "InstancePacking.h"
+#include "FrameExporter.h"
+#include "Profiler.h"
+#include "ColorMap.h"
+#include "RangeFilter.h"
 
 // Forward declarations to avoid heavy includes in header
 struct GLFWwindow;
+class Camera;
+class FeatureStore;
+class QspFile;
+class SpatialIndex;
+class MiniBatchKMeans;
+class SessionWriter;
+struct FrameUniforms;
+enum class SessionKind : uint8_t;
 
 class Renderer {
 public:
@@ -30,6 +52,16 @@ public:
     // Set the target state for morphing
     void setTargetPoints(const float* positions, const float* values, size_t count);
 
+    // Sparse update: patch `count` points (indices into the current point set)
+    // with new positions (count x 3) and values. Only the changed ranges are
+    // re-uploaded. Returns false (and applies nothing) if an index is out of range.
+    bool updatePoints(const int* indices, const float* positions, const float* values, size_t count);
+    bool updateTargetPoints(const int* indices, const float* positions, const float* values, size_t count);
+
+    // Completes once the render thread has applied and uploaded everything
+    // submitted before this call. Producer calls may come from several threads.
+    std::shared_ptr<Completion> fence();
+
     // Bypasses PCA/Scaling in DataProcessor. Assumes input is already normalized to reasonable range (e.g. -10 to 10)
     void setPointsRaw(const float* positions, const float* values, size_t count);
 
@@ -40,12 +72,12 @@ public:
     std::string getSelectedTicker() const;
 
     // Get selected ID
-    int getSelectedID() const { return m_selectedID; }
+    int getSelectedID() const;
 
     // Get/Set configuration
     const RendererConfig& getConfig() const { return m_config; }
 
-    // Request a screenshot to be saved
+    // Request a screenshot to be saved (the scene without UI, see renderFrames)
     void saveScreenshot(const std::string& path);
 
     // Set dimension labels for UI display
@@ -54,6 +86,66 @@ public:
                             const std::string& yLabel, 
                             const std::string& zLabel);
 
+    // --- Color Modes ---
+    // 0: Heatmap, 1: CoolWarm, 2: Grayscale, 3: Categorical (labels of setCategories)
+    void setColorMode(int mode);
+    // One uint8 label per point, in point order (e.g. cluster ids), copied.
+    // names[k] is shown for category k in the legend. Switching between
+    // palettes and modes afterwards only rewrites the color LUT texture.
+    void setCategories(const uint8_t* labels, size_t count, const std::vector<std::string>& names = {});
+    // Categories computed natively as new data arrives, with no round trip
+    // through Python. Clusters: mini-batch k-means over every feature store
+    // passed to setFeatureStore, warm-started from the previous store's
+    // centroids so cluster k stays the same group from frame to frame.
+    // Outliers: the `contamination` share of each point set passed to
+    // setPoints that lies furthest from its `neighbors` nearest points.
+    // Both run on the calling thread and replace the labels of setCategories.
+    struct AutoCategories {
+        enum Mode { Off = 0, Clusters, Outliers };
+        Mode mode = Off;
+        int clusters = 5;              // At most 256 (uint8 labels)
+        float contamination = 0.05f;
+        size_t neighbors = 10;
+    };
+    // Takes effect with the next feature store or point set
+    void setAutoCategories(const AutoCategories& settings);
+
+    // --- Viewports (small multiples) ---
+    // Splits the window into a grid of `count` viewports (at most kMaxViewports)
+    // drawn from the same GPU point data in one frame; 0 restores the single
+    // view. Each viewport has its own camera and, optionally, a subset of the
+    // points and a value range. Hover, clicks and brushes act on the viewport
+    // under the cursor. Calls naming a viewport that does not exist are ignored.
+    void setViewportCount(size_t count);
+    // Point indices drawn in a viewport, copied (empty: every point)
+    void setViewportSubset(size_t viewport, const uint32_t* indices, size_t count);
+    // Only points whose color value lies in [minValue, maxValue] are drawn
+    void setViewportFilter(size_t viewport, bool enabled, float minValue, float maxValue);
+    void setViewportLabel(size_t viewport, const std::string& label);
+    void setViewportCamera(size_t viewport, float yaw, float pitch, float distance);  // Radians, world units
+    // Linked (default): orbit and zoom move every viewport's camera together
+    void setViewportsLinked(bool linked);
+
+    // --- Range Filters ---
+    // Replaces the range filters: a point is drawn, picked and brushed only if
+    // its feature value lies in [min, max] for every range (at most
+    // RangeFilter::kMaxRanges, on columns of the FeatureStore). The columns are
+    // kept on the GPU and follow the feature store as it changes.
+    void setRangeFilters(const std::vector<RangeFilter::Range>& ranges);
+    void clearRangeFilters() { setRangeFilters({}); }
+    // Points passing every range, -1 without filters; updated a frame or two after a change
+    long long getFilteredCount() const;
+    // Replaces the selection (getSelectedIDs) with the passing points once they are known
+    void selectFiltered();
+
+    // --- Spatial Queries ---
+    // Answered from a grid over the points as drawn (morph and keyframe
+    // interpolation applied, see SpatialIndex), rebuilt on all cores the first
+    // time it is needed after the points changed; the call waits for that.
+    // Results are nearest first. Points without a position are never returned.
+    std::vector<int> queryKnn(int id, size_t k);  // Without id itself; empty if id is not drawn
+    std::vector<int> queryRadius(const float* point, float radius);  // point: x, y, z
+
     // --- Phase 1: Feature Switching ---
     void setFeatureNames(const std::vector<std::string>& names);
     int getSelectedColorFeatureIndex() const;
@@ -61,7 +153,7 @@ public:
 
     // --- Phase 1: Stats Panel ---
     struct StatsData {
-        std::string name;
+        std::string name;  // Empty: use the feature name of this column
         float min, max, mean, std, median;
         int count;
     };
@@ -69,8 +161,11 @@ public:
     void setExplainedVariance(const std::vector<float>& variance);
 
     // --- Phase 1: Enhanced Tooltips ---
-    // All feature values for all points (N x F flattened, row-major)
+    // All feature values for all points (N x F flattened, row-major), copied
     void setAllFeatureValues(const float* values, size_t numPoints, size_t numFeatures);
+    // Shared N x F matrix for tooltips and the Statistics tab, not copied. Its column
+    // statistics are computed on the calling thread and replace those of setStats.
+    void setFeatureStore(std::shared_ptr<const FeatureStore> store);
 
     // --- Phase 2: Rectangle Brush Selection ---
     std::vector<int> getSelectedIDs() const;
@@ -79,24 +174,205 @@ public:
     // Check if the engine is running
     bool isRunning() const { return m_running; }
 
+    // --- Keyframe Timeline ---
+    // A window of `window` keyframes (pointCount points each) lives on the GPU
+    // at once; playback interpolates between neighbouring frames without any
+    // upload. Frame f is stored in slot f % window, so a prefetcher can stream
+    // a long range in ahead of the playhead. While a timeline is set it
+    // replaces the current/target point sets.
+    void setTimeline(size_t frameCount, size_t pointCount, size_t window);
+    void clearTimeline();
+    // positions: pointCount x 3, values: pointCount. NaN positions are not drawn
+    // (points absent from a frame). Returns false if frame or size don't match.
+    bool setKeyframe(size_t frame, const float* positions, const float* values, size_t count);
+    // Marks every held keyframe outdated (e.g. recolored): the frames on screen
+    // stay drawn, but playback waits for each to be set again before it moves
+    // onto it. No effect on a dataset timeline.
+    void invalidateKeyframes();
+    // Timeline over a mapped .qsp file (see QspFile.h): the render thread pages
+    // keyframes from the mapping into the slots, nearest the playhead first, so
+    // no Python prefetcher is needed and setKeyframe is rejected. Tickers and
+    // feature names come from the file, the tooltip shows the drawn frame's
+    // features and the Statistics tab those of the first frame.
+    void loadDataset(std::shared_ptr<const QspFile> dataset, size_t window);
+    void setTimelinePlayback(bool playing, float framesPerSecond, bool loop);
+    void seekTimeline(float position);
+    float getTimelinePosition() const;  // Playhead in frames
+
+    // --- Offscreen Export ---
+    // Each request is drawn into an offscreen target of the framebuffer size
+    // (scene only, no UI), read back through PBOs and encoded on a worker pool.
+    // Requests are queued like any setter, so they see every earlier upload.
+    struct FrameRequest {
+        std::string path;             // .png or .ppm; unused when piping
+        float morphTime = -1.0f;      // < 0 keeps the current value
+        float timelinePosition = -1.0f;  // Playhead in frames (pauses playback), < 0 keeps it
+        bool setCamera = false;
+        float yaw = 0.0f, pitch = 0.0f, distance = 25.0f;  // Radians, world units
+    };
+    // pipeCommand: if set, every frame of the batch goes to this command's stdin
+    // as raw RGB24 instead of a file. Returns false if it could not be started.
+    bool renderFrames(std::vector<FrameRequest> frames, const std::string& pipeCommand = "");
+    // Block until every requested frame is written. timeoutSeconds < 0 waits forever.
+    // Returns false on timeout or when the render thread is not running.
+    bool waitForFrames(double timeoutSeconds = -1.0) const;
+    struct ExportStats {
+        uint64_t requested;
+        uint64_t finished;  // Written or failed
+        uint64_t failed;
+    };
+    ExportStats getExportStats() const;
+
+    // --- Command Queue ---
+    // All setters are forwarded to the render thread through a lock-free queue
+    // that is drained once at frame start.
+    struct QueueStats {
+        size_t depth;         // Commands waiting for the render thread
+        size_t maxDepth;      // High-water mark since start
+        uint64_t submitted;   // Total commands submitted
+        uint64_t stalls;      // Times the producer found the queue full
+        double stallMs;       // Total time the producer spent waiting
+        double lastDrainMs;   // Render-thread time spent applying the last batch
+    };
+    QueueStats getQueueStats() const;
+
+    // --- Profiling ---
+    // Per-pass CPU and GPU timings over the last frames, republished a few
+    // times per second. Null until the render thread has drawn for a while.
+    std::shared_ptr<const Profiler::Snapshot> getPerfStats() const { return m_profiler.snapshot(); }
+
+    // --- Session Recording ---
+    // Logs every point set, patch, metadata setter (stats and range filters
+    // included), viewport setter and camera move (mouse or orbitCamera/
+    // zoomCamera/setViewportCamera) made after the call, plus color mode and
+    // range filter changes made in the UI, to a compressed, append-only .qsr
+    // file (see SessionLog.h). Producers only copy the payload; a writer
+    // thread encodes and appends it. Feature matrices (setAllFeatureValues/
+    // setFeatureStore) are large and only logged when `features` is set.
+    // Not logged: the keyframe timeline and datasets, auto categories,
+    // selections and the other UI controls. Replaces a recording in progress.
+    // Returns false if the file could not be created.
+    bool startRecording(const std::string& path, bool features = false);
+    void stopRecording();  // Writes everything queued and closes the file
+    struct RecordingStats {
+        bool active;
+        std::string path;          // Of the current or last recording
+        uint64_t records;
+        uint64_t bytes;            // Payload bytes
+        uint64_t storedBytes;      // On disk
+        uint64_t queuedBytes;      // Not yet written
+        bool failed;               // An I/O error stopped the recording
+    };
+    RecordingStats getRecordingStats() const;
+    // Feeds a recording back through the setters on the calling thread, at
+    // `speed` times the original pace (<= 0: as fast as the queue takes it).
+    // Returns the records applied, or -1 if the file is not a session log.
+    // Returns early after stopReplay() or when the render thread stops.
+    // Nothing is recorded while a replay runs, so replaying into a recording
+    // renderer does not log the session a second time.
+    long long replay(const std::string& path, double speed = 1.0);
+    void stopReplay();
+    // Camera moves as the mouse makes them: the active viewport's camera, or
+    // every camera while the viewports are linked
+    void orbitCamera(float deltaX, float deltaY);  // Radians
+    void zoomCamera(float delta);
+
 private:
     void loop(); 
     void initGL();
     void renderFrame();
     void renderGizmo(); // Render Axes
 
+    Profiler m_profiler;
+    void renderPerformancePanel();
+
+    // Point attribute locations 1/2 (current) or 3/4 (next) at the given buffers
+    void bindInstanceAttributes(bool next, unsigned int posBuffer, size_t posOffset,
+                                unsigned int valBuffer, size_t valOffset);
+    // Same locations at the staged VBOs, float or packed
+    void bindStagedAttributes(bool next);
+    // Values of the source currently bound for drawing (staged or streamed).
+    // Render thread only.
+    const float* currentValues(size_t& count) const;
+    const float* nextValues(size_t& count) const;
+    const float* currentPositions(size_t& count) const;
+    const float* nextPositions(size_t& count) const;
+    InstanceSource currentSource() const;  // Positions as drawn this frame
+    InstanceSource nextSource() const;
+
+    // Delta updates: coalesce dirty indices into glBufferSubData ranges, or
+    // scatter them with a compute shader when the dirty set is large
+    void uploadDirtyPoints(std::vector<unsigned int>& dirty, unsigned int posVBO, unsigned int valVBO,
+                           const std::vector<float>& positions, const std::vector<float>& values);
+
+    // Shader helpers (log compile/link errors, return 0 on failure)
+    static unsigned int buildProgram(const char* vertexSource, const char* fragmentSource);
+    // Point programs: instance fetch prelude (attributes or buffer textures) + vertex body
+    // and an optional fragment output prelude (blended or OIT)
+    static unsigned int buildPointProgram(const char* fetchSource, const char* vertexBody,
+                                          const char* fragmentSource, const char* outputSource = nullptr);
+    static unsigned int buildComputeProgram(const char* computeSource);
+
     void processEvents_deprecated();
 
+    // Command queue (producer: Python thread, consumer: render thread)
+    using Command = std::function<void()>;
+    static constexpr size_t kCommandQueueSize = 1024;
+    void submit(Command cmd);
+    void drainCommands();
+    void stopAcceptingCommands();  // Render thread, at loop exit: clears m_running under m_producerMutex
+
+    // Render on demand (RendererConfig::renderOnDemand). Frames are drawn while
+    // anything is changing; otherwise the loop blocks in glfwWaitEventsTimeout
+    // until input, a producer call (wake) or the idle frame cap.
+    static constexpr int kSettleFrames = 3;  // Redrawn after a change (ImGui settles hover/widgets)
+    int m_redrawFrames = kSettleFrames;      // Render thread only
+    std::mutex m_wakeMutex;                  // Guards posting against window teardown
+    bool m_eventsReady = false;
+    void requestRedraw() { m_redrawFrames = kSettleFrames; }
+    void wake();             // Any thread: interrupt a blocked event wait
+    bool frameWanted();      // Render thread: the next frame may differ from this one
+    void waitForEvents();
+
+    SpscQueue<Command, kCommandQueueSize> m_commands;
+    std::mutex m_producerMutex;  // Serializes producers (queue pushes, stream writes)
+    std::atomic<size_t> m_maxQueueDepth{0};
+    std::atomic<uint64_t> m_commandsSubmitted{0};
+    std::atomic<uint64_t> m_queueStalls{0};
+    std::atomic<uint64_t> m_queueStallNs{0};
+    std::atomic<uint64_t> m_lastDrainNs{0};
+
+    // Point counts of the last submitted sets (producer side, validates sparse updates)
+    std::atomic<size_t> m_submittedCount{0};
+    std::atomic<size_t> m_submittedNextCount{0};
+
+    // Fences whose commands were applied, completed after this frame's uploads
+    std::vector<std::shared_ptr<Completion>> m_appliedFences;
+    void completeFences();
+
+    // Render-thread state the Python side can query, republished when it changes
+    struct UiSnapshot {
+        int selectedID = -1;
+        std::vector<int> selectedIDs;
+        std::string selectedTicker;
+        int colorFeatureIdx = 0;
+        long long filteredCount = -1;
+    };
+    std::atomic<std::shared_ptr<const UiSnapshot>> m_uiSnapshot;
+    bool m_uiDirty = false;
+    void publishUiSnapshot();
+    std::string selectedTicker() const;  // Render thread only
+
     // Configuration
     RendererConfig m_config;
 
     // Interaction with the window
     GLFWwindow* m_window;
-    std::atomic<bool> m_running;
+    std::atomic<bool> m_running;              // Cleared only by the render thread (stopAcceptingCommands)
+    std::atomic<bool> m_stopRequested{false};  // stop(): the loop exits after this frame
     std::thread m_renderThread;
 
-    // Data buffers (Current State) - Now using std::vector for memory safety
-    std::mutex m_dataMutex;
+    // Data buffers (Current State) - owned by the render thread, filled by commands
     std::vector<float> m_stagedPositions;
     std::vector<float> m_stagedValues;
     size_t m_stagedCount;
@@ -108,6 +384,38 @@ private:
     size_t m_stagedNextCount;
     bool m_forceUpdateNext;
 
+    // Points patched by updatePoints/updateTargetPoints since the last upload
+    std::vector<unsigned int> m_dirtyIndices;
+    std::vector<unsigned int> m_dirtyNextIndices;
+
+    // Streaming uploads (lock-free, see InstanceStream)
+    InstanceStream m_stream;
+    InstanceStream m_nextStream;
+    bool m_streamBound = false;      // Attributes 1/2 read from m_stream
+    bool m_nextStreamBound = false;  // Attributes 3/4 read from m_nextStream
+
+    // Allocated sizes of the staged instance VBOs (bytes), reused until outgrown
+    size_t m_capacityPos = 0, m_capacityVal = 0;
+    size_t m_capacityNextPos = 0, m_capacityNextVal = 0;
+
+    // Packed staged sets (RendererConfig::packedInstances): the position VBO of
+    // each set holds interleaved PackedInstances and the value VBO stays empty.
+    // Index 0 current, 1 next.
+    bool m_packedBound[2] = { false, false };  // Attributes read a packed VBO
+    PackedRange m_packedRange[2];
+    std::vector<PackedInstance> m_packScratch;
+
+    void uploadPacked(bool next);
+    void uploadDirtyPacked(bool next, std::vector<unsigned int>& dirty);
+    bool instancesPacked() const { return m_packedBound[0] || m_packedBound[1]; }
+
+    // Driver capabilities queried in initGL
+    struct GLCaps {
+        bool bufferStorage = false;  // GL 4.4 glBufferStorage / persistent mapping
+        bool computeShaders = false; // GL 4.3 compute shaders + SSBOs
+    };
+    GLCaps m_caps;
+
     // Values used for CPU-side selection color calculation
     // (Now just references to staged buffers, no separate cache needed)
 
@@ -123,15 +431,21 @@ private:
     // --- Phase 1: Feature Switching ---
     std::vector<std::string> m_featureNames;
     int m_selectedColorFeatureIdx = 0;
-    bool m_colorFeatureChanged = false;
+    std::atomic<bool> m_colorFeatureChanged{false};
 
     // --- Phase 1: Stats Panel ---
     std::vector<StatsData> m_statsData;
     std::vector<float> m_explainedVariance;
 
     // --- Phase 1: Enhanced Tooltips ---
-    std::vector<float> m_allFeatureValues;  // N x F flattened
-    size_t m_numFeatures = 0;
+    std::shared_ptr<const FeatureStore> m_features;  // Rows read on hover
+    uint64_t m_featuresVersion = 0;                  // Bumped whenever m_features is replaced
+    // Replaced stores, released by the next producer call: a store viewing a
+    // numpy array takes the GIL on release, which the render thread must not wait for
+    std::vector<std::shared_ptr<const FeatureStore>> m_retiredFeatures;
+    std::mutex m_retiredMutex;
+    void retireFeatures(std::shared_ptr<const FeatureStore> store);
+    void releaseRetiredFeatures();
 
     // OpenGL Objects
     unsigned int m_validVAO, m_validVBO; 
@@ -140,6 +454,21 @@ private:
     unsigned int m_instanceVBO_NextPos; // Target Pos (Loc 3)
     unsigned int m_instanceVBO_NextVal; // Target Val (Loc 4)
     unsigned int m_shaderProgram;
+    unsigned int m_scatterProgram = 0;  // Delta update scatter (GL 4.3)
+    int m_scatterPatchCountLoc = -1;
+    unsigned int m_scatterBuffer = 0;   // Packed {index, value, position} patches
+    size_t m_scatterCapacity = 0;
+
+    // FrameState block of every render program (see Shader.h): camera, style,
+    // selection, filter, LOD and instance decode, written once per frame. One
+    // slice per view at GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT: slice 0 for the
+    // frame, slice 1 + i for viewport i, bound with bindFrameUniforms()
+    unsigned int m_frameUBO = 0;
+    size_t m_frameSliceStride = 0;
+    std::vector<uint8_t> m_frameSlices;  // Staging, one upload per frame
+    void updateFrameUniforms(bool lod);
+    void fillFrameUniforms(FrameUniforms& u, bool lod) const;  // For m_camera and m_drawViewport
+    void bindFrameUniforms(size_t slice);
 
     // Gizmo
     unsigned int m_gizmoVAO, m_gizmoVBO;
@@ -180,17 +509,283 @@ private:
     double m_rectEndX = 0, m_rectEndY = 0;
 
     void initPickingFBO(int width, int height);
-    int getPickedID(double mouseX, double mouseY);
-    std::vector<int> getPickedIDsInRect(double x1, double y1, double x2, double y2);
 
-    // Screenshot
-    std::string m_screenshotPath;
-    std::atomic<bool> m_screenshotRequested{false};
-    void processScreenshotRequest();
+    // Asynchronous picking: ID passes are rendered into a scissored region of the
+    // picking FBO and read back through PBOs a frame or two later
+    enum PickTag { PickHover = 0, PickClick, PickRect };
+    static constexpr int kHoverRadius = 2;  // Hover/click window is (2r+1)^2 pixels
+    AsyncReadback m_pickReadback;
+    int m_pickingWidth = 0, m_pickingHeight = 0;
+    bool m_hoverPickActive = false;  // Cursor is over the scene this frame
+    bool m_clickPending = false;
+    int m_clickPixelX = 0, m_clickPixelY = 0;
+
+    // Brush selection (see SelectionEngine)
+    SelectionEngine m_selection;
+    unsigned int m_selectionProgram = 0;
+    bool m_selectOccluded = false;     // Include points hidden behind others
+    bool m_rectPending = false;
+    std::vector<float> m_pendingBrush;  // Polygon in framebuffer pixels (x, y pairs)
+    std::vector<float> m_activeBrush;   // Brush of the selection in flight
+
+    // Pixel of the view under picking: the active viewport's when split
+    bool windowToFramebuffer(double x, double y, int& px, int& py) const;
+    void renderPickingPass(int x, int y, int width, int height);
+    void issuePickRequests();
+    void processPickResults();
+    SelectionEngine::Query makeSelectionQuery() const;
+    void issueBrushSelection();
+    void applyBrushSelection(std::vector<int>&& ids);
+
+    // Level of detail: density aggregation (see Renderer_Lod.cpp)
+    int m_lodMode;
+    float m_lodThreshold;
+    float m_lodExposure = 0.15f;
+    unsigned int m_densityFBO = 0;
+    unsigned int m_densityTexture = 0;  // RG32F: count, value sum
+    int m_densityWidth = 0, m_densityHeight = 0;
+    unsigned int m_densityProgram = 0;
+    unsigned int m_densityCompositeProgram = 0;
+    unsigned int m_fullscreenVAO = 0;   // Attribute-less full-screen triangle
+
+    bool lodActive() const;
+    void initDensityTarget(int width, int height);
+    void renderDensityPass();
+    void renderDensityComposite();
+
+    // Weighted blended order-independent transparency (see Renderer_Oit.cpp)
+    int m_transparencyMode;
+    unsigned int m_oitFBO = 0;
+    unsigned int m_oitAccumTexture = 0;   // RGBA16F: weighted premultiplied color, weighted alpha
+    unsigned int m_oitRevealTexture = 0;  // R16F: product of (1 - alpha)
+    unsigned int m_oitDepth = 0;          // Depth tested, not written, by the accumulation pass
+    int m_oitWidth = 0, m_oitHeight = 0;
+    unsigned int m_oitProgram = 0;
+    unsigned int m_culledOitProgram = 0;  // Buffer-texture fetch
+    unsigned int m_oitCompositeProgram = 0;
+
+    bool oitActive() const;
+    void initOitTarget(int width, int height);
+    void renderTransparentPoints();
+
+    // Color lookup texture and per-point categories (see Renderer_Color.cpp)
+    static constexpr int kCategoricalMode = ColorMap::kPaletteCount;
+    static constexpr int kColorLutUnit = 5;   // After the instance buffer textures (1-4)
+    static constexpr int kCategoryUnit = 6;
+    ColorMap::Table m_palette = ColorMap::palette(ColorMap::Heatmap);  // LUT layer 0
+    ColorMap::Table m_categoryColors = ColorMap::categorical();       // LUT layer 1
+    int m_paletteMode = ColorMap::Heatmap;  // Palette held by m_palette
+    bool m_paletteDirty = false;            // m_palette not uploaded yet
+    unsigned int m_colorLutTexture = 0;     // RGBA8 1D array, 2 layers
+    std::vector<uint8_t> m_categories;      // CPU copy for the selection color
+    std::vector<std::string> m_categoryNames;
+    int m_categoryClasses = 0;              // Largest label + 1
+    bool m_categoriesDirty = false;
+    unsigned int m_categoryBuffer = 0;
+    unsigned int m_categoryTexture = 0;     // R8UI buffer texture over m_categoryBuffer
+
+    void initColorMap();
+    void refreshPalette();  // Follows m_colorMode, CPU table only
+    void updateColorMap();  // Uploads what changed since the last frame
+    void pointColor(int id, float value, float* rgb) const;
+    void renderColorLegend();
+
+    // Auto categories, producer side (see Renderer_Color.cpp)
+    std::mutex m_autoCategoryMutex;  // Serializes the fits of concurrent producers
+    AutoCategories m_autoCategories;
+    std::unique_ptr<MiniBatchKMeans> m_kmeans;  // Centroids carried between stores
+    void clusterCategories(const FeatureStore& store);
+    void outlierCategories(const float* positions, size_t count);
+
+    // Range filters over feature columns (see Renderer_Filters.cpp)
+    static constexpr int kRangeUnit = 7;
+    RangeFilter m_rangeFilter;
+    unsigned int m_rangeProgram = 0;
+    std::vector<RangeFilter::Range> m_ranges;  // Requested; m_rangeFilter.active() is what is applied
+    bool m_rangesDirty = false;
+    uint64_t m_rangeFeaturesVersion = 0;       // m_featuresVersion the columns were taken from
+    std::vector<int> m_rangeIDs;               // Passing points, ascending
+    bool m_rangeMatched = false;               // m_rangeIDs belongs to the applied ranges
+    bool m_selectFilteredPending = false;
+
+    void initRangeFilter();
+    void updateRangeFilter();  // Re-uploads on change, collects the match
+    bool passesRanges(int id) const;
+    void renderRangeFilterControls();
+
+    // Frustum culling + indirect draws (see Renderer_Culling.cpp)
+    FrustumCuller m_culler;
+    unsigned int m_cullProgram = 0;
+    unsigned int m_culledShaderProgram = 0;   // Billboards, buffer-texture fetch
+    unsigned int m_culledPickingProgram = 0;  // Picking, buffer-texture fetch
+    unsigned int m_culledVAO = 0;             // Quad + attribute 5 (visible index)
+    unsigned int m_instanceTBO[4] = {0, 0, 0, 0};  // Pos, Val, NextPos, NextVal
+    // Culled then pulled billboard, picking, OIT programs: the four offsets, uNextCount
+    int m_instanceOffsetLoc[6][5] = {};
+    bool m_cullEnabled;
+    bool m_cullActive = false;       // Culled path used this frame
+    uint64_t m_instanceVersion = 0;  // Bumped on every instance upload
+
+    void initCulling();
+    void updateCulling();
+    // Culled draws, the timeline and viewport subsets fetch instances from buffer textures
+    bool bufferFetch() const { return m_cullActive || m_timelineActive || subsetDraw(); }
+    unsigned int pointProgram() const {
+        return pulledDraw() ? m_pulledShaderProgram : bufferFetch() ? m_culledShaderProgram : m_shaderProgram;
+    }
+    unsigned int pickingProgram() const {
+        return pulledDraw() ? m_pulledPickingProgram : bufferFetch() ? m_culledPickingProgram : m_pickingShaderProgram;
+    }
+    void bindInstanceBuffers(unsigned int program);
+    void drawPoints(unsigned int program);
+
+    // Vertex pulling (RendererConfig::vertexPulling): draws of every point in
+    // order become one non-instanced glDrawArrays over the buffer textures
+    unsigned int m_pulledShaderProgram = 0;
+    unsigned int m_pulledPickingProgram = 0;
+    unsigned int m_pulledOitProgram = 0;
+    unsigned int m_pulledVAO = 0;  // No attributes
+    bool pulledDraw() const;
+    unsigned int oitProgram() const {
+        return pulledDraw() ? m_pulledOitProgram : bufferFetch() ? m_culledOitProgram : m_oitProgram;
+    }
+
+    // Spatial index over the drawn positions (see Renderer_Spatial.cpp)
+    std::atomic<std::shared_ptr<const SpatialIndex>> m_spatialIndex;  // Queried from any thread
+    uint64_t m_spatialVersion = 0;  // m_instanceVersion, morph time and count it was built from
+    float m_spatialMorph = 0.0f;
+    size_t m_spatialCount = 0;
+    std::vector<std::shared_ptr<Completion>> m_spatialRequests;  // Waiting producer queries
+
+    std::shared_ptr<const SpatialIndex> spatialIndex();  // Producer: waits for an up-to-date index
+    // Render thread. staged: build from the CPU sets as they are now (nothing uploaded yet)
+    const SpatialIndex& updateSpatialIndex(bool staged);
+    void serveSpatialRequests(bool staged);
+    void pickClickRay();
+
+    // Small multiples over the shared point data (see Renderer_Viewports.cpp)
+    static constexpr size_t kMaxViewports = 16;
+    struct Viewport {
+        std::unique_ptr<Camera> camera;
+        std::string label;
+        std::vector<uint32_t> subset;   // Sorted point indices, empty: every point
+        bool subsetDirty = false;
+        size_t drawCount = 0;           // Subset entries below the point count, this frame
+        unsigned int indexBuffer = 0;   // subset as attribute 5 of vao
+        unsigned int vao = 0;
+        bool filterEnabled = false;
+        float filterMin = 0.0f, filterMax = 1.0f;
+        int rect[4] = {0, 0, 0, 0};     // Framebuffer pixels (x, y from the bottom, w, h)
+    };
+    std::vector<Viewport> m_viewports;  // Empty: one view through m_mainCamera
+    Camera* m_mainCamera = nullptr;     // Owned; m_camera is the active view's camera
+    int m_activeViewport = 0;           // Under the cursor, receives input and picking
+    int m_drawViewport = -1;            // Viewport whose frame state is bound, -1 in single view
+    bool m_viewportsLinked = true;
+
+    bool multiView() const { return !m_viewports.empty(); }
+    bool subsetDraw() const;
+    void layoutViewports();
+    void renderViewports();
+    void renderViewportOverlay();                 // Borders and labels
+    void activateViewportAt(double x, double y);  // Window coordinates
+    void viewSize(int& width, int& height) const; // Framebuffer, or the active viewport
+    void orbitCameras(float deltaX, float deltaY);
+    void zoomCameras(float delta);
+    void releaseViewportGL(Viewport& view);
+    bool inActiveSubset(int id) const;
+
+    // Keyframe timeline (see Renderer_Timeline.cpp)
+    struct Timeline {
+        size_t frames = 0;              // Frames in the whole range
+        size_t points = 0;
+        size_t window = 0;              // Resident frame slots
+        std::vector<int64_t> slotFrame; // Frame held by each slot, -1 if empty
+        std::vector<uint8_t> slotStale; // Held frame is outdated (invalidateKeyframes): drawn, not played into
+        std::vector<float> positions;   // CPU mirror, window x points x 3
+        std::vector<float> values;      // window x points
+        std::shared_ptr<const QspFile> dataset;  // Paged from the mapping instead, no mirror
+        bool paging = false;            // Window frames still to page in
+        std::vector<size_t> dirtySlots; // Slots to upload this frame
+        bool reallocate = false;
+
+        float position = 0.0f;          // Playhead in frames
+        float fps = 1.0f;
+        bool playing = false;
+        bool loop = true;
+        bool buffering = false;         // Playback waits for the prefetcher
+        double lastTime = 0.0;
+
+        size_t frame = 0, nextFrame = 0;  // Pair drawn this frame
+        bool shown = false;
+    };
+    Timeline m_timeline;
+    bool m_timelineActive = false;
+    unsigned int m_timelinePosBuffer = 0;
+    unsigned int m_timelineValBuffer = 0;
+    unsigned int m_timelineIndexBuffer = 0;  // 0..points-1 as attribute 5
+    unsigned int m_timelineVAO = 0;
+    size_t m_timelineIndexCount = 0;
+    std::atomic<float> m_timelinePosition{0.0f};
+    size_t m_submittedTimelineFrames = 0;  // Producer side, for setKeyframe checks (m_producerMutex)
+    size_t m_submittedTimelinePoints = 0;
+
+    static constexpr size_t kDatasetPagesPerFrame = 2;  // Frames paged per render frame
+    void resetTimeline(size_t frameCount, size_t pointCount, size_t window, std::shared_ptr<const QspFile> dataset);
+    void updateTimeline();
+    void uploadTimeline();
+    void pageDataset();
+    const float* timelinePositions(size_t frame) const;
+    const float* timelineValues(size_t frame) const;
+    bool timelineHeld(size_t frame) const;      // In its slot, possibly stale
+    bool timelineResident(size_t frame) const;  // In its slot and current
+    size_t timelineSlot(size_t frame) const { return frame % m_timeline.window; }
+    void renderTimelineControls();
+
+    // Offscreen export (see Renderer_Export.cpp)
+    struct ExportJob {
+        FrameRequest request;
+        std::shared_ptr<FrameExporter::Pipe> pipe;
+    };
+    FrameExporter m_exporter;
+    std::deque<ExportJob> m_exportQueue;
+    std::atomic<uint64_t> m_framesRequested{0};  // Producer side
+    unsigned int m_exportFBO = 0, m_exportColor = 0, m_exportDepth = 0;
+    int m_exportWidth = 0, m_exportHeight = 0;
+    unsigned int m_sceneFBO = 0;     // Target of the scene passes this frame
+    bool m_exportFrame = false;      // This frame is read back
+    FrameExporter::Frame m_exportCurrent;
+
+    bool beginExportFrame();
+    void finishExportFrame();
+    void initExportTarget(int width, int height);
+    void destroyExport();
+
+    // Session recording (see Renderer_Session.cpp). Producers record their
+    // payload before submitting it; the render thread records camera input.
+    std::atomic<std::shared_ptr<SessionWriter>> m_recorder;
+    std::atomic<bool> m_recordFeatures{false};
+    std::atomic<bool> m_replayCancel{false};
+    std::atomic<int> m_replays{0};        // Replays running: recording is suspended
+    mutable std::mutex m_recordingMutex;  // Serializes start/stop
+    RecordingStats m_lastRecording{};     // Of the last stopped recording
+
+    bool recording() const {
+        return m_replays.load(std::memory_order_acquire) == 0 && m_recorder.load(std::memory_order_acquire) != nullptr;
+    }
+    void record(SessionKind kind, std::vector<uint8_t> payload);
+    void recordPoints(SessionKind kind, const float* positions, const float* values, size_t count);
+    void recordPatch(SessionKind kind, const int* indices, const float* positions, const float* values,
+                     size_t count);
+    void recordStrings(SessionKind kind, const std::vector<std::string>& list);
+    void recordFeatures(SessionKind kind, const FeatureStore& store);
+    void recordColorMode(int mode);
+    void recordRanges(const std::vector<RangeFilter::Range>& ranges);
 
     // GLFW Callbacks
     static void mouse_button_callback(GLFWwindow* window, int button, int action, int mods);
     static void cursor_position_callback(GLFWwindow* window, double xpos, double ypos);
     static void scroll_callback(GLFWwindow* window, double xoffset, double yoffset);
     static void framebuffer_size_callback(GLFWwindow* window, int width, int height);
+    static void window_refresh_callback(GLFWwindow* window);
 };
\ No newline at end of file
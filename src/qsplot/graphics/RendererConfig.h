@@ -1,5 +1,7 @@
 #pragma once
 
+#include <cstddef>
+
 /**
  * @brief Configuration for the Renderer.
  * 
@@ -16,13 +18,68 @@ struct RendererConfig {
     // Visual settings
     float pointScale = 0.05f;
     float globalAlpha = 1.0f;
-    int colorMode = 0;  // 0: Heatmap, 1: CoolWarm, 2: Grayscale
+    int colorMode = 0;  // 0: Heatmap, 1: CoolWarm, 2: Grayscale, 3: Categorical
     
     // Background color (RGB)
     float backgroundColor[3] = {0.05f, 0.05f, 0.05f};
     
     // Camera settings
     float cameraDistance = 25.0f;
+
+    // Streaming uploads: set_points/set_target_points copy straight into a
+    // triple-buffered ring (persistently mapped on GL 4.4+) without locking
+    bool streamingUploads = false;
+    size_t streamingCapacity = 0;  // Points reserved per ring segment (0 = size on first upload)
+
+    // Brush selection: also select points hidden behind others (toggle in the UI)
+    bool selectOccluded = false;
+
+    // Clicks are resolved on the CPU as a ray query against the spatial index
+    // (see SpatialIndex) instead of an ID pass read back a frame or two later
+    bool spatialPicking = true;
+
+    // Level of detail: dense screen regions are drawn as an aggregated density
+    // splat instead of overlapping billboards
+    int lodMode = 1;                 // 0: Off, 1: Auto (dense cells only), 2: Density only
+    size_t lodMinPoints = 1000000;   // Auto mode engages above this many points
+    float lodCellThreshold = 8.0f;   // Points per density cell before it is aggregated
+    int lodDownsample = 4;           // Density cell size in framebuffer pixels
+
+    // Translucent billboards (alpha < 1): 0 blends them in instance order,
+    // 1 resolves them with weighted blended order-independent transparency
+    int transparencyMode = 0;
+
+    // Frustum culling: only on-screen points are drawn (compute pass on GL 4.3+,
+    // multithreaded CPU pass otherwise)
+    bool frustumCulling = true;
+    size_t cullMinPoints = 100000;   // Culling engages above this many points
+
+    // Vertex pulling: frames that draw every point (not culled, no viewport
+    // subset) issue one non-instanced glDrawArrays of six vertices per point
+    // that read the point data from buffer textures, instead of instancing the
+    // quad strip over per-instance attributes. Float sets only.
+    bool vertexPulling = false;
+
+    // Packed instances: staged sets are uploaded as 16-bit snorm positions and
+    // a 16-bit value (8 bytes per point instead of 16), quantized to each set's
+    // bounds. Frustum culling and GPU brush selection need float buffers and
+    // fall back (no culling, CPU selection) while a packed set is drawn.
+    bool packedInstances = false;
+
+    // Headless: the window stays hidden and frames are only drawn for
+    // render_frames() requests, into an offscreen windowWidth x windowHeight target
+    bool headless = false;
+    int exportThreads = 0;           // Image encoder threads (0 = one per core but one)
+    // Render on demand: a window with nothing changing (no input, commands,
+    // streamed data, playback, exports or pending readbacks) is not redrawn and
+    // the render thread sleeps in the event loop. idleFrameRate still redraws an
+    // idle window this many times per second (0 = only when woken).
+    bool renderOnDemand = true;
+    float idleFrameRate = 1.0f;
+
+    // Closing the window ends the whole process (the original behaviour).
+    // Never applies to headless renderers.
+    bool exitProcessOnClose = true;
     
     // Default constructor
     RendererConfig() = default;
@@ -0,0 +1,234 @@
+#include "Renderer.h"
+#include "../core/Clustering.h"
+#include "../core/FeatureStore.h"
+#include "../core/SessionLog.h"
+#include <glad/glad.h>
+#include <algorithm>
+#include <initializer_list>
+
+#include "imgui.h"
+
+// Color lookup.
+//
+// Every color mode samples one RGBA8 1D array texture: layer 0 holds the
+// continuous palette, layer 1 the category colors. The billboard vertex shader
+// turns the value (or the point's uint8 label) into a flat texel coordinate and
+// the fragment shader does a single fetch, so changing palette or mode rewrites
+// 256 texels and never touches the instance data. The legend and the selection
+// color read the same ColorMap tables on the CPU.
+
+namespace {
+
+constexpr int kLutLayers = 2;
+constexpr int kLegendSteps = 40;
+constexpr int kLegendCategories = 16;  // Swatches listed before "+N more"
+constexpr int kMaxCategories = 256;    // uint8 labels
+
+}  // namespace
+
+void Renderer::setColorMode(int mode) {
+    mode = std::clamp(mode, 0, (int)kCategoricalMode);
+    recordColorMode(mode);
+    submit([this, mode]() { m_colorMode = mode; });
+}
+
+void Renderer::setCategories(const uint8_t* labels, size_t count, const std::vector<std::string>& names) {
+    std::vector<uint8_t> copy(labels, labels + (labels ? count : 0));
+    int classes = copy.empty() ? 0 : *std::max_element(copy.begin(), copy.end()) + 1;
+    if (recording()) {
+        SessionPayload payload;
+        payload.put<uint64_t>(copy.size());
+        payload.putArray(copy.data(), copy.size());
+        payload.putStrings(names);
+        record(SessionKind::Categories, payload.take());
+    }
+    submit([this, copy = std::move(copy), names = names, classes]() mutable {
+        m_categories.swap(copy);
+        m_categoryNames.swap(names);
+        m_categoryClasses = classes;
+        m_categoriesDirty = true;
+    });
+}
+
+void Renderer::setAutoCategories(const AutoCategories& settings) {
+    std::lock_guard<std::mutex> lock(m_autoCategoryMutex);
+    m_autoCategories = settings;
+    m_autoCategories.clusters = std::clamp(settings.clusters, 1, kMaxCategories);
+    if (settings.mode != AutoCategories::Clusters) {
+        m_kmeans.reset();
+    } else if (!m_kmeans || m_kmeans->options().clusters != m_autoCategories.clusters) {
+        MiniBatchKMeans::Options options;
+        options.clusters = m_autoCategories.clusters;
+        m_kmeans = std::make_unique<MiniBatchKMeans>(options);
+    }
+}
+
+void Renderer::clusterCategories(const FeatureStore& store) {
+    std::vector<uint8_t> labels;
+    std::vector<std::string> names;
+    {
+        std::lock_guard<std::mutex> lock(m_autoCategoryMutex);
+        if (m_autoCategories.mode != AutoCategories::Clusters || !m_kmeans || store.rows() == 0) return;
+        std::vector<int32_t> clusters = m_kmeans->fitPredict(store);
+        labels.assign(clusters.begin(), clusters.end());
+        for (Eigen::Index k = 0; k < m_kmeans->centroids().rows(); k++) {
+            names.push_back("Cluster " + std::to_string(k));
+        }
+    }
+    setCategories(labels.data(), labels.size(), names);
+}
+
+void Renderer::outlierCategories(const float* positions, size_t count) {
+    float contamination;
+    size_t neighbors;
+    {
+        std::lock_guard<std::mutex> lock(m_autoCategoryMutex);
+        if (m_autoCategories.mode != AutoCategories::Outliers || !positions || count == 0) return;
+        contamination = m_autoCategories.contamination;
+        neighbors = m_autoCategories.neighbors;
+    }
+    std::vector<uint8_t> flags = flagOutliers(knnOutlierScores(positions, count, neighbors), contamination);
+    setCategories(flags.data(), flags.size(), { "Inlier", "Outlier" });
+}
+
+void Renderer::initColorMap() {
+    refreshPalette();
+
+    glGenTextures(1, &m_colorLutTexture);
+    glActiveTexture(GL_TEXTURE0 + kColorLutUnit);
+    glBindTexture(GL_TEXTURE_1D_ARRAY, m_colorLutTexture);
+    glTexImage2D(GL_TEXTURE_1D_ARRAY, 0, GL_RGBA8, ColorMap::kSize, kLutLayers, 0, GL_RGBA, GL_UNSIGNED_BYTE, NULL);
+    // Linear: values blend neighbouring entries; categories sample texel centers
+    glTexParameteri(GL_TEXTURE_1D_ARRAY, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_1D_ARRAY, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_1D_ARRAY, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTexSubImage2D(GL_TEXTURE_1D_ARRAY, 0, 0, 0, ColorMap::kSize, 1, GL_RGBA, GL_UNSIGNED_BYTE, m_palette.data());
+    glTexSubImage2D(GL_TEXTURE_1D_ARRAY, 0, 0, 1, ColorMap::kSize, 1, GL_RGBA, GL_UNSIGNED_BYTE,
+                    m_categoryColors.data());
+    m_paletteDirty = false;
+
+    // The buffer is never empty, so the shader always has a store to size-check against
+    uint8_t none = 0;
+    glGenBuffers(1, &m_categoryBuffer);
+    glBindBuffer(GL_TEXTURE_BUFFER, m_categoryBuffer);
+    glBufferData(GL_TEXTURE_BUFFER, 1, &none, GL_DYNAMIC_DRAW);
+    glBindBuffer(GL_TEXTURE_BUFFER, 0);
+
+    glGenTextures(1, &m_categoryTexture);
+    glActiveTexture(GL_TEXTURE0 + kCategoryUnit);
+    glBindTexture(GL_TEXTURE_BUFFER, m_categoryTexture);
+    glTexBuffer(GL_TEXTURE_BUFFER, GL_R8UI, m_categoryBuffer);
+    glActiveTexture(GL_TEXTURE0);
+
+    // Both units stay bound for the lifetime of the context
+    for (unsigned int program : { m_shaderProgram, m_culledShaderProgram, m_oitProgram, m_culledOitProgram,
+                                  m_pulledShaderProgram, m_pulledOitProgram }) {
+        if (!program) continue;
+        glUseProgram(program);
+        glUniform1i(glGetUniformLocation(program, "uColorLut"), kColorLutUnit);
+        glUniform1i(glGetUniformLocation(program, "uCategories"), kCategoryUnit);
+    }
+    if (m_densityCompositeProgram) {
+        glUseProgram(m_densityCompositeProgram);
+        glUniform1i(glGetUniformLocation(m_densityCompositeProgram, "uColorLut"), kColorLutUnit);
+    }
+    glUseProgram(0);
+}
+
+void Renderer::refreshPalette() {
+    // The categorical mode keeps the last continuous palette for the density composite
+    if (m_colorMode == kCategoricalMode || m_colorMode == m_paletteMode) return;
+    m_palette = ColorMap::palette(m_colorMode);
+    m_paletteMode = m_colorMode;
+    m_paletteDirty = true;
+}
+
+void Renderer::updateColorMap() {
+    refreshPalette();
+    if (m_paletteDirty) {
+        glActiveTexture(GL_TEXTURE0 + kColorLutUnit);
+        glTexSubImage2D(GL_TEXTURE_1D_ARRAY, 0, 0, 0, ColorMap::kSize, 1, GL_RGBA, GL_UNSIGNED_BYTE, m_palette.data());
+        glActiveTexture(GL_TEXTURE0);
+        m_paletteDirty = false;
+    }
+
+    if (m_categoriesDirty) {
+        // Sized to the labels: points past the end read category 0
+        uint8_t none = 0;
+        glBindBuffer(GL_TEXTURE_BUFFER, m_categoryBuffer);
+        if (m_categories.empty()) {
+            glBufferData(GL_TEXTURE_BUFFER, 1, &none, GL_DYNAMIC_DRAW);
+        } else {
+            glBufferData(GL_TEXTURE_BUFFER, m_categories.size(), m_categories.data(), GL_DYNAMIC_DRAW);
+        }
+        glBindBuffer(GL_TEXTURE_BUFFER, 0);
+        m_categoriesDirty = false;
+    }
+}
+
+void Renderer::pointColor(int id, float value, float* rgb) const {
+    if (m_colorMode == kCategoricalMode) {
+        int category = id >= 0 && id < (int)m_categories.size() ? m_categories[id] : 0;
+        ColorMap::category(m_categoryColors, category, rgb);
+    } else {
+        ColorMap::sample(m_palette, value, rgb);
+    }
+}
+
+void Renderer::renderColorLegend() {
+    refreshPalette();
+    ImDrawList* drawList = ImGui::GetWindowDrawList();
+    auto toImGui = [](const ColorMap::Color& c) { return IM_COL32(c.r, c.g, c.b, 255); };
+
+    if (m_colorMode == kCategoricalMode) {
+        if (m_categoryClasses == 0) {
+            ImGui::TextDisabled("No categories (compute_clusters / compute_outliers)");
+            return;
+        }
+        float size = ImGui::GetTextLineHeight();
+        int shown = std::min(m_categoryClasses, kLegendCategories);
+        for (int k = 0; k < shown; k++) {
+            ImVec2 pos = ImGui::GetCursorScreenPos();
+            drawList->AddRectFilled(pos, ImVec2(pos.x + size, pos.y + size), toImGui(m_categoryColors[k]));
+            ImGui::Dummy(ImVec2(size, size));
+            ImGui::SameLine();
+            if (k < (int)m_categoryNames.size() && !m_categoryNames[k].empty()) {
+                ImGui::TextUnformatted(m_categoryNames[k].c_str());
+            } else {
+                ImGui::Text("Category %d", k);
+            }
+        }
+        if (m_categoryClasses > shown) ImGui::TextDisabled("+%d more", m_categoryClasses - shown);
+        return;
+    }
+
+    ImVec2 legendSize(200, 20);
+    ImVec2 pos = ImGui::GetCursorScreenPos();
+
+    // Draw gradient bar
+    float stepWidth = legendSize.x / kLegendSteps;
+    for (int i = 0; i < kLegendSteps; i++) {
+        float rgb[3];
+        ColorMap::sample(m_palette, (float)i / (kLegendSteps - 1), rgb);
+        drawList->AddRectFilled(
+            ImVec2(pos.x + i * stepWidth, pos.y),
+            ImVec2(pos.x + (i + 1) * stepWidth, pos.y + legendSize.y),
+            IM_COL32((int)(rgb[0] * 255), (int)(rgb[1] * 255), (int)(rgb[2] * 255), 255)
+        );
+    }
+
+    // Draw color filter slider indicator (thin white bar)
+    if (m_colorFilterEnabled) {
+        float sliderX = pos.x + m_colorFilterValue * legendSize.x;
+        drawList->AddLine(
+            ImVec2(sliderX, pos.y - 5),
+            ImVec2(sliderX, pos.y + legendSize.y + 5),
+            IM_COL32(255, 255, 255, 255),
+            3.0f
+        );
+    }
+
+    // Move cursor past the legend
+    ImGui::Dummy(legendSize);
+    ImGui::Text("0.0                     1.0");
+}
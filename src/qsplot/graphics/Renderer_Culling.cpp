@@ -0,0 +1,172 @@
+#include "Renderer.h"
+#include "Camera.h"
+#include <glad/glad.h>
+#include <GLFW/glfw3.h>
+#include <algorithm>
+#include <limits>
+#include <Eigen/Dense>
+
+// Frustum culling with indirect draws.
+//
+// Above cullMinPoints instances the culler compacts the indices of the visible
+// points into an index buffer every frame, and the billboard and picking passes
+// draw only those through glDrawArraysIndirect. The culled programs read the
+// visible index as instanced attribute 5 and fetch the instance data from
+// buffer textures, so the staged VBOs and the stream ring are used as-is.
+//
+// Vertex pulling reads the same buffer textures without any vertex stream:
+// draws of the whole set (no culling, no viewport subset) become one
+// glDrawArrays(GL_TRIANGLES) of six vertices per point, which avoids the
+// instancing of a 4-vertex strip that many drivers handle poorly.
+
+namespace {
+    // Half diagonal of the unit billboard quad
+    constexpr float kBillboardRadius = 0.7072f;
+    // Texture units 1-4: unit 0 belongs to the density/picking passes
+    constexpr GLint kFirstInstanceUnit = 1;
+    constexpr size_t kPulledVertices = 6;  // Two triangles per point
+    const char* kInstanceSamplers[4] = { "uPositionBuffer", "uValueBuffer", "uNextPositionBuffer", "uNextValueBuffer" };
+    const char* kInstanceOffsets[4] = { "uPositionOffset", "uValueOffset", "uNextPositionOffset", "uNextValueOffset" };
+}
+
+void Renderer::initCulling() {
+    m_culler.init(m_cullProgram);  // CPU culling when 0
+    glGenTextures(4, m_instanceTBO);
+
+    glGenVertexArrays(1, &m_culledVAO);
+    glBindVertexArray(m_culledVAO);
+
+    glBindBuffer(GL_ARRAY_BUFFER, m_validVBO);
+    glEnableVertexAttribArray(0);
+    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 3 * sizeof(float), (void*)0);
+
+    // Visible instance index, one per instance
+    glBindBuffer(GL_ARRAY_BUFFER, m_culler.indexBuffer());
+    glEnableVertexAttribArray(5);
+    glVertexAttribIPointer(5, 1, GL_UNSIGNED_INT, sizeof(GLuint), (void*)0);
+    glVertexAttribDivisor(5, 1);
+
+    glBindVertexArray(0);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+    unsigned int programs[6] = { m_culledShaderProgram, m_culledPickingProgram, m_culledOitProgram,
+                                 m_pulledShaderProgram, m_pulledPickingProgram, m_pulledOitProgram };
+    for (int p = 0; p < 6; p++) {
+        if (!programs[p]) continue;
+        glUseProgram(programs[p]);
+        for (int k = 0; k < 4; k++) {
+            glUniform1i(glGetUniformLocation(programs[p], kInstanceSamplers[k]), kFirstInstanceUnit + k);
+            m_instanceOffsetLoc[p][k] = glGetUniformLocation(programs[p], kInstanceOffsets[k]);
+        }
+        m_instanceOffsetLoc[p][4] = glGetUniformLocation(programs[p], "uNextCount");
+    }
+    glUseProgram(0);
+}
+
+void Renderer::updateCulling() {
+    // The culled programs fetch float instances; packed sets only draw through attributes
+    bool floatInstances = m_timelineActive || !instancesPacked();
+    // One frustum per frame: split views draw every point
+    m_cullActive = !multiView() && m_cullEnabled && m_camera && m_culledShaderProgram && m_culledPickingProgram &&
+                   floatInstances && m_renderCount > 0 && m_renderCount >= m_config.cullMinPoints;
+    if (!m_cullActive) return;
+
+    FrustumCuller::Query query;
+    Eigen::Matrix4f vp = m_camera->getViewProjectionMatrix();
+    std::copy(vp.data(), vp.data() + 16, query.viewProj);
+    query.morphTime = m_morphTime;
+    query.radius = m_pointScale * kBillboardRadius;
+    query.current = currentSource();
+    query.next = nextSource();
+    query.dataVersion = m_instanceVersion;
+    m_culler.cull(query);
+}
+
+bool Renderer::pulledDraw() const {
+    if (!m_config.vertexPulling || !m_pulledShaderProgram || !m_pulledPickingProgram) return false;
+    if (m_cullActive || subsetDraw()) return false;  // Index lists draw through attribute 5
+    if (m_renderCount > (size_t)std::numeric_limits<GLsizei>::max() / kPulledVertices) return false;
+    // The buffer-fetch programs read float instances
+    return m_timelineActive || !instancesPacked();
+}
+
+void Renderer::bindInstanceBuffers(unsigned int program) {
+    GLuint buffers[4];
+    size_t offsets[4];  // Bytes
+    size_t nextCount = 0;
+    nextPositions(nextCount);
+
+    if (m_timelineActive) {
+        // Both halves of the pair are slots of the keyframe buffers
+        const size_t points = m_timeline.points;
+        const size_t slots[2] = { timelineSlot(m_timeline.frame), timelineSlot(m_timeline.nextFrame) };
+        for (int k = 0; k < 2; k++) {
+            buffers[k * 2] = m_timelinePosBuffer;
+            buffers[k * 2 + 1] = m_timelineValBuffer;
+            offsets[k * 2] = slots[k] * points * 3 * sizeof(float);
+            offsets[k * 2 + 1] = slots[k] * points * sizeof(float);
+        }
+    } else {
+        if (m_streamBound) {
+            buffers[0] = buffers[1] = m_stream.buffer();
+            offsets[0] = m_stream.positionOffset();
+            offsets[1] = m_stream.valueOffset();
+        } else {
+            buffers[0] = m_instanceVBO_Pos; offsets[0] = 0;
+            buffers[1] = m_instanceVBO_Val; offsets[1] = 0;
+        }
+        if (m_nextStreamBound) {
+            buffers[2] = buffers[3] = m_nextStream.buffer();
+            offsets[2] = m_nextStream.positionOffset();
+            offsets[3] = m_nextStream.valueOffset();
+        } else {
+            buffers[2] = m_instanceVBO_NextPos; offsets[2] = 0;
+            buffers[3] = m_instanceVBO_NextVal; offsets[3] = 0;
+        }
+    }
+
+    // Re-attached every draw: a regrown ring may reuse a deleted buffer name
+    for (int k = 0; k < 4; k++) {
+        glActiveTexture(GL_TEXTURE0 + kFirstInstanceUnit + k);
+        glBindTexture(GL_TEXTURE_BUFFER, m_instanceTBO[k]);
+        glTexBuffer(GL_TEXTURE_BUFFER, GL_R32F, buffers[k]);
+    }
+    glActiveTexture(GL_TEXTURE0);
+    const unsigned int programs[6] = { m_culledShaderProgram, m_culledPickingProgram, m_culledOitProgram,
+                                       m_pulledShaderProgram, m_pulledPickingProgram, m_pulledOitProgram };
+    int slot = 0;
+    for (int p = 0; p < 6; p++) {
+        if (programs[p] == program) slot = p;
+    }
+    const GLint* loc = m_instanceOffsetLoc[slot];
+    for (int k = 0; k < 4; k++) {
+        glUniform1i(loc[k], (GLint)(offsets[k] / sizeof(float)));
+    }
+    glUniform1i(loc[4], (GLint)nextCount);
+}
+
+void Renderer::drawPoints(unsigned int program) {
+    if (subsetDraw()) {
+        const Viewport& view = m_viewports[m_drawViewport];
+        bindInstanceBuffers(program);
+        glBindVertexArray(view.vao);
+        glDrawArraysInstanced(GL_TRIANGLE_STRIP, 0, 4, (GLsizei)view.drawCount);
+    } else if (m_cullActive) {
+        bindInstanceBuffers(program);
+        glBindVertexArray(m_culledVAO);
+        glBindBuffer(GL_DRAW_INDIRECT_BUFFER, m_culler.commandBuffer());
+        glDrawArraysIndirect(GL_TRIANGLE_STRIP, nullptr);
+        glBindBuffer(GL_DRAW_INDIRECT_BUFFER, 0);
+    } else if (pulledDraw()) {
+        bindInstanceBuffers(program);
+        glBindVertexArray(m_pulledVAO);
+        glDrawArrays(GL_TRIANGLES, 0, (GLsizei)(m_renderCount * kPulledVertices));
+    } else if (m_timelineActive) {
+        bindInstanceBuffers(program);
+        glBindVertexArray(m_timelineVAO);
+        glDrawArraysInstanced(GL_TRIANGLE_STRIP, 0, 4, (GLsizei)m_renderCount);
+    } else {
+        glBindVertexArray(m_validVAO);
+        glDrawArraysInstanced(GL_TRIANGLE_STRIP, 0, 4, (GLsizei)m_renderCount);
+    }
+}
@@ -0,0 +1,146 @@
+#include "Renderer.h"
+#include "Camera.h"
+#include <glad/glad.h>
+#include <GLFW/glfw3.h>
+#include <chrono>
+#include <iostream>
+#include <thread>
+
+// Offscreen export.
+//
+// Export requests travel through the command queue into m_exportQueue. Each
+// one takes a whole frame: its state (morph, playhead, camera) is applied, the
+// scene passes draw into m_exportFBO instead of the window, and the frame is
+// handed to the FrameExporter, which reads it back through a PBO ring and
+// encodes on its worker pool. The render thread only blocks when every PBO is
+// still in flight, so a batch runs at GPU speed. Headless renderers draw
+// nothing between requests.
+
+bool Renderer::renderFrames(std::vector<FrameRequest> frames, const std::string& pipeCommand) {
+    std::shared_ptr<FrameExporter::Pipe> pipe;
+    if (!pipeCommand.empty()) {
+        pipe = FrameExporter::openPipe(pipeCommand);
+        if (!pipe) return false;
+    }
+    m_framesRequested += frames.size();
+
+    submit([this, frames = std::move(frames), pipe = std::move(pipe)]() {
+        for (const FrameRequest& request : frames) {
+            m_exportQueue.push_back({ request, pipe });
+        }
+    });
+    return true;
+}
+
+void Renderer::saveScreenshot(const std::string& path) {
+    FrameRequest request;
+    request.path = path;
+    renderFrames({ request });
+}
+
+bool Renderer::waitForFrames(double timeoutSeconds) const {
+    auto start = std::chrono::steady_clock::now();
+    while (m_exporter.finished() < m_framesRequested) {
+        if (!m_running) return false;
+        if (timeoutSeconds >= 0.0) {
+            std::chrono::duration<double> waited = std::chrono::steady_clock::now() - start;
+            if (waited.count() >= timeoutSeconds) return false;
+        }
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    return true;
+}
+
+Renderer::ExportStats Renderer::getExportStats() const {
+    return { m_framesRequested, m_exporter.finished(), m_exporter.failed() };
+}
+
+void Renderer::initExportTarget(int width, int height) {
+    if (!m_exportFBO) {
+        glGenFramebuffers(1, &m_exportFBO);
+        glGenTextures(1, &m_exportColor);
+        glGenRenderbuffers(1, &m_exportDepth);
+    }
+
+    glBindTexture(GL_TEXTURE_2D, m_exportColor);
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, width, height, 0, GL_RGBA, GL_UNSIGNED_BYTE, nullptr);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+    glBindTexture(GL_TEXTURE_2D, 0);
+
+    glBindRenderbuffer(GL_RENDERBUFFER, m_exportDepth);
+    glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH_COMPONENT24, width, height);
+    glBindRenderbuffer(GL_RENDERBUFFER, 0);
+
+    glBindFramebuffer(GL_FRAMEBUFFER, m_exportFBO);
+    glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, m_exportColor, 0);
+    glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_RENDERBUFFER, m_exportDepth);
+    if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE) {
+        std::cerr << "[Export] ERROR: Offscreen framebuffer is not complete" << std::endl;
+    }
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+
+    m_exportWidth = width;
+    m_exportHeight = height;
+}
+
+void Renderer::destroyExport() {
+    m_exporter.destroy();  // Finishes every frame already read back
+    m_exportQueue.clear();
+    m_exportCurrent = FrameExporter::Frame{};
+    if (m_exportFBO) {
+        glDeleteFramebuffers(1, &m_exportFBO);
+        glDeleteTextures(1, &m_exportColor);
+        glDeleteRenderbuffers(1, &m_exportDepth);
+        m_exportFBO = m_exportColor = m_exportDepth = 0;
+    }
+}
+
+bool Renderer::beginExportFrame() {
+    m_exportFrame = false;
+    m_sceneFBO = 0;
+    if (m_exportQueue.empty()) return false;
+
+    // Throughput is bounded here: wait for the GPU only when every PBO is taken
+    m_exporter.poll(false);
+    if (m_exporter.full()) m_exporter.poll(true);
+
+    int width = 0, height = 0;
+    glfwGetFramebufferSize(m_window, &width, &height);
+    if (width <= 0 || height <= 0) return false;  // Minimized: try again next frame
+    if (width != m_exportWidth || height != m_exportHeight) initExportTarget(width, height);
+
+    ExportJob job = std::move(m_exportQueue.front());
+    m_exportQueue.pop_front();
+
+    const FrameRequest& request = job.request;
+    if (request.morphTime >= 0.0f) m_morphTime = request.morphTime;
+    if (request.timelinePosition >= 0.0f) {
+        m_timeline.position = request.timelinePosition;
+        m_timeline.playing = false;
+    }
+    if (request.setCamera && m_camera) {
+        m_camera->setOrbit(request.yaw, request.pitch, request.distance);
+    }
+
+    m_exportCurrent.path = request.path;
+    m_exportCurrent.pipe = std::move(job.pipe);
+    m_exportFrame = true;
+    m_sceneFBO = m_exportFBO;
+    return true;
+}
+
+void Renderer::finishExportFrame() {
+    glBindFramebuffer(GL_READ_FRAMEBUFFER, m_exportFBO);
+    m_exporter.request(m_exportWidth, m_exportHeight, std::move(m_exportCurrent));
+    m_exportCurrent = FrameExporter::Frame{};
+
+    // A visible window shows the exported frame too
+    if (!m_config.headless) {
+        glBindFramebuffer(GL_DRAW_FRAMEBUFFER, 0);
+        glBlitFramebuffer(0, 0, m_exportWidth, m_exportHeight, 0, 0, m_exportWidth, m_exportHeight,
+                          GL_COLOR_BUFFER_BIT, GL_NEAREST);
+    }
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+    m_sceneFBO = 0;
+}
@@ -0,0 +1,171 @@
+#include "Renderer.h"
+#include "../core/FeatureStore.h"
+#include <glad/glad.h>
+#include <algorithm>
+#include <cfloat>
+#include <initializer_list>
+#include <iostream>
+
+#include "imgui.h"
+
+// Range filters.
+//
+// The filtered feature columns live in one buffer texture next to the
+// instance data. Every point vertex shader tests its point against the ranges
+// of the frame state and moves rejected points outside the clip volume, so
+// changing a range rewrites a few uniforms and never touches the instances.
+// The columns are re-copied only when the ranges name other columns or the
+// feature store is replaced (every frame of an animation); dragging a bound
+// only re-runs the match.
+
+void Renderer::setRangeFilters(const std::vector<RangeFilter::Range>& ranges) {
+    std::vector<RangeFilter::Range> copy;
+    for (const RangeFilter::Range& r : ranges) {
+        if ((int)copy.size() == RangeFilter::kMaxRanges) {
+            std::cerr << "[RangeFilter] ERROR: at most " << RangeFilter::kMaxRanges
+                      << " ranges, ignoring the rest" << std::endl;
+            break;
+        }
+        copy.push_back({ r.column, std::min(r.min, r.max), std::max(r.min, r.max) });
+    }
+    recordRanges(copy);
+    submit([this, copy = std::move(copy)]() mutable {
+        m_ranges.swap(copy);
+        m_rangesDirty = true;
+    });
+}
+
+long long Renderer::getFilteredCount() const {
+    return m_uiSnapshot.load(std::memory_order_acquire)->filteredCount;
+}
+
+void Renderer::selectFiltered() {
+    submit([this]() { m_selectFilteredPending = true; });
+}
+
+void Renderer::initRangeFilter() {
+    m_rangeFilter.init(m_rangeProgram);  // CPU match when 0
+
+    // Stays bound for the lifetime of the context
+    glActiveTexture(GL_TEXTURE0 + kRangeUnit);
+    glBindTexture(GL_TEXTURE_BUFFER, m_rangeFilter.texture());
+    glActiveTexture(GL_TEXTURE0);
+
+    for (unsigned int program : { m_shaderProgram, m_culledShaderProgram, m_oitProgram, m_culledOitProgram,
+                                  m_pulledShaderProgram, m_pulledOitProgram, m_pickingShaderProgram,
+                                  m_culledPickingProgram, m_pulledPickingProgram, m_densityProgram }) {
+        if (!program) continue;
+        glUseProgram(program);
+        glUniform1i(glGetUniformLocation(program, "uRangeColumns"), kRangeUnit);
+    }
+    glUseProgram(0);
+}
+
+void Renderer::updateRangeFilter() {
+    if (m_rangesDirty || m_rangeFeaturesVersion != m_featuresVersion) {
+        bool wasActive = !m_rangeFilter.active().empty();
+        m_rangeFilter.update(m_features.get(), m_ranges, m_rangeFeaturesVersion != m_featuresVersion);
+        m_rangeFeaturesVersion = m_featuresVersion;
+        m_rangesDirty = false;
+        m_rangeMatched = false;
+        if (m_rangeFilter.active().empty()) {
+            m_rangeIDs.clear();
+            if (wasActive) m_uiDirty = true;
+        }
+    }
+
+    std::vector<int> ids;
+    if (m_rangeFilter.poll(ids)) {
+        m_rangeIDs.swap(ids);
+        m_rangeMatched = true;
+        m_uiDirty = true;
+    }
+
+    if (m_selectFilteredPending) {
+        if (m_rangeFilter.active().empty()) {
+            m_selectFilteredPending = false;  // Nothing is filtered
+        } else if (m_rangeMatched) {
+            applyBrushSelection(std::vector<int>(m_rangeIDs));
+            m_selectFilteredPending = false;
+        }
+    }
+}
+
+bool Renderer::passesRanges(int id) const {
+    if (m_rangeFilter.active().empty()) return true;
+    if (!m_rangeMatched) return true;  // Not known yet; the shaders already hide it
+    return std::binary_search(m_rangeIDs.begin(), m_rangeIDs.end(), id);
+}
+
+void Renderer::renderRangeFilterControls() {
+    size_t columns = m_features ? m_features->cols() : 0;
+    if (columns == 0) {
+        ImGui::TextDisabled("No feature values loaded");
+        return;
+    }
+
+    auto columnName = [this](size_t column) -> std::string {
+        if (column < m_featureNames.size()) return m_featureNames[column];
+        return "Feature " + std::to_string(column);
+    };
+    bool edited = false;
+
+    for (size_t k = 0; k < m_ranges.size();) {
+        RangeFilter::Range& range = m_ranges[k];
+        // Dragged within the column's extent when its statistics are known
+        float lo = 0.0f, hi = 0.0f;
+        if (range.column < m_statsData.size()) {
+            lo = m_statsData[range.column].min;
+            hi = m_statsData[range.column].max;
+        }
+        float speed = hi > lo ? (hi - lo) / 200.0f : 0.01f;
+
+        ImGui::PushID((int)k);
+        if (ImGui::DragFloatRange2(columnName(range.column).c_str(), &range.min, &range.max, speed, lo, hi,
+                                   "%.3g", "%.3g")) {
+            edited = true;
+        }
+        ImGui::SameLine();
+        bool removed = ImGui::SmallButton("x");
+        ImGui::PopID();
+        if (removed) {
+            m_ranges.erase(m_ranges.begin() + k);
+            edited = true;
+        } else {
+            k++;
+        }
+    }
+
+    if ((int)m_ranges.size() < RangeFilter::kMaxRanges && ImGui::BeginCombo("Add Range", "Feature...")) {
+        for (size_t column = 0; column < columns; column++) {
+            bool used = std::any_of(m_ranges.begin(), m_ranges.end(),
+                                    [column](const RangeFilter::Range& r) { return r.column == column; });
+            if (used || !ImGui::Selectable(columnName(column).c_str())) continue;
+            // Starts open over the whole column
+            RangeFilter::Range range{ column, -FLT_MAX, FLT_MAX };
+            if (column < m_statsData.size()) {
+                range.min = m_statsData[column].min;
+                range.max = m_statsData[column].max;
+            }
+            m_ranges.push_back(range);
+            edited = true;
+        }
+        ImGui::EndCombo();
+    }
+
+    if (!m_rangeFilter.active().empty()) {
+        ImGui::Text("Passing: %zu / %zu", m_rangeIDs.size(), m_rangeFilter.rows());
+        ImGui::SameLine();
+        if (ImGui::SmallButton("Select")) m_selectFilteredPending = true;
+        ImGui::SameLine();
+        if (ImGui::SmallButton("Clear")) {
+            m_ranges.clear();
+            edited = true;
+        }
+    }
+
+    if (edited) {
+        m_rangesDirty = true;
+        recordRanges(m_ranges);  // As if set with setRangeFilters
+    }
+}
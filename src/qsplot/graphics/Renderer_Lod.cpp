@@ -0,0 +1,108 @@
+#include "Renderer.h"
+#include "Camera.h"
+#include <glad/glad.h>
+#include <GLFW/glfw3.h>
+#include <iostream>
+#include <algorithm>
+#include <Eigen/Dense>
+
+// Level of detail by density aggregation.
+//
+// Every frame the instances are splatted as single pixels into a downsampled
+// RG32F target (count, value sum). Cells holding more than m_lodThreshold points
+// are then drawn by one full-screen composite pass, and the billboard vertex
+// shader drops the instances that fall into them. Zooming in spreads the
+// points over more cells, so the view refines back to individual billboards.
+
+bool Renderer::lodActive() const {
+    if (!m_densityProgram || !m_densityCompositeProgram || m_renderCount == 0) return false;
+    // The splat pass reads the point-set attributes, not the keyframe slots
+    if (m_timelineActive) return false;
+    // The density target covers the whole window, not one viewport
+    if (multiView()) return false;
+    if (m_lodMode == 2) return true;
+    return m_lodMode == 1 && m_renderCount >= m_config.lodMinPoints;
+}
+
+void Renderer::initDensityTarget(int width, int height) {
+    if (width <= 0 || height <= 0) return;
+
+    if (m_densityFBO) {
+        glDeleteFramebuffers(1, &m_densityFBO);
+        glDeleteTextures(1, &m_densityTexture);
+    }
+
+    glGenFramebuffers(1, &m_densityFBO);
+    glBindFramebuffer(GL_FRAMEBUFFER, m_densityFBO);
+
+    glGenTextures(1, &m_densityTexture);
+    glBindTexture(GL_TEXTURE_2D, m_densityTexture);
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_RG32F, width, height, 0, GL_RG, GL_FLOAT, NULL);
+    // Nearest: cells are tested against the threshold individually
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, m_densityTexture, 0);
+    glBindTexture(GL_TEXTURE_2D, 0);
+
+    if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE) {
+        std::cerr << "[LOD] Density FBO is not complete, LOD disabled" << std::endl;
+        glDeleteProgram(m_densityProgram);
+        m_densityProgram = 0;
+    }
+
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+    m_densityWidth = width;
+    m_densityHeight = height;
+}
+
+void Renderer::renderDensityPass() {
+    int fbWidth, fbHeight;
+    glfwGetFramebufferSize(m_window, &fbWidth, &fbHeight);
+    int cell = std::max(1, m_config.lodDownsample);
+    int width = std::max(1, fbWidth / cell);
+    int height = std::max(1, fbHeight / cell);
+    if (width != m_densityWidth || height != m_densityHeight || !m_densityFBO) {
+        initDensityTarget(width, height);
+        if (!m_densityProgram) return;
+    }
+
+    GLint lastViewport[4]; glGetIntegerv(GL_VIEWPORT, lastViewport);
+
+    glBindFramebuffer(GL_FRAMEBUFFER, m_densityFBO);
+    glViewport(0, 0, m_densityWidth, m_densityHeight);
+    float zero[4] = {0.0f, 0.0f, 0.0f, 0.0f};
+    glClearBufferfv(GL_COLOR, 0, zero);
+
+    // Pure accumulation: every point counts, none occludes another
+    glDisable(GL_DEPTH_TEST);
+    glEnable(GL_BLEND);
+    glBlendFunc(GL_ONE, GL_ONE);
+
+    glUseProgram(m_densityProgram);
+
+    glBindVertexArray(m_validVAO);
+    glDrawArraysInstanced(GL_POINTS, 0, 1, (GLsizei)m_renderCount);
+
+    glBindFramebuffer(GL_FRAMEBUFFER, m_sceneFBO);
+    glViewport(lastViewport[0], lastViewport[1], lastViewport[2], lastViewport[3]);
+    glEnable(GL_DEPTH_TEST);
+    glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+}
+
+void Renderer::renderDensityComposite() {
+    // Aggregates sit behind the billboards and never write depth
+    glDisable(GL_DEPTH_TEST);
+    glDepthMask(GL_FALSE);
+
+    glUseProgram(m_densityCompositeProgram);
+    glActiveTexture(GL_TEXTURE0);
+    glBindTexture(GL_TEXTURE_2D, m_densityTexture);
+
+    glBindVertexArray(m_fullscreenVAO);
+    glDrawArrays(GL_TRIANGLES, 0, 3);
+
+    glDepthMask(GL_TRUE);
+    glEnable(GL_DEPTH_TEST);
+}
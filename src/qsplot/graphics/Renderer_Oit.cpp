@@ -0,0 +1,120 @@
+#include "Renderer.h"
+#include <glad/glad.h>
+#include <GLFW/glfw3.h>
+#include <iostream>
+
+// Weighted blended order-independent transparency.
+//
+// Blending translucent billboards in instance order is only correct for
+// sorted input. With alpha < 1 the billboards are instead drawn once, unsorted
+// and depth tested without depth writes, into two full-resolution targets: the
+// weighted sum of premultiplied colors and the product of (1 - alpha). A
+// full-screen pass divides the sum by its weight and blends it over the scene
+// with the remaining coverage. The weight favours near fragments, which approximates
+// front-to-back compositing without any per-frame sort.
+
+bool Renderer::oitActive() const {
+    if (m_transparencyMode != 1 || m_globalAlpha >= 1.0f) return false;
+    if (!m_oitCompositeProgram || !m_camera) return false;
+    return oitProgram() != 0;
+}
+
+void Renderer::initOitTarget(int width, int height) {
+    if (width <= 0 || height <= 0) return;
+
+    if (m_oitFBO) {
+        glDeleteFramebuffers(1, &m_oitFBO);
+        glDeleteTextures(1, &m_oitAccumTexture);
+        glDeleteTextures(1, &m_oitRevealTexture);
+        glDeleteRenderbuffers(1, &m_oitDepth);
+    }
+
+    glGenFramebuffers(1, &m_oitFBO);
+    glBindFramebuffer(GL_FRAMEBUFFER, m_oitFBO);
+
+    // Read texel for texel by the composite pass
+    glGenTextures(1, &m_oitAccumTexture);
+    glBindTexture(GL_TEXTURE_2D, m_oitAccumTexture);
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA16F, width, height, 0, GL_RGBA, GL_FLOAT, NULL);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+    glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, m_oitAccumTexture, 0);
+
+    glGenTextures(1, &m_oitRevealTexture);
+    glBindTexture(GL_TEXTURE_2D, m_oitRevealTexture);
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_R16F, width, height, 0, GL_RED, GL_FLOAT, NULL);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+    glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT1, GL_TEXTURE_2D, m_oitRevealTexture, 0);
+    glBindTexture(GL_TEXTURE_2D, 0);
+
+    glGenRenderbuffers(1, &m_oitDepth);
+    glBindRenderbuffer(GL_RENDERBUFFER, m_oitDepth);
+    glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH_COMPONENT24, width, height);
+    glBindRenderbuffer(GL_RENDERBUFFER, 0);
+    glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_RENDERBUFFER, m_oitDepth);
+
+    GLenum drawBuffers[2] = { GL_COLOR_ATTACHMENT0, GL_COLOR_ATTACHMENT1 };
+    glDrawBuffers(2, drawBuffers);
+
+    if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE) {
+        std::cerr << "[OIT] Transparency FBO is not complete, falling back to ordered blending" << std::endl;
+        glDeleteProgram(m_oitCompositeProgram);
+        m_oitCompositeProgram = 0;
+    }
+
+    glBindFramebuffer(GL_FRAMEBUFFER, m_sceneFBO);
+    m_oitWidth = width;
+    m_oitHeight = height;
+}
+
+void Renderer::renderTransparentPoints() {
+    int fbWidth, fbHeight;
+    glfwGetFramebufferSize(m_window, &fbWidth, &fbHeight);
+    if (fbWidth != m_oitWidth || fbHeight != m_oitHeight || !m_oitFBO) {
+        initOitTarget(fbWidth, fbHeight);
+    }
+    unsigned int program = oitProgram();
+    if (!m_oitCompositeProgram) {
+        // Target failed: blend in instance order instead
+        program = pointProgram();
+        glUseProgram(program);
+        drawPoints(program);
+        return;
+    }
+
+    glBindFramebuffer(GL_FRAMEBUFFER, m_oitFBO);
+    float zero[4] = {0.0f, 0.0f, 0.0f, 0.0f};
+    float one[4] = {1.0f, 1.0f, 1.0f, 1.0f};
+    glClearBufferfv(GL_COLOR, 0, zero);
+    glClearBufferfv(GL_COLOR, 1, one);
+    // Nothing opaque is drawn before the billboards, so a cleared buffer holds the scene depth
+    glClearBufferfv(GL_DEPTH, 0, one);
+
+    // Depth tested but not written: every visible fragment contributes, depth also shapes the weights
+    glEnable(GL_DEPTH_TEST);
+    glDepthMask(GL_FALSE);
+    glEnable(GL_BLEND);
+    glBlendFunci(0, GL_ONE, GL_ONE);
+    glBlendFunci(1, GL_ZERO, GL_ONE_MINUS_SRC_COLOR);
+
+    glUseProgram(program);
+    drawPoints(program);
+
+    // Resolve over the background and density aggregates
+    glBindFramebuffer(GL_FRAMEBUFFER, m_sceneFBO);
+    glDisable(GL_DEPTH_TEST);
+    glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+    glUseProgram(m_oitCompositeProgram);
+    glActiveTexture(GL_TEXTURE0);
+    glBindTexture(GL_TEXTURE_2D, m_oitAccumTexture);
+    glActiveTexture(GL_TEXTURE1);
+    glBindTexture(GL_TEXTURE_2D, m_oitRevealTexture);
+    glBindVertexArray(m_fullscreenVAO);
+    glDrawArrays(GL_TRIANGLES, 0, 3);
+
+    glBindTexture(GL_TEXTURE_2D, 0);
+    glActiveTexture(GL_TEXTURE0);
+    glDepthMask(GL_TRUE);
+    glEnable(GL_DEPTH_TEST);
+}
@@ -3,9 +3,12 @@
 #include <glad/glad.h>
 #include <GLFW/glfw3.h>
 #include <iostream>
-#include <set>
+#include <algorithm>
+#include <cmath>
 #include <Eigen/Dense>
 
+#include "imgui.h"
+
 void Renderer::initPickingFBO(int width, int height) {
     if (width <= 0 || height <= 0) return;
 
@@ -39,192 +42,258 @@ void Renderer::initPickingFBO(int width, int height) {
     }
 
     glBindFramebuffer(GL_FRAMEBUFFER, 0);
+    m_pickingWidth = width;
+    m_pickingHeight = height;
 }
 
-int Renderer::getPickedID(double mouseX, double mouseY) {
-    if (!m_pickingFBO || !m_camera) return -1;
+bool Renderer::windowToFramebuffer(double x, double y, int& px, int& py) const {
+    int fbWidth, fbHeight;
+    glfwGetFramebufferSize(m_window, &fbWidth, &fbHeight);
+    int winWidth, winHeight;
+    glfwGetWindowSize(m_window, &winWidth, &winHeight);
+    if (winWidth == 0 || winHeight == 0) return false;
 
-    // 1. Sace current OpenGL settings
+    double scaleX = (double)fbWidth / (double)winWidth;
+    double scaleY = (double)fbHeight / (double)winHeight;
+    px = (int)(x * scaleX);
+    py = (int)(((double)winHeight - y) * scaleY);  // Y inverted (window is top-left)
+    if (multiView()) {
+        // Split views pick in the active viewport's own pixels
+        const int* rect = m_viewports[m_activeViewport].rect;
+        px -= rect[0];
+        py -= rect[1];
+        fbWidth = rect[2];
+        fbHeight = rect[3];
+    }
+    return px >= 0 && px < fbWidth && py >= 0 && py < fbHeight;
+}
+
+void Renderer::renderPickingPass(int x, int y, int width, int height) {
+    // Save current OpenGL settings
     GLint lastViewport[4]; glGetIntegerv(GL_VIEWPORT, lastViewport);
     GLboolean lastScissor = glIsEnabled(GL_SCISSOR_TEST);
     GLboolean lastBlend = glIsEnabled(GL_BLEND);
     GLboolean lastDither = glIsEnabled(GL_DITHER);
 
-    glDisable(GL_SCISSOR_TEST);
     glDisable(GL_BLEND);
     glDisable(GL_DITHER);
     glEnable(GL_DEPTH_TEST);
 
-    int fbWidth, fbHeight;
-    glfwGetFramebufferSize(m_window, &fbWidth, &fbHeight);
-    int winWidth, winHeight;
-    glfwGetWindowSize(m_window, &winWidth, &winHeight);
-
-    if (winWidth == 0 || winHeight == 0) return -1;
+    int viewWidth, viewHeight;
+    viewSize(viewWidth, viewHeight);
 
     glBindFramebuffer(GL_FRAMEBUFFER, m_pickingFBO);
-    glViewport(0, 0, fbWidth, fbHeight);
-    
+    glViewport(0, 0, viewWidth, viewHeight);
+
+    // Only the requested region is cleared and shaded
+    glEnable(GL_SCISSOR_TEST);
+    glScissor(x, y, width, height);
+
     int clearVal = -1;
     glClearBufferiv(GL_COLOR, 0, &clearVal);
     glClear(GL_DEPTH_BUFFER_BIT);
 
-    glUseProgram(m_pickingShaderProgram);
+    GLuint program = pickingProgram();
+    glUseProgram(program);
+    drawPoints(program);
 
-    Eigen::Matrix4f vp = m_camera->getViewProjectionMatrix();
-    glUniformMatrix4fv(glGetUniformLocation(m_pickingShaderProgram, "uVP"), 1, GL_FALSE, vp.data());
-    glUniform1f(glGetUniformLocation(m_pickingShaderProgram, "uScale"), m_pointScale); 
-    glUniform1f(glGetUniformLocation(m_pickingShaderProgram, "uTime"), m_morphTime);
-    
-    Eigen::Vector3f right = m_camera->getRight();
-    Eigen::Vector3f up    = m_camera->getUp();
-    glUniform3fv(glGetUniformLocation(m_pickingShaderProgram, "uCameraRight"), 1, right.data());
-    glUniform3fv(glGetUniformLocation(m_pickingShaderProgram, "uCameraUp"), 1, up.data());
-
-    glBindVertexArray(m_validVAO);
-    glDrawArraysInstanced(GL_TRIANGLE_STRIP, 0, 4, (GLsizei)m_renderCount);
-
-    glFlush();
-    glFinish();
-
-    double scaleX = (double)fbWidth / (double)winWidth;
-    double scaleY = (double)fbHeight / (double)winHeight;
-    double invertedY = (double)winHeight - mouseY; // Y Ekseni Tersi
-
-    int readX = (int)(mouseX * scaleX);
-    int readY = (int)(invertedY * scaleY);
-
-    int id = -1;
-    if (readX >= 0 && readX < fbWidth && readY >= 0 && readY < fbHeight) {
-        if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE) {
-             std::cerr << "[Picking] FBO Incomplete! Aborting read." << std::endl;
-             return -1;
-        }
-
-        glPixelStorei(GL_PACK_ALIGNMENT, 1);
-        glReadBuffer(GL_COLOR_ATTACHMENT0); 
-        
-        glReadPixels(readX, readY, 1, 1, GL_RED_INTEGER, GL_INT, &id);
-        
-        GLenum err = glGetError();
-        if (err != GL_NO_ERROR) {
-             std::cerr << "[Picking] glReadPixels Error: " << err << std::endl;
-             id = -1; 
-        }
-
-        glPixelStorei(GL_PACK_ALIGNMENT, 4);
-    } else {
-        id = -1;
-    }
-
-    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+    glBindFramebuffer(GL_FRAMEBUFFER, m_sceneFBO);
     glViewport(lastViewport[0], lastViewport[1], lastViewport[2], lastViewport[3]);
-    if (lastScissor) glEnable(GL_SCISSOR_TEST);
+    if (!lastScissor) glDisable(GL_SCISSOR_TEST);
     if (lastBlend) glEnable(GL_BLEND);
     if (lastDither) glEnable(GL_DITHER);
-
-    return id;
 }
 
-std::vector<int> Renderer::getPickedIDsInRect(double x1, double y1, double x2, double y2) {
-    std::vector<int> result;
-    if (!m_pickingFBO || !m_camera) return result;
-
-    // Ensure proper ordering
-    double minX = std::min(x1, x2);
-    double maxX = std::max(x1, x2);
-    double minY = std::min(y1, y2);
-    double maxY = std::max(y1, y2);
-
-    // Save OpenGL state
-    GLint lastViewport[4]; glGetIntegerv(GL_VIEWPORT, lastViewport);
-    GLboolean lastScissor = glIsEnabled(GL_SCISSOR_TEST);
-    GLboolean lastBlend = glIsEnabled(GL_BLEND);
-    GLboolean lastDither = glIsEnabled(GL_DITHER);
-
-    glDisable(GL_SCISSOR_TEST);
-    glDisable(GL_BLEND);
-    glDisable(GL_DITHER);
-    glEnable(GL_DEPTH_TEST);
+void Renderer::issuePickRequests() {
+    if (!m_pickingFBO || !m_camera) return;
 
     int fbWidth, fbHeight;
     glfwGetFramebufferSize(m_window, &fbWidth, &fbHeight);
-    int winWidth, winHeight;
-    glfwGetWindowSize(m_window, &winWidth, &winHeight);
+    if (fbWidth <= 0 || fbHeight <= 0) return;
+    if (fbWidth != m_pickingWidth || fbHeight != m_pickingHeight) {
+        initPickingFBO(fbWidth, fbHeight);
+    }
 
-    if (winWidth == 0 || winHeight == 0) return result;
+    // Read a scissored ID pass back through the PBO ring; clamped to the (active) view
+    int viewWidth, viewHeight;
+    viewSize(viewWidth, viewHeight);
+    auto request = [&](int x, int y, int w, int h, int tag) {
+        int x0 = std::max(0, x), y0 = std::max(0, y);
+        int x1 = std::min(viewWidth, x + w), y1 = std::min(viewHeight, y + h);
+        if (x1 <= x0 || y1 <= y0) return true;  // Nothing on screen to read
+
+        renderPickingPass(x0, y0, x1 - x0, y1 - y0);
+        glBindFramebuffer(GL_READ_FRAMEBUFFER, m_pickingFBO);
+        bool queued = m_pickReadback.request(x0, y0, x1 - x0, y1 - y0, tag);
+        glBindFramebuffer(GL_READ_FRAMEBUFFER, 0);
+        return queued;
+    };
+
+    // Clicks and brushes wait for a free slot; hover is simply skipped this frame
+    if (m_clickPending && m_config.spatialPicking) {
+        pickClickRay();  // Resolved right away against the spatial index
+        m_clickPending = false;
+    }
+    if (m_clickPending) {
+        int r = kHoverRadius;
+        if (request(m_clickPixelX - r, m_clickPixelY - r, 2 * r + 1, 2 * r + 1, PickClick)) {
+            m_clickPending = false;
+        }
+    }
+    if (m_rectPending) {
+        issueBrushSelection();
+    }
+    if (m_hoverPickActive) {
+        ImGuiIO& io = ImGui::GetIO();
+        int px, py;
+        if (windowToFramebuffer(io.MousePos.x, io.MousePos.y, px, py)) {
+            int r = kHoverRadius;
+            request(px - r, py - r, 2 * r + 1, 2 * r + 1, PickHover);
+        } else {
+            m_hoveredID = -1;  // Cursor left the window
+        }
+    }
+}
 
-    // Render picking pass
-    glBindFramebuffer(GL_FRAMEBUFFER, m_pickingFBO);
-    glViewport(0, 0, fbWidth, fbHeight);
-    
-    int clearVal = -1;
-    glClearBufferiv(GL_COLOR, 0, &clearVal);
-    glClear(GL_DEPTH_BUFFER_BIT);
+// ID closest to the centre of a small pick window (-1 if the window is empty)
+static int nearestID(const AsyncReadback::Result& res, int centerX, int centerY) {
+    int best = -1;
+    int bestDist = 0;
+    for (int row = 0; row < res.height; row++) {
+        for (int col = 0; col < res.width; col++) {
+            int id = res.pixels[(size_t)row * res.width + col];
+            if (id < 0) continue;
+            int dx = res.x + col - centerX;
+            int dy = res.y + row - centerY;
+            int dist = dx * dx + dy * dy;
+            if (best < 0 || dist < bestDist) {
+                best = id;
+                bestDist = dist;
+            }
+        }
+    }
+    return best;
+}
 
-    glUseProgram(m_pickingShaderProgram);
+// Cursor pixel of a (2r+1)^2 pick window, recovered from its border clamping
+static void windowCenter(const AsyncReadback::Result& res, int r, int& cx, int& cy) {
+    cx = (res.x == 0 && res.width < 2 * r + 1) ? res.width - 1 - r : res.x + r;
+    cy = (res.y == 0 && res.height < 2 * r + 1) ? res.height - 1 - r : res.y + r;
+}
 
+void Renderer::processPickResults() {
+    AsyncReadback::Result res;
+    while (m_pickReadback.poll(res)) {
+        int cx, cy;
+        windowCenter(res, kHoverRadius, cx, cy);
+        switch (res.tag) {
+        case PickHover:
+            if (m_hoverPickActive) m_hoveredID = nearestID(res, cx, cy);
+            break;
+        case PickClick: {
+            int picked = nearestID(res, cx, cy);
+            if (picked != -1) {
+                m_selectedID = picked;
+                m_selectedIDs.clear();  // Single select clears multi-select
+                m_uiDirty = true;
+            }
+            break;
+        }
+        case PickRect: {
+            // CPU fallback of the visible-only brush
+            SelectionEngine::Query query = makeSelectionQuery();
+            query.brush = m_activeBrush;
+            applyBrushSelection(SelectionEngine::collectVisibleCPU(
+                query, res.pixels.data(), res.x, res.y, res.width, res.height));
+            break;
+        }
+        }
+    }
+
+    std::vector<int> ids;
+    if (m_selection.poll(ids)) {
+        applyBrushSelection(std::move(ids));
+    }
+}
+
+SelectionEngine::Query Renderer::makeSelectionQuery() const {
+    SelectionEngine::Query query;
     Eigen::Matrix4f vp = m_camera->getViewProjectionMatrix();
-    glUniformMatrix4fv(glGetUniformLocation(m_pickingShaderProgram, "uVP"), 1, GL_FALSE, vp.data());
-    glUniform1f(glGetUniformLocation(m_pickingShaderProgram, "uScale"), m_pointScale); 
-    glUniform1f(glGetUniformLocation(m_pickingShaderProgram, "uTime"), m_morphTime);
-    
-    Eigen::Vector3f right = m_camera->getRight();
-    Eigen::Vector3f up    = m_camera->getUp();
-    glUniform3fv(glGetUniformLocation(m_pickingShaderProgram, "uCameraRight"), 1, right.data());
-    glUniform3fv(glGetUniformLocation(m_pickingShaderProgram, "uCameraUp"), 1, up.data());
-
-    glBindVertexArray(m_validVAO);
-    glDrawArraysInstanced(GL_TRIANGLE_STRIP, 0, 4, (GLsizei)m_renderCount);
-
-    glFlush();
-    glFinish();
-
-    // Map window coords to framebuffer coords
-    double scaleX = (double)fbWidth / (double)winWidth;
-    double scaleY = (double)fbHeight / (double)winHeight;
+    std::copy(vp.data(), vp.data() + 16, query.viewProj);
+    query.morphTime = m_morphTime;
+    viewSize(query.viewportWidth, query.viewportHeight);
 
-    int readMinX = std::max(0, (int)(minX * scaleX));
-    int readMaxX = std::min(fbWidth - 1, (int)(maxX * scaleX));
-    int readMinY = std::max(0, (int)(((double)winHeight - maxY) * scaleY));  // Y inverted
-    int readMaxY = std::min(fbHeight - 1, (int)(((double)winHeight - minY) * scaleY));
-
-    int readW = readMaxX - readMinX + 1;
-    int readH = readMaxY - readMinY + 1;
-
-    if (readW > 0 && readH > 0) {
-        std::vector<int> pixelData(readW * readH);
-        glPixelStorei(GL_PACK_ALIGNMENT, 1);
-        glReadBuffer(GL_COLOR_ATTACHMENT0);
-        glReadPixels(readMinX, readMinY, readW, readH, GL_RED_INTEGER, GL_INT, pixelData.data());
-        glPixelStorei(GL_PACK_ALIGNMENT, 4);
-
-        // Collect unique IDs
-        std::set<int> uniqueIDs;
-        for (int id : pixelData) {
-            if (id >= 0) {
-                uniqueIDs.insert(id);
-            }
+    query.current = currentSource();
+    query.next = nextSource();
+    return query;
+}
+
+void Renderer::issueBrushSelection() {
+    SelectionEngine::Query query = makeSelectionQuery();
+    query.brush = m_pendingBrush;
+
+    if (m_selectOccluded) {
+        // Every instance inside the brush, front-most or not
+        // The projection pass reads float positions, which packed sets only have on the CPU
+        if (m_selection.gpuAvailable() && query.current.buffer) {
+            if (!m_selection.submitAll(query)) return;  // Previous query in flight
+        } else {
+            applyBrushSelection(SelectionEngine::selectCPU(query));
+        }
+    } else {
+        // Only IDs that survive the depth test in the brush bounds
+        float minX = query.brush[0], maxX = query.brush[0];
+        float minY = query.brush[1], maxY = query.brush[1];
+        for (size_t i = 2; i + 1 < query.brush.size(); i += 2) {
+            minX = std::min(minX, query.brush[i]);
+            maxX = std::max(maxX, query.brush[i]);
+            minY = std::min(minY, query.brush[i + 1]);
+            maxY = std::max(maxY, query.brush[i + 1]);
+        }
+        int x0 = std::max(0, (int)minX), y0 = std::max(0, (int)minY);
+        int x1 = std::min(query.viewportWidth, (int)std::ceil(maxX));
+        int y1 = std::min(query.viewportHeight, (int)std::ceil(maxY));
+        bool onScreen = x1 > x0 && y1 > y0;
+
+        if (m_selection.gpuAvailable()) {
+            if (m_selection.busy()) return;
+            if (onScreen) renderPickingPass(x0, y0, x1 - x0, y1 - y0);
+            m_selection.submitVisible(query, m_pickingTexture);
+        } else if (onScreen) {
+            // Read the ID region back and resolve it on the CPU (see processPickResults)
+            renderPickingPass(x0, y0, x1 - x0, y1 - y0);
+            glBindFramebuffer(GL_READ_FRAMEBUFFER, m_pickingFBO);
+            bool queued = m_pickReadback.request(x0, y0, x1 - x0, y1 - y0, PickRect);
+            glBindFramebuffer(GL_READ_FRAMEBUFFER, 0);
+            if (!queued) return;
         }
-        result.assign(uniqueIDs.begin(), uniqueIDs.end());
     }
 
-    // Restore state
-    glBindFramebuffer(GL_FRAMEBUFFER, 0);
-    glViewport(lastViewport[0], lastViewport[1], lastViewport[2], lastViewport[3]);
-    if (lastScissor) glEnable(GL_SCISSOR_TEST);
-    if (lastBlend) glEnable(GL_BLEND);
-    if (lastDither) glEnable(GL_DITHER);
+    m_activeBrush = std::move(m_pendingBrush);
+    m_pendingBrush.clear();
+    m_rectPending = false;
+}
 
-    return result;
+void Renderer::applyBrushSelection(std::vector<int>&& ids) {
+    // Points hidden by the active viewport's subset or a range filter are not selectable
+    if (multiView() || !m_rangeFilter.active().empty()) {
+        ids.erase(std::remove_if(ids.begin(), ids.end(),
+                                 [this](int id) { return !inActiveSubset(id) || !passesRanges(id); }),
+                  ids.end());
+    }
+    m_selectedIDs = std::move(ids);
+    m_selectedID = m_selectedIDs.empty() ? -1 : m_selectedIDs[0];
+    m_uiDirty = true;
 }
 
 std::vector<int> Renderer::getSelectedIDs() const {
-    return m_selectedIDs;
+    return m_uiSnapshot.load(std::memory_order_acquire)->selectedIDs;
 }
 
 void Renderer::clearSelection() {
-    std::lock_guard<std::mutex> lock(m_dataMutex);
-    m_selectedIDs.clear();
-    m_selectedID = -1;
+    submit([this]() {
+        m_selectedIDs.clear();
+        m_selectedID = -1;
+        m_uiDirty = true;
+    });
 }
@@ -0,0 +1,372 @@
+#include "Renderer.h"
+#include "../core/FeatureStore.h"
+#include "../core/SessionLog.h"
+#include <algorithm>
+#include <chrono>
+#include <iostream>
+
+// Session recording and replay.
+//
+// Every recorded producer setter records its arguments as it is called,
+// before the payload is handed to the queue, and the render thread records
+// camera input and the UI's color mode and range filter edits as it applies
+// them; SessionWriter stamps and queues the bytes and a writer thread does the
+// encoding and the disk I/O. Replay decodes each record and calls the same
+// setter again, so a recording is also a load generator that drives the
+// queue, the uploads and the frame loop exactly as the original producer did.
+// The keyframe timeline is not recorded: its frames come from a dataset or a
+// prefetcher, not from the command stream.
+
+namespace {
+
+constexpr uint64_t kMaxRecordCount = uint64_t(1) << 40;  // Rejects counts that would overflow sizes
+constexpr auto kReplayPoll = std::chrono::milliseconds(50);  // stopReplay() latency while waiting
+
+Renderer::RecordingStats statsOf(const SessionWriter& writer, bool active) {
+    SessionWriter::Stats s = writer.stats();
+    return {active, writer.path(), s.records, s.bytes, s.storedBytes, s.queuedBytes, s.failed};
+}
+
+std::shared_ptr<const FeatureStore> makeStore(std::vector<float> values, size_t rows, size_t cols) {
+    if (rows == 0 || cols == 0) return nullptr;
+    auto all = std::make_shared<const std::vector<float>>(std::move(values));
+    FeatureStore::View view;
+    view.data = all->data();
+    view.type = FeatureStore::View::Type::Float32;
+    view.rows = (Eigen::Index)rows;
+    view.cols = (Eigen::Index)cols;
+    view.rowStride = (Eigen::Index)cols;
+    view.colStride = 1;
+    view.owner = std::move(all);
+    return std::make_shared<const FeatureStore>(std::move(view));
+}
+
+// Calls the setter a record was made from; false if the payload is malformed
+bool applyRecord(Renderer& renderer, SessionKind kind, const std::vector<uint8_t>& payload) {
+    SessionCursor in(payload);
+    switch (kind) {
+    case SessionKind::Points:
+    case SessionKind::TargetPoints: {
+        uint64_t count;
+        uint8_t hasPositions, hasValues;
+        std::vector<float> positions, values;
+        if (!in.get(count) || !in.get(hasPositions) || !in.get(hasValues) || count > kMaxRecordCount) return false;
+        if (hasPositions && !in.getArray(positions, count * 3)) return false;
+        if (hasValues && !in.getArray(values, count)) return false;
+        const float* p = hasPositions ? positions.data() : nullptr;
+        const float* v = hasValues ? values.data() : nullptr;
+        if (kind == SessionKind::Points) {
+            renderer.setPoints(p, v, count);
+        } else {
+            renderer.setTargetPoints(p, v, count);
+        }
+        return true;
+    }
+    case SessionKind::UpdatePoints:
+    case SessionKind::UpdateTargetPoints: {
+        uint64_t count;
+        uint8_t hasPositions, hasValues;
+        std::vector<int> indices;
+        std::vector<float> positions, values;
+        if (!in.get(count) || !in.get(hasPositions) || !in.get(hasValues) || count > kMaxRecordCount) return false;
+        if (!in.getArray(indices, count)) return false;
+        if (hasPositions && !in.getArray(positions, count * 3)) return false;
+        if (hasValues && !in.getArray(values, count)) return false;
+        const float* p = hasPositions ? positions.data() : nullptr;
+        const float* v = hasValues ? values.data() : nullptr;
+        // Rejected patches were rejected when recorded too: nothing to apply either way
+        if (kind == SessionKind::UpdatePoints) {
+            renderer.updatePoints(indices.data(), p, v, count);
+        } else {
+            renderer.updateTargetPoints(indices.data(), p, v, count);
+        }
+        return true;
+    }
+    case SessionKind::Tickers:
+    case SessionKind::FeatureNames: {
+        std::vector<std::string> list;
+        if (!in.getStrings(list)) return false;
+        if (kind == SessionKind::Tickers) {
+            renderer.setTickers(list);
+        } else {
+            renderer.setFeatureNames(list);
+        }
+        return true;
+    }
+    case SessionKind::DimensionLabels: {
+        std::string color, x, y, z;
+        if (!in.getString(color) || !in.getString(x) || !in.getString(y) || !in.getString(z)) return false;
+        renderer.setDimensionLabels(color, x, y, z);
+        return true;
+    }
+    case SessionKind::Categories: {
+        uint64_t count;
+        std::vector<uint8_t> labels;
+        std::vector<std::string> names;
+        if (!in.get(count) || count > kMaxRecordCount || !in.getArray(labels, count) || !in.getStrings(names)) {
+            return false;
+        }
+        renderer.setCategories(labels.data(), labels.size(), names);
+        return true;
+    }
+    case SessionKind::ColorMode: {
+        int32_t mode;
+        if (!in.get(mode)) return false;
+        renderer.setColorMode(mode);
+        return true;
+    }
+    case SessionKind::ExplainedVariance: {
+        uint64_t count;
+        std::vector<float> variance;
+        if (!in.get(count) || count > kMaxRecordCount || !in.getArray(variance, count)) return false;
+        renderer.setExplainedVariance(variance);
+        return true;
+    }
+    case SessionKind::FeatureValues:
+    case SessionKind::FeatureStore: {
+        uint64_t rows, cols;
+        std::vector<float> values;
+        if (!in.get(rows) || !in.get(cols) || rows > kMaxRecordCount || cols > kMaxRecordCount) return false;
+        if (cols > 0 && rows > kMaxRecordCount / cols) return false;
+        if (!in.getArray(values, rows * cols)) return false;
+        if (kind == SessionKind::FeatureValues) {
+            renderer.setAllFeatureValues(values.data(), rows, cols);
+        } else {
+            renderer.setFeatureStore(makeStore(std::move(values), rows, cols));
+        }
+        return true;
+    }
+    case SessionKind::CameraOrbit: {
+        float deltaX, deltaY;
+        if (!in.get(deltaX) || !in.get(deltaY)) return false;
+        renderer.orbitCamera(deltaX, deltaY);
+        return true;
+    }
+    case SessionKind::CameraZoom: {
+        float delta;
+        if (!in.get(delta)) return false;
+        renderer.zoomCamera(delta);
+        return true;
+    }
+    case SessionKind::ViewportCamera: {
+        uint64_t viewport;
+        float yaw, pitch, distance;
+        if (!in.get(viewport) || !in.get(yaw) || !in.get(pitch) || !in.get(distance)) return false;
+        renderer.setViewportCamera(viewport, yaw, pitch, distance);
+        return true;
+    }
+    case SessionKind::Stats: {
+        uint64_t count;
+        if (!in.get(count) || count > in.remaining()) return false;
+        std::vector<Renderer::StatsData> stats(count);
+        for (Renderer::StatsData& s : stats) {
+            int32_t rows;
+            if (!in.getString(s.name) || !in.get(s.min) || !in.get(s.max) || !in.get(s.mean) || !in.get(s.std) ||
+                !in.get(s.median) || !in.get(rows)) {
+                return false;
+            }
+            s.count = rows;
+        }
+        renderer.setStats(stats);
+        return true;
+    }
+    case SessionKind::RangeFilters: {
+        uint64_t count;
+        if (!in.get(count) || count > in.remaining()) return false;
+        std::vector<RangeFilter::Range> ranges(count);
+        for (RangeFilter::Range& r : ranges) {
+            uint64_t column;
+            if (!in.get(column) || !in.get(r.min) || !in.get(r.max)) return false;
+            r.column = (size_t)column;
+        }
+        renderer.setRangeFilters(ranges);
+        return true;
+    }
+    case SessionKind::ViewportCount: {
+        uint64_t count;
+        if (!in.get(count)) return false;
+        renderer.setViewportCount((size_t)count);
+        return true;
+    }
+    case SessionKind::ViewportSubset: {
+        uint64_t viewport, count;
+        std::vector<uint32_t> indices;
+        if (!in.get(viewport) || !in.get(count) || count > kMaxRecordCount || !in.getArray(indices, count)) {
+            return false;
+        }
+        renderer.setViewportSubset((size_t)viewport, indices.data(), indices.size());
+        return true;
+    }
+    case SessionKind::ViewportFilter: {
+        uint64_t viewport;
+        uint8_t enabled;
+        float minValue, maxValue;
+        if (!in.get(viewport) || !in.get(enabled) || !in.get(minValue) || !in.get(maxValue)) return false;
+        renderer.setViewportFilter((size_t)viewport, enabled != 0, minValue, maxValue);
+        return true;
+    }
+    case SessionKind::ViewportLabel: {
+        uint64_t viewport;
+        std::string label;
+        if (!in.get(viewport) || !in.getString(label)) return false;
+        renderer.setViewportLabel((size_t)viewport, label);
+        return true;
+    }
+    case SessionKind::ViewportsLinked: {
+        uint8_t linked;
+        if (!in.get(linked)) return false;
+        renderer.setViewportsLinked(linked != 0);
+        return true;
+    }
+    case SessionKind::Count:
+        break;
+    }
+    return false;
+}
+
+}  // namespace
+
+bool Renderer::startRecording(const std::string& path, bool features) {
+    std::lock_guard<std::mutex> lock(m_recordingMutex);
+    std::shared_ptr<SessionWriter> writer = SessionWriter::open(path);
+    if (!writer) return false;
+    m_recordFeatures = features;
+    std::shared_ptr<SessionWriter> previous = m_recorder.exchange(std::move(writer), std::memory_order_acq_rel);
+    if (previous) {
+        previous->close();
+        m_lastRecording = statsOf(*previous, false);
+    }
+    return true;
+}
+
+void Renderer::stopRecording() {
+    std::lock_guard<std::mutex> lock(m_recordingMutex);
+    std::shared_ptr<SessionWriter> writer = m_recorder.exchange(nullptr, std::memory_order_acq_rel);
+    if (!writer) return;
+    // A producer still holding the writer finds it closed and drops its record
+    writer->close();
+    m_lastRecording = statsOf(*writer, false);
+}
+
+Renderer::RecordingStats Renderer::getRecordingStats() const {
+    std::lock_guard<std::mutex> lock(m_recordingMutex);
+    std::shared_ptr<SessionWriter> writer = m_recorder.load(std::memory_order_acquire);
+    return writer ? statsOf(*writer, true) : m_lastRecording;
+}
+
+void Renderer::record(SessionKind kind, std::vector<uint8_t> payload) {
+    if (m_replays.load(std::memory_order_acquire) > 0) return;
+    std::shared_ptr<SessionWriter> writer = m_recorder.load(std::memory_order_acquire);
+    if (writer) writer->write(kind, std::move(payload));
+}
+
+void Renderer::recordPoints(SessionKind kind, const float* positions, const float* values, size_t count) {
+    if (!recording()) return;
+    SessionPayload payload;
+    payload.put<uint64_t>(count);
+    payload.put<uint8_t>(positions != nullptr);
+    payload.put<uint8_t>(values != nullptr);
+    payload.putArray(positions, count * 3);
+    payload.putArray(values, count);
+    record(kind, payload.take());
+}
+
+void Renderer::recordPatch(SessionKind kind, const int* indices, const float* positions, const float* values,
+                           size_t count) {
+    if (!recording()) return;
+    SessionPayload payload;
+    payload.put<uint64_t>(count);
+    payload.put<uint8_t>(positions != nullptr);
+    payload.put<uint8_t>(values != nullptr);
+    payload.putArray(indices, count);
+    payload.putArray(positions, count * 3);
+    payload.putArray(values, count);
+    record(kind, payload.take());
+}
+
+void Renderer::recordStrings(SessionKind kind, const std::vector<std::string>& list) {
+    if (!recording()) return;
+    SessionPayload payload;
+    payload.putStrings(list);
+    record(kind, payload.take());
+}
+
+void Renderer::recordFeatures(SessionKind kind, const FeatureStore& store) {
+    if (!recording() || !m_recordFeatures) return;
+    std::vector<float> values(store.rows() * store.cols());
+    for (size_t r = 0; r < store.rows(); r++) store.row(r, values.data() + r * store.cols());
+    SessionPayload payload;
+    payload.put<uint64_t>(store.rows());
+    payload.put<uint64_t>(store.cols());
+    payload.putArray(values.data(), values.size());
+    record(kind, payload.take());
+}
+
+void Renderer::recordColorMode(int mode) {
+    if (!recording()) return;
+    SessionPayload payload;
+    payload.put<int32_t>(mode);
+    record(SessionKind::ColorMode, payload.take());
+}
+
+void Renderer::recordRanges(const std::vector<RangeFilter::Range>& ranges) {
+    if (!recording()) return;
+    SessionPayload payload;
+    payload.put<uint64_t>(ranges.size());
+    for (const RangeFilter::Range& r : ranges) {
+        payload.put<uint64_t>(r.column);
+        payload.put(r.min);
+        payload.put(r.max);
+    }
+    record(SessionKind::RangeFilters, payload.take());
+}
+
+long long Renderer::replay(const std::string& path, double speed) {
+    std::unique_ptr<SessionReader> reader = SessionReader::open(path);
+    if (!reader) return -1;
+    // The replayed setters would record themselves again
+    m_replays.fetch_add(1, std::memory_order_acq_rel);
+    m_replayCancel = false;
+    bool wasRunning = m_running;
+    auto stopped = [&]() { return m_replayCancel || (wasRunning && !m_running); };
+
+    using Clock = std::chrono::steady_clock;
+    Clock::time_point start = Clock::now();
+    long long applied = 0, malformed = 0;
+    SessionReader::Record record;
+    while (!stopped() && reader->next(record)) {
+        if (speed > 0.0) {
+            Clock::time_point due = start + std::chrono::microseconds((long long)((double)record.timeUs / speed));
+            for (Clock::time_point now = Clock::now(); now < due && !stopped(); now = Clock::now()) {
+                std::this_thread::sleep_for(std::min<Clock::duration>(due - now, kReplayPoll));
+            }
+            if (stopped()) break;
+        }
+        if (applyRecord(*this, record.kind, record.payload)) {
+            applied++;
+        } else {
+            malformed++;
+        }
+    }
+    m_replays.fetch_sub(1, std::memory_order_acq_rel);
+    if (malformed > 0) {
+        std::cerr << "[SessionLog] ERROR: " << path << ": skipped " << malformed << " malformed records" << std::endl;
+    }
+    return applied;
+}
+
+void Renderer::stopReplay() {
+    m_replayCancel = true;
+}
+
+void Renderer::orbitCamera(float deltaX, float deltaY) {
+    submit([this, deltaX, deltaY]() {
+        if (m_camera) orbitCameras(deltaX, deltaY);  // No camera before the window exists
+    });
+}
+
+void Renderer::zoomCamera(float delta) {
+    submit([this, delta]() {
+        if (m_camera) zoomCameras(delta);
+    });
+}
@@ -0,0 +1,112 @@
+#include "Renderer.h"
+#include "Camera.h"
+#include "../core/SpatialIndex.h"
+#include <algorithm>
+#include <cmath>
+#include <Eigen/Dense>
+
+// Spatial queries.
+//
+// The index is built on the render thread, where the drawn positions live,
+// and only on demand: the first query or click after the points changed
+// rebuilds it (on all cores), so animations pay nothing until someone asks.
+// Once published it is immutable, so producer threads query it themselves
+// and the renderer can replace it at any time.
+
+std::shared_ptr<const SpatialIndex> Renderer::spatialIndex() {
+    auto done = std::make_shared<Completion>();
+    submit([this, done]() {
+        m_spatialRequests.push_back(done);
+        if (!m_running) serveSpatialRequests(true);  // Applied in place
+    });
+    done->wait();
+    return m_spatialIndex.load(std::memory_order_acquire);
+}
+
+std::vector<int> Renderer::queryKnn(int id, size_t k) {
+    std::shared_ptr<const SpatialIndex> index = spatialIndex();
+    if (!index->contains(id)) return {};
+    return index->knn(index->position(id), k, id);
+}
+
+std::vector<int> Renderer::queryRadius(const float* point, float radius) {
+    return spatialIndex()->radius(point, radius);
+}
+
+const SpatialIndex& Renderer::updateSpatialIndex(bool staged) {
+    size_t count = 0, nextCount = 0;
+    const float* current = currentPositions(count);
+    const float* next = nextPositions(nextCount);
+    if (!staged) count = std::min(count, m_renderCount);
+
+    // Staged sets carry no version until they are uploaded: always rebuilt
+    std::shared_ptr<const SpatialIndex> index = m_spatialIndex.load(std::memory_order_acquire);
+    if (index && !staged && m_spatialVersion == m_instanceVersion && m_spatialMorph == m_morphTime &&
+        m_spatialCount == count) {
+        return *index;
+    }
+
+    auto built = std::make_shared<SpatialIndex>();
+    built->build(current, count, next, nextCount, m_morphTime);
+    m_spatialIndex.store(built, std::memory_order_release);
+    m_spatialVersion = m_instanceVersion;
+    m_spatialMorph = m_morphTime;
+    m_spatialCount = count;
+    return *built;
+}
+
+void Renderer::serveSpatialRequests(bool staged) {
+    if (m_spatialRequests.empty()) return;
+    updateSpatialIndex(staged);
+    for (auto& done : m_spatialRequests) done->complete();
+    m_spatialRequests.clear();
+}
+
+void Renderer::pickClickRay() {
+    int width, height;
+    viewSize(width, height);
+    if (width <= 0 || height <= 0) return;
+    const SpatialIndex& index = updateSpatialIndex(false);
+
+    // Ray through the clicked pixel centre, from the near plane
+    Eigen::Matrix4f inverse = m_camera->getViewProjectionMatrix().inverse();
+    float ndcX = ((float)m_clickPixelX + 0.5f) / (float)width * 2.0f - 1.0f;
+    float ndcY = ((float)m_clickPixelY + 0.5f) / (float)height * 2.0f - 1.0f;
+    Eigen::Vector4f nearPoint = inverse * Eigen::Vector4f(ndcX, ndcY, -1.0f, 1.0f);
+    Eigen::Vector4f farPoint = inverse * Eigen::Vector4f(ndcX, ndcY, 1.0f, 1.0f);
+    Eigen::Vector3f origin = nearPoint.head<3>() / nearPoint.w();
+    Eigen::Vector3f direction = farPoint.head<3>() / farPoint.w() - origin;
+
+    // Billboards are discs of radius scale / 2; near misses get the ID pass's
+    // kHoverRadius pixels of tolerance, which widen with depth
+    float radius = 0.5f * m_pointScale;
+    float spread = 2.0f * (float)kHoverRadius / (m_camera->getProjectionMatrix()(1, 1) * (float)height);
+
+    // Only what the click could have hit on screen: the color filter (or the
+    // viewport's value range) discards fragments, subsets and ranges whole points
+    bool filtered = m_colorFilterEnabled;
+    float filterValue = m_colorFilterValue, filterTolerance = m_colorFilterTolerance;
+    if (multiView() && m_viewports[m_activeViewport].filterEnabled) {
+        const Viewport& view = m_viewports[m_activeViewport];
+        filtered = true;
+        filterValue = (view.filterMin + view.filterMax) * 0.5f;
+        filterTolerance = (view.filterMax - view.filterMin) * 0.5f;
+    }
+    size_t numValues = 0, numNext = 0;
+    const float* values = currentValues(numValues);
+    const float* next = nextValues(numNext);
+    auto pickable = [&](int id) {
+        if (!inActiveSubset(id) || !passesRanges(id)) return false;
+        if (!filtered || (size_t)id >= numValues) return true;
+        float value = values[id];
+        if ((size_t)id < numNext) value += (next[id] - value) * m_morphTime;
+        return std::abs(value - filterValue) <= filterTolerance;
+    };
+
+    int picked = index.raycast(origin.data(), direction.data(), radius, spread, pickable);
+    if (picked != -1) {
+        m_selectedID = picked;
+        m_selectedIDs.clear();  // Single select clears multi-select
+        m_uiDirty = true;
+    }
+}
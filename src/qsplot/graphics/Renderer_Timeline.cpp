@@ -0,0 +1,370 @@
+#include "Renderer.h"
+#include "../core/QspFile.h"
+#include <glad/glad.h>
+#include <GLFW/glfw3.h>
+#include <algorithm>
+#include <cmath>
+#include <numeric>
+
+#include "imgui.h"
+
+// Keyframe timeline.
+//
+// The Python side uploads a window of keyframes into two GPU buffers
+// (window x N positions, window x N values), frame f in slot f % window. Each
+// frame the playhead picks the pair (floor(t), floor(t) + 1) and the buffer
+// fetch programs read both straight from the slots through the instance
+// buffer textures: uTime is the fraction between them. Scrubbing and looping
+// only change offsets, so they cost no uploads. During playback the playhead
+// waits at the edge of the resident frames until the prefetcher catches up.
+//
+// A dataset timeline (loadDataset) has no CPU mirror: the render thread itself
+// uploads slots from the mapped file, and the CPU passes read the frames from
+// the mapping.
+
+void Renderer::setTimeline(size_t frameCount, size_t pointCount, size_t window) {
+    window = frameCount > 0 ? std::clamp<size_t>(window, 1, frameCount) : 0;
+    {
+        std::lock_guard<std::mutex> lock(m_producerMutex);
+        m_submittedTimelineFrames = frameCount;
+        m_submittedTimelinePoints = pointCount;
+    }
+
+    submit([this, frameCount, pointCount, window]() {
+        resetTimeline(frameCount, pointCount, window, nullptr);
+    });
+}
+
+void Renderer::resetTimeline(size_t frameCount, size_t pointCount, size_t window,
+                             std::shared_ptr<const QspFile> dataset) {
+    Timeline& tl = m_timeline;
+    tl.frames = frameCount;
+    tl.points = pointCount;
+    tl.window = window;
+    tl.slotFrame.assign(window, -1);
+    tl.slotStale.assign(window, 0);
+    // Swap rather than assign: clearing a timeline should release the mirror
+    size_t mirrored = dataset ? 0 : window * pointCount;
+    std::vector<float>(mirrored * 3, 0.0f).swap(tl.positions);
+    std::vector<float>(mirrored, 0.0f).swap(tl.values);
+    tl.dataset = std::move(dataset);
+    tl.paging = tl.dataset != nullptr;
+    tl.dirtySlots.clear();
+    tl.reallocate = true;
+    tl.position = 0.0f;
+    tl.buffering = false;
+    tl.shown = false;
+}
+
+void Renderer::clearTimeline() {
+    setTimeline(0, 0, 0);
+}
+
+bool Renderer::setKeyframe(size_t frame, const float* positions, const float* values, size_t count) {
+    {
+        std::lock_guard<std::mutex> lock(m_producerMutex);
+        if (frame >= m_submittedTimelineFrames || count != m_submittedTimelinePoints) return false;
+    }
+
+    std::vector<float> pos(positions, positions + count * 3);
+    std::vector<float> val(values, values + count);
+    submit([this, frame, pos = std::move(pos), val = std::move(val)]() {
+        Timeline& tl = m_timeline;
+        // The timeline may have been replaced since this was submitted
+        if (frame >= tl.frames || val.size() != tl.points) return;
+
+        size_t slot = timelineSlot(frame);
+        std::copy(pos.begin(), pos.end(), tl.positions.begin() + slot * tl.points * 3);
+        std::copy(val.begin(), val.end(), tl.values.begin() + slot * tl.points);
+        tl.slotFrame[slot] = (int64_t)frame;
+        tl.slotStale[slot] = 0;
+        tl.dirtySlots.push_back(slot);
+    });
+    return true;
+}
+
+void Renderer::invalidateKeyframes() {
+    submit([this]() {
+        Timeline& tl = m_timeline;
+        if (!tl.dataset) std::fill(tl.slotStale.begin(), tl.slotStale.end(), 1);
+    });
+}
+
+void Renderer::loadDataset(std::shared_ptr<const QspFile> dataset, size_t window) {
+    if (!dataset) {
+        clearTimeline();
+        return;
+    }
+    const size_t frames = dataset->frameCount();
+    window = std::clamp<size_t>(window, 1, frames);
+    {
+        std::lock_guard<std::mutex> lock(m_producerMutex);
+        m_submittedTimelineFrames = 0;  // Keyframes come from the file
+        m_submittedTimelinePoints = 0;
+    }
+
+    // Stats of the first frame, computed here rather than on the render thread
+    std::shared_ptr<const FeatureStore> features = dataset->features(0);
+    std::vector<StatsData> stats;
+    if (features) {
+        for (const FeatureStore::ColumnStats& c : features->computeStats()) {
+            stats.push_back({std::string(), c.min, c.max, c.mean, c.std, c.median, (int)c.count});
+        }
+    }
+
+    submit([this, dataset = std::move(dataset), window, features = std::move(features),
+            stats = std::move(stats)]() mutable {
+        m_tickers = dataset->labels();
+        if (m_featureNames != dataset->featureNames()) {
+            m_featureNames = dataset->featureNames();
+            m_selectedColorFeatureIdx = 0;
+            m_colorFeatureChanged = false;
+            m_uiDirty = true;
+        }
+        m_features.swap(features);
+        m_featuresVersion++;
+        retireFeatures(std::move(features));
+        m_statsData.swap(stats);
+
+        const size_t frames = dataset->frameCount(), points = dataset->pointCount();
+        resetTimeline(frames, points, window, std::move(dataset));
+    });
+}
+
+void Renderer::setTimelinePlayback(bool playing, float framesPerSecond, bool loop) {
+    submit([this, playing, framesPerSecond, loop]() {
+        m_timeline.playing = playing;
+        m_timeline.fps = std::max(0.0f, framesPerSecond);
+        m_timeline.loop = loop;
+    });
+}
+
+void Renderer::seekTimeline(float position) {
+    submit([this, position]() {
+        m_timeline.position = position;
+    });
+}
+
+float Renderer::getTimelinePosition() const {
+    return m_timelinePosition.load(std::memory_order_acquire);
+}
+
+const float* Renderer::timelinePositions(size_t frame) const {
+    const Timeline& tl = m_timeline;
+    if (tl.dataset) return tl.dataset->positions(frame);
+    return tl.positions.data() + timelineSlot(frame) * tl.points * 3;
+}
+
+const float* Renderer::timelineValues(size_t frame) const {
+    const Timeline& tl = m_timeline;
+    if (tl.dataset) return tl.dataset->values(frame);
+    return tl.values.data() + timelineSlot(frame) * tl.points;
+}
+
+bool Renderer::timelineHeld(size_t frame) const {
+    const Timeline& tl = m_timeline;
+    return frame < tl.frames && tl.slotFrame[timelineSlot(frame)] == (int64_t)frame;
+}
+
+bool Renderer::timelineResident(size_t frame) const {
+    return timelineHeld(frame) && !m_timeline.slotStale[timelineSlot(frame)];
+}
+
+void Renderer::uploadTimeline() {
+    Timeline& tl = m_timeline;
+
+    if (!m_timelineVAO) {
+        glGenBuffers(1, &m_timelinePosBuffer);
+        glGenBuffers(1, &m_timelineValBuffer);
+        glGenBuffers(1, &m_timelineIndexBuffer);
+
+        // Quad + identity point index: the buffer fetch programs without culling
+        glGenVertexArrays(1, &m_timelineVAO);
+        glBindVertexArray(m_timelineVAO);
+        glBindBuffer(GL_ARRAY_BUFFER, m_validVBO);
+        glEnableVertexAttribArray(0);
+        glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 3 * sizeof(float), (void*)0);
+        glBindBuffer(GL_ARRAY_BUFFER, m_timelineIndexBuffer);
+        glEnableVertexAttribArray(5);
+        glVertexAttribIPointer(5, 1, GL_UNSIGNED_INT, sizeof(GLuint), (void*)0);
+        glVertexAttribDivisor(5, 1);
+        glBindVertexArray(0);
+    }
+
+    if (tl.reallocate) {
+        // A dataset has no mirror: its slots are filled by pageDataset
+        const size_t slots = tl.window * tl.points;
+        glBindBuffer(GL_ARRAY_BUFFER, m_timelinePosBuffer);
+        glBufferData(GL_ARRAY_BUFFER, (GLsizeiptr)(slots * 3 * sizeof(float)),
+                     tl.dataset ? nullptr : tl.positions.data(), GL_DYNAMIC_DRAW);
+        glBindBuffer(GL_ARRAY_BUFFER, m_timelineValBuffer);
+        glBufferData(GL_ARRAY_BUFFER, (GLsizeiptr)(slots * sizeof(float)),
+                     tl.dataset ? nullptr : tl.values.data(), GL_DYNAMIC_DRAW);
+
+        if (tl.points > m_timelineIndexCount) {
+            std::vector<GLuint> indices(tl.points);
+            std::iota(indices.begin(), indices.end(), 0u);
+            glBindBuffer(GL_ARRAY_BUFFER, m_timelineIndexBuffer);
+            glBufferData(GL_ARRAY_BUFFER, (GLsizeiptr)(indices.size() * sizeof(GLuint)), indices.data(), GL_STATIC_DRAW);
+            m_timelineIndexCount = tl.points;
+        }
+
+        tl.reallocate = false;
+        tl.dirtySlots.clear();  // The full upload included them
+        m_instanceVersion++;
+    }
+
+    if (!tl.dirtySlots.empty()) {
+        std::sort(tl.dirtySlots.begin(), tl.dirtySlots.end());
+        tl.dirtySlots.erase(std::unique(tl.dirtySlots.begin(), tl.dirtySlots.end()), tl.dirtySlots.end());
+
+        const size_t posBytes = tl.points * 3 * sizeof(float);
+        const size_t valBytes = tl.points * sizeof(float);
+        for (size_t slot : tl.dirtySlots) {
+            glBindBuffer(GL_ARRAY_BUFFER, m_timelinePosBuffer);
+            glBufferSubData(GL_ARRAY_BUFFER, (GLintptr)(slot * posBytes), (GLsizeiptr)posBytes,
+                            tl.positions.data() + slot * tl.points * 3);
+            glBindBuffer(GL_ARRAY_BUFFER, m_timelineValBuffer);
+            glBufferSubData(GL_ARRAY_BUFFER, (GLintptr)(slot * valBytes), (GLsizeiptr)valBytes,
+                            tl.values.data() + slot * tl.points);
+        }
+        tl.dirtySlots.clear();
+        m_instanceVersion++;
+    }
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+    pageDataset();
+}
+
+void Renderer::pageDataset() {
+    Timeline& tl = m_timeline;
+    if (!tl.dataset) return;
+
+    // The drawn pair first, then ahead of the playhead; the page faults of a
+    // frame happen in glBufferSubData, so only a few frames per render frame
+    const size_t posBytes = tl.points * 3 * sizeof(float);
+    const size_t valBytes = tl.points * sizeof(float);
+    const size_t base = std::min((size_t)std::max(tl.position, 0.0f), tl.frames - 1);
+    size_t paged = 0;
+    tl.paging = false;
+    for (size_t k = 0; k < tl.window; k++) {
+        size_t frame = base + k;
+        if (frame >= tl.frames) {
+            if (!tl.loop) break;
+            frame %= tl.frames;
+        }
+        size_t slot = timelineSlot(frame);
+        if (tl.slotFrame[slot] == (int64_t)frame) continue;
+        if (paged == kDatasetPagesPerFrame) {
+            tl.paging = true;
+            break;
+        }
+
+        glBindBuffer(GL_ARRAY_BUFFER, m_timelinePosBuffer);
+        glBufferSubData(GL_ARRAY_BUFFER, (GLintptr)(slot * posBytes), (GLsizeiptr)posBytes, tl.dataset->positions(frame));
+        glBindBuffer(GL_ARRAY_BUFFER, m_timelineValBuffer);
+        glBufferSubData(GL_ARRAY_BUFFER, (GLintptr)(slot * valBytes), (GLsizeiptr)valBytes, tl.dataset->values(frame));
+        tl.slotFrame[slot] = (int64_t)frame;
+        paged++;
+    }
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+    if (paged > 0) m_instanceVersion++;
+}
+
+void Renderer::updateTimeline() {
+    Timeline& tl = m_timeline;
+    bool wasActive = m_timelineActive;
+    m_timelineActive = tl.frames > 0 && tl.points > 0 && m_culledShaderProgram && m_culledPickingProgram;
+
+    if (!m_timelineActive) {
+        if (tl.reallocate && m_timelineVAO) {
+            // Cleared: release the GPU copy too
+            glBindBuffer(GL_ARRAY_BUFFER, m_timelinePosBuffer);
+            glBufferData(GL_ARRAY_BUFFER, 0, nullptr, GL_DYNAMIC_DRAW);
+            glBindBuffer(GL_ARRAY_BUFFER, m_timelineValBuffer);
+            glBufferData(GL_ARRAY_BUFFER, 0, nullptr, GL_DYNAMIC_DRAW);
+            glBindBuffer(GL_ARRAY_BUFFER, 0);
+        }
+        tl.reallocate = false;
+        if (wasActive) {
+            // Back to the point sets
+            m_renderCount = m_streamBound ? m_stream.count() : m_stagedCount;
+            m_morphTime = 0.0f;
+            m_instanceVersion++;
+        }
+        return;
+    }
+
+    uploadTimeline();
+
+    double now = glfwGetTime();
+    float dt = tl.lastTime > 0.0 ? (float)(now - tl.lastTime) : 0.0f;
+    tl.lastTime = now;
+
+    const float last = float(tl.frames - 1);
+    tl.buffering = false;
+    if (tl.playing && tl.frames > 1) {
+        float target = tl.position + dt * tl.fps;
+        if (target >= last) {
+            if (tl.loop) {
+                target = std::fmod(target, last);
+            } else {
+                target = last;
+                tl.playing = false;
+            }
+        }
+        size_t f = (size_t)target;
+        tl.buffering = !timelineResident(f) || !timelineResident(std::min(f + 1, tl.frames - 1));
+        if (!tl.buffering) tl.position = target;
+    }
+    tl.position = std::clamp(tl.position, 0.0f, last);
+
+    size_t frame = (size_t)tl.position;
+    size_t next = std::min(frame + 1, tl.frames - 1);
+    float frac = tl.position - float(frame);
+    if (!timelineHeld(next)) {
+        next = frame;
+        frac = 0.0f;
+    }
+
+    // Stale frames stay on screen until the prefetcher replaces them
+    if (timelineHeld(frame)) {
+        if (!tl.shown || frame != tl.frame || next != tl.nextFrame) m_instanceVersion++;
+        if (tl.dataset && tl.dataset->featureCount() > 0 && (!tl.shown || frame != tl.frame)) {
+            // Tooltip rows of the drawn frame, viewed in the mapping
+            std::shared_ptr<const FeatureStore> features = tl.dataset->features(frame);
+            m_features.swap(features);
+            m_featuresVersion++;
+            retireFeatures(std::move(features));
+        }
+        tl.frame = frame;
+        tl.nextFrame = next;
+        tl.shown = true;
+        m_morphTime = frac;
+    } else if (tl.shown && (!timelineHeld(tl.frame) || !timelineHeld(tl.nextFrame))) {
+        // Scrubbed outside the window and the last pair was evicted
+        tl.shown = false;
+    }
+
+    m_renderCount = tl.shown ? tl.points : 0;
+    m_timelinePosition.store(tl.position, std::memory_order_release);
+}
+
+void Renderer::renderTimelineControls() {
+    if (!m_timelineActive) {
+        ImGui::SliderFloat("Time Morph", &m_morphTime, 0.0f, 1.0f);
+        return;
+    }
+
+    Timeline& tl = m_timeline;
+    ImGui::SliderFloat("Timeline", &tl.position, 0.0f, float(tl.frames - 1), "Frame %.2f");
+    ImGui::Checkbox("Play", &tl.playing);
+    ImGui::SameLine();
+    ImGui::Checkbox("Loop", &tl.loop);
+    ImGui::SliderFloat("Frames / s", &tl.fps, 0.1f, 30.0f);
+
+    size_t resident = (size_t)std::count_if(tl.slotFrame.begin(), tl.slotFrame.end(),
+                                            [](int64_t f) { return f >= 0; });
+    ImGui::Text("Keyframes: %zu / %zu resident (window %zu)%s", resident, tl.frames, tl.window,
+                tl.buffering ? ", buffering" : "");
+}
@@ -0,0 +1,310 @@
+#include "Renderer.h"
+#include "Camera.h"
+#include "../core/SessionLog.h"
+#include <glad/glad.h>
+#include <GLFW/glfw3.h>
+#include <algorithm>
+#include <cmath>
+
+#include "imgui.h"
+
+// Small multiples.
+//
+// Every viewport draws the same instance buffers with its own camera into a
+// cell of a grid over the window, all within one frame and one GL context, so
+// adding a panel costs a few uniform updates and draw calls but no data. A
+// viewport's subset is a sorted list of point indices drawn through the
+// buffer-fetch programs (attribute 5, as in the culled path); its value range
+// reuses the color filter of the frame state. The active viewport is drawn
+// last, so the hover, click and brush passes that follow see its frame state
+// and its subset, in its own pixel coordinates.
+//
+// Frustum culling and the density LOD are single-view passes and are skipped
+// while the window is split.
+
+void Renderer::setViewportCount(size_t count) {
+    count = std::min(count, kMaxViewports);
+    if (recording()) {
+        SessionPayload payload;
+        payload.put<uint64_t>(count);
+        record(SessionKind::ViewportCount, payload.take());
+    }
+    submit([this, count]() {
+        if (count == 0) {
+            // Back to one view, keeping the active viewport's camera
+            if (multiView() && m_mainCamera) {
+                int fbWidth, fbHeight;
+                glfwGetFramebufferSize(m_window, &fbWidth, &fbHeight);
+                *m_mainCamera = *m_viewports[m_activeViewport].camera;
+                m_mainCamera->setAspect(std::max(fbWidth, 1), std::max(fbHeight, 1));
+            }
+            for (Viewport& view : m_viewports) releaseViewportGL(view);
+            m_viewports.clear();
+            m_camera = m_mainCamera;
+            m_activeViewport = 0;
+            m_drawViewport = -1;
+            return;
+        }
+
+        while (m_viewports.size() > count) {
+            releaseViewportGL(m_viewports.back());
+            m_viewports.pop_back();
+        }
+        while (m_viewports.size() < count) {
+            // New panels start from the current view
+            Viewport view;
+            view.camera = m_camera ? std::make_unique<Camera>(*m_camera) : std::make_unique<Camera>(1, 1);
+            m_viewports.push_back(std::move(view));
+        }
+        m_activeViewport = std::min(m_activeViewport, (int)count - 1);
+        m_camera = m_viewports[m_activeViewport].camera.get();
+        m_drawViewport = -1;
+    });
+}
+
+void Renderer::setViewportSubset(size_t viewport, const uint32_t* indices, size_t count) {
+    std::vector<uint32_t> subset(indices, indices + (indices ? count : 0));
+    std::sort(subset.begin(), subset.end());
+    subset.erase(std::unique(subset.begin(), subset.end()), subset.end());
+    if (recording()) {
+        SessionPayload payload;
+        payload.put<uint64_t>(viewport);
+        payload.put<uint64_t>(subset.size());
+        payload.putArray(subset.data(), subset.size());
+        record(SessionKind::ViewportSubset, payload.take());
+    }
+    submit([this, viewport, subset = std::move(subset)]() mutable {
+        if (viewport >= m_viewports.size()) return;
+        m_viewports[viewport].subset.swap(subset);
+        m_viewports[viewport].subsetDirty = true;
+    });
+}
+
+void Renderer::setViewportFilter(size_t viewport, bool enabled, float minValue, float maxValue) {
+    if (recording()) {
+        SessionPayload payload;
+        payload.put<uint64_t>(viewport);
+        payload.put<uint8_t>(enabled);
+        payload.put(minValue);
+        payload.put(maxValue);
+        record(SessionKind::ViewportFilter, payload.take());
+    }
+    submit([this, viewport, enabled, minValue, maxValue]() {
+        if (viewport >= m_viewports.size()) return;
+        Viewport& view = m_viewports[viewport];
+        view.filterEnabled = enabled;
+        view.filterMin = std::min(minValue, maxValue);
+        view.filterMax = std::max(minValue, maxValue);
+    });
+}
+
+void Renderer::setViewportLabel(size_t viewport, const std::string& label) {
+    if (recording()) {
+        SessionPayload payload;
+        payload.put<uint64_t>(viewport);
+        payload.putString(label);
+        record(SessionKind::ViewportLabel, payload.take());
+    }
+    submit([this, viewport, label]() {
+        if (viewport < m_viewports.size()) m_viewports[viewport].label = label;
+    });
+}
+
+void Renderer::setViewportCamera(size_t viewport, float yaw, float pitch, float distance) {
+    if (recording()) {
+        SessionPayload payload;
+        payload.put<uint64_t>(viewport);
+        payload.put(yaw);
+        payload.put(pitch);
+        payload.put(distance);
+        record(SessionKind::ViewportCamera, payload.take());
+    }
+    submit([this, viewport, yaw, pitch, distance]() {
+        if (viewport < m_viewports.size()) m_viewports[viewport].camera->setOrbit(yaw, pitch, distance);
+    });
+}
+
+void Renderer::setViewportsLinked(bool linked) {
+    if (recording()) {
+        SessionPayload payload;
+        payload.put<uint8_t>(linked);
+        record(SessionKind::ViewportsLinked, payload.take());
+    }
+    submit([this, linked]() { m_viewportsLinked = linked; });
+}
+
+bool Renderer::subsetDraw() const {
+    if (m_drawViewport < 0 || m_viewports[m_drawViewport].subset.empty()) return false;
+    if (!m_culledShaderProgram || !m_culledPickingProgram) return false;
+    // The buffer-fetch programs read float instances; packed sets draw every point
+    return m_timelineActive || !instancesPacked();
+}
+
+bool Renderer::inActiveSubset(int id) const {
+    if (!multiView()) return true;
+    const std::vector<uint32_t>& subset = m_viewports[m_activeViewport].subset;
+    return subset.empty() || std::binary_search(subset.begin(), subset.end(), (uint32_t)id);
+}
+
+void Renderer::layoutViewports() {
+    if (!multiView()) return;
+    int fbWidth, fbHeight;
+    glfwGetFramebufferSize(m_window, &fbWidth, &fbHeight);
+
+    // Near-square grid, filled row by row from the top left
+    int count = (int)m_viewports.size();
+    int cols = (int)std::ceil(std::sqrt((double)count));
+    int rows = (count + cols - 1) / cols;
+    for (int i = 0; i < count; i++) {
+        int col = i % cols, row = i / cols;
+        int x0 = fbWidth * col / cols, x1 = fbWidth * (col + 1) / cols;
+        int y1 = fbHeight - fbHeight * row / rows, y0 = fbHeight - fbHeight * (row + 1) / rows;
+        int* rect = m_viewports[i].rect;
+        rect[0] = x0; rect[1] = y0; rect[2] = x1 - x0; rect[3] = y1 - y0;
+    }
+}
+
+void Renderer::viewSize(int& width, int& height) const {
+    if (multiView()) {
+        width = m_viewports[m_activeViewport].rect[2];
+        height = m_viewports[m_activeViewport].rect[3];
+    } else {
+        glfwGetFramebufferSize(m_window, &width, &height);
+    }
+}
+
+void Renderer::activateViewportAt(double x, double y) {
+    if (!multiView()) return;
+    int fbWidth, fbHeight, winWidth, winHeight;
+    glfwGetFramebufferSize(m_window, &fbWidth, &fbHeight);
+    glfwGetWindowSize(m_window, &winWidth, &winHeight);
+    if (winWidth == 0 || winHeight == 0) return;
+
+    int px = (int)(x * fbWidth / winWidth);
+    int py = (int)((winHeight - y) * fbHeight / winHeight);
+    for (int i = 0; i < (int)m_viewports.size(); i++) {
+        const int* r = m_viewports[i].rect;
+        if (px >= r[0] && px < r[0] + r[2] && py >= r[1] && py < r[1] + r[3]) {
+            if (i != m_activeViewport) m_hoveredID = -1;  // Picked in another view's pixels
+            m_activeViewport = i;
+            m_camera = m_viewports[i].camera.get();
+            return;
+        }
+    }
+}
+
+void Renderer::orbitCameras(float deltaX, float deltaY) {
+    if (recording()) {
+        SessionPayload payload;
+        payload.put(deltaX);
+        payload.put(deltaY);
+        record(SessionKind::CameraOrbit, payload.take());
+    }
+    if (!multiView() || !m_viewportsLinked) {
+        m_camera->orbit(deltaX, deltaY);
+        return;
+    }
+    for (Viewport& view : m_viewports) view.camera->orbit(deltaX, deltaY);
+}
+
+void Renderer::zoomCameras(float delta) {
+    if (recording()) {
+        SessionPayload payload;
+        payload.put(delta);
+        record(SessionKind::CameraZoom, payload.take());
+    }
+    if (!multiView() || !m_viewportsLinked) {
+        m_camera->zoom(delta);
+        return;
+    }
+    for (Viewport& view : m_viewports) view.camera->zoom(delta);
+}
+
+void Renderer::releaseViewportGL(Viewport& view) {
+    if (view.vao) {
+        glDeleteVertexArrays(1, &view.vao);
+        glDeleteBuffers(1, &view.indexBuffer);
+    }
+    view.vao = view.indexBuffer = 0;
+    view.subsetDirty = !view.subset.empty();  // Re-uploaded if drawn again
+}
+
+void Renderer::renderViewports() {
+    int fbWidth, fbHeight;
+    glfwGetFramebufferSize(m_window, &fbWidth, &fbHeight);
+    glEnable(GL_SCISSOR_TEST);
+
+    int count = (int)m_viewports.size();
+    for (int k = 1; k <= count; k++) {
+        int i = (m_activeViewport + k) % count;  // Active one last
+        Viewport& view = m_viewports[i];
+        if (view.rect[2] <= 0 || view.rect[3] <= 0) continue;
+
+        if (view.subsetDirty) {
+            if (!view.vao) {
+                glGenBuffers(1, &view.indexBuffer);
+                glGenVertexArrays(1, &view.vao);
+                glBindVertexArray(view.vao);
+                glBindBuffer(GL_ARRAY_BUFFER, m_validVBO);
+                glEnableVertexAttribArray(0);
+                glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 3 * sizeof(float), (void*)0);
+                glBindBuffer(GL_ARRAY_BUFFER, view.indexBuffer);
+                glEnableVertexAttribArray(5);
+                glVertexAttribIPointer(5, 1, GL_UNSIGNED_INT, sizeof(GLuint), (void*)0);
+                glVertexAttribDivisor(5, 1);
+                glBindVertexArray(0);
+            }
+            glBindBuffer(GL_ARRAY_BUFFER, view.indexBuffer);
+            glBufferData(GL_ARRAY_BUFFER, (GLsizeiptr)(view.subset.size() * sizeof(uint32_t)),
+                         view.subset.data(), GL_STATIC_DRAW);
+            glBindBuffer(GL_ARRAY_BUFFER, 0);
+            view.subsetDirty = false;
+        }
+        // Indices past the current point set are not fetched
+        view.drawCount = std::lower_bound(view.subset.begin(), view.subset.end(), (uint32_t)m_renderCount) -
+                         view.subset.begin();
+
+        glViewport(view.rect[0], view.rect[1], view.rect[2], view.rect[3]);
+        glScissor(view.rect[0], view.rect[1], view.rect[2], view.rect[3]);
+        m_camera = view.camera.get();
+        m_drawViewport = i;
+        bindFrameUniforms(1 + i);  // Filled by updateFrameUniforms
+
+        if (view.subset.empty() || view.drawCount > 0) {
+            if (oitActive()) {
+                renderTransparentPoints();
+            } else {
+                unsigned int program = pointProgram();
+                glUseProgram(program);
+                drawPoints(program);
+            }
+        }
+        renderGizmo();
+    }
+
+    glDisable(GL_SCISSOR_TEST);
+    glViewport(0, 0, fbWidth, fbHeight);
+}
+
+void Renderer::renderViewportOverlay() {
+    if (!multiView()) return;
+    int fbWidth, fbHeight, winWidth, winHeight;
+    glfwGetFramebufferSize(m_window, &fbWidth, &fbHeight);
+    glfwGetWindowSize(m_window, &winWidth, &winHeight);
+    if (fbWidth == 0 || fbHeight == 0) return;
+    float sx = (float)winWidth / fbWidth, sy = (float)winHeight / fbHeight;
+
+    ImDrawList* draw = ImGui::GetBackgroundDrawList();
+    for (int i = 0; i < (int)m_viewports.size(); i++) {
+        const Viewport& view = m_viewports[i];
+        const int* r = view.rect;
+        ImVec2 p0(r[0] * sx, (fbHeight - r[1] - r[3]) * sy);
+        ImVec2 p1((r[0] + r[2]) * sx, (fbHeight - r[1]) * sy);
+        bool active = i == m_activeViewport;
+        draw->AddRect(p0, p1, active ? IM_COL32(0, 200, 255, 160) : IM_COL32(255, 255, 255, 50), 0.0f, 0,
+                      active ? 2.0f : 1.0f);
+        if (!view.label.empty()) {
+            draw->AddText(ImVec2(p0.x + 8, p0.y + 6), IM_COL32(255, 255, 255, 220), view.label.c_str());
+        }
+    }
+}
@@ -0,0 +1,278 @@
+#include "SelectionEngine.h"
+#include "../core/Parallel.h"
+
+#include <glad/glad.h>
+#include <Eigen/Dense>
+#include <algorithm>
+
+namespace {
+    constexpr GLuint kGroupSize = 256;
+    constexpr GLuint kMaxGroupsX = 65535;
+
+    enum Pass : GLuint { PassProject = 0, PassMark = 1, PassCompact = 2 };
+
+    // Polygon bounds, used to reject most points before the edge loop
+    struct Bounds { float minX, minY, maxX, maxY; };
+
+    Bounds brushBounds(const std::vector<float>& brush) {
+        Bounds b{0, 0, -1, -1};
+        if (brush.size() < 2) return b;
+        b = {brush[0], brush[1], brush[0], brush[1]};
+        for (size_t i = 2; i + 1 < brush.size(); i += 2) {
+            b.minX = std::min(b.minX, brush[i]);
+            b.maxX = std::max(b.maxX, brush[i]);
+            b.minY = std::min(b.minY, brush[i + 1]);
+            b.maxY = std::max(b.maxY, brush[i + 1]);
+        }
+        return b;
+    }
+}
+
+void SelectionEngine::init(unsigned int program) {
+    m_program = program;
+    if (!m_program) return;
+    glGenBuffers(1, &m_brushBuffer);
+    glGenBuffers(1, &m_markBuffer);
+    glGenBuffers(1, &m_resultBuffer);
+}
+
+void SelectionEngine::destroy() {
+    if (m_fence) {
+        glDeleteSync((GLsync)m_fence);
+        m_fence = nullptr;
+    }
+    if (m_brushBuffer) glDeleteBuffers(1, &m_brushBuffer);
+    if (m_markBuffer) glDeleteBuffers(1, &m_markBuffer);
+    if (m_resultBuffer) glDeleteBuffers(1, &m_resultBuffer);
+    m_brushBuffer = m_markBuffer = m_resultBuffer = 0;
+    m_markCapacity = m_resultCapacity = 0;
+    m_program = 0;  // Owned by the renderer
+}
+
+bool SelectionEngine::insideBrush(const std::vector<float>& brush, float x, float y) {
+    size_t n = brush.size() / 2;
+    bool inside = false;
+    for (size_t i = 0, j = n - 1; i < n; j = i++) {
+        float ax = brush[i * 2], ay = brush[i * 2 + 1];
+        float bx = brush[j * 2], by = brush[j * 2 + 1];
+        if (((ay > y) != (by > y)) && (x < (bx - ax) * (y - ay) / (by - ay) + ax)) {
+            inside = !inside;
+        }
+    }
+    return inside;
+}
+
+// ---------------------------------------------------------------------------
+// GPU path
+// ---------------------------------------------------------------------------
+
+void SelectionEngine::prepareResult(size_t count) {
+    // Layout: uint count, then up to `count` IDs
+    size_t bytes = (count + 1) * sizeof(GLuint);
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, m_resultBuffer);
+    if (bytes > m_resultCapacity) {
+        glBufferData(GL_SHADER_STORAGE_BUFFER, (GLsizeiptr)bytes, nullptr, GL_DYNAMIC_READ);
+        m_resultCapacity = bytes;
+    }
+    GLuint zero = 0;
+    glBufferSubData(GL_SHADER_STORAGE_BUFFER, 0, sizeof(GLuint), &zero);
+    m_resultLimit = count;
+}
+
+void SelectionEngine::bindCommon(const Query& query, unsigned int pass) {
+    glUseProgram(m_program);
+
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, m_brushBuffer);
+    glBufferData(GL_SHADER_STORAGE_BUFFER, (GLsizeiptr)(query.brush.size() * sizeof(float)),
+                 query.brush.data(), GL_STREAM_DRAW);
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+
+    // Offsets are passed as uniforms: stream segments need not meet the SSBO offset alignment
+    bool hasNext = query.next.buffer != 0 && query.next.count > 0;
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 0, query.current.buffer);
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 1, hasNext ? query.next.buffer : query.current.buffer);
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 2, m_markBuffer);
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 3, m_resultBuffer);
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 4, m_brushBuffer);
+
+    glUniform1ui(glGetUniformLocation(m_program, "uPass"), pass);
+    glUniformMatrix4fv(glGetUniformLocation(m_program, "uVP"), 1, GL_FALSE, query.viewProj);
+    glUniform1f(glGetUniformLocation(m_program, "uTime"), query.morphTime);
+    glUniform1ui(glGetUniformLocation(m_program, "uCount"), (GLuint)query.current.count);
+    glUniform1ui(glGetUniformLocation(m_program, "uNextCount"), hasNext ? (GLuint)query.next.count : 0u);
+    glUniform1ui(glGetUniformLocation(m_program, "uCurrentOffset"), (GLuint)(query.current.offset / sizeof(float)));
+    glUniform1ui(glGetUniformLocation(m_program, "uNextOffset"), hasNext ? (GLuint)(query.next.offset / sizeof(float)) : 0u);
+    glUniform2f(glGetUniformLocation(m_program, "uViewport"), (float)query.viewportWidth, (float)query.viewportHeight);
+    glUniform1i(glGetUniformLocation(m_program, "uBrushCount"), (GLint)(query.brush.size() / 2));
+    glUniform1ui(glGetUniformLocation(m_program, "uResultLimit"), (GLuint)m_resultLimit);
+}
+
+void SelectionEngine::dispatch(size_t items) {
+    if (items == 0) return;
+    GLuint groups = (GLuint)((items + kGroupSize - 1) / kGroupSize);
+    GLuint groupsX = std::min(groups, kMaxGroupsX);
+    GLuint groupsY = (groups + groupsX - 1) / groupsX;
+    glDispatchCompute(groupsX, groupsY, 1);
+}
+
+void SelectionEngine::finish() {
+    glMemoryBarrier(GL_BUFFER_UPDATE_BARRIER_BIT);
+    m_fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+    glUseProgram(0);
+}
+
+bool SelectionEngine::submitAll(const Query& query) {
+    if (!m_program || busy()) return false;
+
+    prepareResult(query.current.count);
+    bindCommon(query, PassProject);
+    dispatch(query.current.count);
+    finish();
+    return true;
+}
+
+bool SelectionEngine::submitVisible(const Query& query, unsigned int idTexture) {
+    if (!m_program || busy()) return false;
+
+    // Only the brush bounds of the ID texture can contain matches
+    Bounds b = brushBounds(query.brush);
+    int x0 = std::max(0, (int)b.minX);
+    int y0 = std::max(0, (int)b.minY);
+    int x1 = std::min(query.viewportWidth, (int)b.maxX + 1);
+    int y1 = std::min(query.viewportHeight, (int)b.maxY + 1);
+    int w = std::max(0, x1 - x0), h = std::max(0, y1 - y0);
+
+    // One bit per instance, cleared every query
+    size_t markBytes = std::max<size_t>(1, (query.current.count + 31) / 32) * sizeof(GLuint);
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, m_markBuffer);
+    if (markBytes > m_markCapacity) {
+        glBufferData(GL_SHADER_STORAGE_BUFFER, (GLsizeiptr)markBytes, nullptr, GL_DYNAMIC_COPY);
+        m_markCapacity = markBytes;
+    }
+    glClearBufferData(GL_SHADER_STORAGE_BUFFER, GL_R32UI, GL_RED_INTEGER, GL_UNSIGNED_INT, nullptr);
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+
+    prepareResult(query.current.count);
+    bindCommon(query, PassMark);
+
+    glActiveTexture(GL_TEXTURE0);
+    glBindTexture(GL_TEXTURE_2D, idTexture);
+    glUniform1i(glGetUniformLocation(m_program, "uIdTexture"), 0);
+    glUniform4i(glGetUniformLocation(m_program, "uRegion"), x0, y0, w, h);
+
+    // The picking pass was just rendered into idTexture
+    glMemoryBarrier(GL_TEXTURE_FETCH_BARRIER_BIT);
+    dispatch((size_t)w * (size_t)h);
+
+    glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT);
+    glUniform1ui(glGetUniformLocation(m_program, "uPass"), PassCompact);
+    dispatch(query.current.count);
+
+    glBindTexture(GL_TEXTURE_2D, 0);
+    finish();
+    return true;
+}
+
+bool SelectionEngine::poll(std::vector<int>& ids) {
+    if (!m_fence) return false;
+
+    GLenum status = glClientWaitSync((GLsync)m_fence, 0, 0);
+    if (status != GL_ALREADY_SIGNALED && status != GL_CONDITION_SATISFIED) return false;
+    glDeleteSync((GLsync)m_fence);
+    m_fence = nullptr;
+
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, m_resultBuffer);
+    GLuint count = 0;
+    glGetBufferSubData(GL_SHADER_STORAGE_BUFFER, 0, sizeof(GLuint), &count);
+    size_t n = std::min<size_t>(count, m_resultLimit);
+
+    ids.resize(n);
+    if (n > 0) {
+        // IDs are stored as uint; every valid ID fits in int
+        glGetBufferSubData(GL_SHADER_STORAGE_BUFFER, sizeof(GLuint), (GLsizeiptr)(n * sizeof(GLuint)), ids.data());
+    }
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+
+    // Atomic appends arrive in arbitrary order
+    std::sort(ids.begin(), ids.end());
+    return true;
+}
+
+// ---------------------------------------------------------------------------
+// CPU fallback
+// ---------------------------------------------------------------------------
+
+std::vector<int> SelectionEngine::selectCPU(const Query& query) {
+    std::vector<int> result;
+    const float* current = query.current.cpu;
+    size_t count = query.current.count;
+    if (!current || count == 0 || query.brush.size() < 6) return result;
+
+    const float* next = (query.next.cpu && query.next.count > 0) ? query.next.cpu : nullptr;
+    size_t nextCount = next ? query.next.count : 0;
+
+    Eigen::Map<const Eigen::Matrix4f> vp(query.viewProj);
+    Bounds bounds = brushBounds(query.brush);
+    float halfW = 0.5f * (float)query.viewportWidth;
+    float halfH = 0.5f * (float)query.viewportHeight;
+    float t = query.morphTime;
+
+    size_t chunks = parallelChunkCount(count, 1 << 16);
+    std::vector<std::vector<int>> partial(chunks);
+
+    parallelFor(count, 1 << 16, [&](size_t chunk, size_t begin, size_t end) {
+        // Project in blocks so Eigen can vectorize the 4x3 transform
+        constexpr size_t kBlock = 1024;
+        Eigen::Matrix3Xf pos(3, kBlock);
+        Eigen::Matrix4Xf clip(4, kBlock);
+        std::vector<int>& out = partial[chunk];
+
+        for (size_t b = begin; b < end; b += kBlock) {
+            size_t n = std::min(kBlock, end - b);
+            Eigen::Map<const Eigen::Matrix3Xf> cur(current + b * 3, 3, (Eigen::Index)n);
+            pos.leftCols(n) = cur;
+
+            size_t morphed = (b < nextCount) ? std::min(n, nextCount - b) : 0;
+            if (morphed > 0) {
+                Eigen::Map<const Eigen::Matrix3Xf> nxt(next + b * 3, 3, (Eigen::Index)morphed);
+                pos.leftCols(morphed) += t * (nxt - cur.leftCols(morphed));
+            }
+
+            clip.leftCols(n) = (vp.leftCols<3>() * pos.leftCols(n)).colwise() + vp.col(3);
+
+            for (size_t j = 0; j < n; j++) {
+                float w = clip(3, j);
+                if (w < 0.01f) continue;
+                float px = (clip(0, j) / w + 1.0f) * halfW;
+                float py = (clip(1, j) / w + 1.0f) * halfH;
+                if (px < bounds.minX || px > bounds.maxX || py < bounds.minY || py > bounds.maxY) continue;
+                if (insideBrush(query.brush, px, py)) out.push_back((int)(b + j));
+            }
+        }
+    });
+
+    // Chunks are ordered, so concatenation stays ascending
+    for (auto& p : partial) result.insert(result.end(), p.begin(), p.end());
+    return result;
+}
+
+std::vector<int> SelectionEngine::collectVisibleCPU(const Query& query, const int* pixels,
+                                                    int x, int y, int width, int height) {
+    std::vector<int> result;
+    if (!pixels || width <= 0 || height <= 0) return result;
+
+    // One byte per instance instead of a tree insert per pixel
+    std::vector<unsigned char> seen(query.current.count, 0);
+    for (int row = 0; row < height; row++) {
+        const int* line = pixels + (size_t)row * width;
+        for (int col = 0; col < width; col++) {
+            int id = line[col];
+            if (id < 0 || (size_t)id >= seen.size() || seen[id]) continue;
+            if (!insideBrush(query.brush, x + col + 0.5f, y + row + 0.5f)) continue;
+            seen[id] = 1;
+            result.push_back(id);
+        }
+    }
+    std::sort(result.begin(), result.end());
+    return result;
+}
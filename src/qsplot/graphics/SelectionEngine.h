@@ -0,0 +1,81 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "InstanceSource.h"
+
+/**
+ * @brief Brush selection over instance positions.
+ *
+ * A brush is a closed polygon in framebuffer pixels (a rectangle is four
+ * vertices, a lasso is any number), so every mode works for both.
+ *
+ * - GL 4.3+: a compute pass projects every instance (or scans the ID buffer
+ *   for visible-only selection), and matching IDs are compacted into a result
+ *   buffer with an atomic counter. The result is fenced and fetched with
+ *   poll() a frame or two later, without stalling the pipeline.
+ * - Fallback: selectCPU() projects the staged positions on all cores.
+ */
+class SelectionEngine {
+public:
+    using Source = InstanceSource;
+
+    struct Query {
+        float viewProj[16];        // Column-major view-projection matrix
+        float morphTime = 0.0f;    // Interpolation towards `next`
+        int viewportWidth = 0, viewportHeight = 0;
+        Source current, next;
+        std::vector<float> brush;  // Polygon vertices (x0, y0, x1, y1, ...), framebuffer pixels
+    };
+
+    SelectionEngine() = default;
+    ~SelectionEngine() = default;
+
+    SelectionEngine(const SelectionEngine&) = delete;
+    SelectionEngine& operator=(const SelectionEngine&) = delete;
+
+    // program: linked selectionComputeShaderSource, 0 when compute shaders are unavailable
+    void init(unsigned int program);
+    void destroy();
+
+    bool gpuAvailable() const { return m_program != 0; }
+    bool busy() const { return m_fence != nullptr; }
+
+    // GPU: every instance whose projected centre lies inside the brush,
+    // including points hidden behind others. Returns false while busy.
+    bool submitAll(const Query& query);
+
+    // GPU: only IDs that won the depth test in the picking texture (R32I)
+    // within the brush bounds. Returns false while busy.
+    bool submitVisible(const Query& query, unsigned int idTexture);
+
+    // Fetch the result of the last submit, sorted ascending. Non-blocking.
+    bool poll(std::vector<int>& ids);
+
+    // CPU fallback for submitAll, sorted ascending
+    static std::vector<int> selectCPU(const Query& query);
+
+    // CPU fallback for submitVisible: unique IDs of a read-back pick region
+    static std::vector<int> collectVisibleCPU(const Query& query, const int* pixels,
+                                              int x, int y, int width, int height);
+
+    // Even-odd point-in-polygon test
+    static bool insideBrush(const std::vector<float>& brush, float x, float y);
+
+private:
+    void bindCommon(const Query& query, unsigned int pass);
+    void prepareResult(size_t count);
+    void dispatch(size_t items);
+    void finish();
+
+    unsigned int m_program = 0;
+    unsigned int m_brushBuffer = 0;
+    unsigned int m_markBuffer = 0;
+    unsigned int m_resultBuffer = 0;
+    size_t m_markCapacity = 0;    // Bytes
+    size_t m_resultCapacity = 0;  // Bytes
+    size_t m_resultLimit = 0;     // Max IDs the pending result can hold
+    void* m_fence = nullptr;      // GLsync of the pending selection
+};
@@ -1,34 +1,246 @@
 #ifndef SHADER_H
 #define SHADER_H
 
-const char* vertexShaderSource = R"(
+#include <cstdint>
+
+// Render programs are compiled as frameStateSource + their sources: it carries
+// the #version line and the per-frame uniform block, so only compute shaders
+// declare a version of their own.
+//
+// Instance fetch preludes. Point vertex shaders are compiled as prelude + body;
+// the body calls fetchInstance() and quadCorner() and does not care where the
+// data lives or how the billboard quad is drawn.
+
+// Per-frame state shared by every render program, filled once per frame into
+// a uniform buffer at kFrameStateBinding (GL 4.1 has no layout(binding) for blocks)
+const char* frameStateSource = R"(
     #version 410 core
-    layout(location = 0) in vec3 aLocalPos;    
-    layout(location = 1) in vec3 aInstancePos; 
-    layout(location = 2) in float aValue;      
-    layout(location = 3) in vec3 aNextPos;     
-    layout(location = 4) in float aNextValue;  
+    layout(std140) uniform FrameState {
+        mat4 uVP;
+        vec3 uCameraRight;
+        float uScale;
+        vec3 uCameraUp;
+        float uTime;
+        vec3 uSelectedColor;
+        float uAlpha;
+        int uCategorical;  // Billboards take their LUT entry from uCategories
+        int uSelectedID;
+        bool uHasSelection;
+        bool uColorFilterEnabled;
+        float uColorFilterValue;
+        float uColorFilterTolerance;
+        float uLodThreshold;  // Cells above this are aggregated (0 in density-only mode)
+        float uLodExposure;
+        bool uLodCull;
+        // Instance decode of packed sets (see InstancePacking.h), identity for float
+        // sets. Index 0 current, 1 next; uValueRange is scale, bias per set.
+        // uPositionScale[k].w is 1 for packed sets, whose value code 0 is an absent point.
+        vec4 uPositionScale[2];
+        vec4 uPositionBias[2];
+        vec4 uValueRange;
+        // Range filters (see RangeFilter.h): range k is component k % 4 of entry k / 4
+        vec4 uRangeMin[2];
+        vec4 uRangeMax[2];
+        int uRangeCount;  // 0: no filter
+        int uRangeRows;   // Rows per column in uRangeColumns
+    };
+)";
+
+constexpr unsigned int kFrameStateBinding = 0;
+
+// std140 mirror of FrameState
+struct FrameUniforms {
+    float viewProj[16];
+    float cameraRight[3];
+    float scale;
+    float cameraUp[3];
+    float time;
+    float selectedColor[3];
+    float alpha;
+    int32_t categorical;
+    int32_t selectedID;
+    int32_t hasSelection;
+    int32_t colorFilterEnabled;
+    float colorFilterValue;
+    float colorFilterTolerance;
+    float lodThreshold;
+    float lodExposure;
+    int32_t lodCull;
+    int32_t pad[3];
+    float positionScale[2][4];
+    float positionBias[2][4];
+    float valueRange[4];
+    float rangeMin[2][4];
+    float rangeMax[2][4];
+    int32_t rangeCount;
+    int32_t rangeRows;
+    int32_t pad2[2];
+};
+static_assert(sizeof(FrameUniforms) == 320, "FrameUniforms must match the std140 FrameState block");
+
+// Range predicates of every point vertex shader, compiled between the frame
+// state and the fetch prelude. The filtered feature columns are stored one
+// after another in a float buffer texture; a point without a feature row fails.
+const char* rangeFilterSource = R"(
+    uniform samplerBuffer uRangeColumns;
+
+    bool rangeRejected(int id) {
+        if (uRangeCount == 0) return false;
+        if (id >= uRangeRows) return true;
+        for (int k = 0; k < uRangeCount; k++) {
+            float v = texelFetch(uRangeColumns, k * uRangeRows + id).r;
+            // NaN fails both comparisons
+            if (!(v >= uRangeMin[k / 4][k % 4] && v <= uRangeMax[k / 4][k % 4])) return true;
+        }
+        return false;
+    }
+)";
+
+// Per-instance attributes 1-4 (divisor 1), drawn with glDrawArraysInstanced.
+// Packed sets (see InstancePacking.h) arrive normalized and are restored with
+// their FrameState scale/bias; float sets use scale 1, bias 0.
+const char* instanceAttributeFetchSource = R"(
+    layout(location = 0) in vec3 aLocalPos;
+    layout(location = 1) in vec3 aInstancePos;
+    layout(location = 2) in float aValue;
+    layout(location = 3) in vec3 aNextPos;
+    layout(location = 4) in float aNextValue;
+
+    struct Instance {
+        vec3 pos;
+        vec3 nextPos;
+        float value;
+        float nextValue;
+        int id;
+        bool absent;  // NaN position in either set: clipped out
+    };
+
+    Instance fetchInstance() {
+        vec3 pos = aInstancePos * uPositionScale[0].xyz + uPositionBias[0].xyz;
+        vec3 nextPos = aNextPos * uPositionScale[1].xyz + uPositionBias[1].xyz;
+        // NaN positions: as floats, or the reserved value code 0 of a packed set
+        bool absent = any(isnan(pos)) || any(isnan(nextPos)) ||
+                      (uPositionScale[0].w > 0.0 && aValue == 0.0) ||
+                      (uPositionScale[1].w > 0.0 && aNextValue == 0.0);
+        return Instance(pos, nextPos,
+                        aValue * uValueRange.x + uValueRange.y,
+                        aNextValue * uValueRange.z + uValueRange.w,
+                        gl_InstanceID, absent);
+    }
+
+    vec3 quadCorner() { return aLocalPos; }
+)";
+
+// Instance indices of the buffer fetch, compiled before instanceBufferFetchSource.
+// Culled draws, viewport subsets and the timeline draw the quad strip
+// instanced, with attribute 5 the point index from an index buffer.
+const char* instanceIndexAttributeSource = R"(
+    layout(location = 0) in vec3 aLocalPos;
+    layout(location = 5) in uint aIndex;
 
+    int instanceIndex() { return int(aIndex); }
+    vec3 quadCorner() { return aLocalPos; }
+)";
+
+// Vertex pulling: one non-instanced glDrawArrays(GL_TRIANGLES) of six
+// vertices per point, without vertex attributes; the vertex ID picks the
+// point and the corner of its two triangles
+const char* instanceIndexPulledSource = R"(
+    const vec2 kQuadCorners[6] = vec2[6](vec2(-0.5, 0.5), vec2(-0.5, -0.5), vec2(0.5, 0.5),
+                                         vec2(0.5, 0.5), vec2(-0.5, -0.5), vec2(0.5, -0.5));
+
+    int instanceIndex() { return gl_VertexID / 6; }
+    vec3 quadCorner() { return vec3(kQuadCorners[gl_VertexID % 6], 0.0); }
+)";
+
+// Point data read from buffer textures (offsets in floats) at instanceIndex()
+const char* instanceBufferFetchSource = R"(
+    uniform samplerBuffer uPositionBuffer;
+    uniform samplerBuffer uValueBuffer;
+    uniform samplerBuffer uNextPositionBuffer;
+    uniform samplerBuffer uNextValueBuffer;
+    uniform int uPositionOffset;
+    uniform int uValueOffset;
+    uniform int uNextPositionOffset;
+    uniform int uNextValueOffset;
+    uniform int uNextCount;
+
+    struct Instance {
+        vec3 pos;
+        vec3 nextPos;
+        float value;
+        float nextValue;
+        int id;
+        bool absent;  // NaN position in either set: clipped out
+    };
+
+    vec3 fetchVec3(samplerBuffer buf, int base) {
+        return vec3(texelFetch(buf, base).r, texelFetch(buf, base + 1).r, texelFetch(buf, base + 2).r);
+    }
+
+    Instance fetchInstance() {
+        int i = instanceIndex();
+        vec3 pos = fetchVec3(uPositionBuffer, uPositionOffset + i * 3);
+        float value = texelFetch(uValueBuffer, uValueOffset + i).r;
+        vec3 nextPos = pos;
+        float nextValue = value;
+        if (i < uNextCount) {
+            nextPos = fetchVec3(uNextPositionBuffer, uNextPositionOffset + i * 3);
+            nextValue = texelFetch(uNextValueBuffer, uNextValueOffset + i).r;
+        }
+        return Instance(pos, nextPos, value, nextValue, i, any(isnan(pos)) || any(isnan(nextPos)));
+    }
+)";
+
+// Billboard body (compiled after an instance fetch prelude)
+const char* vertexShaderSource = R"(
     out float vValue;
     out vec2 vUV;
     flat out int vID; 
+    flat out vec2 vColorCoord;  // uColorLut coordinate: entry, layer
 
-    uniform mat4 uVP;       
-    uniform float uScale;   
-    uniform float uTime;    
-    uniform vec3 uCameraRight;
-    uniform vec3 uCameraUp;
+    // One uint8 label per point, points past the last label are category 0
+    uniform usamplerBuffer uCategories;
+
+    // Density LOD: with uLodCull, points in cells denser than uLodThreshold are
+    // drawn by the composite pass
+    uniform sampler2D uDensity;
 
     void main() {
+        Instance inst = fetchInstance();
+        vec3 corner = quadCorner();
         
-        vec3 currentPos = mix(aInstancePos, aNextPos, uTime);
-        float currentValue = mix(aValue, aNextValue, uTime);
+        vec3 currentPos = mix(inst.pos, inst.nextPos, uTime);
+        // Points missing from a keyframe are NaN: place them outside the clip volume
+        if (inst.absent) { gl_Position = vec4(10.0, 10.0, 10.0, 1.0); return; }
+        // Rejected by a range filter: every corner clipped, nothing is rasterized
+        if (rangeRejected(inst.id)) { gl_Position = vec4(10.0, 10.0, 10.0, 1.0); return; }
+        float currentValue = mix(inst.value, inst.nextValue, uTime);
 
         vValue = currentValue;
-        vUV = aLocalPos.xy * 2.0; 
-        vID = gl_InstanceID;
+        vUV = corner.xy * 2.0; 
+        vID = inst.id;
+
+        // Texel centers of the 256-entry LUT (ColorMap::kSize): values are
+        // filtered between entries, categories hit theirs exactly
+        float valueCoord = (clamp(currentValue, 0.0, 1.0) * 255.0 + 0.5) / 256.0;
+        uint category = inst.id < textureSize(uCategories) ? texelFetch(uCategories, inst.id).r : 0u;
+        float categoryCoord = (float(category) + 0.5) / 256.0;
+        vColorCoord = uCategorical != 0 ? vec2(categoryCoord, 1.0) : vec2(valueCoord, 0.0);
+
+        if (uLodCull && inst.id != uSelectedID) {
+            vec4 center = uVP * vec4(currentPos, 1.0);
+            if (center.w > 0.01) {
+                vec2 uv = center.xy / center.w * 0.5 + 0.5;
+                if (all(greaterThanEqual(uv, vec2(0.0))) && all(lessThan(uv, vec2(1.0))) &&
+                    texture(uDensity, uv).r > uLodThreshold) {
+                    gl_Position = vec4(10.0, 10.0, 10.0, 1.0);
+                    return;
+                }
+            }
+        }
         
-        vec3 offset = (uCameraRight * aLocalPos.x * uScale) + (uCameraUp * aLocalPos.y * uScale);
+        vec3 offset = (uCameraRight * corner.x * uScale) + (uCameraUp * corner.y * uScale);
         vec3 worldPos = currentPos + offset;
         vec4 clipPos = uVP * vec4(worldPos, 1.0);        
         
@@ -41,45 +253,40 @@ const char* vertexShaderSource = R"(
     }
 )";
 
+// Billboard fragment outputs. The fragment body is compiled after one of these
+// and hands its final color to writeFragment().
+const char* blendedOutputSource = R"(
+    out vec4 FragColor;
+
+    void writeFragment(vec4 color) {
+        FragColor = color;
+    }
+)";
+
+// Weighted blended order-independent transparency (McGuire & Bavoil 2013):
+// premultiplied color times a depth/alpha weight is summed into attachment 0,
+// the product of (1 - alpha) into attachment 1. Blend state is set by the pass.
+const char* oitOutputSource = R"(
+    layout(location = 0) out vec4 Accum;
+    layout(location = 1) out float Revealage;
+
+    void writeFragment(vec4 color) {
+        // Near and opaque fragments dominate; clamped to stay inside RGBA16F
+        float z = gl_FragCoord.z;
+        float w = clamp(pow(min(1.0, color.a * 10.0) + 0.01, 3.0) * 1e8 * pow(1.0 - z * 0.9, 3.0), 1e-2, 3e3);
+        Accum = vec4(color.rgb * color.a, color.a) * w;
+        Revealage = color.a;
+    }
+)";
+
 const char* fragmentShaderSource = R"(
-    #version 410 core
     in float vValue;
     in vec2 vUV;
     flat in int vID;
+    flat in vec2 vColorCoord;
 
-    out vec4 FragColor;
-    
-    uniform float uAlpha;         
-    uniform int uColorMode;       
-    uniform int uSelectedID;      
-    uniform bool uHasSelection;   
-    uniform vec3 uSelectedColor;
-    
-    // Color filter uniforms
-    uniform bool uColorFilterEnabled;
-    uniform float uColorFilterValue;
-    uniform float uColorFilterTolerance;
-
-    
-    vec3 heatMap(float t) {
-        t = clamp(t, 0.0, 1.0);
-        vec3 color = vec3(0.0);
-        if (t < 0.5) {
-            color = mix(vec3(0.0, 0.0, 1.0), vec3(0.0, 1.0, 1.0), t * 2.0);
-        } else {
-            color = mix(vec3(0.0, 1.0, 1.0), vec3(1.0, 0.0, 0.0), (t - 0.5) * 2.0);
-        }
-        return color;
-    }
-
-    vec3 coolWarm(float t) {
-        t = clamp(t, 0.0, 1.0);
-        if (t < 0.5) {
-            return mix(vec3(0.2, 0.4, 1.0), vec3(0.9, 0.9, 0.9), t * 2.0);
-        } else {
-            return mix(vec3(0.9, 0.9, 0.9), vec3(1.0, 0.2, 0.2), (t - 0.5) * 2.0);
-        }
-    }
+    // Layer 0: continuous palette, layer 1: category colors (see ColorMap)
+    uniform sampler1DArray uColorLut;
 
     void main() {
         
@@ -87,10 +294,7 @@ const char* fragmentShaderSource = R"(
         if (distSq > 1.0) discard;
 
         // Calculate inner color
-        vec3 cv;
-        if (uColorMode == 0) cv = heatMap(vValue);
-        else if (uColorMode == 1) cv = coolWarm(vValue);
-        else cv = vec3(clamp(vValue, 0.0, 1.0));
+        vec3 cv = texture(uColorLut, vColorCoord).rgb;
 
         // Anti-aliased Outline: Smoothly blend to black at the edge
         // Transition starts at radius 0.92, fully black by 0.95
@@ -127,7 +331,7 @@ const char* fragmentShaderSource = R"(
             }
         }
 
-        FragColor = vec4(cv, finalAlpha);
+        writeFragment(vec4(cv, finalAlpha));
     }
 )";
 
@@ -135,29 +339,19 @@ const char* fragmentShaderSource = R"(
 
 
 
+// Picking body (compiled after an instance fetch prelude)
 const char* pickingVertexShaderSource = R"(
-    #version 410 core
-    layout(location = 0) in vec3 aLocalPos;    
-    layout(location = 1) in vec3 aInstancePos; 
-    layout(location = 2) in float aValue;      
-    layout(location = 3) in vec3 aNextPos;     
-    layout(location = 4) in float aNextValue;  
-
-    uniform mat4 uVP;       
-    uniform float uScale;   
-    uniform float uTime;    
-    uniform vec3 uCameraRight;
-    uniform vec3 uCameraUp;
-
-    
     flat out int vID; 
     out vec2 vUV; 
 
     void main() {
-        vec3 currentPos = mix(aInstancePos, aNextPos, uTime);
-        vUV = aLocalPos.xy * 2.0; 
+        Instance inst = fetchInstance();
+        vec3 corner = quadCorner();
+        vec3 currentPos = mix(inst.pos, inst.nextPos, uTime);
+        if (inst.absent || rangeRejected(inst.id)) { gl_Position = vec4(10.0, 10.0, 10.0, 1.0); return; }
+        vUV = corner.xy * 2.0; 
         
-        vec3 offset = (uCameraRight * aLocalPos.x * uScale) + (uCameraUp * aLocalPos.y * uScale);
+        vec3 offset = (uCameraRight * corner.x * uScale) + (uCameraUp * corner.y * uScale);
         vec3 worldPos = currentPos + offset;
 
         vec4 clipPos = uVP * vec4(worldPos, 1.0);
@@ -170,12 +364,11 @@ const char* pickingVertexShaderSource = R"(
         gl_Position = clipPos;
         
         
-        vID = gl_InstanceID;
+        vID = inst.id;
     }
 )";
 
 const char* pickingFragmentShaderSource = R"(
-    #version 410 core
     layout(location = 0) out int FragID; 
 
     flat in int vID;
@@ -189,5 +382,263 @@ const char* pickingFragmentShaderSource = R"(
         FragID = vID; 
     }
 )";
+// Delta updates: scatter packed patches into the instance VBOs (GL 4.3)
+const char* scatterComputeShaderSource = R"(
+    #version 430 core
+    layout(local_size_x = 256) in;
+
+    struct Patch {
+        uint index;
+        float value;
+        float px, py, pz;
+    };
+
+    layout(std430, binding = 0) readonly buffer Patches { Patch patches[]; };
+    layout(std430, binding = 1) buffer Positions { float positions[]; };
+    layout(std430, binding = 2) buffer Values { float values[]; };
+
+    uniform uint uPatchCount;
+
+    void main() {
+        uint i = gl_GlobalInvocationID.x;
+        if (i >= uPatchCount) return;
+
+        Patch p = patches[i];
+        positions[p.index * 3u + 0u] = p.px;
+        positions[p.index * 3u + 1u] = p.py;
+        positions[p.index * 3u + 2u] = p.pz;
+        values[p.index] = p.value;
+    }
+)";
+
+// Brush selection (GL 4.3), see SelectionEngine.
+// Pass 0 projects instances, pass 1 marks IDs visible in the picking texture,
+// pass 2 compacts marked IDs. Matches are appended with an atomic counter.
+const char* selectionComputeShaderSource = R"(
+    #version 430 core
+    layout(local_size_x = 256) in;
+
+    layout(std430, binding = 0) readonly buffer CurrentPos { float currentPos[]; };
+    layout(std430, binding = 1) readonly buffer NextPos { float nextPos[]; };
+    layout(std430, binding = 2) buffer Marks { uint marks[]; };
+    layout(std430, binding = 3) buffer Result { uint resultCount; uint resultIds[]; };
+    layout(std430, binding = 4) readonly buffer Brush { vec2 brush[]; };
+
+    uniform uint uPass;
+    uniform mat4 uVP;
+    uniform float uTime;
+    uniform uint uCount;
+    uniform uint uNextCount;
+    uniform uint uCurrentOffset;  // In floats
+    uniform uint uNextOffset;
+    uniform vec2 uViewport;
+    uniform int uBrushCount;
+    uniform uint uResultLimit;
+    uniform ivec4 uRegion;        // Pass 1: x, y, width, height
+    uniform isampler2D uIdTexture;
+
+    bool insideBrush(vec2 p) {
+        bool inside = false;
+        for (int i = 0, j = uBrushCount - 1; i < uBrushCount; j = i++) {
+            vec2 a = brush[i];
+            vec2 b = brush[j];
+            if (((a.y > p.y) != (b.y > p.y)) &&
+                (p.x < (b.x - a.x) * (p.y - a.y) / (b.y - a.y) + a.x)) {
+                inside = !inside;
+            }
+        }
+        return inside;
+    }
+
+    void append(uint id) {
+        uint slot = atomicAdd(resultCount, 1u);
+        if (slot < uResultLimit) resultIds[slot] = id;
+    }
+
+    void main() {
+        // 2D dispatch: more than 65535 groups do not fit in one dimension
+        uint i = gl_GlobalInvocationID.y * gl_NumWorkGroups.x * 256u + gl_GlobalInvocationID.x;
+
+        if (uPass == 1u) {
+            uint w = uint(uRegion.z);
+            if (i >= w * uint(uRegion.w)) return;
+            ivec2 px = uRegion.xy + ivec2(int(i % w), int(i / w));
+            int id = texelFetch(uIdTexture, px, 0).r;
+            if (id < 0 || uint(id) >= uCount) return;
+            if (!insideBrush(vec2(px) + 0.5)) return;
+            atomicOr(marks[uint(id) >> 5], 1u << (uint(id) & 31u));
+            return;
+        }
+
+        if (i >= uCount) return;
+
+        if (uPass == 2u) {
+            if ((marks[i >> 5] & (1u << (i & 31u))) != 0u) append(i);
+            return;
+        }
+
+        uint c = uCurrentOffset + i * 3u;
+        vec3 pos = vec3(currentPos[c], currentPos[c + 1u], currentPos[c + 2u]);
+        if (i < uNextCount) {
+            uint n = uNextOffset + i * 3u;
+            pos = mix(pos, vec3(nextPos[n], nextPos[n + 1u], nextPos[n + 2u]), uTime);
+        }
+
+        vec4 clip = uVP * vec4(pos, 1.0);
+        if (clip.w < 0.01) return;
+        vec2 pixel = (clip.xy / clip.w * 0.5 + 0.5) * uViewport;
+        if (insideBrush(pixel)) append(i);
+    }
+)";
+
+// Density LOD: one additive point per instance into a downsampled RG32F
+// target (R = count, G = value sum). Drawn instanced with a single vertex so it
+// reuses the billboard VAO and its instance bindings (attribute fetch prelude).
+const char* densityVertexShaderSource = R"(
+    out float vValue;
+
+    void main() {
+        Instance inst = fetchInstance();
+        vec3 currentPos = mix(inst.pos, inst.nextPos, uTime);
+        vValue = mix(inst.value, inst.nextValue, uTime);
+
+        vec4 clipPos = uVP * vec4(currentPos, 1.0);
+        bool filtered = uColorFilterEnabled && abs(vValue - uColorFilterValue) > uColorFilterTolerance;
+        if (inst.absent || clipPos.w < 0.01 || filtered || rangeRejected(inst.id)) {
+            clipPos = vec4(10.0, 10.0, 10.0, 1.0);
+        }
+        gl_Position = clipPos;
+        gl_PointSize = 1.0;
+    }
+)";
+
+const char* densityFragmentShaderSource = R"(
+    in float vValue;
+    layout(location = 0) out vec2 Density;
+
+    void main() {
+        Density = vec2(1.0, vValue);
+    }
+)";
+
+// Density LOD composite: full-screen triangle, mean value through the palette,
+// coverage from the count
+const char* densityCompositeVertexShaderSource = R"(
+    out vec2 vUV;
+
+    void main() {
+        vec2 pos = vec2(float((gl_VertexID << 1) & 2), float(gl_VertexID & 2));
+        vUV = pos;
+        gl_Position = vec4(pos * 2.0 - 1.0, 0.0, 1.0);
+    }
+)";
+
+const char* densityCompositeFragmentShaderSource = R"(
+    in vec2 vUV;
+    out vec4 FragColor;
+
+    uniform sampler2D uDensity;  // Cells at or below uLodThreshold are left to the billboards
+    uniform sampler1DArray uColorLut;  // Mean values use the continuous layer in every mode
+
+    void main() {
+        vec2 d = texture(uDensity, vUV).rg;
+        if (d.r <= uLodThreshold) discard;
+
+        float v = d.g / d.r;
+        vec3 cv = texture(uColorLut, vec2((clamp(v, 0.0, 1.0) * 255.0 + 0.5) / 256.0, 0.0)).rgb;
+
+        float coverage = 1.0 - exp(-d.r * uLodExposure);
+        FragColor = vec4(cv, coverage * uAlpha);
+    }
+)";
+
+// Resolves the OIT targets over the scene (blended SRC_ALPHA, ONE_MINUS_SRC_ALPHA)
+const char* oitCompositeFragmentShaderSource = R"(
+    out vec4 FragColor;
+
+    uniform sampler2D uAccum;
+    uniform sampler2D uRevealage;
+
+    void main() {
+        ivec2 texel = ivec2(gl_FragCoord.xy);
+        float revealage = texelFetch(uRevealage, texel, 0).r;
+        if (revealage >= 1.0) discard;  // No translucent fragment here
+
+        vec4 accum = texelFetch(uAccum, texel, 0);
+        vec3 average = accum.rgb / max(accum.a, 1e-5);
+        FragColor = vec4(average, 1.0 - revealage);
+    }
+)";
+
+// Frustum culling (GL 4.3): append the indices of instances whose bounding
+// sphere touches the frustum and count them into the indirect draw command
+const char* cullComputeShaderSource = R"(
+    #version 430 core
+    layout(local_size_x = 256) in;
+
+    layout(std430, binding = 0) readonly buffer CurrentPos { float currentPos[]; };
+    layout(std430, binding = 1) readonly buffer NextPos { float nextPos[]; };
+    layout(std430, binding = 2) writeonly buffer Visible { uint visible[]; };
+    layout(std430, binding = 3) buffer Command {
+        uint vertexCount;
+        uint instanceCount;
+        uint firstVertex;
+        uint baseInstance;
+    };
+
+    uniform vec4 uPlanes[6];      // Normalized, inside is positive
+    uniform float uRadius;
+    uniform float uTime;
+    uniform uint uCount;
+    uniform uint uNextCount;
+    uniform uint uCurrentOffset;  // In floats
+    uniform uint uNextOffset;
+
+    void main() {
+        uint i = gl_GlobalInvocationID.y * gl_NumWorkGroups.x * 256u + gl_GlobalInvocationID.x;
+        if (i >= uCount) return;
+
+        uint c = uCurrentOffset + i * 3u;
+        vec3 pos = vec3(currentPos[c], currentPos[c + 1u], currentPos[c + 2u]);
+        if (i < uNextCount) {
+            uint n = uNextOffset + i * 3u;
+            pos = mix(pos, vec3(nextPos[n], nextPos[n + 1u], nextPos[n + 2u]), uTime);
+        }
+
+        for (int p = 0; p < 6; p++) {
+            if (dot(uPlanes[p].xyz, pos) + uPlanes[p].w < -uRadius) return;
+        }
+        visible[atomicAdd(instanceCount, 1u)] = i;
+    }
+)";
+
+// Range filters (GL 4.3), see RangeFilter: append the rows whose value lies in
+// [uMin[k], uMax[k]] in every column k of the column buffer
+const char* rangeComputeShaderSource = R"(
+    #version 430 core
+    layout(local_size_x = 256) in;
+
+    layout(std430, binding = 0) readonly buffer Columns { float columns[]; };
+    layout(std430, binding = 1) buffer Result {
+        uint resultCount;
+        uint resultIds[];
+    };
+
+    uniform uint uRows;
+    uniform int uRangeCount;
+    uniform float uMin[8];  // RangeFilter::kMaxRanges
+    uniform float uMax[8];
+
+    void main() {
+        uint i = gl_GlobalInvocationID.y * gl_NumWorkGroups.x * 256u + gl_GlobalInvocationID.x;
+        if (i >= uRows) return;
+
+        for (int k = 0; k < uRangeCount; k++) {
+            float v = columns[uint(k) * uRows + i];
+            if (!(v >= uMin[k] && v <= uMax[k])) return;
+        }
+        resultIds[atomicAdd(resultCount, 1u)] = i;
+    }
+)";
 
 #endif
\ No newline at end of file
@@ -1,6 +1,6 @@
 import numpy as np
 import pandas as pd
-from typing import Optional, List, Tuple, Union
+from typing import Iterable, Optional, List, Tuple, Union
 
 # Optional import for UMAP
 try:
@@ -15,6 +15,88 @@ from sklearn.base import BaseEstimator
 from sklearn.cluster import KMeans
 from sklearn.ensemble import IsolationForest
 
+# Native kernels (mini-batch k-means, kNN outlier scores), optional
+try:
+    from . import qsplot_engine
+except ImportError:
+    try:
+        import qsplot_engine
+    except ImportError:
+        qsplot_engine = None
+
+class IncrementalPCA:
+    """
+    Correlation PCA fitted chunk by chunk by the engine's DataProcessor
+    (partial_fit), with the same axes compute_pca() would find on all chunks
+    at once. Exposes the parts of sklearn's PCA that the reducers use:
+    transform(), n_components, components_ and explained_variance_ratio_.
+    """
+
+    def __init__(self, n_components: int = 3):
+        self.n_components = n_components
+        self._native = qsplot_engine.DataProcessor()
+        self._native.reset_incremental(n_components)
+
+    @staticmethod
+    def _rows(X: np.ndarray) -> np.ndarray:
+        X = np.asarray(X)
+        return X if X.dtype in (np.float32, np.float64) else X.astype(np.float64)
+
+    def partial_fit(self, X: np.ndarray) -> 'IncrementalPCA':
+        self._native.partial_fit(self._rows(X))
+        return self
+
+    def transform(self, X: np.ndarray) -> np.ndarray:
+        return np.asarray(self._native.transform(self._rows(X)))
+
+    @property
+    def components_(self) -> np.ndarray:
+        return np.asarray(self._native.get_incremental_components())
+
+    @property
+    def explained_variance_ratio_(self) -> np.ndarray:
+        return np.asarray(self._native.get_explained_variance_ratio())
+
+
+class StandardizedPCA:
+    """
+    sklearn PCA on standardized features: the correlation PCA the engine's
+    DataProcessor computes, for installs without the extension. Features are
+    centered and divided by their sample std (ddof = 1, constant features by
+    1) and each axis' largest loading is made positive, as the engine does, so
+    both give the same axes, variance ratios and projections.
+    """
+
+    def __init__(self, n_components: int = 3):
+        self.n_components = n_components
+        self._pca = PCA(n_components=n_components)
+        self.mean_ = None
+        self.scale_ = None
+
+    def fit(self, X: np.ndarray) -> 'StandardizedPCA':
+        X = np.asarray(X, dtype=np.float64)
+        self.mean_ = X.mean(axis=0)
+        std = X.std(axis=0, ddof=1) if len(X) > 1 else np.zeros(X.shape[1])
+        self.scale_ = np.where(std < 1e-9, 1.0, std)
+        self._pca.fit((X - self.mean_) / self.scale_)
+        # The engine's sign convention: largest absolute loading positive
+        components = self._pca.components_
+        largest = components[np.arange(len(components)), np.argmax(np.abs(components), axis=1)]
+        self._pca.components_ = components * np.where(largest < 0.0, -1.0, 1.0)[:, None]
+        return self
+
+    def transform(self, X: np.ndarray) -> np.ndarray:
+        return self._pca.transform((np.asarray(X, dtype=np.float64) - self.mean_) / self.scale_)
+
+    @property
+    def components_(self) -> np.ndarray:
+        return self._pca.components_
+
+    @property
+    def explained_variance_ratio_(self) -> np.ndarray:
+        return self._pca.explained_variance_ratio_
+
+
 class DataProcessor:
     """
     Handles data cleaning, dimensionality reduction, and normalization
@@ -22,7 +104,8 @@ class DataProcessor:
     """
     
     def __init__(self):
-        pass
+        self._kmeans = None  # Native model, kept so the next call starts from its centroids
+        self._kmeans_clusters = 0
 
     def clean_data(self, df: pd.DataFrame, strategy: str = 'mean') -> pd.DataFrame:
         """
@@ -47,7 +130,8 @@ class DataProcessor:
             raise ValueError(f"Unknown cleaning strategy: {strategy}")
 
     def fit_global_pca(self, data: np.ndarray, n_components: int = 3, 
-                        feature_names: Optional[List[str]] = None) -> dict:
+                        feature_names: Optional[List[str]] = None,
+                        standardize: bool = False) -> dict:
         """
         Fit PCA on the full dataset (all timestamps concatenated) and return
         the fitted model + metadata. This fitted PCA can then be passed to
@@ -57,6 +141,8 @@ class DataProcessor:
             data: Full dataset (all timestamps), shape (N_total, N_features).
             n_components: Target dimensionality.
             feature_names: Optional feature column names.
+            standardize: Fit on standardized features (a StandardizedPCA), the
+                same model as fit_global_pca_incremental().
             
         Returns:
             Dict with 'pca' (fitted PCA object), 'explained_variance_ratios',
@@ -66,13 +152,48 @@ class DataProcessor:
             feature_names = [f"feat_{i}" for i in range(data.shape[1])]
         
         actual_n = min(n_components, data.shape[0], data.shape[1])
-        pca = PCA(n_components=actual_n)
+        pca = StandardizedPCA(n_components=actual_n) if standardize else PCA(n_components=actual_n)
         pca.fit(data)
         
         info = self._extract_pca_info(pca, feature_names, actual_n)
         info['pca'] = pca
         return info
     
+    @staticmethod
+    def has_incremental_pca() -> bool:
+        """True if the engine's incremental PCA is available."""
+        return qsplot_engine is not None and hasattr(getattr(qsplot_engine, 'DataProcessor', None), 'partial_fit')
+
+    def fit_global_pca_incremental(self, frames: Iterable[np.ndarray], n_features: int, n_components: int = 3,
+                                   feature_names: Optional[List[str]] = None) -> dict:
+        """
+        Like fit_global_pca(), but folds the dataset in one frame at a time
+        with the engine's incremental PCA, so the timestamps are never
+        concatenated. The axes are those of the engine's correlation PCA
+        (DataProcessor.compute_pca), i.e. of the standardized features.
+
+        Args:
+            frames: Iterable of (N_i, N_features) arrays, e.g. one per timestamp.
+            n_features: Column count of every frame.
+            n_components: Target dimensionality.
+            feature_names: Optional feature column names.
+
+        Returns:
+            Same keys as fit_global_pca(), 'pca' being an IncrementalPCA.
+        """
+        if feature_names is None:
+            feature_names = [f"feat_{i}" for i in range(n_features)]
+
+        actual_n = min(n_components, n_features)
+        pca = IncrementalPCA(n_components=actual_n)
+        for X in frames:
+            if len(X):
+                pca.partial_fit(X)
+
+        info = self._extract_pca_info(pca, feature_names, actual_n)
+        info['pca'] = pca
+        return info
+
     def _extract_pca_info(self, pca: PCA, feature_names: List[str], 
                            n_components: int) -> dict:
         """
@@ -261,7 +382,10 @@ class DataProcessor:
         Args:
             X: Feature matrix (N, F).
             n_clusters: Number of clusters to find.
-            method: Clustering algorithm (currently only 'kmeans' is supported).
+            method: Clustering algorithm: 'kmeans' (sklearn) or 'minibatch'
+                (native mini-batch k-means on all cores; each call starts from
+                the previous call's centroids, so consecutive frames converge
+                quickly and keep their cluster numbers).
             
         Returns:
             Cluster labels (N,).
@@ -269,9 +393,43 @@ class DataProcessor:
         if method.lower() == 'kmeans':
             model = KMeans(n_clusters=n_clusters, random_state=42, n_init='auto')
             return model.fit_predict(X)
+        elif method.lower() == 'minibatch':
+            if qsplot_engine is None or not hasattr(qsplot_engine, 'KMeans'):
+                raise RuntimeError("method 'minibatch' needs the qsplot_engine C++ module")
+            if self._kmeans is None or self._kmeans_clusters != n_clusters:
+                self._kmeans = qsplot_engine.KMeans(n_clusters=n_clusters)
+                self._kmeans_clusters = n_clusters
+            X = np.asarray(X)
+            if X.dtype not in (np.float32, np.float64):
+                X = X.astype(np.float64)
+            return self._kmeans.fit_predict(qsplot_engine.FeatureStore(X))
         else:
             raise ValueError(f"Unsupported clustering method: {method}")
 
+    @staticmethod
+    def flag_outliers(scores: np.ndarray, contamination: float = 0.05) -> np.ndarray:
+        """
+        Flags the top `contamination` share of scores, as the engine's
+        set_auto_categories('outliers') does: the threshold is the lower
+        (1 - contamination) quantile, compared strictly when it equals the
+        lowest score, so tied scores (e.g. identical rows) flag nothing.
+
+        Args:
+            scores: Outlier scores (N,), higher is more anomalous.
+            contamination: Expected proportion of outliers.
+
+        Returns:
+            Boolean flags (N,).
+        """
+        scores = np.asarray(scores)
+        if scores.size == 0 or not contamination > 0.0:
+            return np.zeros(scores.shape, dtype=bool)
+        k = int(np.floor((1.0 - min(contamination, 1.0)) * (scores.size - 1)))
+        threshold = np.partition(scores, k)[k]
+        if threshold <= scores.min():
+            return scores > threshold
+        return scores >= threshold
+
     def detect_outliers(self, X: np.ndarray, contamination: float = 0.05, method: str = 'isolation_forest') -> np.ndarray:
         """
         Detects outliers in the feature matrix and returns anomaly scores.
@@ -282,7 +440,9 @@ class DataProcessor:
         Args:
             X: Feature matrix (N, F).
             contamination: Expected proportion of outliers.
-            method: Outlier detection algorithm (currently only 'isolation_forest' is supported).
+            method: Outlier detection algorithm: 'isolation_forest' (sklearn) or
+                'knn' (native: mean distance to the 10 nearest points in the
+                3D PCA projection of X, or in X itself if it is N x 3).
             
         Returns:
             Anomaly scores in range [0, 1] where 1 is most anomalous.
@@ -295,5 +455,15 @@ class DataProcessor:
             # Normalize to [0, 1] where 1 is the most anomalous (lowest original score)
             scores_norm = 1.0 - ((scores - scores.min()) / (scores.max() - scores.min()))
             return scores_norm
+        elif method.lower() == 'knn':
+            if qsplot_engine is None or not hasattr(qsplot_engine, 'outlier_scores'):
+                raise RuntimeError("method 'knn' needs the qsplot_engine C++ module")
+            positions = np.asarray(X)
+            if positions.ndim != 2 or positions.shape[1] != 3:
+                n_components = min(3, positions.shape[1])
+                reduced = PCA(n_components=n_components, random_state=42).fit_transform(positions)
+                positions = np.zeros((len(reduced), 3), dtype=np.float32)
+                positions[:, :n_components] = reduced
+            return qsplot_engine.outlier_scores(np.ascontiguousarray(positions, dtype=np.float32))
         else:
             raise ValueError(f"Unsupported outlier detection method: {method}")
@@ -0,0 +1,225 @@
+"""
+Reader and writer for .qsp session files.
+
+A .qsp file holds precomputed frames (positions, values and optional
+features of a fixed set of labelled points) in the layout documented in
+core/QspFile.h, so the engine can map it and page frames straight to the
+GPU without going through pandas, PCA or normalization again.
+"""
+
+import os
+from typing import Any, Dict, List, Optional, Sequence
+
+import numpy as np
+
+MAGIC = b"QSPLOT\0\0"
+VERSION = 1
+ALIGNMENT = 4096
+HEADER_SIZE = 128
+
+HEADER_DTYPE = np.dtype([
+    ("magic", "V8"),
+    ("version", "<u4"),
+    ("header_size", "<u4"),
+    ("frame_count", "<u8"),
+    ("point_count", "<u8"),
+    ("feature_count", "<u8"),
+    ("positions_offset", "<u8"), ("positions_stride", "<u8"),
+    ("values_offset", "<u8"), ("values_stride", "<u8"),
+    ("features_offset", "<u8"), ("features_stride", "<u8"),
+    ("labels_offset", "<u8"),
+    ("feature_names_offset", "<u8"),
+    ("frame_names_offset", "<u8"),
+    ("reserved", "<u8", (2,)),
+])
+assert HEADER_DTYPE.itemsize == HEADER_SIZE
+
+
+def _align(n: int, alignment: int = ALIGNMENT) -> int:
+    return (n + alignment - 1) // alignment * alignment
+
+
+def _string_table(strings: Sequence[str]) -> bytes:
+    encoded = [str(s).encode("utf-8") for s in strings]
+    offsets = np.zeros(len(encoded) + 1, dtype="<u8")
+    offsets[1:] = np.cumsum([len(e) for e in encoded], dtype=np.uint64)
+    return np.uint64(len(encoded)).astype("<u8").tobytes() + offsets.tobytes() + b"".join(encoded)
+
+
+def _read_string_table(buf: memoryview, offset: int) -> List[str]:
+    count = int(np.frombuffer(buf, dtype="<u8", count=1, offset=offset)[0])
+    offsets = np.frombuffer(buf, dtype="<u8", count=count + 1, offset=offset + 8)
+    base = offset + 8 + 8 * (count + 1)
+    return [bytes(buf[base + int(offsets[i]):base + int(offsets[i + 1])]).decode("utf-8")
+            for i in range(count)]
+
+
+class QspWriter:
+    """
+    Writes a .qsp file frame by frame, so a session never has to fit in memory.
+
+    Frames may be written in any order; frames never written are stored with
+    NaN positions (not drawn). Use as a context manager or call close().
+
+    Args:
+        path: Output file.
+        labels: One label (ticker) per point; fixes the point count.
+        frame_count: Number of frames.
+        feature_names: Feature column names, or None to store no features.
+        frame_names: Optional name per frame (e.g. ISO dates).
+    """
+
+    def __init__(self, path: str, labels: Sequence[str], frame_count: int,
+                 feature_names: Optional[Sequence[str]] = None,
+                 frame_names: Optional[Sequence[str]] = None):
+        if frame_count <= 0 or len(labels) == 0:
+            raise ValueError("A .qsp file needs at least one frame and one point")
+        if frame_names is not None and len(frame_names) != frame_count:
+            raise ValueError("frame_names must have one entry per frame")
+
+        self.path = path
+        self.frame_count = int(frame_count)
+        self.point_count = len(labels)
+        self.feature_count = len(feature_names) if feature_names is not None else 0
+        self._written = np.zeros(self.frame_count, dtype=bool)
+
+        header = np.zeros(1, dtype=HEADER_DTYPE)[0]
+        header["magic"] = np.void(MAGIC)
+        header["version"] = VERSION
+        header["header_size"] = HEADER_SIZE
+        header["frame_count"] = self.frame_count
+        header["point_count"] = self.point_count
+        header["feature_count"] = self.feature_count
+
+        # Point blocks, each frame on its own aligned stride
+        offset = ALIGNMENT
+        layout = {}
+        for name, floats in (("positions", 3), ("values", 1), ("features", self.feature_count)):
+            stride = _align(self.point_count * floats * 4) if floats else 0
+            layout[name] = (offset, stride)
+            header[name + "_offset"] = offset if floats else 0
+            header[name + "_stride"] = stride
+            offset += stride * self.frame_count
+        self._layout = layout
+
+        tables = b""
+        for key, strings in (("labels_offset", labels),
+                             ("feature_names_offset", feature_names or []),
+                             ("frame_names_offset", frame_names or [])):
+            header[key] = offset + len(tables)
+            table = _string_table(strings)
+            tables += table + b"\0" * (_align(len(table), 8) - len(table))
+
+        self._file = open(path, "wb")
+        self._file.write(header.tobytes())
+        self._file.seek(offset)
+        self._file.write(tables)
+        self._file.truncate(offset + len(tables))
+
+    def write_frame(self, frame: int, positions: np.ndarray, values: np.ndarray,
+                    features: Optional[np.ndarray] = None):
+        """Write one frame: positions (N, 3), values (N,), features (N, F) if the file has them."""
+        if not 0 <= frame < self.frame_count:
+            raise IndexError(f"frame {frame} out of range")
+        n = self.point_count
+        blocks = [("positions", positions, (n, 3)), ("values", values, (n,))]
+        if self.feature_count:
+            if features is None:
+                raise ValueError("This file stores features: pass features=")
+            blocks.append(("features", features, (n, self.feature_count)))
+
+        for name, array, shape in blocks:
+            array = np.ascontiguousarray(array, dtype="<f4")
+            if array.shape != shape:
+                raise ValueError(f"{name} must have shape {shape}, got {array.shape}")
+            offset, stride = self._layout[name]
+            self._file.seek(offset + frame * stride)
+            self._file.write(array.tobytes())
+        self._written[frame] = True
+
+    def close(self):
+        if self._file is None:
+            return
+        # Frames never written are absent: NaN positions
+        missing = np.flatnonzero(~self._written)
+        if len(missing):
+            nan_positions = np.full((self.point_count, 3), np.nan, dtype="<f4").tobytes()
+            offset, stride = self._layout["positions"]
+            for frame in missing:
+                self._file.seek(offset + int(frame) * stride)
+                self._file.write(nan_positions)
+        self._file.close()
+        self._file = None
+
+    def __enter__(self):
+        return self
+
+    def __exit__(self, *exc):
+        self.close()
+        return False
+
+
+def write_qsp(path: str, positions: np.ndarray, values: np.ndarray, labels: Sequence[str],
+              features: Optional[np.ndarray] = None, feature_names: Optional[Sequence[str]] = None,
+              frame_names: Optional[Sequence[str]] = None):
+    """
+    Write a whole session at once.
+
+    Args:
+        positions: (T, N, 3) array, NaN rows for points absent from a frame.
+        values: (T, N) color values.
+        labels: N point labels.
+        features: Optional (T, N, F) feature values.
+        feature_names: F names, required with features.
+        frame_names: Optional T frame names.
+    """
+    positions = np.asarray(positions)
+    if features is not None and feature_names is None:
+        feature_names = [f"Feature {i}" for i in range(np.asarray(features).shape[2])]
+    with QspWriter(path, labels, positions.shape[0], feature_names, frame_names) as writer:
+        for t in range(positions.shape[0]):
+            writer.write_frame(t, positions[t], values[t], None if features is None else features[t])
+
+
+def read_qsp(path: str) -> Dict[str, Any]:
+    """
+    Map a .qsp file with NumPy.
+
+    Returns:
+        Dict with read-only memory-mapped arrays `positions` (T, N, 3),
+        `values` (T, N) and `features` (T, N, F) or None, plus the
+        `labels`, `feature_names` and `frame_names` lists.
+    """
+    if os.path.getsize(path) < HEADER_SIZE:
+        raise ValueError(f"{path}: too small for a .qsp header")
+    mm = np.memmap(path, dtype=np.uint8, mode="r")
+    header = np.frombuffer(mm, dtype=HEADER_DTYPE, count=1)[0]
+    if bytes(header["magic"]) != MAGIC:
+        raise ValueError(f"{path}: not a .qsp file")
+    if int(header["version"]) != VERSION:
+        raise ValueError(f"{path}: unsupported .qsp version {int(header['version'])}")
+
+    t = int(header["frame_count"])
+    n = int(header["point_count"])
+    f = int(header["feature_count"])
+    if t == 0 or n == 0:
+        raise ValueError(f"{path}: no frames or points")
+
+    def block(name: str, shape, item_strides):
+        offset = int(header[name + "_offset"])
+        stride = int(header[name + "_stride"])
+        # Every frame's block inside the file, which also rejects corrupt counts
+        item_bytes = 4 * int(np.prod(shape[1:], dtype=object))
+        if stride < item_bytes or offset + (t - 1) * stride + item_bytes > mm.size:
+            raise ValueError(f"{path}: {name} blocks are outside the file")
+        return np.ndarray(shape, dtype="<f4", buffer=mm, offset=offset, strides=(stride,) + item_strides)
+
+    buf = memoryview(mm)
+    return {
+        "positions": block("positions", (t, n, 3), (12, 4)),
+        "values": block("values", (t, n), (4,)),
+        "features": block("features", (t, n, f), (4 * f, 4)) if f else None,
+        "labels": _read_string_table(buf, int(header["labels_offset"])),
+        "feature_names": _read_string_table(buf, int(header["feature_names_offset"])),
+        "frame_names": _read_string_table(buf, int(header["frame_names_offset"])),
+    }
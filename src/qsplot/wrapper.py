@@ -52,12 +52,12 @@ class QsPlotWrapper:
         
         # 1. Coordinate Processing
         if method.lower() == 'pca':
-            # DataProcessor expects MatrixXd (double)
-            # We explicitly cast to float64 to match Eigen::MatrixXd
-            data_double = data.astype(np.float64)
+            # DataProcessor views float32/float64 arrays in place, any layout
+            if data.dtype not in (np.float32, np.float64):
+                data = data.astype(np.float64)
             
             print(f"[QsPlot] Computing PCA on {N} samples, {M} features -> {target_dims} dims...")
-            self.processor.load_data(data_double)
+            self.processor.load_data(data)
             
             # compute_pca returns a copy, likely double
             points_eigen = self.processor.compute_pca(target_dims)
@@ -186,3 +186,137 @@ class TestDataProcessorNormalizePositions:
         
         # Single point centered = all zeros
         np.testing.assert_array_equal(result, np.zeros((1, 3)))
+
+
+class TestDataProcessorNativeML:
+    """Test the engine-backed 'minibatch' clustering and 'knn' outlier methods."""
+
+    @pytest.fixture(autouse=True)
+    def engine(self):
+        return pytest.importorskip("qsplot.qsplot_engine")
+
+    @pytest.fixture
+    def processor(self):
+        return DataProcessor()
+
+    @pytest.fixture
+    def blobs(self):
+        rng = np.random.default_rng(0)
+        centers = np.array([[0.0, 0.0, 0.0], [20.0, 0.0, 0.0], [0.0, 20.0, 0.0]])
+        return np.concatenate([c + rng.normal(scale=0.5, size=(200, 3)) for c in centers])
+
+    def test_minibatch_label_shape(self, processor, blobs):
+        """Test one label in [0, n_clusters) per row."""
+        labels = np.asarray(processor.compute_clusters(blobs, n_clusters=3, method='minibatch'))
+
+        assert labels.shape == (len(blobs),)
+        assert labels.min() >= 0 and labels.max() < 3
+        # Every blob lands in a single cluster of its own
+        blob_labels = [np.unique(labels[i:i + 200]) for i in range(0, 600, 200)]
+        assert all(len(u) == 1 for u in blob_labels)
+        assert len({int(u[0]) for u in blob_labels}) == 3
+
+    def test_minibatch_warm_start_keeps_labels(self, processor, blobs):
+        """Test a slightly moved frame keeps its cluster numbers."""
+        first = np.asarray(processor.compute_clusters(blobs, n_clusters=3, method='minibatch'))
+        rng = np.random.default_rng(1)
+        moved = blobs + rng.normal(scale=0.05, size=blobs.shape)
+        second = np.asarray(processor.compute_clusters(moved, n_clusters=3, method='minibatch'))
+
+        np.testing.assert_array_equal(first, second)
+
+    def test_knn_score_range(self, processor, blobs):
+        """Test scores lie in [0, 1] with the isolated point scoring highest."""
+        X = np.vstack([blobs, [[100.0, 100.0, 100.0]]])
+        scores = np.asarray(processor.detect_outliers(X, method='knn'))
+
+        assert scores.shape == (len(X),)
+        assert scores.min() >= 0.0 and scores.max() <= 1.0
+        assert np.argmax(scores) == len(X) - 1
+
+    def test_knn_scores_of_identical_points(self, processor):
+        """Test identical points all score 0 instead of dividing by a zero range."""
+        scores = np.asarray(processor.detect_outliers(np.ones((50, 3)), method='knn'))
+
+        np.testing.assert_array_equal(scores, np.zeros(50))
+
+    def test_knn_identical_points_flag_nothing(self, processor):
+        """Test tied all-zero scores of identical rows flag no outlier."""
+        scores = np.asarray(processor.detect_outliers(np.ones((50, 3)), method='knn'))
+
+        assert not processor.flag_outliers(scores, contamination=0.05).any()
+
+
+class TestDataProcessorFlagOutliers:
+    """Test the outlier threshold shared with the engine's auto categories."""
+
+    def test_top_share_flagged(self):
+        """Test the lower-quantile threshold flags the top share."""
+        scores = np.linspace(0.0, 1.0, 10)
+        flags = DataProcessor.flag_outliers(scores, contamination=0.2)
+
+        np.testing.assert_array_equal(flags, scores >= scores[7])
+
+    def test_tied_scores_flag_nothing(self):
+        """Test scores tied at the threshold and minimum are not all flagged."""
+        assert not DataProcessor.flag_outliers(np.zeros(20), contamination=0.1).any()
+
+    def test_single_high_score_among_ties(self):
+        """Test one raised score among ties is the only outlier."""
+        scores = np.zeros(20)
+        scores[3] = 1.0
+        flags = DataProcessor.flag_outliers(scores, contamination=0.05)
+
+        np.testing.assert_array_equal(np.flatnonzero(flags), [3])
+
+    def test_zero_contamination(self):
+        """Test a zero contamination flags nothing."""
+        assert not DataProcessor.flag_outliers(np.linspace(0.0, 1.0, 10), contamination=0.0).any()
+
+
+class TestDataProcessorGlobalPCA:
+    """Test that the global PCA is the same correlation PCA with or without the engine."""
+
+    @pytest.fixture
+    def processor(self):
+        return DataProcessor()
+
+    @pytest.fixture
+    def mixed_units(self):
+        rng = np.random.default_rng(0)
+        base = rng.normal(size=(400, 5))
+        base[:, 2] += 0.8 * base[:, 0]
+        # Very different units: covariance PCA would be all column 4
+        return base * np.array([1.0, 2.0, 0.5, 3.0, 1000.0]) + np.array([0.0, 10.0, -5.0, 100.0, 1e4])
+
+    def test_standardized_fit_is_correlation_pca(self, processor, mixed_units):
+        """Test the fallback ratios and axes are those of the correlation matrix."""
+        info = processor.fit_global_pca(mixed_units, n_components=3, standardize=True)
+
+        corr = np.corrcoef(mixed_units, rowvar=False)
+        values, vectors = np.linalg.eigh(corr)
+        np.testing.assert_allclose(info['explained_variance_ratios'], values[::-1][:3] / np.trace(corr), atol=1e-10)
+        np.testing.assert_allclose(np.abs(info['pca'].components_), np.abs(vectors[:, ::-1][:, :3].T), atol=1e-8)
+
+    def test_standardized_fit_ignores_units(self, processor, mixed_units):
+        """Test rescaling a feature leaves the ratios and projections unchanged."""
+        rescaled = mixed_units * np.array([1.0, 1.0, 1.0, 1.0, 1e-3])
+        a = processor.fit_global_pca(mixed_units, n_components=3, standardize=True)
+        b = processor.fit_global_pca(rescaled, n_components=3, standardize=True)
+
+        np.testing.assert_allclose(a['explained_variance_ratios'], b['explained_variance_ratios'], atol=1e-10)
+        np.testing.assert_allclose(a['pca'].transform(mixed_units), b['pca'].transform(rescaled), atol=1e-8)
+
+    def test_incremental_matches_fallback(self, processor, mixed_units):
+        """Test the engine's frame-by-frame fit and the sklearn fallback agree."""
+        pytest.importorskip("qsplot.qsplot_engine")
+        frames = np.array_split(mixed_units, 4)
+        native = processor.fit_global_pca_incremental(frames, mixed_units.shape[1], n_components=3)
+        fallback = processor.fit_global_pca(mixed_units, n_components=3, standardize=True)
+
+        np.testing.assert_allclose(native['explained_variance_ratios'], fallback['explained_variance_ratios'],
+                                   atol=1e-8)
+        np.testing.assert_allclose(native['pca'].components_, fallback['pca'].components_, atol=1e-6)
+        np.testing.assert_allclose(native['pca'].transform(mixed_units), fallback['pca'].transform(mixed_units),
+                                   atol=1e-6)
+        assert native['top_features_per_axis'] == fallback['top_features_per_axis']
@@ -0,0 +1,167 @@
+"""
+Tests for the .qsp session format - writer, reader and Visualizer round trips.
+"""
+
+import numpy as np
+import pandas as pd
+import pytest
+from unittest.mock import patch, MagicMock
+
+from qsplot.qsp import ALIGNMENT, HEADER_DTYPE, QspWriter, read_qsp, write_qsp
+
+
+def _with_header_field(source, path, field, value):
+    """Copy of the .qsp file `source` at `path` with one header field overwritten."""
+    data = bytearray(source.read_bytes())
+    header = np.frombuffer(data, dtype=HEADER_DTYPE, count=1).copy()
+    header[field] = value
+    data[:HEADER_DTYPE.itemsize] = header.tobytes()
+    path.write_bytes(bytes(data))
+    return path
+
+
+class TestQspFormat:
+    """Test the on-disk layout."""
+
+    @pytest.fixture
+    def session(self):
+        rng = np.random.default_rng(3)
+        positions = rng.normal(size=(3, 5, 3)).astype(np.float32)
+        positions[1, 2] = np.nan  # Point 2 absent from frame 1
+        return {
+            "positions": positions,
+            "values": rng.uniform(size=(3, 5)).astype(np.float32),
+            "features": rng.normal(size=(3, 5, 2)).astype(np.float32),
+            "labels": ["AAPL", "MSFT", "GOOG", "AMZN", "NVDA"],
+            "feature_names": ["Beta", "Momentum"],
+            "frame_names": ["2024-01-31", "2024-02-29", "2024-03-31"],
+        }
+
+    def test_round_trip(self, tmp_path, session):
+        """Everything written is read back unchanged."""
+        path = str(tmp_path / "session.qsp")
+        write_qsp(path, session["positions"], session["values"], session["labels"],
+                  features=session["features"], feature_names=session["feature_names"],
+                  frame_names=session["frame_names"])
+
+        data = read_qsp(path)
+        np.testing.assert_array_equal(data["positions"], session["positions"])
+        np.testing.assert_array_equal(data["values"], session["values"])
+        np.testing.assert_array_equal(data["features"], session["features"])
+        assert data["labels"] == session["labels"]
+        assert data["feature_names"] == session["feature_names"]
+        assert data["frame_names"] == session["frame_names"]
+
+    def test_frames_are_aligned_for_upload(self, tmp_path, session):
+        """Every frame block starts on an ALIGNMENT boundary."""
+        path = str(tmp_path / "session.qsp")
+        write_qsp(path, session["positions"], session["values"], session["labels"])
+
+        header = np.fromfile(path, dtype=HEADER_DTYPE, count=1)[0]
+        for name in ("positions", "values"):
+            assert int(header[name + "_offset"]) % ALIGNMENT == 0
+            assert int(header[name + "_stride"]) % ALIGNMENT == 0
+        assert int(header["feature_count"]) == 0
+        assert read_qsp(path)["features"] is None
+
+    def test_unwritten_frames_are_absent(self, tmp_path, session):
+        """Frames the writer never got have NaN positions."""
+        path = str(tmp_path / "partial.qsp")
+        with QspWriter(path, session["labels"], 3) as writer:
+            writer.write_frame(1, session["positions"][1], session["values"][1])
+
+        data = read_qsp(path)
+        assert np.isnan(data["positions"][0]).all()
+        assert np.isnan(data["positions"][2]).all()
+        np.testing.assert_array_equal(data["positions"][1], session["positions"][1])
+
+    def test_write_frame_checks_shapes(self, tmp_path, session):
+        with QspWriter(str(tmp_path / "bad.qsp"), session["labels"], 1, feature_names=["Beta"]) as writer:
+            with pytest.raises(ValueError):
+                writer.write_frame(0, session["positions"][0][:, :2], session["values"][0])
+            with pytest.raises(ValueError):
+                writer.write_frame(0, session["positions"][0], session["values"][0])  # Missing features
+            with pytest.raises(IndexError):
+                writer.write_frame(1, session["positions"][0], session["values"][0])
+
+    def test_rejects_other_files(self, tmp_path, session):
+        path = tmp_path / "not_a_session.qsp"
+        path.write_bytes(b"\0" * 256)
+        with pytest.raises(ValueError):
+            read_qsp(str(path))
+
+        # Corrupt counts in an otherwise valid header: rejected, not a crash
+        valid = tmp_path / "valid.qsp"
+        write_qsp(str(valid), session["positions"], session["values"], session["labels"],
+                  features=session["features"], feature_names=session["feature_names"])
+        for field, count in [("feature_count", 2**64 - 1), ("feature_count", 2**62),
+                             ("point_count", 2**64 - 1), ("frame_count", 2**40)]:
+            corrupt = _with_header_field(valid, tmp_path / f"corrupt_{field}.qsp", field, count)
+            with pytest.raises(ValueError):
+                read_qsp(str(corrupt))
+
+    def test_engine_rejects_corrupt_counts(self, tmp_path, session):
+        engine = pytest.importorskip("qsplot.qsplot_engine")
+        valid = tmp_path / "valid.qsp"
+        write_qsp(str(valid), session["positions"], session["values"], session["labels"],
+                  features=session["features"], feature_names=session["feature_names"])
+        for field, count in [("feature_count", 2**64 - 1), ("feature_count", 2**62), ("point_count", 2**64 - 1)]:
+            corrupt = _with_header_field(valid, tmp_path / f"corrupt_{field}.qsp", field, count)
+            with pytest.raises(ValueError):
+                engine.QspFile.open(str(corrupt))
+
+
+class TestVisualizerQsp:
+    """Test saving and opening sessions from the Visualizer."""
+
+    @pytest.fixture
+    def df_three_dates(self):
+        """Tickers entering and leaving the universe across three dates."""
+        universe = [
+            ("2024-01-31", ["MSFT", "GOOG"]),
+            ("2024-02-29", ["AAPL", "MSFT", "GOOG"]),
+            ("2024-03-31", ["GOOG", "AMZN", "MSFT"]),
+        ]
+        data = []
+        for date, tickers in universe:
+            for i, ticker in enumerate(tickers):
+                data.append({"Date": date, "Ticker": ticker,
+                             "F1": float(i), "F2": float(2 * i + 1), "F3": float(i * i)})
+        return pd.DataFrame(data)
+
+    @patch('qsplot.core.qsplot_engine', None)
+    def test_save_qsp_writes_every_frame_on_the_universe(self, tmp_path, df_three_dates):
+        from qsplot.core import Visualizer
+
+        vis = Visualizer()
+        vis.load_data(df=df_three_dates, date_col="Date", ticker_col="Ticker",
+                      feature_cols=["F1", "F2", "F3"])
+
+        path = str(tmp_path / "session.qsp")
+        assert vis.save_qsp(path) == 3
+
+        data = read_qsp(path)
+        assert data["labels"] == ["MSFT", "GOOG", "AAPL", "AMZN"]
+        assert data["feature_names"] == ["F1", "F2", "F3"]
+        assert data["frame_names"] == ["2024-01-31", "2024-02-29", "2024-03-31"]
+        assert data["positions"].shape == (3, 4, 3)
+
+        # AAPL and AMZN are absent in January, AAPL again in March
+        assert np.isnan(data["positions"][0, 2:]).all()
+        assert not np.isnan(data["positions"][0, :2]).any()
+        assert np.isnan(data["positions"][2, 2]).all()
+        # Raw features in universe order: GOOG is the first ticker in March
+        np.testing.assert_array_equal(data["features"][2, 1], [0.0, 1.0, 0.0])
+
+    @patch('qsplot.core.qsplot_engine')
+    def test_open_qsp_hands_the_file_to_the_engine(self, mock_engine):
+        mock_engine.Renderer = MagicMock
+
+        from qsplot.core import Visualizer
+
+        vis = Visualizer()
+        vis.open_qsp("session.qsp", window=8, fps=4.0)
+
+        mock_engine.QspFile.open.assert_called_once_with("session.qsp")
+        vis.engine.load_dataset.assert_called_once_with(mock_engine.QspFile.open.return_value, 8)
+        vis.engine.set_timeline_playback.assert_called_once_with(True, 4.0, True)
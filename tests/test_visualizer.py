@@ -248,3 +248,331 @@ class TestVisualizerTickerAlignment:
         assert "GOOG" in common
         assert "AAPL" not in common
         assert "AMZN" not in common
+
+
+class TestVisualizerAnimate:
+    """Test the animate() frame pipeline."""
+
+    @pytest.fixture
+    def df_three_dates(self):
+        """Three dates with a changing ticker universe."""
+        universe = [
+            ("2024-01-31", ["AAPL", "MSFT", "GOOG"]),
+            ("2024-02-29", ["MSFT", "GOOG", "AMZN"]),
+            ("2024-03-31", ["GOOG", "AMZN", "MSFT"]),
+        ]
+        data = []
+        for date, tickers in universe:
+            for i, ticker in enumerate(tickers):
+                data.append({"Date": date, "Ticker": ticker,
+                             "F1": float(i), "F2": float(2 * i + 1), "F3": float(i * i)})
+        return pd.DataFrame(data)
+
+    @patch('qsplot.core.qsplot_engine')
+    def test_animate_prepares_each_frame_once(self, mock_engine, df_three_dates):
+        """Each frame is prepared once and reused as the next pair's current frame."""
+        mock_engine.Renderer = MagicMock
+        del mock_engine.FrameAligner  # NumPy alignment fallback
+
+        from qsplot.core import Visualizer
+
+        vis = Visualizer()
+        vis.engine.is_running.return_value = False  # Skip the per-frame wait
+        vis.engine.has_color_feature_changed.return_value = False
+        vis.load_data(
+            df=df_three_dates,
+            date_col="Date",
+            ticker_col="Ticker",
+            feature_cols=["F1", "F2", "F3"]
+        )
+
+        with patch.object(vis, 'prepare_frame', wraps=vis.prepare_frame) as prepare:
+            vis.animate("2024-01-01", "2024-12-31")
+
+        assert prepare.call_count == 3
+
+        # Jan -> Feb shares MSFT and GOOG, Feb -> Mar shares all three
+        sent_curr = [c.args[0].shape[0] for c in vis.engine.set_points_raw.call_args_list]
+        sent_next = [c.args[0].shape[0] for c in vis.engine.set_target_points.call_args_list]
+        assert sent_curr == [2, 3]
+        assert sent_next == [2, 3]
+
+    @patch('qsplot.core.qsplot_engine')
+    def test_animate_metadata_follows_the_uploaded_points(self, mock_engine, df_three_dates):
+        """Labels and feature rows are sent in the aligned (sorted ticker) order, not frame row order."""
+        mock_engine.Renderer = MagicMock
+        del mock_engine.FrameAligner  # NumPy alignment fallback
+
+        from qsplot.core import Visualizer
+
+        vis = Visualizer()
+        vis.engine.is_running.return_value = False
+        vis.engine.has_color_feature_changed.return_value = False
+        vis.load_data(
+            df=df_three_dates,
+            date_col="Date",
+            ticker_col="Ticker",
+            feature_cols=["F1", "F2", "F3"]
+        )
+        vis.processor.compute_clusters = MagicMock(return_value=np.arange(len(df_three_dates)) % 3)
+        vis.compute_clusters(n_clusters=3)
+
+        vis.animate("2024-01-01", "2024-12-31")
+
+        # Jan -> Feb draws GOOG, MSFT; Feb -> Mar draws AMZN, GOOG, MSFT
+        labels = [c.args[0] for c in vis.engine.set_categories.call_args_list]
+        np.testing.assert_array_equal(labels[0], [2, 1])     # January rows: AAPL, MSFT, GOOG
+        np.testing.assert_array_equal(labels[1], [2, 1, 0])  # February rows: MSFT, GOOG, AMZN
+        features = mock_engine.FeatureStore.call_args.args[0]
+        np.testing.assert_array_equal(features[:, 0], [2.0, 1.0, 0.0])
+
+    @patch('qsplot.core.qsplot_engine')
+    def test_play_uploads_keyframes_over_ticker_universe(self, mock_engine, df_three_dates):
+        """Every keyframe covers all tickers in the range, NaN where one is absent."""
+        mock_engine.Renderer = MagicMock
+
+        from qsplot.core import Visualizer
+
+        vis = Visualizer()
+        vis.engine.is_running.side_effect = [True] * 5 + [False]
+        vis.engine.has_color_feature_changed.return_value = False
+        vis.engine.get_timeline_position.return_value = 0.0
+        vis.load_data(
+            df=df_three_dates,
+            date_col="Date",
+            ticker_col="Ticker",
+            feature_cols=["F1", "F2", "F3"]
+        )
+
+        vis.play("2024-01-01", "2024-12-31", window=2)
+
+        vis.engine.set_timeline.assert_called_once_with(3, 4, 2)
+        tickers = vis.engine.set_tickers.call_args.args[0]
+        assert tickers == ["AAPL", "MSFT", "GOOG", "AMZN"]
+
+        # Frames 0 and 1 fill the window, then the prefetcher idles
+        keyframes = vis.engine.set_keyframe.call_args_list
+        assert [c.args[0] for c in keyframes] == [0, 1]
+        for c in keyframes:
+            assert c.args[1].shape == (4, 3)
+            assert c.args[2].shape == (4,)
+
+        # AMZN is absent in January, AAPL from February on
+        assert np.isnan(keyframes[0].args[1][3]).all()
+        assert np.isnan(keyframes[1].args[1][0]).all()
+        assert not np.isnan(keyframes[1].args[1][1:]).any()
+
+        # Tooltip features of frame 0, one row per point of the universe
+        features = mock_engine.FeatureStore.call_args.args[0]
+        assert features.shape == (4, 3)
+        np.testing.assert_array_equal(features[:3, 0], [0.0, 1.0, 2.0])
+        assert np.isnan(features[3]).all()
+
+    @patch('qsplot.core.qsplot_engine')
+    def test_export_frames_queues_one_frame_per_date(self, mock_engine, df_three_dates):
+        """Frames are queued without waiting, then waited for once."""
+        mock_engine.Renderer = MagicMock
+
+        from qsplot.core import Visualizer
+
+        vis = Visualizer()
+        vis.engine.wait_for_frames.return_value = True
+        vis.load_data(
+            df=df_three_dates,
+            date_col="Date",
+            ticker_col="Ticker",
+            feature_cols=["F1", "F2", "F3"]
+        )
+
+        queued = vis.export_frames("out/{frame:03d}_{date}.png", start_date="2024-02-01",
+                                   camera=(0.5, 0.2, 30.0))
+
+        assert queued == 2
+        calls = vis.engine.render_frames.call_args_list
+        assert [c.args[0] for c in calls] == [["out/000_2024-02-29.png"], ["out/001_2024-03-31.png"]]
+        for c in calls:
+            assert c.kwargs["cameras"] == [(0.5, 0.2, 30.0)]
+            assert c.kwargs["wait"] is False
+        assert vis.engine.set_points_raw.call_count == 2
+        vis.engine.wait_for_frames.assert_called_once_with(-1.0)
+
+    @patch('qsplot.core.qsplot_engine')
+    def test_metadata_shares_feature_matrix_without_copy(self, mock_engine, df_three_dates):
+        """The feature matrix goes to a FeatureStore in place; stats are left to the engine."""
+        mock_engine.Renderer = MagicMock
+
+        from qsplot.core import Visualizer
+
+        vis = Visualizer()
+        vis.load_data(
+            df=df_three_dates,
+            date_col="Date",
+            ticker_col="Ticker",
+            feature_cols=["F1", "F2", "F3"]
+        )
+
+        data = vis.prepare_frame("2024-03-31")
+        vis._send_metadata_to_engine(data)
+
+        mock_engine.FeatureStore.assert_called_once()
+        assert mock_engine.FeatureStore.call_args.args[0] is data["all_feature_values"]
+        vis.engine.set_feature_store.assert_called_once_with(mock_engine.FeatureStore.return_value)
+        vis.engine.set_stats.assert_not_called()
+        vis.engine.set_all_feature_values.assert_not_called()
+
+    @patch('qsplot.core.qsplot_engine')
+    def test_metadata_falls_back_to_copied_features(self, mock_engine, df_three_dates):
+        """Engines without a FeatureStore get NumPy stats and a float32 copy."""
+        mock_engine.Renderer = MagicMock
+        del mock_engine.FeatureStore
+
+        from qsplot.core import Visualizer
+
+        vis = Visualizer()
+        vis.load_data(
+            df=df_three_dates,
+            date_col="Date",
+            ticker_col="Ticker",
+            feature_cols=["F1", "F2", "F3"]
+        )
+
+        vis._send_metadata_to_engine(vis.prepare_frame("2024-03-31"))
+
+        stats = vis.engine.set_stats.call_args.args[0]
+        assert [s["name"] for s in stats] == ["F1", "F2", "F3"]
+        assert stats[0]["count"] == 3
+        values = vis.engine.set_all_feature_values.call_args.args[0]
+        assert values.dtype == np.float32 and values.shape == (3, 3)
+
+    @patch('qsplot.core.qsplot_engine')
+    def test_cluster_labels_follow_the_frame_points(self, mock_engine, df_three_dates):
+        """compute_clusters labels reach the engine as uint8, in the frame's point order."""
+        mock_engine.Renderer = MagicMock
+
+        from qsplot.core import Visualizer
+
+        vis = Visualizer()
+        vis.load_data(
+            df=df_three_dates,
+            date_col="Date",
+            ticker_col="Ticker",
+            feature_cols=["F1", "F2", "F3"]
+        )
+        vis.processor.compute_clusters = MagicMock(return_value=np.arange(len(df_three_dates)) % 3)
+        vis.compute_clusters(n_clusters=3)
+
+        vis._send_metadata_to_engine(vis.prepare_frame("2024-02-29"))
+
+        labels, names = vis.engine.set_categories.call_args.args
+        assert labels.dtype == np.uint8
+        np.testing.assert_array_equal(labels, [0, 1, 2])  # Rows 3-5 of the frame
+        assert names == ["Cluster 0", "Cluster 1", "Cluster 2"]
+
+    @patch('qsplot.core.qsplot_engine')
+    def test_compare_draws_one_viewport_per_group(self, mock_engine, df_three_dates):
+        """compare() uploads the snapshot once and gives each group its point indices."""
+        mock_engine.Renderer = MagicMock
+
+        from qsplot.core import Visualizer
+
+        df_three_dates["Sector"] = ["Tech", "Retail", "Tech"] * 3
+        vis = Visualizer()
+        vis.load_data(
+            df=df_three_dates,
+            date_col="Date",
+            ticker_col="Ticker",
+            feature_cols=["F1", "F2", "F3"]
+        )
+        vis.compare("Sector", date="2024-02-29", block=False)
+
+        vis.engine.set_viewport_count.assert_called_once_with(2)
+        subsets = [c.args for c in vis.engine.set_viewport_subset.call_args_list]
+        assert [viewport for viewport, _ in subsets] == [0, 1]
+        assert all(indices.dtype == np.uint32 for _, indices in subsets)
+        np.testing.assert_array_equal(subsets[0][1], [0, 2])
+        np.testing.assert_array_equal(subsets[1][1], [1])
+        vis.engine.set_viewport_label.assert_any_call(1, "Retail")
+        vis.engine.set_viewports_linked.assert_called_once_with(True)
+        vis.engine.set_points_raw.assert_called_once()
+
+    @patch('qsplot.core.qsplot_engine')
+    def test_filter_sends_feature_column_ranges(self, mock_engine, df_three_dates):
+        """filter() maps feature names to FeatureStore columns; None is an open bound."""
+        mock_engine.Renderer = MagicMock
+
+        from qsplot.core import Visualizer
+
+        vis = Visualizer()
+        vis.load_data(
+            df=df_three_dates,
+            date_col="Date",
+            ticker_col="Ticker",
+            feature_cols=["F1", "F2", "F3"]
+        )
+        vis.filter({"F2": (1, 3), "F3": (None, 4.0), "Unknown": (0, 1)}, select=True)
+
+        vis.engine.set_range_filters.assert_called_once_with([(1, 1.0, 3.0), (2, -np.inf, 4.0)])
+        vis.engine.select_filtered.assert_called_once()
+
+        vis.filter()
+        vis.engine.set_range_filters.assert_called_with([])
+
+    @patch('qsplot.core.qsplot_engine')
+    def test_spatial_queries_forward_to_engine(self, mock_engine):
+        """nearest() and within() hand plain ints/floats to the engine's index queries."""
+        mock_engine.Renderer = MagicMock
+
+        from qsplot.core import Visualizer
+
+        vis = Visualizer()
+        vis.engine.query_knn.return_value = [4, 2]
+        vis.engine.query_radius.return_value = [1]
+
+        assert vis.nearest(np.int64(3), k=2) == [4, 2]
+        vis.engine.query_knn.assert_called_once_with(3, 2)
+        assert vis.within(np.array([0.0, 1.0, 2.0]), 0.5) == [1]
+        vis.engine.query_radius.assert_called_once_with((0.0, 1.0, 2.0), 0.5)
+
+    @patch('qsplot.core.qsplot_engine')
+    def test_auto_categories_replace_python_labels(self, mock_engine, df_three_dates):
+        """With native categories on, frames no longer carry compute_clusters() labels."""
+        mock_engine.Renderer = MagicMock
+
+        from qsplot.core import Visualizer
+
+        vis = Visualizer()
+        vis.load_data(
+            df=df_three_dates,
+            date_col="Date",
+            ticker_col="Ticker",
+            feature_cols=["F1", "F2", "F3"]
+        )
+        vis.processor.compute_clusters = MagicMock(return_value=np.arange(len(df_three_dates)) % 3)
+        vis.compute_clusters(n_clusters=3)
+
+        vis.auto_categories('clusters', n_clusters=4)
+        vis.engine.set_auto_categories.assert_called_once_with('clusters', 4, 0.05, 10)
+        vis._send_metadata_to_engine(vis.prepare_frame("2024-02-29"))
+        vis.engine.set_categories.assert_not_called()
+
+        vis.auto_categories('off')
+        vis._send_metadata_to_engine(vis.prepare_frame("2024-02-29"))
+        vis.engine.set_categories.assert_called_once()
+
+    @patch('qsplot.core.qsplot_engine')
+    def test_recording_forwards_to_engine(self, mock_engine):
+        """record(), stop_recording() and replay() drive the engine's session log."""
+        mock_engine.Renderer = MagicMock
+
+        from qsplot.core import Visualizer
+
+        vis = Visualizer()
+        vis.engine.get_recording_stats.return_value = {'records': 7}
+        vis.engine.replay.return_value = 7
+
+        assert vis.record("session.qsr")
+        vis.engine.start_recording.assert_called_once_with("session.qsr", False)
+        assert vis.stop_recording() == {'records': 7}
+        vis.engine.stop_recording.assert_called_once()
+        assert vis.replay("session.qsr", speed=0) == 7
+        vis.engine.replay.assert_called_once_with("session.qsr", 0.0)